@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef BEDINDEX_H_
+#define BEDINDEX_H_
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * A flat index of BED intervals. Intervals are collected per sequence name and,
+ * once bed_finalizeIndex() has been called, held as sorted arrays of merged,
+ * non-overlapping, half open [start, end) intervals. Lookups do no allocation.
+ */
+typedef struct bedIndex bedIndex_t;
+typedef struct bedIntervals bedIntervals_t;
+typedef struct bedCursor {
+  // a position along one sequence's intervals for monotonic walks, see bed_cursor_contains().
+  // intended to live on the stack, set up with bed_cursor_init().
+  const bedIntervals_t *intervals;
+  uint64_t i;
+} bedCursor_t;
+
+// creators, destroyers
+bedIndex_t* bed_newIndex(void);
+void bed_destroyIndex(bedIndex_t *bi);
+// building, bed_finalizeIndex() must be called before any lookups
+void bed_addInterval(bedIndex_t *bi, const char *name, uint64_t start, uint64_t end);
+void bed_readFile(bedIndex_t *bi, const char *filename);
+void bed_readFiles(bedIndex_t *bi, const char *commaSepFiles);
+void bed_finalizeIndex(bedIndex_t *bi);
+// getters
+uint64_t bed_getNumberOfSequences(bedIndex_t *bi);
+bedIntervals_t* bed_getIntervalsByIndex(bedIndex_t *bi, uint64_t i);
+bedIntervals_t* bed_getIntervals(bedIndex_t *bi, const char *name);
+char* bed_intervals_getName(const bedIntervals_t *bis);
+uint64_t bed_intervals_getNumberOfIntervals(const bedIntervals_t *bis);
+uint64_t bed_intervals_getStart(const bedIntervals_t *bis, uint64_t i);
+uint64_t bed_intervals_getEnd(const bedIntervals_t *bis, uint64_t i);
+uint64_t bed_intervals_getTotalLength(const bedIntervals_t *bis);
+// lookups
+bool bed_intervals_contains(const bedIntervals_t *bis, uint64_t pos);
+bool bed_contains(bedIndex_t *bi, const char *name, uint64_t pos);
+void bed_cursor_init(bedCursor_t *bc, const bedIntervals_t *bis);
+bool bed_cursor_contains(bedCursor_t *bc, uint64_t pos);
+
+#endif // BEDINDEX_H_
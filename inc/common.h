@@ -47,5 +47,6 @@ int minint(int a, int b);
 char* de_strtok(char **s, char t);
 unsigned countChar(char *s, const char c);
 char** extractSubStrings(char *nameList, unsigned n, const char delineator);
+uint64_t fileFingerprint(const char *filename, uint64_t size);
 
 #endif // COMMON_H_
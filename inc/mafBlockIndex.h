@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MAFBLOCKINDEX_H_
+#define MAFBLOCKINDEX_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include "sharedMaf.h"
+#include "bedIndex.h"
+
+/*
+ * A per-sequence index of the blocks of a maf. For every block the byte offset at which it
+ * starts is kept and, for every sequence, the positive strand interval covered by each of its
+ * rows, so that the blocks overlapping a set of regions may be read without reading the rest
+ * of the file. An index may be saved beside its maf, FILE.maf.mbi, and is only reloaded while
+ * the size and modification time of the maf are unchanged. Read only once built.
+ */
+typedef struct mafBlockIndex mafBlockIndex_t;
+
+// creators, destroyers
+mafBlockIndex_t* mafBlockIndex_build(const char *mafFilename);
+mafBlockIndex_t* mafBlockIndex_read(const char *indexFilename, const char *mafFilename);
+bool mafBlockIndex_write(mafBlockIndex_t *mbi, const char *indexFilename);
+mafBlockIndex_t* mafBlockIndex_load(const char *mafFilename);
+void mafBlockIndex_destroy(mafBlockIndex_t *mbi);
+// getters
+uint64_t mafBlockIndex_getNumberOfBlocks(mafBlockIndex_t *mbi);
+uint64_t mafBlockIndex_getNumberOfSequences(mafBlockIndex_t *mbi);
+char* mafBlockIndex_getSequenceName(mafBlockIndex_t *mbi, uint64_t i);
+uint64_t mafBlockIndex_getSourceLength(mafBlockIndex_t *mbi, uint64_t i);
+// lookups
+uint64_t* mafBlockIndex_findBlocks(mafBlockIndex_t *mbi, bedIndex_t *regions, uint64_t slop,
+                                   uint64_t *numBlocks);
+mafBlock_t* mafBlockIndex_readBlock(mafBlockIndex_t *mbi, mafFileApi_t *mfa, uint64_t block);
+
+#endif // MAFBLOCKINDEX_H_
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MAFPARTITION_H_
+#define MAFPARTITION_H_
+#include <stdbool.h>
+#include <stdint.h>
+#include "sharedMaf.h"
+
+/*
+ * The blocks of a maf, read once and spooled to an unlinked temporary file, grouped into parts
+ * that can each be worked on as though they were the only blocks in the maf. Each sequence
+ * line a block is keyed by, see mafPartition_isKey_t, puts the block in the same part as every
+ * other block keyed by that sequence, so a block keyed by several sequences joins their parts.
+ * Blocks with no key are dropped. Parts are numbered in order of first appearance and keep
+ * their blocks in file order. Read only once built, blocks may be read back from any thread.
+ */
+typedef struct mafPartition mafPartition_t;
+// whether ml, a sequence line of mb, is one of the keys of mb
+typedef bool (*mafPartition_isKey_t)(mafBlock_t *mb, mafLine_t *ml, void *arg);
+// the work on part p, built by any thread, then reported in part order and destroyed
+typedef void* (*mafPartition_build_t)(mafPartition_t *mp, uint64_t p, void *arg);
+typedef void (*mafPartition_report_t)(void *built, void *arg);
+typedef void (*mafPartition_destroy_t)(void *built, void *arg);
+
+// creators, destroyers
+mafPartition_t* mafPartition_build(mafFileApi_t *mfa, const char *tempDir, const char *prefix,
+                                   mafPartition_isKey_t isKey, void *arg);
+void mafPartition_destroy(mafPartition_t *mp);
+// getters
+uint64_t mafPartition_getNumberOfBlocks(mafPartition_t *mp);
+uint64_t mafPartition_getNumberOfParts(mafPartition_t *mp);
+uint64_t mafPartition_getNumberOfPartBlocks(mafPartition_t *mp, uint64_t p);
+uint64_t mafPartition_getBlockIndex(mafPartition_t *mp, uint64_t p, uint64_t i);
+char* mafPartition_getPartName(mafPartition_t *mp, uint64_t p);
+// reading
+mafBlock_t* mafPartition_readBlock(mafPartition_t *mp, uint64_t p, uint64_t i);
+void mafPartition_buildInOrder(mafPartition_t *mp, uint64_t numThreads, mafPartition_build_t build,
+                               mafPartition_report_t report, mafPartition_destroy_t destroy, void *arg);
+
+#endif // MAFPARTITION_H_
@@ -57,6 +57,8 @@ uint64_t maf_mafFileApi_getLineNumber(mafFileApi_t *mfa);
 // getters
 char* maf_mafFileApi_getFilename(mafFileApi_t *mfa);
 uint64_t maf_mafFileApi_getLineNumber(mafFileApi_t *mfa);
+int64_t maf_mafFileApi_tell(mafFileApi_t *mfa);
+void maf_mafFileApi_seek(mafFileApi_t *mfa, int64_t offset, uint64_t lineNumber);
 mafLine_t* maf_mafBlock_getHeadLine(mafBlock_t *mb);
 mafLine_t* maf_mafBlock_getTailLine(mafBlock_t *mb);
 uint64_t maf_mafBlock_getLineNumber(mafBlock_t *mb);
@@ -27,6 +27,9 @@
 #include "CuTest.h"
 #include "test.common.h"
 #include "test.sharedMaf.h"
+#include "test.bedIndex.h"
+#include "test.mafBlockIndex.h"
+#include "test.mafPartition.h"
 
 CuSuite* mafShared_TestSuite(void);
 
@@ -35,8 +38,14 @@ int include_RunAllTests(void) {
   CuSuite *suite = CuSuiteNew();
   CuSuite *common_s = common_TestSuite();
   CuSuite *maf_s = mafShared_TestSuite();
+  CuSuite *bed_s = bedIndex_TestSuite();
+  CuSuite *mbi_s = mafBlockIndex_TestSuite();
+  CuSuite *mp_s = mafPartition_TestSuite();
   CuSuiteAddSuite(suite, common_s);
   CuSuiteAddSuite(suite, maf_s);
+  CuSuiteAddSuite(suite, bed_s);
+  CuSuiteAddSuite(suite, mbi_s);
+  CuSuiteAddSuite(suite, mp_s);
   CuSuiteRun(suite);
   CuSuiteSummary(suite, output);
   CuSuiteDetails(suite, output);
@@ -45,6 +54,9 @@ int include_RunAllTests(void) {
   int status = (suite->failCount > 0);
   free(common_s);
   free(maf_s);
+  free(bed_s);
+  free(mbi_s);
+  free(mp_s);
   CuSuiteDelete(suite);
   return status;
 }
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "bedIndex.h"
+
+typedef struct bedInterval {
+  uint64_t start;
+  uint64_t end;
+} bedInterval_t;
+struct bedIntervals {
+  char *name;
+  uint64_t numIntervals;
+  uint64_t capacity;
+  bedInterval_t *pending; // intervals as read, free'd by bed_finalizeIndex()
+  uint64_t *starts; // sorted, merged starts, built by bed_finalizeIndex()
+  uint64_t *ends; // ends (exclusive) matching starts
+};
+struct bedIndex {
+  uint64_t numSequences;
+  uint64_t capacity;
+  bedIntervals_t **sequences; // kept sorted by name
+  bedIntervals_t *last; // most recently added to, bed files are usually grouped by name
+  bool isFinalized;
+};
+
+bedIndex_t* bed_newIndex(void) {
+  bedIndex_t *bi = (bedIndex_t*) de_malloc(sizeof(*bi));
+  bi->numSequences = 0;
+  bi->capacity = 0;
+  bi->sequences = NULL;
+  bi->last = NULL;
+  bi->isFinalized = false;
+  return bi;
+}
+static void bed_destroyIntervals(bedIntervals_t *bis) {
+  free(bis->name);
+  free(bis->pending);
+  free(bis->starts);
+  free(bis->ends);
+  free(bis);
+}
+void bed_destroyIndex(bedIndex_t *bi) {
+  if (bi == NULL) {
+    return;
+  }
+  for (uint64_t i = 0; i < bi->numSequences; ++i) {
+    bed_destroyIntervals(bi->sequences[i]);
+  }
+  free(bi->sequences);
+  free(bi);
+}
+static uint64_t bed_searchName(bedIndex_t *bi, const char *name, bool *found) {
+  // binary search for name in the sorted sequences. returns the index of name if present,
+  // otherwise the index at which name would be inserted.
+  uint64_t lo = 0, hi = bi->numSequences;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    int c = strcmp(bi->sequences[mid]->name, name);
+    if (c == 0) {
+      *found = true;
+      return mid;
+    } else if (c < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *found = false;
+  return lo;
+}
+static bedIntervals_t* bed_getOrCreateIntervals(bedIndex_t *bi, const char *name) {
+  if ((bi->last != NULL) && (strcmp(bi->last->name, name) == 0)) {
+    return bi->last;
+  }
+  bool found;
+  uint64_t i = bed_searchName(bi, name, &found);
+  if (!found) {
+    if (bi->numSequences == bi->capacity) {
+      bi->capacity = (bi->capacity == 0) ? 16 : 2 * bi->capacity;
+      bi->sequences = (bedIntervals_t**) realloc(bi->sequences, sizeof(*(bi->sequences)) * bi->capacity);
+      if (bi->sequences == NULL) {
+        fprintf(stderr, "Error, realloc failed in bed_getOrCreateIntervals()\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    memmove(bi->sequences + i + 1, bi->sequences + i, sizeof(*(bi->sequences)) * (bi->numSequences - i));
+    bedIntervals_t *bis = (bedIntervals_t*) de_malloc(sizeof(*bis));
+    bis->name = de_strdup(name);
+    bis->numIntervals = 0;
+    bis->capacity = 0;
+    bis->pending = NULL;
+    bis->starts = NULL;
+    bis->ends = NULL;
+    bi->sequences[i] = bis;
+    ++(bi->numSequences);
+  }
+  bi->last = bi->sequences[i];
+  return bi->last;
+}
+void bed_addInterval(bedIndex_t *bi, const char *name, uint64_t start, uint64_t end) {
+  // add the half open interval [start, end) on sequence name to the index
+  if (bi->isFinalized) {
+    fprintf(stderr, "Error, bed_addInterval() called on a finalized index\n");
+    exit(EXIT_FAILURE);
+  }
+  if (end <= start) {
+    // empty interval, contains nothing
+    return;
+  }
+  bedIntervals_t *bis = bed_getOrCreateIntervals(bi, name);
+  if (bis->numIntervals == bis->capacity) {
+    bis->capacity = (bis->capacity == 0) ? 16 : 2 * bis->capacity;
+    bis->pending = (bedInterval_t*) realloc(bis->pending, sizeof(*(bis->pending)) * bis->capacity);
+    if (bis->pending == NULL) {
+      fprintf(stderr, "Error, realloc failed in bed_addInterval()\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  bis->pending[bis->numIntervals].start = start;
+  bis->pending[bis->numIntervals].end = end;
+  ++(bis->numIntervals);
+}
+void bed_readFile(bedIndex_t *bi, const char *filename) {
+  /*
+   * read the first three columns (name, start, end) of each line of a bed file
+   * into the index. blank lines and track, browser and comment lines are skipped.
+   */
+  FILE *ifp = fopen(filename, "r");
+  if (ifp == NULL) {
+    if (errno == ENOENT)
+      fprintf(stderr, "ERROR, file %s does not exist.\n", filename);
+    else
+      fprintf(stderr, "ERROR, unable to open %s\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  int64_t n = kMaxStringLength;
+  char *line = (char*) de_malloc(n);
+  size_t nameLength = n;
+  char *name = (char*) de_malloc(nameLength);
+  uint64_t lineNumber = 0;
+  int64_t status = 0;
+  while (status != -1) {
+    status = de_getline(&line, &n, ifp);
+    ++lineNumber;
+    // the final line need not end in a newline
+    if ((line[0] == '\0') || (line[0] == '#') || (strncmp(line, "track", 5) == 0) ||
+        (strncmp(line, "browser", 7) == 0)) {
+      continue;
+    }
+    if (strlen(line) + 1 > nameLength) {
+      free(name);
+      nameLength = strlen(line) + 1;
+      name = (char*) de_malloc(nameLength);
+    }
+    int64_t start, end;
+    if (sscanf(line, "%s %" SCNi64 " %" SCNi64, name, &start, &end) != 3) {
+      fprintf(stderr, "Error while parsing line %" PRIu64 " of bed file %s, expected 3 "
+              "column bed format:\nsequence_name\tstart\tend\n", lineNumber, filename);
+      exit(EXIT_FAILURE);
+    }
+    if ((start < 0) || (end < start)) {
+      fprintf(stderr, "Error, bad interval on line %" PRIu64 " of bed file %s: %s %" PRIi64
+              " %" PRIi64 "\n", lineNumber, filename, name, start, end);
+      exit(EXIT_FAILURE);
+    }
+    bed_addInterval(bi, name, (uint64_t) start, (uint64_t) end);
+  }
+  free(line);
+  free(name);
+  fclose(ifp);
+}
+void bed_readFiles(bedIndex_t *bi, const char *commaSepFiles) {
+  // read each of a comma separated list of bed files into the index
+  char *copy = de_strdup(commaSepFiles);
+  char *s = copy;
+  char *filename = NULL;
+  while ((filename = de_strtok(&s, ',')) != NULL) {
+    bed_readFile(bi, filename);
+    free(filename);
+  }
+  free(copy);
+}
+static int bed_cmpInterval(const void *a, const void *b) {
+  const bedInterval_t *x = (const bedInterval_t *) a;
+  const bedInterval_t *y = (const bedInterval_t *) b;
+  if (x->start != y->start) {
+    return (x->start < y->start) ? -1 : 1;
+  }
+  if (x->end != y->end) {
+    return (x->end < y->end) ? -1 : 1;
+  }
+  return 0;
+}
+static void bed_finalizeIntervals(bedIntervals_t *bis) {
+  // sort the pending intervals and merge any that overlap or abut into flat arrays
+  qsort(bis->pending, bis->numIntervals, sizeof(*(bis->pending)), bed_cmpInterval);
+  uint64_t j = 0;
+  for (uint64_t i = 1; i < bis->numIntervals; ++i) {
+    if (bis->pending[i].start <= bis->pending[j].end) {
+      if (bis->pending[i].end > bis->pending[j].end) {
+        bis->pending[j].end = bis->pending[i].end;
+      }
+    } else {
+      bis->pending[++j] = bis->pending[i];
+    }
+  }
+  bis->numIntervals = (bis->numIntervals == 0) ? 0 : j + 1;
+  bis->starts = (uint64_t*) de_malloc(sizeof(*(bis->starts)) * (bis->numIntervals + 1));
+  bis->ends = (uint64_t*) de_malloc(sizeof(*(bis->ends)) * (bis->numIntervals + 1));
+  for (uint64_t i = 0; i < bis->numIntervals; ++i) {
+    bis->starts[i] = bis->pending[i].start;
+    bis->ends[i] = bis->pending[i].end;
+  }
+  free(bis->pending);
+  bis->pending = NULL;
+  bis->capacity = bis->numIntervals;
+}
+void bed_finalizeIndex(bedIndex_t *bi) {
+  // sort and merge the intervals of every sequence. no more intervals may be added.
+  if (bi->isFinalized) {
+    return;
+  }
+  for (uint64_t i = 0; i < bi->numSequences; ++i) {
+    bed_finalizeIntervals(bi->sequences[i]);
+  }
+  bi->last = NULL;
+  bi->isFinalized = true;
+}
+uint64_t bed_getNumberOfSequences(bedIndex_t *bi) {
+  return bi->numSequences;
+}
+bedIntervals_t* bed_getIntervalsByIndex(bedIndex_t *bi, uint64_t i) {
+  // sequences are in name order
+  assert(i < bi->numSequences);
+  return bi->sequences[i];
+}
+bedIntervals_t* bed_getIntervals(bedIndex_t *bi, const char *name) {
+  // returns NULL if name has no intervals
+  assert(bi->isFinalized);
+  bool found;
+  uint64_t i = bed_searchName(bi, name, &found);
+  if (!found) {
+    return NULL;
+  }
+  return bi->sequences[i];
+}
+char* bed_intervals_getName(const bedIntervals_t *bis) {
+  return bis->name;
+}
+uint64_t bed_intervals_getNumberOfIntervals(const bedIntervals_t *bis) {
+  return bis->numIntervals;
+}
+uint64_t bed_intervals_getStart(const bedIntervals_t *bis, uint64_t i) {
+  assert(i < bis->numIntervals);
+  return bis->starts[i];
+}
+uint64_t bed_intervals_getEnd(const bedIntervals_t *bis, uint64_t i) {
+  assert(i < bis->numIntervals);
+  return bis->ends[i];
+}
+uint64_t bed_intervals_getTotalLength(const bedIntervals_t *bis) {
+  uint64_t n = 0;
+  for (uint64_t i = 0; i < bis->numIntervals; ++i) {
+    n += bis->ends[i] - bis->starts[i];
+  }
+  return n;
+}
+bool bed_intervals_contains(const bedIntervals_t *bis, uint64_t pos) {
+  // branchless binary search for the last interval starting at or before pos
+  if ((bis == NULL) || (bis->numIntervals == 0) || (pos < bis->starts[0])) {
+    return false;
+  }
+  const uint64_t *base = bis->starts;
+  uint64_t n = bis->numIntervals;
+  while (n > 1) {
+    uint64_t half = n / 2;
+    base = (base[half] <= pos) ? base + half : base;
+    n -= half;
+  }
+  return pos < bis->ends[base - bis->starts];
+}
+bool bed_contains(bedIndex_t *bi, const char *name, uint64_t pos) {
+  return bed_intervals_contains(bed_getIntervals(bi, name), pos);
+}
+void bed_cursor_init(bedCursor_t *bc, const bedIntervals_t *bis) {
+  // bis may be NULL, in which case the cursor contains nothing
+  bc->intervals = bis;
+  bc->i = 0;
+}
+bool bed_cursor_contains(bedCursor_t *bc, uint64_t pos) {
+  /*
+   * same as bed_intervals_contains() but steps the cursor from the interval of the
+   * previous query, so a walk whose positions move monotonically (in either direction)
+   * along the sequence costs amortized O(1) per call.
+   */
+  const bedIntervals_t *bis = bc->intervals;
+  if ((bis == NULL) || (bis->numIntervals == 0)) {
+    return false;
+  }
+  while ((bc->i + 1 < bis->numIntervals) && (bis->starts[bc->i + 1] <= pos)) {
+    ++(bc->i);
+  }
+  while ((bc->i > 0) && (bis->starts[bc->i] > pos)) {
+    --(bc->i);
+  }
+  return (bis->starts[bc->i] <= pos) && (pos < bis->ends[bc->i]);
+}
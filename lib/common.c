@@ -264,3 +264,30 @@ char** extractSubStrings(char *nameList, unsigned n, const char delineator) {
     copy = NULL;
     return mat;
 }
+uint64_t fileFingerprint(const char *filename, uint64_t size) {
+    /* FNV-1a hash of the first and last 64KiB of a file of the given size. Along with the
+     * size and modification time (which has only one second resolution) this notices a file
+     * that has been rewritten in place without reading all of it, for keying caches of
+     * things computed from large files.
+     */
+    const size_t kLength = 1 << 16;
+    uint64_t h = 14695981039346656037ULL;
+    FILE *f = de_fopen(filename, "rb");
+    unsigned char *buffer = (unsigned char*) de_malloc(kLength);
+    for (int end = 0; end < 2; ++end) {
+        if (end && size > kLength) {
+            if (fseek(f, -(long) kLength, SEEK_END) != 0) {
+                fprintf(stderr, "Error, unable to seek in %s\n", filename);
+                exit(EXIT_FAILURE);
+            }
+        }
+        size_t n = fread(buffer, 1, kLength, f);
+        for (size_t i = 0; i < n; ++i) {
+            h ^= buffer[i];
+            h *= 1099511628211ULL;
+        }
+    }
+    free(buffer);
+    fclose(f);
+    return h;
+}
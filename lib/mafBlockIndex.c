@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "common.h"
+#include "sharedMaf.h"
+#include "bedIndex.h"
+#include "mafBlockIndex.h"
+
+static const uint64_t kMbiMagic = 0x6d6166426c6b4958ULL; // "mafBlkIX"
+static const uint64_t kMbiVersion = 1;
+
+typedef struct mbiRow {
+  uint64_t start; // positive strand, half open [start, end)
+  uint64_t end;
+  uint64_t block;
+} mbiRow_t;
+typedef struct mbiSequence {
+  char *name;
+  uint64_t sourceLength;
+  uint64_t numRows;
+  uint64_t capacity;
+  mbiRow_t *rows; // sorted by start once built
+  uint64_t maxLength; // longest row, bounds how far back an overlapping row can start
+} mbiSequence_t;
+struct mafBlockIndex {
+  uint64_t mafSize;
+  int64_t mafModified;
+  uint64_t mafFingerprint;
+  uint64_t numBlocks;
+  uint64_t blockCapacity;
+  int64_t *offsets; // where each block may be read from, see mafBlockIndex_readBlock()
+  uint64_t *lineNumbers;
+  uint64_t numSequences;
+  uint64_t sequenceCapacity;
+  mbiSequence_t **sequences; // kept sorted by name
+};
+
+static void* mbi_realloc(void *p, size_t size) {
+  void *q = realloc(p, size);
+  if (q == NULL) {
+    fprintf(stderr, "Error, realloc failed in mafBlockIndex\n");
+    exit(EXIT_FAILURE);
+  }
+  return q;
+}
+static mafBlockIndex_t* mbi_new(void) {
+  mafBlockIndex_t *mbi = (mafBlockIndex_t*) de_malloc(sizeof(*mbi));
+  memset(mbi, 0, sizeof(*mbi));
+  return mbi;
+}
+void mafBlockIndex_destroy(mafBlockIndex_t *mbi) {
+  if (mbi == NULL) {
+    return;
+  }
+  for (uint64_t i = 0; i < mbi->numSequences; ++i) {
+    free(mbi->sequences[i]->name);
+    free(mbi->sequences[i]->rows);
+    free(mbi->sequences[i]);
+  }
+  free(mbi->sequences);
+  free(mbi->offsets);
+  free(mbi->lineNumbers);
+  free(mbi);
+}
+static bool mbi_stat(const char *filename, uint64_t *size, int64_t *modified) {
+  struct stat s;
+  if (stat(filename, &s) != 0) {
+    return false;
+  }
+  *size = (uint64_t) s.st_size;
+  *modified = (int64_t) s.st_mtime;
+  return true;
+}
+static uint64_t mbi_searchName(mafBlockIndex_t *mbi, const char *name, bool *found) {
+  // binary search for name in the sorted sequences. returns the index of name if present,
+  // otherwise the index at which name would be inserted.
+  uint64_t lo = 0, hi = mbi->numSequences;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    int c = strcmp(mbi->sequences[mid]->name, name);
+    if (c == 0) {
+      *found = true;
+      return mid;
+    } else if (c < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *found = false;
+  return lo;
+}
+static mbiSequence_t* mbi_getOrCreateSequence(mafBlockIndex_t *mbi, const char *name) {
+  bool found;
+  uint64_t i = mbi_searchName(mbi, name, &found);
+  if (!found) {
+    if (mbi->numSequences == mbi->sequenceCapacity) {
+      mbi->sequenceCapacity = (mbi->sequenceCapacity == 0) ? 16 : 2 * mbi->sequenceCapacity;
+      mbi->sequences = (mbiSequence_t**) mbi_realloc(mbi->sequences,
+                                                     sizeof(*(mbi->sequences)) * mbi->sequenceCapacity);
+    }
+    memmove(mbi->sequences + i + 1, mbi->sequences + i, sizeof(*(mbi->sequences)) * (mbi->numSequences - i));
+    mbiSequence_t *seq = (mbiSequence_t*) de_malloc(sizeof(*seq));
+    memset(seq, 0, sizeof(*seq));
+    seq->name = de_strdup(name);
+    mbi->sequences[i] = seq;
+    ++(mbi->numSequences);
+  }
+  return mbi->sequences[i];
+}
+static void mbi_addBlock(mafBlockIndex_t *mbi, int64_t offset, uint64_t lineNumber) {
+  if (mbi->numBlocks == mbi->blockCapacity) {
+    mbi->blockCapacity = (mbi->blockCapacity == 0) ? 1024 : 2 * mbi->blockCapacity;
+    mbi->offsets = (int64_t*) mbi_realloc(mbi->offsets, sizeof(*(mbi->offsets)) * mbi->blockCapacity);
+    mbi->lineNumbers = (uint64_t*) mbi_realloc(mbi->lineNumbers,
+                                               sizeof(*(mbi->lineNumbers)) * mbi->blockCapacity);
+  }
+  mbi->offsets[mbi->numBlocks] = offset;
+  mbi->lineNumbers[mbi->numBlocks] = lineNumber;
+  ++(mbi->numBlocks);
+}
+static void mbi_addRow(mafBlockIndex_t *mbi, const char *filename, mafLine_t *ml, uint64_t block) {
+  mbiSequence_t *seq = mbi_getOrCreateSequence(mbi, maf_mafLine_getSpecies(ml));
+  if (seq->numRows == 0) {
+    seq->sourceLength = maf_mafLine_getSourceLength(ml);
+  } else if (seq->sourceLength != maf_mafLine_getSourceLength(ml)) {
+    fprintf(stderr, "Error, conflicting source length information for sequence in maf. %s source length "
+            "was first %" PRIu64 " but on line %" PRIu64 " of %s the value is %" PRIu64 ".\n",
+            seq->name, seq->sourceLength, maf_mafLine_getLineNumber(ml), filename,
+            maf_mafLine_getSourceLength(ml));
+    exit(EXIT_FAILURE);
+  }
+  if (seq->numRows == seq->capacity) {
+    seq->capacity = (seq->capacity == 0) ? 16 : 2 * seq->capacity;
+    seq->rows = (mbiRow_t*) mbi_realloc(seq->rows, sizeof(*(seq->rows)) * seq->capacity);
+  }
+  mbiRow_t *row = seq->rows + seq->numRows;
+  row->start = maf_mafLine_getPositiveLeftCoord(ml);
+  row->end = row->start + maf_mafLine_getLength(ml);
+  row->block = block;
+  ++(seq->numRows);
+}
+static int mbi_cmpRows(const void *a, const void *b) {
+  const mbiRow_t *x = (const mbiRow_t*) a;
+  const mbiRow_t *y = (const mbiRow_t*) b;
+  if (x->start != y->start) {
+    return (x->start < y->start) ? -1 : 1;
+  }
+  if (x->block != y->block) {
+    return (x->block < y->block) ? -1 : 1;
+  }
+  return 0;
+}
+static void mbi_finalize(mafBlockIndex_t *mbi) {
+  for (uint64_t i = 0; i < mbi->numSequences; ++i) {
+    mbiSequence_t *seq = mbi->sequences[i];
+    qsort(seq->rows, seq->numRows, sizeof(*(seq->rows)), mbi_cmpRows);
+    seq->maxLength = 0;
+    for (uint64_t r = 0; r < seq->numRows; ++r) {
+      if (seq->rows[r].end - seq->rows[r].start > seq->maxLength) {
+        seq->maxLength = seq->rows[r].end - seq->rows[r].start;
+      }
+    }
+  }
+}
+mafBlockIndex_t* mafBlockIndex_build(const char *mafFilename) {
+  /*
+   * read the whole of mafFilename, noting where each block starts and the rows it holds.
+   */
+  mafBlockIndex_t *mbi = mbi_new();
+  if (!mbi_stat(mafFilename, &(mbi->mafSize), &(mbi->mafModified))) {
+    fprintf(stderr, "Error, unable to stat %s\n", mafFilename);
+    exit(EXIT_FAILURE);
+  }
+  mbi->mafFingerprint = fileFingerprint(mafFilename, mbi->mafSize);
+  mafFileApi_t *mfa = maf_newMfa(mafFilename, "r");
+  mafBlock_t *mb = maf_readBlock(mfa); // the header
+  if (mb == NULL) {
+    maf_destroyMfa(mfa);
+    return mbi;
+  }
+  maf_destroyMafBlockList(mb);
+  while (true) {
+    int64_t offset = maf_mafFileApi_tell(mfa);
+    uint64_t lineNumber = maf_mafFileApi_getLineNumber(mfa);
+    if (offset == -1) {
+      // this block was started along with the header, it is read by starting over
+      offset = 0;
+      lineNumber = 0;
+    }
+    if ((mb = maf_readBlock(mfa)) == NULL) {
+      break;
+    }
+    for (mafLine_t *ml = maf_mafBlock_getHeadLine(mb); ml != NULL; ml = maf_mafLine_getNext(ml)) {
+      if (maf_mafLine_getType(ml) == 's') {
+        mbi_addRow(mbi, mafFilename, ml, mbi->numBlocks);
+      }
+    }
+    mbi_addBlock(mbi, offset, lineNumber);
+    maf_destroyMafBlockList(mb);
+  }
+  maf_destroyMfa(mfa);
+  mbi_finalize(mbi);
+  return mbi;
+}
+static bool mbi_writeU64(FILE *f, uint64_t x) {
+  return fwrite(&x, sizeof(x), 1, f) == 1;
+}
+static bool mbi_readU64(FILE *f, uint64_t *x) {
+  return fread(x, sizeof(*x), 1, f) == 1;
+}
+static bool mbi_consume(uint64_t *remaining, uint64_t count, uint64_t size) {
+  // take count items of size bytes from the unread part of an index, false if they aren't there.
+  // keeps a damaged count from becoming an enormous allocation.
+  if (count > *remaining / size) {
+    return false;
+  }
+  *remaining -= count * size;
+  return true;
+}
+bool mafBlockIndex_write(mafBlockIndex_t *mbi, const char *indexFilename) {
+  // write the index in host byte order, returns false if it could not be written.
+  FILE *f = fopen(indexFilename, "wb");
+  if (f == NULL) {
+    return false;
+  }
+  bool ok = mbi_writeU64(f, kMbiMagic) && mbi_writeU64(f, kMbiVersion) &&
+    mbi_writeU64(f, mbi->mafSize) && mbi_writeU64(f, (uint64_t) mbi->mafModified) &&
+    mbi_writeU64(f, mbi->mafFingerprint) &&
+    mbi_writeU64(f, mbi->numBlocks) &&
+    fwrite(mbi->offsets, sizeof(*(mbi->offsets)), mbi->numBlocks, f) == mbi->numBlocks &&
+    fwrite(mbi->lineNumbers, sizeof(*(mbi->lineNumbers)), mbi->numBlocks, f) == mbi->numBlocks &&
+    mbi_writeU64(f, mbi->numSequences);
+  for (uint64_t i = 0; ok && i < mbi->numSequences; ++i) {
+    mbiSequence_t *seq = mbi->sequences[i];
+    uint64_t nameLength = strlen(seq->name);
+    ok = mbi_writeU64(f, nameLength) && fwrite(seq->name, 1, nameLength, f) == nameLength &&
+      mbi_writeU64(f, seq->sourceLength) && mbi_writeU64(f, seq->numRows) &&
+      fwrite(seq->rows, sizeof(*(seq->rows)), seq->numRows, f) == seq->numRows;
+  }
+  if (fclose(f) != 0) {
+    ok = false;
+  }
+  if (!ok) {
+    remove(indexFilename);
+  }
+  return ok;
+}
+mafBlockIndex_t* mafBlockIndex_read(const char *indexFilename, const char *mafFilename) {
+  // returns NULL if the index is missing, unreadable or was not built from mafFilename as it is now.
+  uint64_t mafSize, indexSize, magic, version, modified, fingerprint, numBlocks, numSequences;
+  int64_t mafModified, indexModified;
+  if (!mbi_stat(mafFilename, &mafSize, &mafModified) ||
+      !mbi_stat(indexFilename, &indexSize, &indexModified)) {
+    return NULL;
+  }
+  // every count in the index is checked against the bytes left in it before anything is
+  // allocated, a truncated or corrupt index is rebuilt rather than trusted.
+  uint64_t remaining = indexSize;
+  FILE *f = fopen(indexFilename, "rb");
+  if (f == NULL) {
+    return NULL;
+  }
+  mafBlockIndex_t *mbi = mbi_new();
+  bool ok = mbi_readU64(f, &magic) && magic == kMbiMagic && mbi_readU64(f, &version) &&
+    version == kMbiVersion && mbi_readU64(f, &(mbi->mafSize)) && mbi->mafSize == mafSize &&
+    mbi_readU64(f, &modified) && (int64_t) modified == mafModified && mbi_readU64(f, &fingerprint) &&
+    fingerprint == fileFingerprint(mafFilename, mafSize) && mbi_readU64(f, &numBlocks) &&
+    mbi_consume(&remaining, 6, sizeof(uint64_t)) &&
+    mbi_consume(&remaining, numBlocks, sizeof(*(mbi->offsets)) + sizeof(*(mbi->lineNumbers))) &&
+    mbi_consume(&remaining, 1, sizeof(uint64_t));
+  if (ok) {
+    mbi->mafModified = mafModified;
+    mbi->mafFingerprint = fingerprint;
+    mbi->offsets = (int64_t*) de_malloc(sizeof(*(mbi->offsets)) * (numBlocks + 1));
+    mbi->lineNumbers = (uint64_t*) de_malloc(sizeof(*(mbi->lineNumbers)) * (numBlocks + 1));
+    mbi->numBlocks = numBlocks;
+    mbi->blockCapacity = numBlocks + 1;
+    ok = fread(mbi->offsets, sizeof(*(mbi->offsets)), numBlocks, f) == numBlocks &&
+      fread(mbi->lineNumbers, sizeof(*(mbi->lineNumbers)), numBlocks, f) == numBlocks &&
+      mbi_readU64(f, &numSequences) &&
+      mbi_consume(&remaining, numSequences, 3 * sizeof(uint64_t)); // nameLength, sourceLength, numRows
+  }
+  if (ok) {
+    mbi->sequences = (mbiSequence_t**) de_malloc(sizeof(*(mbi->sequences)) * (numSequences + 1));
+    mbi->sequenceCapacity = numSequences + 1;
+  }
+  for (uint64_t i = 0; ok && i < numSequences; ++i) {
+    uint64_t nameLength;
+    mbiSequence_t *seq = (mbiSequence_t*) de_malloc(sizeof(*seq));
+    memset(seq, 0, sizeof(*seq));
+    mbi->sequences[mbi->numSequences++] = seq;
+    ok = mbi_readU64(f, &nameLength) && mbi_consume(&remaining, nameLength, 1);
+    if (ok) {
+      seq->name = (char*) de_malloc(nameLength + 1);
+      ok = fread(seq->name, 1, nameLength, f) == nameLength && mbi_readU64(f, &(seq->sourceLength)) &&
+        mbi_readU64(f, &(seq->numRows)) && mbi_consume(&remaining, seq->numRows, sizeof(*(seq->rows)));
+      seq->name[ok ? nameLength : 0] = '\0';
+    }
+    if (ok) {
+      seq->rows = (mbiRow_t*) de_malloc(sizeof(*(seq->rows)) * (seq->numRows + 1));
+      seq->capacity = seq->numRows + 1;
+      ok = fread(seq->rows, sizeof(*(seq->rows)), seq->numRows, f) == seq->numRows;
+    }
+  }
+  fclose(f);
+  if (!ok) {
+    mafBlockIndex_destroy(mbi);
+    return NULL;
+  }
+  mbi_finalize(mbi);
+  return mbi;
+}
+mafBlockIndex_t* mafBlockIndex_load(const char *mafFilename) {
+  // read the index saved beside mafFilename if it is current, otherwise build it and try to
+  // save it there for next time. A maf in a directory that can't be written to is indexed anew
+  // on every load.
+  char *indexFilename = (char*) de_malloc(strlen(mafFilename) + 5);
+  sprintf(indexFilename, "%s.mbi", mafFilename);
+  mafBlockIndex_t *mbi = mafBlockIndex_read(indexFilename, mafFilename);
+  if (mbi == NULL) {
+    mbi = mafBlockIndex_build(mafFilename);
+    mafBlockIndex_write(mbi, indexFilename);
+  }
+  free(indexFilename);
+  return mbi;
+}
+uint64_t mafBlockIndex_getNumberOfBlocks(mafBlockIndex_t *mbi) {
+  return mbi->numBlocks;
+}
+uint64_t mafBlockIndex_getNumberOfSequences(mafBlockIndex_t *mbi) {
+  return mbi->numSequences;
+}
+char* mafBlockIndex_getSequenceName(mafBlockIndex_t *mbi, uint64_t i) {
+  // sequences are in name order
+  assert(i < mbi->numSequences);
+  return mbi->sequences[i]->name;
+}
+uint64_t mafBlockIndex_getSourceLength(mafBlockIndex_t *mbi, uint64_t i) {
+  assert(i < mbi->numSequences);
+  return mbi->sequences[i]->sourceLength;
+}
+static int mbi_cmpU64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t*) a;
+  uint64_t y = *(const uint64_t*) b;
+  return (x < y) ? -1 : (x > y);
+}
+uint64_t* mafBlockIndex_findBlocks(mafBlockIndex_t *mbi, bedIndex_t *regions, uint64_t slop,
+                                   uint64_t *numBlocks) {
+  /*
+   * returns the distinct blocks, in file order, with a row overlapping any interval of the
+   * (finalized) regions widened by slop on either side. The array is the caller's to free.
+   */
+  uint64_t n = 0, capacity = 16;
+  uint64_t *blocks = (uint64_t*) de_malloc(sizeof(*blocks) * capacity);
+  for (uint64_t i = 0; i < bed_getNumberOfSequences(regions); ++i) {
+    bedIntervals_t *bis = bed_getIntervalsByIndex(regions, i);
+    bool found;
+    uint64_t j = mbi_searchName(mbi, bed_intervals_getName(bis), &found);
+    if (!found) {
+      continue;
+    }
+    mbiSequence_t *seq = mbi->sequences[j];
+    for (uint64_t k = 0; k < bed_intervals_getNumberOfIntervals(bis); ++k) {
+      uint64_t start = bed_intervals_getStart(bis, k);
+      uint64_t end = bed_intervals_getEnd(bis, k) + slop;
+      start = (start > slop) ? start - slop : 0;
+      // rows overlapping [start, end) begin no earlier than start - maxLength
+      uint64_t earliest = (start > seq->maxLength) ? start - seq->maxLength : 0;
+      uint64_t lo = 0, hi = seq->numRows;
+      while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (seq->rows[mid].start < earliest) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      for (uint64_t r = lo; r < seq->numRows && seq->rows[r].start < end; ++r) {
+        if (seq->rows[r].end > start) {
+          if (n == capacity) {
+            capacity *= 2;
+            blocks = (uint64_t*) mbi_realloc(blocks, sizeof(*blocks) * capacity);
+          }
+          blocks[n++] = seq->rows[r].block;
+        }
+      }
+    }
+  }
+  qsort(blocks, n, sizeof(*blocks), mbi_cmpU64);
+  uint64_t m = 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    if (m == 0 || blocks[m - 1] != blocks[i]) {
+      blocks[m++] = blocks[i];
+    }
+  }
+  *numBlocks = m;
+  return blocks;
+}
+mafBlock_t* mafBlockIndex_readBlock(mafBlockIndex_t *mbi, mafFileApi_t *mfa, uint64_t block) {
+  // read the given block from mfa, which must be open on the indexed maf.
+  assert(block < mbi->numBlocks);
+  maf_mafFileApi_seek(mfa, mbi->offsets[block], mbi->lineNumbers[block]);
+  mafBlock_t *mb = maf_readBlock(mfa);
+  if (mbi->lineNumbers[block] == 0 && mb != NULL) {
+    // started over, the header comes first
+    maf_destroyMafBlockList(mb);
+    mb = maf_readBlock(mfa);
+  }
+  return mb;
+}
@@ -0,0 +1,395 @@
+/*
+ * Copyright (C) 2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common.h"
+#include "sharedMaf.h"
+#include "mafPartition.h"
+
+struct mafPartition {
+  FILE *spool;
+  pthread_mutex_t lock; // guards seeking and reading the spool
+  uint64_t numBlocks;
+  uint64_t *offsets; // numBlocks + 1, where each block starts in the spool
+  uint64_t *lineNumbers; // numBlocks, the line of the maf each block's a line is on
+  uint64_t numParts;
+  uint64_t *partStarts; // numParts + 1, where each part starts in blocks
+  uint64_t *blocks; // block indices, grouped by part
+  char **partNames; // numParts, the first key of the first block of each part
+};
+typedef struct mpNames {
+  // the key names seen so far: an open addressed hash of names to ids, numbered from 0 in
+  // order of first appearance, and the union-find forest joining the ids into parts.
+  uint64_t numNames;
+  uint64_t maxNames;
+  char **names;
+  uint64_t *parents;
+  uint64_t *sizes;
+  uint64_t numSlots; // a power of two, at least twice maxNames
+  uint64_t *slots; // 1 + the id of the name hashed to each slot, 0 when empty
+} mpNames_t;
+typedef struct mpWorkers {
+  // parts are handed out in order and reported in order, see mp_buildParts()
+  mafPartition_t *mp;
+  mafPartition_build_t build;
+  mafPartition_report_t report;
+  mafPartition_destroy_t destroy;
+  void *arg;
+  pthread_mutex_t lock;
+  pthread_cond_t reported;
+  uint64_t nextToBuild;
+  uint64_t nextToReport;
+} mpWorkers_t;
+
+static void* mp_resize(void *a, uint64_t n, size_t size) {
+  a = realloc(a, size * n);
+  if (a == NULL) {
+    fprintf(stderr, "Error, unable to grow an array to %" PRIu64 " elements in mafPartition\n", n);
+    exit(EXIT_FAILURE);
+  }
+  return a;
+}
+static void mp_writeSpool(mafPartition_t *mp, const void *p, size_t n) {
+  if (fwrite(p, 1, n, mp->spool) != n) {
+    fprintf(stderr, "Error, unable to write to a temporary file, see --tempDir\n");
+    exit(EXIT_FAILURE);
+  }
+}
+static bool mp_seekSpool(FILE *spool, uint64_t offset) {
+  // fseek() takes a long, so the spool can only be read back up to LONG_MAX bytes
+  if (offset > (uint64_t) LONG_MAX) {
+    fprintf(stderr, "Error, a temporary file has grown past %ld bytes, the most that can be "
+            "read back on this system\n", LONG_MAX);
+    exit(EXIT_FAILURE);
+  }
+  return fseek(spool, (long) offset, SEEK_SET) == 0;
+}
+static uint64_t mp_hashName(const char *s) {
+  // 64 bit FNV-1a
+  uint64_t h = UINT64_C(14695981039346656037);
+  for (; *s != '\0'; ++s) {
+    h ^= (unsigned char) *s;
+    h *= UINT64_C(1099511628211);
+  }
+  return h;
+}
+static mpNames_t* mp_newNames(void) {
+  mpNames_t *names = (mpNames_t*) de_malloc(sizeof(*names));
+  names->numNames = 0;
+  names->maxNames = 64;
+  names->names = (char**) de_malloc(sizeof(*(names->names)) * names->maxNames);
+  names->parents = (uint64_t*) de_malloc(sizeof(*(names->parents)) * names->maxNames);
+  names->sizes = (uint64_t*) de_malloc(sizeof(*(names->sizes)) * names->maxNames);
+  names->numSlots = 2 * names->maxNames;
+  names->slots = (uint64_t*) de_malloc(sizeof(*(names->slots)) * names->numSlots);
+  memset(names->slots, 0, sizeof(*(names->slots)) * names->numSlots);
+  return names;
+}
+static void mp_destroyNames(mpNames_t *names) {
+  for (uint64_t i = 0; i < names->numNames; ++i) {
+    free(names->names[i]);
+  }
+  free(names->names);
+  free(names->parents);
+  free(names->sizes);
+  free(names->slots);
+  free(names);
+}
+static uint64_t* mp_findSlot(mpNames_t *names, const char *name) {
+  // the slot holding name, or the empty slot it would go in
+  uint64_t i = mp_hashName(name) & (names->numSlots - 1);
+  while (names->slots[i] != 0 && strcmp(names->names[names->slots[i] - 1], name) != 0) {
+    i = (i + 1) & (names->numSlots - 1);
+  }
+  return names->slots + i;
+}
+static uint64_t mp_getId(mpNames_t *names, const char *name) {
+  // the id of name, given the next one if it is new
+  uint64_t *slot = mp_findSlot(names, name);
+  if (*slot != 0) {
+    return *slot - 1;
+  }
+  if (names->numNames == names->maxNames) {
+    names->maxNames *= 2;
+    names->names = (char**) mp_resize(names->names, names->maxNames, sizeof(*(names->names)));
+    names->parents = (uint64_t*) mp_resize(names->parents, names->maxNames, sizeof(*(names->parents)));
+    names->sizes = (uint64_t*) mp_resize(names->sizes, names->maxNames, sizeof(*(names->sizes)));
+    free(names->slots);
+    names->numSlots = 2 * names->maxNames;
+    names->slots = (uint64_t*) de_malloc(sizeof(*(names->slots)) * names->numSlots);
+    memset(names->slots, 0, sizeof(*(names->slots)) * names->numSlots);
+    for (uint64_t i = 0; i < names->numNames; ++i) {
+      *mp_findSlot(names, names->names[i]) = i + 1;
+    }
+    slot = mp_findSlot(names, name);
+  }
+  uint64_t id = names->numNames++;
+  names->names[id] = de_strdup(name);
+  names->parents[id] = id;
+  names->sizes[id] = 1;
+  *slot = id + 1;
+  return id;
+}
+static uint64_t mp_findRoot(mpNames_t *names, uint64_t i) {
+  // union-find root of i, halving the path on the way
+  while (names->parents[i] != i) {
+    names->parents[i] = names->parents[names->parents[i]];
+    i = names->parents[i];
+  }
+  return i;
+}
+static void mp_join(mpNames_t *names, uint64_t i, uint64_t j) {
+  i = mp_findRoot(names, i);
+  j = mp_findRoot(names, j);
+  if (i == j) {
+    return;
+  }
+  if (names->sizes[i] < names->sizes[j]) {
+    uint64_t tmp = i;
+    i = j;
+    j = tmp;
+  }
+  names->parents[j] = i;
+  names->sizes[i] += names->sizes[j];
+}
+mafPartition_t* mafPartition_build(mafFileApi_t *mfa, const char *tempDir, const char *prefix,
+                                   mafPartition_isKey_t isKey, void *arg) {
+  /*
+   * one pass over mfa, copying each block with a key to a spool in tempDir, named for prefix,
+   * and joining the parts of its keys. isKey may be NULL, in which case every sequence line of
+   * a block is one of its keys. Only the key names are kept in memory.
+   */
+  mafPartition_t *mp = (mafPartition_t*) de_malloc(sizeof(*mp));
+  char *filename = de_malloc(strlen(tempDir) + strlen(prefix) + 64);
+  sprintf(filename, "%s/%s.%d.spool", tempDir, prefix, (int) getpid());
+  mp->spool = fopen(filename, "w+b");
+  if (mp->spool == NULL) {
+    fprintf(stderr, "Error, unable to create temporary file %s, see --tempDir\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  remove(filename);
+  free(filename);
+  pthread_mutex_init(&(mp->lock), NULL);
+  mpNames_t *names = mp_newNames();
+  uint64_t maxBlocks = 64, offset = 0;
+  uint64_t *firsts = (uint64_t*) de_malloc(sizeof(*firsts) * maxBlocks); // first key of each block
+  mp->offsets = (uint64_t*) de_malloc(sizeof(*(mp->offsets)) * (maxBlocks + 1));
+  mp->lineNumbers = (uint64_t*) de_malloc(sizeof(*(mp->lineNumbers)) * maxBlocks);
+  mp->numBlocks = 0;
+  mafBlock_t *mb = NULL;
+  while ((mb = maf_readBlock(mfa)) != NULL) {
+    bool hasKey = false;
+    uint64_t first = 0;
+    for (mafLine_t *ml = maf_mafBlock_getHeadLine(mb); ml != NULL; ml = maf_mafLine_getNext(ml)) {
+      if (maf_mafLine_getType(ml) != 's' || (isKey != NULL && !isKey(mb, ml, arg))) {
+        continue;
+      }
+      uint64_t id = mp_getId(names, maf_mafLine_getSpecies(ml));
+      if (hasKey) {
+        mp_join(names, first, id);
+      } else {
+        first = id;
+        hasKey = true;
+      }
+    }
+    if (!hasKey) {
+      maf_destroyMafBlockList(mb);
+      continue;
+    }
+    if (mp->numBlocks == maxBlocks) {
+      maxBlocks *= 2;
+      firsts = (uint64_t*) mp_resize(firsts, maxBlocks, sizeof(*firsts));
+      mp->offsets = (uint64_t*) mp_resize(mp->offsets, maxBlocks + 1, sizeof(*(mp->offsets)));
+      mp->lineNumbers = (uint64_t*) mp_resize(mp->lineNumbers, maxBlocks, sizeof(*(mp->lineNumbers)));
+    }
+    firsts[mp->numBlocks] = first;
+    mp->offsets[mp->numBlocks] = offset;
+    mp->lineNumbers[mp->numBlocks] = maf_mafLine_getLineNumber(maf_mafBlock_getHeadLine(mb));
+    for (mafLine_t *ml = maf_mafBlock_getHeadLine(mb); ml != NULL; ml = maf_mafLine_getNext(ml)) {
+      char *line = maf_mafLine_getLine(ml);
+      mp_writeSpool(mp, line, strlen(line));
+      mp_writeSpool(mp, "\n", 1);
+      offset += strlen(line) + 1;
+    }
+    ++(mp->numBlocks);
+    maf_destroyMafBlockList(mb);
+  }
+  mp->offsets[mp->numBlocks] = offset;
+  if (fflush(mp->spool) != 0) {
+    fprintf(stderr, "Error, unable to write to a temporary file, see --tempDir\n");
+    exit(EXIT_FAILURE);
+  }
+  // number the parts by first appearance, then bucket the blocks, keeping file order
+  uint64_t *parts = (uint64_t*) de_malloc(sizeof(*parts) * (names->numNames + 1));
+  for (uint64_t i = 0; i < names->numNames; ++i) {
+    parts[i] = UINT64_MAX;
+  }
+  mp->numParts = 0;
+  mp->partNames = (char**) de_malloc(sizeof(*(mp->partNames)) * (names->numNames + 1));
+  for (uint64_t b = 0; b < mp->numBlocks; ++b) {
+    uint64_t root = mp_findRoot(names, firsts[b]);
+    if (parts[root] == UINT64_MAX) {
+      mp->partNames[mp->numParts] = de_strdup(names->names[firsts[b]]);
+      parts[root] = mp->numParts++;
+    }
+    firsts[b] = parts[root];
+  }
+  mp->partStarts = (uint64_t*) de_malloc(sizeof(*(mp->partStarts)) * (mp->numParts + 1));
+  memset(mp->partStarts, 0, sizeof(*(mp->partStarts)) * (mp->numParts + 1));
+  for (uint64_t b = 0; b < mp->numBlocks; ++b) {
+    ++(mp->partStarts[firsts[b] + 1]);
+  }
+  for (uint64_t p = 0; p < mp->numParts; ++p) {
+    mp->partStarts[p + 1] += mp->partStarts[p];
+  }
+  uint64_t *next = (uint64_t*) de_malloc(sizeof(*next) * (mp->numParts + 1));
+  memcpy(next, mp->partStarts, sizeof(*next) * (mp->numParts + 1));
+  mp->blocks = (uint64_t*) de_malloc(sizeof(*(mp->blocks)) * (mp->numBlocks + 1));
+  for (uint64_t b = 0; b < mp->numBlocks; ++b) {
+    mp->blocks[next[firsts[b]]++] = b;
+  }
+  free(next);
+  free(parts);
+  free(firsts);
+  mp_destroyNames(names);
+  return mp;
+}
+void mafPartition_destroy(mafPartition_t *mp) {
+  if (mp == NULL) {
+    return;
+  }
+  fclose(mp->spool);
+  pthread_mutex_destroy(&(mp->lock));
+  for (uint64_t p = 0; p < mp->numParts; ++p) {
+    free(mp->partNames[p]);
+  }
+  free(mp->partNames);
+  free(mp->offsets);
+  free(mp->lineNumbers);
+  free(mp->partStarts);
+  free(mp->blocks);
+  free(mp);
+}
+uint64_t mafPartition_getNumberOfBlocks(mafPartition_t *mp) {
+  return mp->numBlocks;
+}
+uint64_t mafPartition_getNumberOfParts(mafPartition_t *mp) {
+  return mp->numParts;
+}
+uint64_t mafPartition_getNumberOfPartBlocks(mafPartition_t *mp, uint64_t p) {
+  return mp->partStarts[p + 1] - mp->partStarts[p];
+}
+uint64_t mafPartition_getBlockIndex(mafPartition_t *mp, uint64_t p, uint64_t i) {
+  // the file order index, among the blocks with a key, of the i-th block of part p
+  return mp->blocks[mp->partStarts[p] + i];
+}
+char* mafPartition_getPartName(mafPartition_t *mp, uint64_t p) {
+  return mp->partNames[p];
+}
+mafBlock_t* mafPartition_readBlock(mafPartition_t *mp, uint64_t p, uint64_t i) {
+  // read the i-th block of part p back in from the spool
+  uint64_t b = mafPartition_getBlockIndex(mp, p, i);
+  uint64_t length = mp->offsets[b + 1] - mp->offsets[b];
+  char *buffer = (char*) de_malloc(length + 1);
+  pthread_mutex_lock(&(mp->lock));
+  if (!mp_seekSpool(mp->spool, mp->offsets[b]) || fread(buffer, 1, length, mp->spool) != length) {
+    fprintf(stderr, "Error, unable to read back a temporary file, see --tempDir\n");
+    exit(EXIT_FAILURE);
+  }
+  pthread_mutex_unlock(&(mp->lock));
+  buffer[length] = '\0';
+  mafBlock_t *mb = maf_newMafBlockFromString(buffer, mp->lineNumbers[b]);
+  free(buffer);
+  return mb;
+}
+static void* mp_buildParts(void *arg) {
+  // build parts until there are none left. A built part waits for the ones before it to be
+  // reported, so at most one part per thread is held at once.
+  mpWorkers_t *workers = (mpWorkers_t*) arg;
+  uint64_t p;
+  while (true) {
+    pthread_mutex_lock(&(workers->lock));
+    p = workers->nextToBuild++;
+    pthread_mutex_unlock(&(workers->lock));
+    if (p >= workers->mp->numParts) {
+      break;
+    }
+    void *built = workers->build(workers->mp, p, workers->arg);
+    pthread_mutex_lock(&(workers->lock));
+    while (workers->nextToReport != p) {
+      pthread_cond_wait(&(workers->reported), &(workers->lock));
+    }
+    pthread_mutex_unlock(&(workers->lock));
+    workers->report(built, workers->arg);
+    pthread_mutex_lock(&(workers->lock));
+    ++(workers->nextToReport);
+    pthread_cond_broadcast(&(workers->reported));
+    pthread_mutex_unlock(&(workers->lock));
+    workers->destroy(built, workers->arg);
+  }
+  return NULL;
+}
+void mafPartition_buildInOrder(mafPartition_t *mp, uint64_t numThreads, mafPartition_build_t build,
+                               mafPartition_report_t report, mafPartition_destroy_t destroy, void *arg) {
+  /*
+   * build each part on its own, numThreads at a time, and report them one after another in
+   * part order, so the output does not depend on numThreads. build may run on any thread,
+   * report is only ever called by one thread at a time.
+   */
+  mpWorkers_t workers;
+  workers.mp = mp;
+  workers.build = build;
+  workers.report = report;
+  workers.destroy = destroy;
+  workers.arg = arg;
+  workers.nextToBuild = 0;
+  workers.nextToReport = 0;
+  pthread_mutex_init(&(workers.lock), NULL);
+  pthread_cond_init(&(workers.reported), NULL);
+  if (numThreads > 1) {
+    pthread_t *threads = (pthread_t*) de_malloc(sizeof(*threads) * numThreads);
+    for (uint64_t t = 0; t < numThreads; ++t) {
+      if (pthread_create(&(threads[t]), NULL, mp_buildParts, &workers) != 0) {
+        fprintf(stderr, "Error, unable to create thread for mafPartition_buildInOrder()\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    for (uint64_t t = 0; t < numThreads; ++t) {
+      pthread_join(threads[t], NULL);
+    }
+    free(threads);
+  } else {
+    mp_buildParts(&workers);
+  }
+  pthread_mutex_destroy(&(workers.lock));
+  pthread_cond_destroy(&(workers.reported));
+}
@@ -89,6 +89,21 @@ static void maf_checkForPrematureMafEnd(char *filename, int status, char *line)
     exit(EXIT_FAILURE);
   }
 }
+static char* maf_nextField(char **s) {
+  // strtok(*s, " \t") without the hidden state, so that lines may be parsed on several threads
+  // at once. *s is advanced past the returned field, which is NULL when there are no more.
+  char *start = *s + strspn(*s, " \t");
+  if (*start == '\0') {
+    *s = start;
+    return NULL;
+  }
+  char *end = start + strcspn(start, " \t");
+  if (*end != '\0') {
+    *end++ = '\0';
+  }
+  *s = end;
+  return start;
+}
 static void maf_failBadFormat(uint64_t lineNumber, char *errorMessage) {
   fprintf(stderr, "The maf sequence at line %" PRIi64 " is incorrectly formatted: %s\n",
           lineNumber, errorMessage);
@@ -258,7 +273,8 @@ mafLine_t* maf_newMafLineFromString(const char *s, uint64_t lineNumber) {
     return ml;
   }
   char *tkn = NULL;
-  tkn = strtok(cline, " \t");
+  char *rest = cline;
+  tkn = maf_nextField(&rest);
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
@@ -266,7 +282,7 @@ mafLine_t* maf_newMafLineFromString(const char *s, uint64_t lineNumber) {
     sprintf(error, "Unable to separate line on tabs and spaces at line definition field:\n%s", s);
     maf_failBadFormat(lineNumber, error);
   }
-  tkn = strtok(NULL, " \t"); // name field
+  tkn = maf_nextField(&rest); // name field
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
@@ -275,21 +291,21 @@ mafLine_t* maf_newMafLineFromString(const char *s, uint64_t lineNumber) {
   char *species = (char *) de_malloc(strlen(tkn) + 1);
   strcpy(species, tkn);
   ml->species = species;
-  tkn = strtok(NULL, " \t"); // start position
+  tkn = maf_nextField(&rest); // start position
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
     maf_failBadFormat(lineNumber, "Unable to separate line on tabs and spaces at start position field.");
   }
   ml->start = strtoul(tkn, NULL, 10);
-  tkn = strtok(NULL, " \t"); // length position
+  tkn = maf_nextField(&rest); // length position
   if (tkn == NULL){
     free(cline);
     cline = NULL;
     maf_failBadFormat(lineNumber, "Unable to separate line on tabs and spaces at length position field.");
   }
   ml->length = strtoul(tkn, NULL, 10);
-  tkn = strtok(NULL, " \t"); // strand
+  tkn = maf_nextField(&rest); // strand
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
@@ -301,14 +317,14 @@ mafLine_t* maf_newMafLineFromString(const char *s, uint64_t lineNumber) {
     maf_failBadFormat(lineNumber, error);
   }
   ml->strand = tkn[0];
-  tkn = strtok(NULL, " \t"); // source length position
+  tkn = maf_nextField(&rest); // source length position
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
     maf_failBadFormat(lineNumber, "Unable to separate line on tabs and spaces at source length field.");
   }
   ml->sourceLength = strtoul(tkn, NULL, 10);
-  tkn = strtok(NULL, " \t"); // sequence field
+  tkn = maf_nextField(&rest); // sequence field
   if (tkn == NULL) {
     free(cline);
     cline = NULL;
@@ -440,6 +456,26 @@ char* maf_mafFileApi_getFilename(mafFileApi_t *mfa) {
 uint64_t maf_mafFileApi_getLineNumber(mafFileApi_t *mfa) {
   return mfa->lineNumber;
 }
+int64_t maf_mafFileApi_tell(mafFileApi_t *mfa) {
+  // the byte offset from which the next maf_readBlock() will read, or -1 if the next block has
+  // already been started (the first block of a file whose header is not followed by a blank
+  // line) or the position can not be had.
+  if (mfa->lastLine != NULL) {
+    return -1;
+  }
+  return (int64_t) ftell(mfa->mfp);
+}
+void maf_mafFileApi_seek(mafFileApi_t *mfa, int64_t offset, uint64_t lineNumber) {
+  // move to an offset returned by maf_mafFileApi_tell() when the last line read was lineNumber.
+  // seeking to offset 0 with lineNumber 0 starts the file over, header and all.
+  if (fseek(mfa->mfp, (long) offset, SEEK_SET) != 0) {
+    fprintf(stderr, "Error, unable to seek to byte %" PRIi64 " of %s\n", offset, mfa->filename);
+    exit(EXIT_FAILURE);
+  }
+  mfa->lineNumber = lineNumber;
+  free(mfa->lastLine);
+  mfa->lastLine = NULL;
+}
 mafLine_t* maf_mafBlock_getHeadLine(mafBlock_t *mb) {
   return mb->headLine;
 }
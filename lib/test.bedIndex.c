@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "CuTest.h"
+#include "common.h"
+#include "bedIndex.h"
+#include "test.bedIndex.h"
+
+static bool bruteContains(uint64_t intervals[][2], uint64_t n, uint64_t pos) {
+  for (uint64_t i = 0; i < n; ++i) {
+    if ((intervals[i][0] <= pos) && (pos < intervals[i][1])) {
+      return true;
+    }
+  }
+  return false;
+}
+static void test_bedIndex_contains_0(CuTest *testCase) {
+  // unsorted, overlapping, abutting and empty intervals
+  uint64_t intervals[][2] = {{50, 60}, {10, 20}, {15, 25}, {25, 30}, {100, 101},
+                             {40, 40}, {70, 90}, {75, 80}, {0, 1}};
+  uint64_t n = sizeof(intervals) / sizeof(intervals[0]);
+  bedIndex_t *bi = bed_newIndex();
+  for (uint64_t i = 0; i < n; ++i) {
+    bed_addInterval(bi, "seqB", intervals[i][0], intervals[i][1]);
+  }
+  bed_addInterval(bi, "seqA", 5, 6);
+  bed_finalizeIndex(bi);
+  CuAssertTrue(testCase, bed_getNumberOfSequences(bi) == 2);
+  CuAssertTrue(testCase, strcmp(bed_intervals_getName(bed_getIntervalsByIndex(bi, 0)), "seqA") == 0);
+  bedIntervals_t *bis = bed_getIntervals(bi, "seqB");
+  CuAssertTrue(testCase, bis != NULL);
+  CuAssertTrue(testCase, bed_getIntervals(bi, "seqC") == NULL);
+  // {0, 1}, {10, 30}, {50, 60}, {70, 90}, {100, 101}
+  CuAssertTrue(testCase, bed_intervals_getNumberOfIntervals(bis) == 5);
+  CuAssertTrue(testCase, bed_intervals_getStart(bis, 1) == 10);
+  CuAssertTrue(testCase, bed_intervals_getEnd(bis, 1) == 30);
+  CuAssertTrue(testCase, bed_intervals_getTotalLength(bis) == 1 + 20 + 10 + 20 + 1);
+  for (uint64_t pos = 0; pos < 110; ++pos) {
+    bool expected = bruteContains(intervals, n, pos);
+    CuAssertTrue(testCase, bed_intervals_contains(bis, pos) == expected);
+    CuAssertTrue(testCase, bed_contains(bi, "seqB", pos) == expected);
+    CuAssertTrue(testCase, bed_contains(bi, "seqA", pos) == (pos == 5));
+    CuAssertTrue(testCase, bed_contains(bi, "seqC", pos) == false);
+  }
+  // cursor walks in both directions, and a jump
+  bedCursor_t bc;
+  bed_cursor_init(&bc, bis);
+  for (uint64_t pos = 0; pos < 110; ++pos) {
+    CuAssertTrue(testCase, bed_cursor_contains(&bc, pos) == bruteContains(intervals, n, pos));
+  }
+  for (uint64_t pos = 110; pos > 0; --pos) {
+    CuAssertTrue(testCase, bed_cursor_contains(&bc, pos - 1) == bruteContains(intervals, n, pos - 1));
+  }
+  CuAssertTrue(testCase, bed_cursor_contains(&bc, 100) == true);
+  CuAssertTrue(testCase, bed_cursor_contains(&bc, 12) == true);
+  bed_cursor_init(&bc, NULL);
+  CuAssertTrue(testCase, bed_cursor_contains(&bc, 12) == false);
+  bed_destroyIndex(bi);
+}
+static void test_bedIndex_readFile_0(CuTest *testCase) {
+  mkdir("test_tmp", S_IRWXU | S_IRUSR | S_IXUSR | S_IWUSR);
+  FILE *f = de_fopen("test_tmp/test.bed", "w");
+  fprintf(f, "track name=test\n"
+          "chr2\t100\t200\n"
+          "\n"
+          "chr1 5 10 name 0 +\n"
+          "chr2\t150\t250");
+  fclose(f);
+  f = de_fopen("test_tmp/test2.bed", "w");
+  fprintf(f, "chr3\t0\t1\n");
+  fclose(f);
+  bedIndex_t *bi = bed_newIndex();
+  bed_readFiles(bi, "test_tmp/test.bed,test_tmp/test2.bed");
+  bed_finalizeIndex(bi);
+  CuAssertTrue(testCase, bed_getNumberOfSequences(bi) == 3);
+  CuAssertTrue(testCase, bed_intervals_getNumberOfIntervals(bed_getIntervals(bi, "chr2")) == 1);
+  CuAssertTrue(testCase, bed_contains(bi, "chr2", 249));
+  CuAssertTrue(testCase, !bed_contains(bi, "chr2", 250));
+  CuAssertTrue(testCase, bed_contains(bi, "chr1", 5));
+  CuAssertTrue(testCase, !bed_contains(bi, "chr1", 10));
+  CuAssertTrue(testCase, bed_contains(bi, "chr3", 0));
+  bed_destroyIndex(bi);
+  unlink("test_tmp/test.bed");
+  unlink("test_tmp/test2.bed");
+  rmdir("test_tmp");
+}
+CuSuite* bedIndex_TestSuite(void) {
+  CuSuite* suite = CuSuiteNew();
+  SUITE_ADD_TEST(suite, test_bedIndex_contains_0);
+  SUITE_ADD_TEST(suite, test_bedIndex_readFile_0);
+  return suite;
+}
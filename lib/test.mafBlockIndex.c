@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "CuTest.h"
+#include "common.h"
+#include "sharedMaf.h"
+#include "bedIndex.h"
+#include "mafBlockIndex.h"
+#include "test.mafBlockIndex.h"
+
+static void writeMaf(const char *filename, bool blankAfterHeader) {
+  FILE *f = de_fopen(filename, "w");
+  fprintf(f, "##maf version=1\n");
+  if (blankAfterHeader) {
+    fprintf(f, "\n");
+  }
+  fprintf(f, "a score=0\n"
+          "s A.chr1 0 10 + 100 ACGTACGTAC\n"
+          "s B.chr1 20 10 - 50 ACGTACGTAC\n"
+          "\n"
+          "a score=1\n"
+          "s A.chr1 40 5 + 100 ACGTA\n"
+          "\n"
+          "a score=2\n"
+          "s B.chr1 0 5 + 50 ACGTA\n"
+          "s A.chr1 5 30 + 100 ACGTACGTACACGTACGTACACGTACGTAC\n"
+          "\n");
+  fclose(f);
+}
+static uint64_t firstLineNumber(mafBlock_t *mb) {
+  return maf_mafLine_getLineNumber(maf_mafBlock_getHeadLine(mb));
+}
+static void checkIndex(CuTest *testCase, mafBlockIndex_t *mbi, const char *filename, bool blankAfterHeader) {
+  CuAssertTrue(testCase, mafBlockIndex_getNumberOfBlocks(mbi) == 3);
+  CuAssertTrue(testCase, mafBlockIndex_getNumberOfSequences(mbi) == 2);
+  CuAssertTrue(testCase, strcmp(mafBlockIndex_getSequenceName(mbi, 0), "A.chr1") == 0);
+  CuAssertTrue(testCase, strcmp(mafBlockIndex_getSequenceName(mbi, 1), "B.chr1") == 0);
+  CuAssertTrue(testCase, mafBlockIndex_getSourceLength(mbi, 0) == 100);
+  CuAssertTrue(testCase, mafBlockIndex_getSourceLength(mbi, 1) == 50);
+  // blocks come back in any order, with their line numbers intact
+  uint64_t offset = blankAfterHeader ? 1 : 0;
+  uint64_t expected[] = {2 + offset, 6 + offset, 9 + offset};
+  mafFileApi_t *mfa = maf_newMfa(filename, "r");
+  for (uint64_t i = 3; i > 0; --i) {
+    mafBlock_t *mb = mafBlockIndex_readBlock(mbi, mfa, i - 1);
+    CuAssertTrue(testCase, mb != NULL);
+    CuAssertTrue(testCase, firstLineNumber(mb) == expected[i - 1]);
+    maf_destroyMafBlockList(mb);
+  }
+  mafBlock_t *mb = mafBlockIndex_readBlock(mbi, mfa, 0);
+  CuAssertTrue(testCase, firstLineNumber(mb) == expected[0]);
+  maf_destroyMafBlockList(mb);
+  maf_destroyMfa(mfa);
+}
+static void checkFind(CuTest *testCase, mafBlockIndex_t *mbi, const char *name, uint64_t start,
+                      uint64_t end, uint64_t slop, uint64_t n, uint64_t *expected) {
+  bedIndex_t *bi = bed_newIndex();
+  bed_addInterval(bi, name, start, end);
+  bed_finalizeIndex(bi);
+  uint64_t numBlocks;
+  uint64_t *blocks = mafBlockIndex_findBlocks(mbi, bi, slop, &numBlocks);
+  CuAssertTrue(testCase, numBlocks == n);
+  for (uint64_t i = 0; i < n && i < numBlocks; ++i) {
+    CuAssertTrue(testCase, blocks[i] == expected[i]);
+  }
+  free(blocks);
+  bed_destroyIndex(bi);
+}
+static void test_mafBlockIndex_build_0(CuTest *testCase) {
+  mkdir("test_tmp", S_IRWXU | S_IRUSR | S_IXUSR | S_IWUSR);
+  for (int blank = 0; blank < 2; ++blank) {
+    writeMaf("test_tmp/test.maf", blank);
+    mafBlockIndex_t *mbi = mafBlockIndex_build("test_tmp/test.maf");
+    checkIndex(testCase, mbi, "test_tmp/test.maf", blank);
+    mafBlockIndex_destroy(mbi);
+  }
+  unlink("test_tmp/test.maf");
+  rmdir("test_tmp");
+}
+static void test_mafBlockIndex_findBlocks_0(CuTest *testCase) {
+  // A.chr1 rows: [0, 10) in 0, [40, 45) in 1, [5, 35) in 2
+  // B.chr1 rows: [20, 30) in 0 (- strand 20 10 of 50), [0, 5) in 2
+  mkdir("test_tmp", S_IRWXU | S_IRUSR | S_IXUSR | S_IWUSR);
+  writeMaf("test_tmp/test.maf", true);
+  mafBlockIndex_t *mbi = mafBlockIndex_build("test_tmp/test.maf");
+  uint64_t b0[] = {0}, b1[] = {1}, b2[] = {2}, b02[] = {0, 2}, b12[] = {1, 2}, b012[] = {0, 1, 2};
+  checkFind(testCase, mbi, "A.chr1", 0, 1, 0, 1, b0);
+  checkFind(testCase, mbi, "A.chr1", 9, 10, 0, 2, b02);
+  checkFind(testCase, mbi, "A.chr1", 34, 40, 0, 1, b2);
+  checkFind(testCase, mbi, "A.chr1", 35, 40, 0, 0, NULL);
+  checkFind(testCase, mbi, "A.chr1", 35, 40, 1, 2, b12);
+  checkFind(testCase, mbi, "A.chr1", 0, 100, 0, 3, b012);
+  checkFind(testCase, mbi, "A.chr1", 44, 100, 0, 1, b1);
+  checkFind(testCase, mbi, "B.chr1", 20, 25, 0, 1, b0);
+  checkFind(testCase, mbi, "B.chr1", 30, 50, 0, 0, NULL);
+  checkFind(testCase, mbi, "C.chr1", 0, 50, 10, 0, NULL);
+  mafBlockIndex_destroy(mbi);
+  unlink("test_tmp/test.maf");
+  rmdir("test_tmp");
+}
+static void test_mafBlockIndex_readWrite_0(CuTest *testCase) {
+  mkdir("test_tmp", S_IRWXU | S_IRUSR | S_IXUSR | S_IWUSR);
+  writeMaf("test_tmp/test.maf", false);
+  CuAssertTrue(testCase, mafBlockIndex_read("test_tmp/test.maf.mbi", "test_tmp/test.maf") == NULL);
+  mafBlockIndex_t *mbi = mafBlockIndex_load("test_tmp/test.maf");
+  mafBlockIndex_destroy(mbi);
+  mbi = mafBlockIndex_read("test_tmp/test.maf.mbi", "test_tmp/test.maf");
+  CuAssertTrue(testCase, mbi != NULL);
+  checkIndex(testCase, mbi, "test_tmp/test.maf", false);
+  uint64_t b02[] = {0, 2};
+  checkFind(testCase, mbi, "A.chr1", 9, 10, 0, 2, b02);
+  mafBlockIndex_destroy(mbi);
+  // a maf that changes size makes the saved index stale...
+  FILE *f = de_fopen("test_tmp/test.maf", "a");
+  fprintf(f, "a score=3\ns A.chr1 90 1 + 100 A\n\n");
+  fclose(f);
+  CuAssertTrue(testCase, mafBlockIndex_read("test_tmp/test.maf.mbi", "test_tmp/test.maf") == NULL);
+  mbi = mafBlockIndex_load("test_tmp/test.maf");
+  CuAssertTrue(testCase, mafBlockIndex_getNumberOfBlocks(mbi) == 4);
+  mafBlockIndex_destroy(mbi);
+  // nor does rewriting it in place with the same size
+  f = de_fopen("test_tmp/test.maf", "r+");
+  fprintf(f, "##maf version=2");
+  fclose(f);
+  CuAssertTrue(testCase, mafBlockIndex_read("test_tmp/test.maf.mbi", "test_tmp/test.maf") == NULL);
+  mbi = mafBlockIndex_load("test_tmp/test.maf");
+  mafBlockIndex_destroy(mbi);
+  // a count larger than the index can hold is rejected before it is allocated, and rebuilt
+  uint64_t numBlocks = UINT64_C(1) << 60;
+  f = de_fopen("test_tmp/test.maf.mbi", "r+b");
+  CuAssertTrue(testCase, fseek(f, 5 * sizeof(numBlocks), SEEK_SET) == 0);
+  CuAssertTrue(testCase, fwrite(&numBlocks, sizeof(numBlocks), 1, f) == 1);
+  fclose(f);
+  CuAssertTrue(testCase, mafBlockIndex_read("test_tmp/test.maf.mbi", "test_tmp/test.maf") == NULL);
+  mbi = mafBlockIndex_load("test_tmp/test.maf");
+  CuAssertTrue(testCase, mafBlockIndex_getNumberOfBlocks(mbi) == 4);
+  mafBlockIndex_destroy(mbi);
+  // as is one cut short
+  char buffer[4096];
+  f = de_fopen("test_tmp/test.maf.mbi", "rb");
+  size_t n = fread(buffer, 1, sizeof(buffer), f);
+  fclose(f);
+  CuAssertTrue(testCase, n > 8 && n < sizeof(buffer));
+  f = de_fopen("test_tmp/test.maf.mbi", "wb");
+  CuAssertTrue(testCase, fwrite(buffer, 1, n - 8, f) == n - 8);
+  fclose(f);
+  CuAssertTrue(testCase, mafBlockIndex_read("test_tmp/test.maf.mbi", "test_tmp/test.maf") == NULL);
+  // garbage is not an index
+  f = de_fopen("test_tmp/test.maf.mbi", "w");
+  fprintf(f, "not an index\n");
+  fclose(f);
+  CuAssertTrue(testCase, mafBlockIndex_read("test_tmp/test.maf.mbi", "test_tmp/test.maf") == NULL);
+  unlink("test_tmp/test.maf.mbi");
+  unlink("test_tmp/test.maf");
+  rmdir("test_tmp");
+}
+CuSuite* mafBlockIndex_TestSuite(void) {
+  CuSuite* suite = CuSuiteNew();
+  SUITE_ADD_TEST(suite, test_mafBlockIndex_build_0);
+  SUITE_ADD_TEST(suite, test_mafBlockIndex_findBlocks_0);
+  SUITE_ADD_TEST(suite, test_mafBlockIndex_readWrite_0);
+  return suite;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "CuTest.h"
+#include "common.h"
+#include "sharedMaf.h"
+#include "mafPartition.h"
+#include "test.mafPartition.h"
+
+static void writeMaf(const char *filename) {
+  // blocks 0 and 2 share B.chr1, blocks 1, 3 and 5 are joined by block 5, block 4 has only C.chr3
+  FILE *f = de_fopen(filename, "w");
+  fprintf(f, "##maf version=1\n"
+          "\n"
+          "a score=0\n"
+          "s A.chr1 0 4 + 100 ACGT\n"
+          "s B.chr1 0 4 + 100 ACGT\n"
+          "\n"
+          "a score=1\n"
+          "s C.chr1 0 2 + 100 AC\n"
+          "\n"
+          "a score=2\n"
+          "s B.chr1 10 3 + 100 GGC\n"
+          "s D.chr1 10 3 - 100 GGC\n"
+          "\n"
+          "a score=3\n"
+          "s C.chr2 0 2 + 100 TT\n"
+          "\n"
+          "a score=4\n"
+          "s C.chr3 0 2 + 100 AA\n"
+          "\n"
+          "a score=5\n"
+          "s C.chr2 5 2 + 100 GG\n"
+          "s C.chr1 5 2 + 100 GG\n"
+          "\n");
+  fclose(f);
+}
+static mafPartition_t* partitionOf(const char *filename, mafPartition_isKey_t isKey, void *arg) {
+  mafFileApi_t *mfa = maf_newMfa(filename, "r");
+  mafPartition_t *mp = mafPartition_build(mfa, "test_tmp", "test", isKey, arg);
+  maf_destroyMfa(mfa);
+  return mp;
+}
+static void checkPart(CuTest *testCase, mafPartition_t *mp, uint64_t p, const char *name,
+                      uint64_t n, uint64_t *blocks, uint64_t *lineNumbers) {
+  CuAssertStrEquals(testCase, name, mafPartition_getPartName(mp, p));
+  CuAssertTrue(testCase, mafPartition_getNumberOfPartBlocks(mp, p) == n);
+  for (uint64_t i = n; i > 0; --i) {
+    CuAssertTrue(testCase, mafPartition_getBlockIndex(mp, p, i - 1) == blocks[i - 1]);
+    mafBlock_t *mb = mafPartition_readBlock(mp, p, i - 1);
+    CuAssertTrue(testCase, mb != NULL);
+    CuAssertTrue(testCase, maf_mafLine_getLineNumber(maf_mafBlock_getHeadLine(mb)) == lineNumbers[i - 1]);
+    maf_destroyMafBlockList(mb);
+  }
+}
+static bool isChr1(mafBlock_t *mb, mafLine_t *ml, void *arg) {
+  (void) mb;
+  (void) arg;
+  char *name = maf_mafLine_getSpecies(ml);
+  return strcmp(name + strlen(name) - 5, ".chr1") == 0;
+}
+static void test_mafPartition_build_0(CuTest *testCase) {
+  // every sequence line is a key
+  mkdir("test_tmp", S_IRWXU | S_IRUSR | S_IXUSR | S_IWUSR);
+  writeMaf("test_tmp/test.maf");
+  mafPartition_t *mp = partitionOf("test_tmp/test.maf", NULL, NULL);
+  CuAssertTrue(testCase, mafPartition_getNumberOfBlocks(mp) == 6);
+  CuAssertTrue(testCase, mafPartition_getNumberOfParts(mp) == 3);
+  uint64_t b0[] = {0, 2}, l0[] = {3, 10};
+  uint64_t b1[] = {1, 3, 5}, l1[] = {7, 14, 20};
+  uint64_t b2[] = {4}, l2[] = {17};
+  checkPart(testCase, mp, 0, "A.chr1", 2, b0, l0);
+  checkPart(testCase, mp, 1, "C.chr1", 3, b1, l1);
+  checkPart(testCase, mp, 2, "C.chr3", 1, b2, l2);
+  mafPartition_destroy(mp);
+  // the spool is gone as soon as it is opened, leaving only the maf
+  unlink("test_tmp/test.maf");
+  CuAssertTrue(testCase, rmdir("test_tmp") == 0);
+}
+static void test_mafPartition_build_1(CuTest *testCase) {
+  // only the .chr1 lines are keys, so blocks 3 and 4 are dropped and 5 joins C.chr1 alone
+  mkdir("test_tmp", S_IRWXU | S_IRUSR | S_IXUSR | S_IWUSR);
+  writeMaf("test_tmp/test.maf");
+  mafPartition_t *mp = partitionOf("test_tmp/test.maf", isChr1, NULL);
+  CuAssertTrue(testCase, mafPartition_getNumberOfBlocks(mp) == 4);
+  CuAssertTrue(testCase, mafPartition_getNumberOfParts(mp) == 2);
+  uint64_t b0[] = {0, 2}, l0[] = {3, 10};
+  uint64_t b1[] = {1, 3}, l1[] = {7, 20};
+  checkPart(testCase, mp, 0, "A.chr1", 2, b0, l0);
+  checkPart(testCase, mp, 1, "C.chr1", 2, b1, l1);
+  mafPartition_destroy(mp);
+  unlink("test_tmp/test.maf");
+  rmdir("test_tmp");
+}
+static void test_mafPartition_build_2(CuTest *testCase) {
+  // enough names to grow the name table: a chain of 300 blocks, each sharing a sequence with
+  // the next, interleaved with 300 blocks of their own
+  mkdir("test_tmp", S_IRWXU | S_IRUSR | S_IXUSR | S_IWUSR);
+  FILE *f = de_fopen("test_tmp/test.maf", "w");
+  fprintf(f, "##maf version=1\n\n");
+  for (uint64_t i = 0; i < 300; ++i) {
+    fprintf(f, "a score=0\ns N%" PRIu64 ".chr1 0 1 + 10 A\ns N%" PRIu64 ".chr1 0 1 + 10 A\n\n", i, i + 1);
+    fprintf(f, "a score=0\ns S%" PRIu64 ".chr1 0 1 + 10 A\n\n", i);
+  }
+  fclose(f);
+  mafPartition_t *mp = partitionOf("test_tmp/test.maf", NULL, NULL);
+  CuAssertTrue(testCase, mafPartition_getNumberOfBlocks(mp) == 600);
+  CuAssertTrue(testCase, mafPartition_getNumberOfParts(mp) == 301);
+  CuAssertStrEquals(testCase, "N0.chr1", mafPartition_getPartName(mp, 0));
+  CuAssertTrue(testCase, mafPartition_getNumberOfPartBlocks(mp, 0) == 300);
+  for (uint64_t i = 0; i < 300; ++i) {
+    CuAssertTrue(testCase, mafPartition_getBlockIndex(mp, 0, i) == 2 * i);
+    char name[32];
+    sprintf(name, "S%" PRIu64 ".chr1", i);
+    CuAssertStrEquals(testCase, name, mafPartition_getPartName(mp, i + 1));
+    CuAssertTrue(testCase, mafPartition_getNumberOfPartBlocks(mp, i + 1) == 1);
+    CuAssertTrue(testCase, mafPartition_getBlockIndex(mp, i + 1, 0) == 2 * i + 1);
+  }
+  mafPartition_destroy(mp);
+  unlink("test_tmp/test.maf");
+  rmdir("test_tmp");
+}
+typedef struct reported {
+  char buffer[1024];
+  uint64_t numBuilt;
+} reported_t;
+static void* buildCount(mafPartition_t *mp, uint64_t p, void *arg) {
+  (void) arg;
+  char *built = de_malloc(64);
+  sprintf(built, "%s:%" PRIu64 " ", mafPartition_getPartName(mp, p), mafPartition_getNumberOfPartBlocks(mp, p));
+  return built;
+}
+static void reportCount(void *built, void *arg) {
+  reported_t *r = (reported_t*) arg;
+  strcat(r->buffer, (char*) built);
+  ++(r->numBuilt);
+}
+static void destroyCount(void *built, void *arg) {
+  (void) arg;
+  free(built);
+}
+static void test_mafPartition_buildInOrder_0(CuTest *testCase) {
+  // parts are reported in order, however many threads build them
+  mkdir("test_tmp", S_IRWXU | S_IRUSR | S_IXUSR | S_IWUSR);
+  writeMaf("test_tmp/test.maf");
+  mafPartition_t *mp = partitionOf("test_tmp/test.maf", NULL, NULL);
+  for (uint64_t numThreads = 1; numThreads <= 8; ++numThreads) {
+    reported_t r;
+    r.buffer[0] = '\0';
+    r.numBuilt = 0;
+    mafPartition_buildInOrder(mp, numThreads, buildCount, reportCount, destroyCount, &r);
+    CuAssertStrEquals(testCase, "A.chr1:2 C.chr1:3 C.chr3:1 ", r.buffer);
+    CuAssertTrue(testCase, r.numBuilt == 3);
+  }
+  mafPartition_destroy(mp);
+  unlink("test_tmp/test.maf");
+  rmdir("test_tmp");
+}
+CuSuite* mafPartition_TestSuite(void) {
+  CuSuite* suite = CuSuiteNew();
+  SUITE_ADD_TEST(suite, test_mafPartition_build_0);
+  SUITE_ADD_TEST(suite, test_mafPartition_build_1);
+  SUITE_ADD_TEST(suite, test_mafPartition_build_2);
+  SUITE_ADD_TEST(suite, test_mafPartition_buildInOrder_0);
+  return suite;
+}
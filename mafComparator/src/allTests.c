@@ -28,18 +28,38 @@
 #include "CuTest.h"
 #include "comparatorAPI.h"
 #include "test.comparatorAPI.h"
+#include "test.comparatorAdaptive.h"
+#include "test.comparatorCount.h"
+#include "test.comparatorExact.h"
 #include "test.comparatorRandom.h"
+#include "test.comparatorSampleFile.h"
+#include "test.comparatorSpill.h"
 
 CuSuite* comparatorAPI_TestSuite(void);
 CuSuite* comparatorRandom_TestSuite(void);
+CuSuite* comparatorExact_TestSuite(void);
+CuSuite* comparatorAdaptive_TestSuite(void);
+CuSuite* comparatorCount_TestSuite(void);
+CuSuite* comparatorSpill_TestSuite(void);
+CuSuite* comparatorSampleFile_TestSuite(void);
 
 int comparator_RunAllTests(void) {
     CuString *output = CuStringNew();
     CuSuite *suite = CuSuiteNew();
     CuSuite *comparatorAPI_s = comparatorAPI_TestSuite();
     CuSuite *comparatorRandom_s = comparatorRandom_TestSuite();
+    CuSuite *comparatorSampleFile_s = comparatorSampleFile_TestSuite();
+    CuSuite *comparatorExact_s = comparatorExact_TestSuite();
+    CuSuite *comparatorAdaptive_s = comparatorAdaptive_TestSuite();
+    CuSuite *comparatorCount_s = comparatorCount_TestSuite();
+    CuSuite *comparatorSpill_s = comparatorSpill_TestSuite();
     CuSuiteAddSuite(suite, comparatorAPI_s);
     CuSuiteAddSuite(suite, comparatorRandom_s);
+    CuSuiteAddSuite(suite, comparatorSampleFile_s);
+    CuSuiteAddSuite(suite, comparatorExact_s);
+    CuSuiteAddSuite(suite, comparatorAdaptive_s);
+    CuSuiteAddSuite(suite, comparatorCount_s);
+    CuSuiteAddSuite(suite, comparatorSpill_s);
     CuSuiteRun(suite);
     CuSuiteSummary(suite, output);
     CuSuiteDetails(suite, output);
@@ -48,6 +68,11 @@ int comparator_RunAllTests(void) {
     int status = (suite->failCount > 0);
     free(comparatorAPI_s);
     free(comparatorRandom_s);
+    free(comparatorSampleFile_s);
+    free(comparatorExact_s);
+    free(comparatorAdaptive_s);
+    free(comparatorCount_s);
+    free(comparatorSpill_s);
     CuSuiteDelete(suite);
     return status;
 }
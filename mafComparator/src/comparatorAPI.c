@@ -25,12 +25,18 @@
  * THE SOFTWARE.
 */
 
+#include <ctype.h>
 #include <math.h>
+#include <pthread.h>
 #include <string.h>
 #include "sonLib.h"
 #include "common.h"
+#include "mafBlockIndex.h"
 #include "comparatorAPI.h"
+#include "comparatorAdaptive.h"
+#include "comparatorCount.h"
 #include "comparatorRandom.h"
+#include "comparatorSpill.h"
 
 const unsigned kChooseTwoCacheLength = 101;
 
@@ -80,12 +86,26 @@ Options* options_construct(void) {
     o->wiggleRegionStop = 0;
     o->numPairsString = NULL;
     o->legitSequences = NULL;
+    o->writeSamples = NULL;
+    o->readSamples = NULL;
     o->numberOfSamples = 1000000; // by default do a million samples per file pair.
     o->randomSeed = (time(NULL) << 16) | (getpid() & 65535); // Likely to be unique
     o->near = 0;
     o->numPairs1 = 0;
     o->numPairs2 = 0;
     o->wiggleBinLength = 100000; // by default have bins of length 100,000
+    o->numThreads = 1;
+    o->exact = false;
+    o->sortMemory = (uint64_t) 1 << 30;
+    o->tempDir = NULL;
+    o->ciWidth = 0.0;
+    o->ciLevel = 0.95;
+    o->region = NULL;
+    o->regionBed = NULL;
+    o->regions = NULL;
+    o->blockIndexes = NULL;
+    o->maxMemory = 0;
+    o->noCache = false;
     return o;
 }
 APair* aPair_construct(const char *seq1, const char *seq2, uint64_t pos1, uint64_t pos2) {
@@ -146,6 +166,17 @@ void options_destruct(Options *o) {
     free(o->wigglePairs);
     free(o->legitSequences);
     free(o->numPairsString);
+    free(o->writeSamples);
+    free(o->readSamples);
+    free(o->tempDir);
+    free(o->region);
+    free(o->regionBed);
+    if (o->regions != NULL) {
+        bed_destroyIndex(o->regions);
+    }
+    if (o->blockIndexes != NULL) {
+        stHash_destruct(o->blockIndexes);
+    }
     free(o);
     o = NULL;
 }
@@ -259,6 +290,39 @@ int aPair_cmpFunction(APair *p1, APair *p2) {
     }
     return i;
 }
+int aPair_cmpFunction_pos2(APair *p1, APair *p2) {
+    /*
+     * Compares the sequences, then the second position, then the first. Orders the pairs sharing
+     * seq1, seq2 and pos2 by pos1, see constructPairsByPos2().
+     */
+    int i = strcmpnull(p1->seq1, p2->seq1);
+    if (i == 0) {
+        i = strcmpnull(p1->seq2, p2->seq2);
+    }
+    if (i == 0) {
+        if (p1->pos2 != p2->pos2) {
+            i = (p1->pos2 < p2->pos2) ? -1 : 1;
+        } else if (p1->pos1 != p2->pos1) {
+            i = (p1->pos1 < p2->pos1) ? -1 : 1;
+        }
+    }
+    return i;
+}
+stSortedSet* constructPairsByPos2(stSortedSet *sampledPairs, uint64_t near) {
+    // the sampled pairs again, ordered by aPair_cmpFunction_pos2(), for recordNearPair(). Holds
+    // no pairs of its own. NULL when near is 0 since it is then not needed.
+    if (near == 0) {
+        return NULL;
+    }
+    stSortedSet *byPos2 = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_pos2, NULL);
+    stSortedSetIterator *sit = stSortedSet_getIterator(sampledPairs);
+    APair *pair = NULL;
+    while ((pair = stSortedSet_getNext(sit)) != NULL) {
+        stSortedSet_insert(byPos2, pair);
+    }
+    stSortedSet_destructIterator(sit);
+    return byPos2;
+}
 uint64_t aPositionKey(const void *p) {
     // maybe not the best composite hash function,
     APosition *pos = (APosition*) p;
@@ -440,10 +504,27 @@ uint64_t walkBlockCountingPairs(mafBlock_t *mb, stSet *legitSequences, uint64_t
     char **names = maf_mafBlock_getSpeciesArray(mb);
     char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
     bool *legitRows = getLegitRows(names, numSeqs, legitSequences);
+    // tally the gapless legit rows of every column, row by row rather than column by column, so
+    // that the matrix is read in order and the inner loop is vectorizable.
+    uint64_t *possiblePartners = (uint64_t*) st_calloc(seqFieldLength, sizeof(*possiblePartners));
+    for (uint64_t r = 0; r < numSeqs; ++r) {
+        if (!legitRows[r]) {
+            continue;
+        }
+        const char *row = mat[r];
+        for (uint64_t c = 0; c < seqFieldLength; ++c) {
+            possiblePartners[c] += (row[c] != '-');
+        }
+    }
     for (uint64_t c = 0; c < seqFieldLength; ++c) {
-        count += countPairsInColumn(mat, c, numSeqs, legitRows, chooseTwoArray);
+        if (possiblePartners[c] < kChooseTwoCacheLength) {
+            count += chooseTwoArray[possiblePartners[c]];
+        } else {
+            count += chooseTwo(possiblePartners[c]);
+        }
     }
     // clean up
+    free(possiblePartners);
     for (uint64_t i = 0; i < numSeqs; ++i) {
         free(names[i]);
     }
@@ -523,40 +604,71 @@ void samplePairsFromColumn(double acceptProbability,
     // numSeqs is the number of sequences in either array, columnMlArray is an array that contains
     // pointers to mafLine_t's and columnPositions is an array that contains the current position
     // of the sequence
+    samplePairsFromRun(acceptProbability, pairs, numSeqs, 1, chooseTwoArray, nameArray, columnPositions, NULL);
+}
+void samplePairsFromRun(double acceptProbability, stSortedSet *pairs, uint64_t numSeqs, uint64_t runLength,
+                        uint64_t *chooseTwoArray, char **nameArray, uint64_t *runPositions, int *runStrandInts) {
+    // a run is runLength consecutive columns that all share the same numSeqs gapless sequences.
+    // runPositions contains the position of each sequence in the first column of the run and
+    // runStrandInts its strand (+1 or -1), which may be NULL if runLength is 1. All three arrays
+    // are free'd.
     uint64_t numPairs;
     if (numSeqs < kChooseTwoCacheLength) {
         numPairs = chooseTwoArray[numSeqs];
     } else {
         numPairs = chooseTwo(numSeqs);
     }
-    if (numPairs < 5) {
+    if (numPairs == 0) {
+        // nothing to sample
+    } else if (numPairs * runLength < 5) {
         // keep in mind the sequence of values for v = k choose 2 is
         // k: 2 3 4  5 ...
         // v: 1 3 6 10 ...
-        samplePairsFromColumnBruteForce(acceptProbability, pairs,
-                                        chooseTwoArray, nameArray,
-                                        columnPositions, numSeqs, numPairs);
+        samplePairsFromRunBruteForce(acceptProbability, pairs,
+                                     chooseTwoArray, nameArray,
+                                     runPositions, runStrandInts, numSeqs, numPairs, runLength);
     } else {
-        samplePairsFromColumnAnalytic(acceptProbability, pairs,
-                                      chooseTwoArray, nameArray,
-                                      columnPositions, numSeqs, numPairs);
+        samplePairsFromRunAnalytic(acceptProbability, pairs,
+                                   chooseTwoArray, nameArray,
+                                   runPositions, runStrandInts, numSeqs, numPairs, runLength);
     }
     free(nameArray);
-    free(columnPositions);
+    free(runPositions);
+    free(runStrandInts);
+}
+static void insertRunPair(stSortedSet *pairs, uint64_t i, uint64_t numSeqs, uint64_t pairsPerColumn,
+                          char **nameArray, uint64_t *positions, int *strandInts) {
+    // i is an index into the run's pairs, which are laid out column by column, pairsPerColumn
+    // to a column. every row is gapless throughout the run so each position advances by its
+    // strand at each column.
+    uint64_t offset = i / pairsPerColumn;
+    uint64_t p1, p2;
+    arrayIndexToPairIndices(i % pairsPerColumn, numSeqs, &p1, &p2);
+    uint64_t pos1 = positions[p1];
+    uint64_t pos2 = positions[p2];
+    if (offset > 0) {
+        pos1 += strandInts[p1] * (int64_t) offset;
+        pos2 += strandInts[p2] * (int64_t) offset;
+    }
+    // printf("1. adding pair (%s %u):(%s %u)\n", nameArray[p1], pos1, nameArray[p2], pos2);
+    APair *aPair = aPair_construct(nameArray[p1], nameArray[p2], pos1, pos2);
+    stSortedSet_insert(pairs, aPair);
 }
 void samplePairsFromColumnBruteForce(double acceptProbability, stSortedSet *pairs,
                                      uint64_t *chooseTwoArray,
                                      char **nameArray, uint64_t *positions, uint64_t numSeqs,
                                      uint64_t numPairs) {
-    uint64_t p1, p2;
-    for (uint64_t i = 0; i < numPairs; ++i) {
+    samplePairsFromRunBruteForce(acceptProbability, pairs, chooseTwoArray, nameArray, positions, NULL,
+                                 numSeqs, numPairs, 1);
+}
+void samplePairsFromRunBruteForce(double acceptProbability, stSortedSet *pairs,
+                                  uint64_t *chooseTwoArray,
+                                  char **nameArray, uint64_t *positions, int *strandInts,
+                                  uint64_t numSeqs, uint64_t numPairs, uint64_t runLength) {
+    // numPairs is the number of pairs in one column of the run
+    for (uint64_t i = 0; i < numPairs * runLength; ++i) {
         if (st_random() <= acceptProbability) {
-            arrayIndexToPairIndices(i, numSeqs, &p1, &p2);
-            // printf("1. adding pair (%s %u):(%s %u)\n", maf_mafLine_getSpecies(mlArray[p1]),
-            //        positions[p1], maf_mafLine_getSpecies(mlArray[p2]), positions[p2]);
-            APair *aPair = aPair_construct(nameArray[p1], nameArray[p2],
-                                           positions[p1], positions[p2]);
-            stSortedSet_insert(pairs, aPair);
+            insertRunPair(pairs, i, numSeqs, numPairs, nameArray, positions, strandInts);
         }
     }
 }
@@ -564,6 +676,20 @@ void samplePairsFromColumnAnalytic(double acceptProbability, stSortedSet *pairs,
                                    uint64_t *chooseTwoArray,
                                    char **nameArray, uint64_t *positions, uint64_t numSeqs,
                                    uint64_t numPairs) {
+    samplePairsFromRunAnalytic(acceptProbability, pairs, chooseTwoArray, nameArray, positions, NULL,
+                               numSeqs, numPairs, 1);
+}
+void samplePairsFromRunAnalytic(double acceptProbability, stSortedSet *pairs,
+                                uint64_t *chooseTwoArray,
+                                char **nameArray, uint64_t *positions, int *strandInts,
+                                uint64_t numSeqs, uint64_t pairsPerColumn, uint64_t runLength) {
+    // one binomial draw covers every pair of every column in the run.
+    if (runLength > UINT64_MAX / pairsPerColumn) {
+        fprintf(stderr, "Error in samplePairsFromRunAnalytic(), run of %" PRIu64 " columns with %"
+                PRIu64 " pairs each overflows.\n", runLength, pairsPerColumn);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t numPairs = pairsPerColumn * runLength;
     uint64_t n = rbinom(numPairs, acceptProbability);
     if (n == 0) {
         return;
@@ -624,25 +750,18 @@ void samplePairsFromColumnAnalytic(double acceptProbability, stSortedSet *pairs,
     }
     stSetIterator *sit = stSet_getIterator(set);
     uint64_t *key = NULL;
-    uint64_t p1, p2;
     if (numPairsToSample == n) {
         // items in set *have* been sampled
         while ((key = stSet_getNext(sit)) != NULL) {
             // use nameArray
-            arrayIndexToPairIndices(*key, numSeqs, &p1, &p2);
-            APair *aPair = aPair_construct(nameArray[p1], nameArray[p2],
-                                           positions[p1], positions[p2]);
-            stSortedSet_insert(pairs, aPair);
+            insertRunPair(pairs, *key, numSeqs, pairsPerColumn, nameArray, positions, strandInts);
         }
     } else {
         // items in set *have not* been sampled
         for (i = 0; i < numPairs; ++i) {
             *randPair = i;
             if (stSet_search(set, randPair) == NULL) {
-                arrayIndexToPairIndices(i, numSeqs, &p1, &p2);
-                APair *aPair = aPair_construct(nameArray[p1], nameArray[p2],
-                                               positions[p1], positions[p2]);
-                stSortedSet_insert(pairs, aPair);
+                insertRunPair(pairs, i, numSeqs, pairsPerColumn, nameArray, positions, strandInts);
             }
         }
     }
@@ -781,6 +900,47 @@ uint64_t* cullPositionsByColumn(char **mat, uint64_t c, uint64_t *positions, boo
     }
     return colPositions;
 }
+int* cullStrandIntsByColumn(char **mat, uint64_t c, int *strandInts, bool *legitRows,
+                            uint64_t numRows, uint64_t numLegitGaplessPositions) {
+    // create an array of strands that excludes all sequences that contain gaps
+    int *colStrandInts = (int*) st_malloc(sizeof(*strandInts) * numLegitGaplessPositions);
+    uint64_t j = 0;
+    for (uint64_t r = 0; r < numRows; ++r) {
+        if (legitRows[r] && mat[r][c] != '-') {
+            colStrandInts[j++] = strandInts[r];
+        }
+    }
+    return colStrandInts;
+}
+bool* findGapPatternBreaks(char **mat, uint64_t seqFieldLength, uint64_t numRows, bool *legitRows) {
+    // returns an array with true at column c if the gap pattern of the legit rows at c differs
+    // from that at c - 1, i.e. wherever a new run of identically gapped columns starts. the scan
+    // runs along each row, which keeps it cache friendly and lets the compiler vectorize it.
+    bool *breaks = (bool*) st_calloc(seqFieldLength, sizeof(*breaks));
+    if (seqFieldLength > 0) {
+        breaks[0] = true;
+    }
+    for (uint64_t r = 0; r < numRows; ++r) {
+        if (!legitRows[r]) {
+            continue;
+        }
+        const char *row = mat[r];
+        for (uint64_t c = 1; c < seqFieldLength; ++c) {
+            breaks[c] |= ((row[c] == '-') != (row[c - 1] == '-'));
+        }
+    }
+    return breaks;
+}
+void updatePositionsByRun(char **mat, uint64_t c, uint64_t runLength, uint64_t *allPositions,
+                          int *allStrandInts, uint64_t numSeqs, bool *legitRows) {
+    // advance the legit rows past a run of runLength identically gapped columns starting at c.
+    // non-legit rows are not tracked by the runs and so are left alone.
+    for (uint64_t i = 0; i < numSeqs; ++i) {
+        if (legitRows[i] && mat[i][c] != '-') {
+            allPositions[i] += allStrandInts[i] * (int64_t) runLength;
+        }
+    }
+}
 void validateMafBlockSourceLengths(const char *filename, mafBlock_t *mb, stHash *sequenceLengthHash) {
     // make sure that the information contained in the maf matches the information
     // contained in the sequenceLengthHash data.
@@ -825,24 +985,32 @@ void walkBlockSamplingPairs(const char *filename, mafBlock_t *mb, stSortedSet *s
     int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
     char **gaplessNameArray = NULL;
     uint64_t *gaplessPositions = NULL;
-    // walk over each column in the block
-    for (uint64_t c = 0; c < seqFieldLength; ++c) {
+    int *gaplessStrandInts = NULL;
+    bool *patternBreaks = findGapPatternBreaks(mat, seqFieldLength, numSeqs, legitRows);
+    uint64_t runLength, numRunPairs;
+    // walk over each run of identically gapped columns in the block
+    for (uint64_t c = 0; c < seqFieldLength; c += runLength) {
+        for (runLength = 1; c + runLength < seqFieldLength && !patternBreaks[c + runLength]; ++runLength);
         numLegitGaplessPositions = countLegitGaplessPositions(mat, c, numSeqs, legitRows);
-        // create arrays that contain *only* the valid (legit and non gap) sequences for this column
+        // create arrays that contain *only* the valid (legit and non gap) sequences for this run
         gaplessNameArray = extractLegitGaplessNamesFromMlArrayByColumn(mat, c, mlArray, legitRows,
                                                                        numSeqs, numLegitGaplessPositions);
         gaplessPositions = cullPositionsByColumn(mat, c, allPositions, legitRows,
                                                  numSeqs, numLegitGaplessPositions);
-        samplePairsFromColumn(acceptProbability, sampledPairs, numLegitGaplessPositions, chooseTwoArray,
-                              gaplessNameArray, gaplessPositions);
-        updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
+        gaplessStrandInts = cullStrandIntsByColumn(mat, c, allStrandInts, legitRows,
+                                                   numSeqs, numLegitGaplessPositions);
+        samplePairsFromRun(acceptProbability, sampledPairs, numLegitGaplessPositions, runLength,
+                           chooseTwoArray, gaplessNameArray, gaplessPositions, gaplessStrandInts);
+        updatePositionsByRun(mat, c, runLength, allPositions, allStrandInts, numSeqs, legitRows);
         // double check:
         if (numLegitGaplessPositions < kChooseTwoCacheLength) {
-            *numPairs += chooseTwoArray[numLegitGaplessPositions];
+            numRunPairs = chooseTwoArray[numLegitGaplessPositions];
         } else {
-            *numPairs += chooseTwo(numLegitGaplessPositions);
+            numRunPairs = chooseTwo(numLegitGaplessPositions);
         }
+        *numPairs += numRunPairs * runLength;
     }
+    free(patternBreaks);
     // clean up
     free(mlArray);
     free(allPositions);
@@ -868,7 +1036,110 @@ void samplePairsFromMaf(const char *filename, stSortedSet *pairs, double acceptP
     free(chooseTwoArray);
     maf_destroyMfa(mfa);
 }
-void countPairs(APair *pair, stHash *intervalsHash, int64_t *counter,
+bool pairInRegions(APair *pair, bedIndex_t *regions) {
+    // true if either member of the pair lies in one of the regions
+    return bed_contains(regions, pair->seq1, pair->pos1) || bed_contains(regions, pair->seq2, pair->pos2);
+}
+uint64_t walkBlockCountingRegionPairs(mafBlock_t *mb, stSet *legitSequences, bedIndex_t *regions,
+                                      uint64_t *chooseTwoArray) {
+    // count the pairs in the block with at least one member in the regions. For a column with g
+    // gapless legit positions of which k are in the regions that is all g choose 2 pairs less
+    // the g - k choose 2 pairs with neither member inside.
+    uint64_t count = 0;
+    uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
+    if (numSeqs < 2) {
+        return 0;
+    }
+    uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
+    char **names = maf_mafBlock_getSpeciesArray(mb);
+    char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
+    bool *legitRows = getLegitRows(names, numSeqs, legitSequences);
+    uint64_t *allPositions = maf_mafBlock_getPosCoordStartArray(mb);
+    int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
+    bedCursor_t *cursors = (bedCursor_t*) st_malloc(sizeof(*cursors) * numSeqs);
+    for (uint64_t r = 0; r < numSeqs; ++r) {
+        bed_cursor_init(&(cursors[r]), legitRows[r] ? bed_getIntervals(regions, names[r]) : NULL);
+    }
+    for (uint64_t c = 0; c < seqFieldLength; ++c) {
+        uint64_t g = 0, k = 0;
+        for (uint64_t r = 0; r < numSeqs; ++r) {
+            if (legitRows[r] && mat[r][c] != '-') {
+                ++g;
+                k += bed_cursor_contains(&(cursors[r]), allPositions[r]);
+            }
+        }
+        count += ((g < kChooseTwoCacheLength) ? chooseTwoArray[g] : chooseTwo(g)) -
+            ((g - k < kChooseTwoCacheLength) ? chooseTwoArray[g - k] : chooseTwo(g - k));
+        updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
+    }
+    // clean up
+    free(cursors);
+    free(allPositions);
+    free(allStrandInts);
+    for (uint64_t i = 0; i < numSeqs; ++i) {
+        free(names[i]);
+    }
+    free(names);
+    maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
+    free(legitRows);
+    return count;
+}
+uint64_t countPairsInRegions(const char *filename, mafBlockIndex_t *mbi, stSet *legitSequences,
+                             bedIndex_t *regions) {
+    // countPairsInMaf() for only the pairs with a member in the regions, reading only the blocks
+    // that overlap them.
+    uint64_t numBlocks;
+    uint64_t *blocks = mafBlockIndex_findBlocks(mbi, regions, 0, &numBlocks);
+    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    uint64_t counter = 0;
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    for (uint64_t i = 0; i < numBlocks; ++i) {
+        mafBlock_t *mb = mafBlockIndex_readBlock(mbi, mfa, blocks[i]);
+        counter += walkBlockCountingRegionPairs(mb, legitSequences, regions, chooseTwoArray);
+        maf_destroyMafBlockList(mb);
+    }
+    // clean up
+    free(chooseTwoArray);
+    free(blocks);
+    maf_destroyMfa(mfa);
+    return counter;
+}
+void samplePairsFromRegions(const char *filename, mafBlockIndex_t *mbi, stSortedSet *pairs,
+                            double acceptProbability, stSet *legitSequences, bedIndex_t *regions,
+                            stHash *sequenceLengthHash) {
+    /*
+     * samplePairsFromMaf() for only the pairs with a member in the regions. Each block overlapping
+     * the regions is sampled as usual and the pairs with neither member inside are thrown back,
+     * which leaves every qualifying pair sampled with acceptProbability.
+     */
+    uint64_t numBlocks, numPairs = 0;
+    uint64_t *blocks = mafBlockIndex_findBlocks(mbi, regions, 0, &numBlocks);
+    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    APair *pair = NULL;
+    for (uint64_t i = 0; i < numBlocks; ++i) {
+        mafBlock_t *mb = mafBlockIndex_readBlock(mbi, mfa, blocks[i]);
+        stSortedSet *blockPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, NULL);
+        walkBlockSamplingPairs(filename, mb, blockPairs, acceptProbability, legitSequences, chooseTwoArray,
+                               &numPairs, sequenceLengthHash);
+        stSortedSetIterator *sit = stSortedSet_getIterator(blockPairs);
+        while ((pair = stSortedSet_getNext(sit)) != NULL) {
+            if (pairInRegions(pair, regions)) {
+                stSortedSet_insert(pairs, pair);
+            } else {
+                aPair_destruct(pair);
+            }
+        }
+        stSortedSet_destructIterator(sit);
+        stSortedSet_destruct(blockPairs);
+        maf_destroyMafBlockList(mb);
+    }
+    // clean up
+    free(chooseTwoArray);
+    free(blocks);
+    maf_destroyMfa(mfa);
+}
+void countPairs(APair *pair, bedIndex_t *bedIndex, int64_t *counter,
                 stSortedSet *legitPairs, void *a, uint64_t near) {
     /*
      * Counts the number of pairs in the MAF file.
@@ -881,7 +1152,7 @@ void countPairs(APair *pair, stHash *intervalsHash, int64_t *counter,
         }
     }
 }
-void samplePairs(APair *thisPair, stHash *intervalsHash, stSortedSet *pairs,
+void samplePairs(APair *thisPair, bedIndex_t *bedIndex, stSortedSet *pairs,
                  double *acceptProbability, stHash *legitPairs, uint64_t near) {
     /*
      * Adds *thisPair to *pairs with a given probability.
@@ -891,23 +1162,6 @@ void samplePairs(APair *thisPair, stHash *intervalsHash, stSortedSet *pairs,
             if (st_random() <= *acceptProbability)
                 stSortedSet_insert(pairs, aPair_copyConstruct(thisPair));
 }
-bool inInterval(stHash *intervalsHash, char *seq, uint64_t pos) {
-    /*
-     * check to see if the sequence and position are within the intervals hash.
-     */
-    stSortedSet *intervals = stHash_search(intervalsHash, seq);
-    if (intervals == NULL) {
-        return false;
-    }
-    stIntTuple *i = stIntTuple_construct2( pos, INT64_MAX);
-    stIntTuple *j = stSortedSet_searchLessThanOrEqual(intervals, i);
-    stIntTuple_destruct(i);
-    if (j == NULL) {
-        return false;
-    }
-    assert(stIntTuple_length(j) == 2);
-    return stIntTuple_get(j, 0) <= pos && pos < stIntTuple_get(j, 1);
-}
 uint64_t findLowerBound(uint64_t pos, uint64_t near) {
     // since we have unsigned values we must be careful about subtracting
     // the "near" value willy-nilly.
@@ -917,40 +1171,64 @@ uint64_t findLowerBound(uint64_t pos, uint64_t near) {
         return pos - near;
     }
 }
-void recordNearPair(APair *thisPair, stSortedSet *sampledPairs, uint64_t near, stSet *positivePairs) {
+static void recordNearPairRange(APair *thisPair, stSortedSet *pairs, uint64_t near, bool modifyPos1,
+                                stSet *positivePairs) {
+    /* record every pair in `pairs' that equals thisPair except for pos1 (if modifyPos1) or pos2
+     * (otherwise), which may be anywhere within +- `near'. pairs is ordered so that the window is a
+     * single contiguous run: by seq1, seq2, pos2, pos1 (aPair_cmpFunction_pos2()) if modifyPos1,
+     * else by seq1, pos1, seq2, pos2 (aPair_cmpFunction()). The run is found with one search and
+     * walked in order, so the cost is a search plus the number of pairs in the window.
+     */
+    APair key = *thisPair;
+    uint64_t upperBound;
+    if (modifyPos1) {
+        key.pos1 = findLowerBound(thisPair->pos1, near);
+        upperBound = thisPair->pos1 + near;
+    } else {
+        key.pos2 = findLowerBound(thisPair->pos2, near);
+        upperBound = thisPair->pos2 + near;
+    }
+    APair *aPair = stSortedSet_searchGreaterThanOrEqual(pairs, &key);
+    if (aPair == NULL) {
+        return;
+    }
+    stSortedSetIterator *sit = stSortedSet_getIteratorFrom(pairs, aPair);
+    while ((aPair = stSortedSet_getNext(sit)) != NULL) {
+        if (strcmp(thisPair->seq1, aPair->seq1) != 0 || strcmp(thisPair->seq2, aPair->seq2) != 0) {
+            break;
+        }
+        if (modifyPos1) {
+            if (thisPair->pos2 != aPair->pos2 || aPair->pos1 > upperBound) {
+                break;
+            }
+        } else {
+            if (thisPair->pos1 != aPair->pos1 || aPair->pos2 > upperBound) {
+                break;
+            }
+        }
+        stSet_insert(positivePairs, aPair);
+    }
+    stSortedSet_destructIterator(sit);
+}
+void recordNearPair(APair *thisPair, stSortedSet *sampledPairs, stSortedSet *sampledPairsByPos2, uint64_t near,
+                    stSet *positivePairs) {
     /* given thisPair, if thisPair is in the table `sampledPairs' then record it in the positivePairs set.
      * if the `near' option is set, do this not only for thisPair but for all pairs within +- `near'.
      * if near = 0 this will just look at thisPair->pos1 and thisPair->pos2 and record those values.
+     * sampledPairsByPos2 holds the same pairs ordered by aPair_cmpFunction_pos2(), see
+     * constructPairsByPos2(), and is only used when near is not 0.
      */
     APair *aPair;
-    uint64_t i = thisPair->pos1;
-    // Try modifying position 1
-    for (thisPair->pos1 = findLowerBound(thisPair->pos1, near); thisPair->pos1 < i + near + 1; thisPair->pos1++) {
+    if (near == 0) {
         if ((aPair = stSortedSet_search(sampledPairs, thisPair)) != NULL) {
-            if (strcmp(thisPair->seq1, aPair->seq1) == 0 && strcmp(thisPair->seq2, aPair->seq2) == 0 &&
-                thisPair->pos1 == aPair->pos1 && thisPair->pos2 == aPair->pos2) {
-                // printf("positivePair1: (%s %u, %s %u):(%s %u, %s %u)\n",
-                //        thisPair->seq1, thisPair->pos1, thisPair->seq2, thisPair->pos2,
-                //        aPair->seq1, aPair->pos1, aPair->seq2, aPair->pos2);
-                stSet_insert(positivePairs, aPair);
-            }
+            stSet_insert(positivePairs, aPair);
         }
+        return;
     }
-    thisPair->pos1 = i; // reset pos 1
+    // Try modifying position 1
+    recordNearPairRange(thisPair, sampledPairsByPos2, near, true, positivePairs);
     // Try modifying position 2
-    i = thisPair->pos2;
-    for (thisPair->pos2 = findLowerBound(thisPair->pos2, near); thisPair->pos2 < i + near + 1; thisPair->pos2++) {
-        if ((aPair = stSortedSet_search(sampledPairs, thisPair)) != NULL) {
-            if (strcmp(thisPair->seq1, aPair->seq1) == 0 && strcmp(thisPair->seq2, aPair->seq2) == 0 &&
-                thisPair->pos1 == aPair->pos1 && thisPair->pos2 == aPair->pos2) {
-                // printf("positivePair2: (%s %u, %s %u):(%s %u, %s %u)\n",
-                //        thisPair->seq1, thisPair->pos1, thisPair->seq2, thisPair->pos2,
-                //        aPair->seq1, aPair->pos1, aPair->seq2, aPair->pos2);
-                stSet_insert(positivePairs, aPair);
-            }
-        }
-    }
-    thisPair->pos2 = i; // reset pos 2
+    recordNearPairRange(thisPair, sampledPairs, near, false, positivePairs);
 }
 stHash* constructPositionHash(char **mat, uint64_t c, char **names, uint64_t numSeqs,
                               uint64_t *allPositions, bool *legitRows) {
@@ -1014,8 +1292,8 @@ void printHash(stHash *hash) {
     stHash_destructIterator(hit);
 }
 void testHomologyOnColumn(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, char **names,
-                          stSortedSet *sampledPairs, stSet *positivePairs, mafLine_t **mlArray,
-                          uint64_t *allPositions, stHash *intervalsHash, uint64_t near) {
+                          stSortedSet *sampledPairs, stSortedSet *sampledPairsByPos2, stSet *positivePairs,
+                          mafLine_t **mlArray, uint64_t *allPositions, bedIndex_t *bedIndex, uint64_t near) {
     /* For a given column,
        1) hash all the positions in the column
        2) For each position in the hash:
@@ -1063,7 +1341,7 @@ void testHomologyOnColumn(char **mat, uint64_t c, uint64_t numSeqs, bool *legitR
                 thisPair->pos2 = otherPair->pos2;
                 // 2ai.
                 if (pairMemberInPositionHash(positionHash, thisPair)) {
-                    recordNearPair(thisPair, sampledPairs, near, positivePairs);
+                    recordNearPair(thisPair, sampledPairs, sampledPairsByPos2, near, positivePairs);
                 }
                 free(thisPair->seq2);
                 thisPair->seq2 = NULL;
@@ -1091,8 +1369,8 @@ void printAllStrandInts(int *allStrandInts, mafBlock_t *mb) {
     }
     printf("]\n");
 }
-void walkBlockTestingHomology(mafBlock_t *mb, stSortedSet *sampledPairs, stSet *positivePairs,
-                              stSet *legitSequences, stHash *intervalsHash, uint64_t near) {
+void walkBlockTestingHomology(mafBlock_t *mb, stSortedSet *sampledPairs, stSortedSet *sampledPairsByPos2,
+                              stSet *positivePairs, stSet *legitSequences, bedIndex_t *bedIndex, uint64_t near) {
     uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
     if (numSeqs < 2) {
         return;
@@ -1109,8 +1387,8 @@ void walkBlockTestingHomology(mafBlock_t *mb, stSortedSet *sampledPairs, stSet *
     uint64_t *allPositions = maf_mafBlock_getPosCoordStartArray(mb);
     int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
     for (uint64_t c = 0; c < seqFieldLength; ++c) {
-        testHomologyOnColumn(mat, c, numSeqs, legitRows, names, sampledPairs, positivePairs,
-                             mlArray, allPositions, intervalsHash, near);
+        testHomologyOnColumn(mat, c, numSeqs, legitRows, names, sampledPairs, sampledPairsByPos2,
+                             positivePairs, mlArray, allPositions, bedIndex, near);
         updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
     }
     // clean up
@@ -1125,17 +1403,45 @@ void walkBlockTestingHomology(mafBlock_t *mb, stSortedSet *sampledPairs, stSet *
     free(legitRows);
 }
 void performHomologyTests(const char *filename, stSortedSet *sampledPairs, stSet *positivePairs,
-                          stSet *legitSequences, stHash *intervalsHash, uint64_t near) {
+                          stSet *legitSequences, bedIndex_t *bedIndex, uint64_t near) {
+    stSortedSet *sampledPairsByPos2 = constructPairsByPos2(sampledPairs, near);
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
     mafBlock_t *mb = NULL;
     while ((mb = maf_readBlock(mfa)) != NULL) {
-        walkBlockTestingHomology(mb, sampledPairs, positivePairs, legitSequences, intervalsHash, near);
+        walkBlockTestingHomology(mb, sampledPairs, sampledPairsByPos2, positivePairs, legitSequences, bedIndex,
+                                 near);
+        maf_destroyMafBlockList(mb);
+    }
+    // clean up
+    maf_destroyMfa(mfa);
+    if (sampledPairsByPos2 != NULL) {
+        stSortedSet_destruct(sampledPairsByPos2);
+    }
+}
+void performHomologyTestsInRegions(const char *filename, mafBlockIndex_t *mbi, bedIndex_t *regions,
+                                   stSortedSet *sampledPairs, stSet *positivePairs, stSet *legitSequences,
+                                   bedIndex_t *bedIndex, uint64_t near) {
+    // performHomologyTests() for pairs that each have a member in the regions. Any block where
+    // such a pair can be found holds a position within near of that member, so only the blocks
+    // overlapping the regions widened by near need be read.
+    uint64_t numBlocks;
+    uint64_t *blocks = mafBlockIndex_findBlocks(mbi, regions, near, &numBlocks);
+    stSortedSet *sampledPairsByPos2 = constructPairsByPos2(sampledPairs, near);
+    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    for (uint64_t i = 0; i < numBlocks; ++i) {
+        mafBlock_t *mb = mafBlockIndex_readBlock(mbi, mfa, blocks[i]);
+        walkBlockTestingHomology(mb, sampledPairs, sampledPairsByPos2, positivePairs, legitSequences, bedIndex,
+                                 near);
         maf_destroyMafBlockList(mb);
     }
     // clean up
+    free(blocks);
     maf_destroyMfa(mfa);
+    if (sampledPairsByPos2 != NULL) {
+        stSortedSet_destruct(sampledPairsByPos2);
+    }
 }
-void homologyTests1(APair *thisPair, stHash *intervalsHash, stSortedSet *pairs,
+void homologyTests1(APair *thisPair, bedIndex_t *bedIndex, stSortedSet *pairs,
                     stSet *positivePairs, stSet *legitPairs, int64_t near) {
     /*
      * If both members of *thisPair are in the intersection of maf1 and maf2,
@@ -1143,7 +1449,11 @@ void homologyTests1(APair *thisPair, stHash *intervalsHash, stSortedSet *pairs,
      */
     if ((stSet_search(legitPairs, thisPair->seq1) != NULL)
         && (stSet_search(legitPairs, thisPair->seq2) != NULL)) {
-        recordNearPair(thisPair, pairs, near, positivePairs);
+        stSortedSet *pairsByPos2 = constructPairsByPos2(pairs, near);
+        recordNearPair(thisPair, pairs, pairsByPos2, near, positivePairs);
+        if (pairsByPos2 != NULL) {
+            stSortedSet_destruct(pairsByPos2);
+        }
     }
 }
 bool positionIsInWiggleRegion(WiggleContainer *wc, uint64_t *refPos) {
@@ -1163,136 +1473,736 @@ bool positionIsInWiggleRegion(WiggleContainer *wc, uint64_t *refPos) {
     }
     return true;
 }
-void enumerateHomologyResults(stSortedSet *sampledPairs, stSortedSet *resultPairs, stHash *intervalsHash,
-                              stSet *positivePairs, stHash *wigglePairHash, bool isAtoB,
-                              uint64_t wiggleBinLength) {
+typedef struct _wiggleLink {
+    // a WiggleContainer that names a sequence as its ref or its partner
+    uint64_t wiggle; // index into SequenceTable.wiggles
+    uint64_t other; // id of the other sequence of the pair
+    bool refIsThis;
+} WiggleLink;
+struct _sequenceTable {
+    uint64_t numSeqs;
+    char **names; // borrowed from legitSequences, sorted
+    uint64_t *ids;
+    stHash *nameToId; // names[i] -> ids + i
+    bedIntervals_t **intervals; // may be NULL
+    uint64_t numWiggles;
+    WiggleContainer **wiggles; // borrowed from the wigglePairHash
+    WiggleLink **links; // per id, the wiggles naming it
+    uint64_t *numLinks;
+};
+static int cmpNames(const void *a, const void *b) {
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+SequenceTable* sequenceTable_construct(stSet *legitSequences, bedIndex_t *bedIndex, stHash *wigglePairHash) {
     /*
-     * For every pair in 'sampledPairs', add 1 to the total number of homology tests for the sequence-pair
-     * (the ResultPair).
+     * Intern the legit sequences of a comparison as dense ids and look up everything a tally needs
+     * to know about each one in advance. Ids are assigned in name order, so comparing the ids
+     * of two sequences is the same as comparing their names. wigglePairHash may be NULL.
      */
-    static stSortedSetIterator *sit;
-    sit = stSortedSet_getIterator(sampledPairs);
-    APair *pair = NULL;
-    ResultPair *thisResultPair = NULL;
-    WiggleContainer *wc = NULL;
-    uint64_t *refPos = NULL;
-    uint64_t localPos = 0; // local offset within the region of interest (0 is wc->refStart)
-    char wigKey[kMaxStringLength];
-    wigKey[0] = '\0';
-    while ((pair = stSortedSet_getNext(sit)) != NULL) {
-        if ((thisResultPair = stSortedSet_search(resultPairs, pair)) == NULL) {
-            // the stSortedSet resultPairs is searched only based on sequence names.
-            thisResultPair = resultPair_construct(pair->seq1, pair->seq2);
-            stSortedSet_insert(resultPairs, thisResultPair);
-        }
-        sprintf(wigKey, "%s-%s", pair->seq1, pair->seq2);
-        if ((wc = stHash_search(wigglePairHash, wigKey)) == NULL) {
-            // seq1 is not the ref
-            sprintf(wigKey, "%s-%s", pair->seq2, pair->seq1);
-            if ((wc = stHash_search(wigglePairHash, wigKey)) == NULL) {
-                // seq2 is also not the ref
-                wigKey[0] = '\0';
-            } else {
-                refPos = buildUInt64(pair->pos2);
+    SequenceTable *st = st_calloc(1, sizeof(*st));
+    st->numSeqs = stSet_size(legitSequences);
+    st->names = st_malloc(sizeof(*(st->names)) * (st->numSeqs + 1));
+    st->ids = st_malloc(sizeof(*(st->ids)) * (st->numSeqs + 1));
+    st->intervals = st_malloc(sizeof(*(st->intervals)) * (st->numSeqs + 1));
+    st->links = st_calloc(st->numSeqs + 1, sizeof(*(st->links)));
+    st->numLinks = st_calloc(st->numSeqs + 1, sizeof(*(st->numLinks)));
+    st->nameToId = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+    stSetIterator *sit = stSet_getIterator(legitSequences);
+    char *name = NULL;
+    uint64_t i = 0;
+    while ((name = stSet_getNext(sit)) != NULL) {
+        st->names[i++] = name;
+    }
+    stSet_destructIterator(sit);
+    qsort(st->names, st->numSeqs, sizeof(*(st->names)), cmpNames);
+    for (i = 0; i < st->numSeqs; ++i) {
+        st->ids[i] = i;
+        st->intervals[i] = bed_getIntervals(bedIndex, st->names[i]);
+        stHash_insert(st->nameToId, st->names[i], st->ids + i);
+    }
+    if (wigglePairHash == NULL) {
+        return st;
+    }
+    // wiggle pairs whose sequences are not both legit can never be sampled
+    st->wiggles = st_malloc(sizeof(*(st->wiggles)) * (stHash_size(wigglePairHash) + 1));
+    stHashIterator *hit = stHash_getIterator(wigglePairHash);
+    char *key = NULL;
+    while ((key = stHash_getNext(hit)) != NULL) {
+        WiggleContainer *wc = stHash_search(wigglePairHash, key);
+        int64_t refId = sequenceTable_getId(st, wc->ref);
+        int64_t partnerId = sequenceTable_getId(st, wc->partner);
+        if (refId == -1 || partnerId == -1) {
+            continue;
+        }
+        uint64_t ends[2] = {refId, partnerId};
+        for (int e = 0; e < 2; ++e) {
+            if (e == 1 && refId == partnerId) {
+                break;
+            }
+            uint64_t id = ends[e];
+            st->links[id] = realloc(st->links[id], sizeof(WiggleLink) * (st->numLinks[id] + 1));
+            if (st->links[id] == NULL) {
+                fprintf(stderr, "Error, realloc failed in sequenceTable_construct()\n");
+                exit(EXIT_FAILURE);
             }
+            st->links[id][st->numLinks[id]].wiggle = st->numWiggles;
+            st->links[id][st->numLinks[id]].other = ends[1 - e];
+            st->links[id][st->numLinks[id]].refIsThis = (e == 0);
+            ++(st->numLinks[id]);
+        }
+        st->wiggles[st->numWiggles++] = wc;
+    }
+    stHash_destructIterator(hit);
+    return st;
+}
+void sequenceTable_destruct(SequenceTable *st) {
+    for (uint64_t i = 0; i < st->numSeqs; ++i) {
+        free(st->links[i]);
+    }
+    free(st->links);
+    free(st->numLinks);
+    free(st->wiggles);
+    free(st->intervals);
+    stHash_destruct(st->nameToId);
+    free(st->ids);
+    free(st->names);
+    free(st);
+}
+uint64_t sequenceTable_getNumberOfSequences(SequenceTable *st) {
+    return st->numSeqs;
+}
+int64_t sequenceTable_getId(SequenceTable *st, const char *name) {
+    // returns -1 if name is not a legit sequence
+    uint64_t *id = stHash_search(st->nameToId, (void *) name);
+    if (id == NULL) {
+        return -1;
+    }
+    return *id;
+}
+char* sequenceTable_getName(SequenceTable *st, uint64_t id) {
+    assert(id < st->numSeqs);
+    return st->names[id];
+}
+struct _resultAccumulator {
+    // Results are accumulated in dense rows indexed by seq2 id, one seq1 at a time, so pairs
+    // must be tallied grouped by seq1.
+    SequenceTable *st;
+    uint64_t wiggleBinLength;
+    int64_t seq1; // id of the current row, -1 if there is none
+    bedCursor_t cursor1;
+    ResultPair *row; // counts of the current seq1 against each seq2
+    uint64_t *touched; // ids of the row entries in use
+    uint64_t numTouched;
+    int64_t *wiggleRow; // per seq2 id, the index of the wiggle of the current seq1, or -1
+    bool *wiggleRefIsSeq1;
+    uint64_t **present; // per wiggle, the present and absent bins of this tally's direction
+    uint64_t **absent;
+    bool isAtoB;
+    bool ownsBins; // present and absent are private copies, to be merged
+    stList *results; // ResultPairs of the finished rows
+};
+ResultAccumulator* resultAccumulator_construct(SequenceTable *st, uint64_t wiggleBinLength, bool isAtoB,
+                                               bool privateBins) {
+    // with privateBins the wiggle counts are kept apart from the WiggleContainers until
+    // resultAccumulator_merge(), so that several accumulators may run concurrently.
+    ResultAccumulator *ra = st_calloc(1, sizeof(*ra));
+    ra->st = st;
+    ra->wiggleBinLength = wiggleBinLength;
+    ra->seq1 = -1;
+    ra->row = st_calloc(st->numSeqs + 1, sizeof(*(ra->row)));
+    ra->touched = st_malloc(sizeof(*(ra->touched)) * (st->numSeqs + 1));
+    ra->numTouched = 0;
+    ra->wiggleRow = st_malloc(sizeof(*(ra->wiggleRow)) * (st->numSeqs + 1));
+    ra->wiggleRefIsSeq1 = st_calloc(st->numSeqs + 1, sizeof(*(ra->wiggleRefIsSeq1)));
+    for (uint64_t i = 0; i < st->numSeqs; ++i) {
+        ra->wiggleRow[i] = -1;
+    }
+    ra->present = st_malloc(sizeof(*(ra->present)) * (st->numWiggles + 1));
+    ra->absent = st_malloc(sizeof(*(ra->absent)) * (st->numWiggles + 1));
+    ra->isAtoB = isAtoB;
+    ra->ownsBins = privateBins;
+    for (uint64_t k = 0; k < st->numWiggles; ++k) {
+        WiggleContainer *wc = st->wiggles[k];
+        if (privateBins) {
+            ra->present[k] = st_calloc(wc->numBins, sizeof(uint64_t));
+            ra->absent[k] = st_calloc(wc->numBins, sizeof(uint64_t));
         } else {
-            refPos = buildUInt64(pair->pos1);
+            ra->present[k] = isAtoB ? wc->presentAtoB : wc->presentBtoA;
+            ra->absent[k] = isAtoB ? wc->absentAtoB : wc->absentBtoA;
         }
-        bool foundPair = stSet_search(positivePairs, pair) != NULL;
-        if (inInterval(intervalsHash, pair->seq1, pair->pos1)) {
-            if (inInterval(intervalsHash, pair->seq2, pair->pos2)) {
-                ++(thisResultPair->totalBoth);
-                if (foundPair) {
-                    ++(thisResultPair->inBoth);
-                }
-            } else {
-                ++(thisResultPair->totalA);
-                if (foundPair) {
-                    ++(thisResultPair->inA);
-                }
-            }
+    }
+    ra->results = stList_construct3(0, (void(*)(void *)) resultPair_destruct);
+    return ra;
+}
+void resultAccumulator_destruct(ResultAccumulator *ra) {
+    if (ra->ownsBins) {
+        for (uint64_t k = 0; k < ra->st->numWiggles; ++k) {
+            free(ra->present[k]);
+            free(ra->absent[k]);
+        }
+    }
+    free(ra->present);
+    free(ra->absent);
+    free(ra->row);
+    free(ra->touched);
+    free(ra->wiggleRow);
+    free(ra->wiggleRefIsSeq1);
+    stList_destruct(ra->results);
+    free(ra);
+}
+static void resultAccumulator_startRow(ResultAccumulator *ra, uint64_t seq1) {
+    // fill out the seq2 -> wiggle row of seq1. As with the "ref-partner" keys of the
+    // wigglePairHash, a wiggle that has seq1 as its ref wins over one that has it as partner.
+    SequenceTable *st = ra->st;
+    ra->seq1 = seq1;
+    bed_cursor_init(&(ra->cursor1), st->intervals[seq1]);
+    for (uint64_t l = 0; l < st->numLinks[seq1]; ++l) {
+        WiggleLink *link = &(st->links[seq1][l]);
+        if (link->refIsThis) {
+            ra->wiggleRow[link->other] = link->wiggle;
+            ra->wiggleRefIsSeq1[link->other] = true;
+        }
+    }
+    for (uint64_t l = 0; l < st->numLinks[seq1]; ++l) {
+        WiggleLink *link = &(st->links[seq1][l]);
+        if (!link->refIsThis && ra->wiggleRow[link->other] == -1) {
+            ra->wiggleRow[link->other] = link->wiggle;
+            ra->wiggleRefIsSeq1[link->other] = false;
+        }
+    }
+}
+static void resultAccumulator_finishRow(ResultAccumulator *ra) {
+    // move the counts of the current row into ResultPairs and reset the row
+    SequenceTable *st = ra->st;
+    if (ra->seq1 == -1) {
+        return;
+    }
+    for (uint64_t t = 0; t < ra->numTouched; ++t) {
+        uint64_t seq2 = ra->touched[t];
+        ResultPair *rp = resultPair_construct(st->names[ra->seq1], st->names[seq2]);
+        resultPair_add(rp, &(ra->row[seq2]));
+        stList_append(ra->results, rp);
+        memset(&(ra->row[seq2]), 0, sizeof(ResultPair));
+    }
+    ra->numTouched = 0;
+    for (uint64_t l = 0; l < st->numLinks[ra->seq1]; ++l) {
+        ra->wiggleRow[st->links[ra->seq1][l].other] = -1;
+    }
+    ra->seq1 = -1;
+}
+void resultAccumulator_tally(ResultAccumulator *ra, uint64_t seq1, uint64_t pos1, uint64_t seq2,
+                             uint64_t pos2, bool foundPair) {
+    // count one tested pair, seq1 and seq2 are SequenceTable ids
+    SequenceTable *st = ra->st;
+    if ((int64_t) seq1 != ra->seq1) {
+        resultAccumulator_finishRow(ra);
+        resultAccumulator_startRow(ra, seq1);
+    }
+    ResultPair *rp = &(ra->row[seq2]);
+    if (rp->total == 0) {
+        ra->touched[ra->numTouched++] = seq2;
+    }
+    bool inInterval1 = bed_cursor_contains(&(ra->cursor1), pos1);
+    bool inInterval2 = bed_intervals_contains(st->intervals[seq2], pos2);
+    if (inInterval1) {
+        if (inInterval2) {
+            ++(rp->totalBoth);
+            rp->inBoth += foundPair;
         } else {
-            if (inInterval(intervalsHash, pair->seq2, pair->pos2)) {
-                ++(thisResultPair->totalB);
-                if (foundPair) {
-                    ++(thisResultPair->inB);
-                }
-            } else {
-                ++(thisResultPair->totalNeither);
-                if (foundPair) {
-                    ++(thisResultPair->inNeither);
-                }
-            }
+            ++(rp->totalA);
+            rp->inA += foundPair;
         }
-
-        ++(thisResultPair->total);
-        // put results in wiggle pairs
-        if (positionIsInWiggleRegion(wc, refPos)) {
-            localPos = *refPos - wc->refStart;
-            if (isAtoB) {
-                ++(wc->absentAtoB[(int)floor(localPos / wiggleBinLength)]);
-            } else {
-                ++(wc->absentBtoA[(int)floor(localPos / wiggleBinLength)]);
-            }
+    } else {
+        if (inInterval2) {
+            ++(rp->totalB);
+            rp->inB += foundPair;
+        } else {
+            ++(rp->totalNeither);
+            rp->inNeither += foundPair;
         }
-        if (foundPair) {
-            ++(thisResultPair->inAll);
-            if (positionIsInWiggleRegion(wc, refPos)) {
-                localPos = *refPos - wc->refStart;
-                if (isAtoB) {
-                    --(wc->absentAtoB[(int)floor(localPos / wiggleBinLength)]);
-                    ++(wc->presentAtoB[(int)floor(localPos / wiggleBinLength)]);
+    }
+    ++(rp->total);
+    rp->inAll += foundPair;
+    // put results in wiggle pairs
+    if (ra->wiggleRow[seq2] != -1) {
+        uint64_t k = ra->wiggleRow[seq2];
+        WiggleContainer *wc = st->wiggles[k];
+        uint64_t refPos = ra->wiggleRefIsSeq1[seq2] ? pos1 : pos2;
+        if (positionIsInWiggleRegion(wc, &refPos)) {
+            uint64_t bin = (refPos - wc->refStart) / ra->wiggleBinLength;
+            if (bin < wc->numBins) {
+                if (foundPair) {
+                    ++(ra->present[k][bin]);
                 } else {
-                    --(wc->absentBtoA[(int)floor(localPos / wiggleBinLength)]);
-                    ++(wc->presentBtoA[(int)floor(localPos / wiggleBinLength)]);
+                    ++(ra->absent[k][bin]);
                 }
             }
+        }
+    }
+}
+void resultAccumulator_merge(ResultAccumulator *ra, stSortedSet *resultPairs) {
+    // add everything tallied so far into resultPairs (and, with private bins, into the
+    // WiggleContainers), leaving the accumulator empty.
+    resultAccumulator_finishRow(ra);
+    for (int64_t r = 0; r < stList_length(ra->results); ++r) {
+        ResultPair *rp = stList_get(ra->results, r);
+        ResultPair *dest = stSortedSet_search(resultPairs, rp);
+        if (dest == NULL) {
+            stSortedSet_insert(resultPairs, rp);
+            stList_set(ra->results, r, NULL);
         } else {
-           if (g_isVerboseFailures){
-              fprintf(stderr, "sampled pair not present in comparison: (%s, %" PRIu64 "):(%s, %" PRIu64 ")\n",
-                      pair->seq1, pair->pos1, pair->seq2, pair->pos2);
-           }
+            resultPair_add(dest, rp);
         }
-        if (refPos != NULL) {
-            free(refPos);
-            refPos = NULL;
+    }
+    while (stList_length(ra->results) > 0) {
+        resultPair_destruct(stList_pop(ra->results));
+    }
+    if (ra->ownsBins) {
+        for (uint64_t k = 0; k < ra->st->numWiggles; ++k) {
+            WiggleContainer *wc = ra->st->wiggles[k];
+            uint64_t *present = ra->isAtoB ? wc->presentAtoB : wc->presentBtoA;
+            uint64_t *absent = ra->isAtoB ? wc->absentAtoB : wc->absentBtoA;
+            for (uint64_t b = 0; b < wc->numBins; ++b) {
+                present[b] += ra->present[k][b];
+                absent[b] += ra->absent[k][b];
+                ra->present[k][b] = 0;
+                ra->absent[k][b] = 0;
+            }
         }
     }
+}
+typedef struct _enumerateWorker {
+    // the share of one thread of enumerateHomologyResults()
+    ResultAccumulator *ra;
+    APair **pairs;
+    uint64_t start;
+    uint64_t end;
+    stSet *positivePairs;
+} EnumerateWorker;
+static uint64_t getLegitId(SequenceTable *st, const char *name) {
+    int64_t id = sequenceTable_getId(st, name);
+    if (id == -1) {
+        fprintf(stderr, "Error, sampled pair sequence %s is not a legit sequence\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return id;
+}
+static void* enumerateWorker_run(void *a) {
+    EnumerateWorker *w = (EnumerateWorker *) a;
+    SequenceTable *st = w->ra->st;
+    char *lastSeq1 = NULL;
+    char *lastSeq2 = NULL;
+    uint64_t seq1 = 0;
+    uint64_t seq2 = 0;
+    for (uint64_t p = w->start; p < w->end; ++p) {
+        APair *pair = w->pairs[p];
+        if ((lastSeq1 == NULL) || (strcmp(lastSeq1, pair->seq1) != 0)) {
+            lastSeq1 = pair->seq1;
+            seq1 = getLegitId(st, pair->seq1);
+        }
+        if ((lastSeq2 == NULL) || (strcmp(lastSeq2, pair->seq2) != 0)) {
+            lastSeq2 = pair->seq2;
+            seq2 = getLegitId(st, pair->seq2);
+        }
+        bool foundPair = stSet_search(w->positivePairs, pair) != NULL;
+        resultAccumulator_tally(w->ra, seq1, pair->pos1, seq2, pair->pos2, foundPair);
+        if (!foundPair && g_isVerboseFailures) {
+            fprintf(stderr, "sampled pair not present in comparison: (%s, %" PRIu64 "):(%s, %" PRIu64 ")\n",
+                    pair->seq1, pair->pos1, pair->seq2, pair->pos2);
+        }
+    }
+    return NULL;
+}
+void resultPair_add(ResultPair *dest, ResultPair *src) {
+    // add the counts of src to those of dest
+    dest->inAll += src->inAll;
+    dest->inBoth += src->inBoth;
+    dest->inA += src->inA;
+    dest->inB += src->inB;
+    dest->inNeither += src->inNeither;
+    dest->total += src->total;
+    dest->totalBoth += src->totalBoth;
+    dest->totalA += src->totalA;
+    dest->totalB += src->totalB;
+    dest->totalNeither += src->totalNeither;
+}
+void enumerateHomologyResults(stSortedSet *sampledPairs, stSortedSet *resultPairs, bedIndex_t *bedIndex,
+                              stSet *positivePairs, stHash *wigglePairHash, bool isAtoB,
+                              uint64_t wiggleBinLength, stSet *legitSequences, uint64_t numThreads) {
+    /*
+     * For every pair in 'sampledPairs', add 1 to the total number of homology tests for the sequence-pair
+     * (the ResultPair). Every sampled pair must be between legitSequences, which are interned so that
+     * the counts, bed intervals and wiggle containers of each pair are found by array index. With
+     * numThreads > 1 the sampled pairs are split into contiguous runs, each counted into a private
+     * table by its own thread, and the tables are merged in order at the end. --printFailed output
+     * is kept in order by counting in a single thread.
+     */
+    uint64_t numPairs = stSortedSet_size(sampledPairs);
+    if (numPairs == 0) {
+        return;
+    }
+    if (numThreads < 1 || g_isVerboseFailures) {
+        numThreads = 1;
+    }
+    if (numThreads > numPairs) {
+        numThreads = numPairs;
+    }
+    SequenceTable *st = sequenceTable_construct(legitSequences, bedIndex, wigglePairHash);
+    APair **pairs = st_malloc(sizeof(*pairs) * numPairs);
+    stSortedSetIterator *sit = stSortedSet_getIterator(sampledPairs);
+    for (uint64_t p = 0; p < numPairs; ++p) {
+        pairs[p] = stSortedSet_getNext(sit);
+    }
     stSortedSet_destructIterator(sit);
+    EnumerateWorker *workers = st_malloc(sizeof(*workers) * numThreads);
+    for (uint64_t t = 0; t < numThreads; ++t) {
+        workers[t].ra = resultAccumulator_construct(st, wiggleBinLength, isAtoB, numThreads > 1);
+        workers[t].pairs = pairs;
+        workers[t].start = (numPairs * t) / numThreads;
+        workers[t].end = (numPairs * (t + 1)) / numThreads;
+        workers[t].positivePairs = positivePairs;
+    }
+    if (numThreads == 1) {
+        enumerateWorker_run(&(workers[0]));
+    } else {
+        pthread_t *threads = st_malloc(sizeof(*threads) * numThreads);
+        for (uint64_t t = 0; t < numThreads; ++t) {
+            if (pthread_create(&(threads[t]), NULL, enumerateWorker_run, &(workers[t])) != 0) {
+                fprintf(stderr, "Error, unable to create thread for enumerateHomologyResults()\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (uint64_t t = 0; t < numThreads; ++t) {
+            pthread_join(threads[t], NULL);
+        }
+        free(threads);
+    }
+    // merge the per thread tables
+    for (uint64_t t = 0; t < numThreads; ++t) {
+        resultAccumulator_merge(workers[t].ra, resultPairs);
+        resultAccumulator_destruct(workers[t].ra);
+    }
+    // clean up
+    free(workers);
+    free(pairs);
+    sequenceTable_destruct(st);
+}
+bool parseRegion(const char *region, char **name, uint64_t *start, uint64_t *end) {
+    // parse a --region of the form seq:start-end, zero based and half open like a bed line. The
+    // sequence name may itself hold colons. Returns false if region is malformed, otherwise
+    // *name is the caller's to free.
+    const char *colon = strrchr(region, ':');
+    if (colon == NULL || colon == region) {
+        return false;
+    }
+    char dash, extra;
+    if (sscanf(colon + 1, "%" SCNu64 "%c%" SCNu64 "%c", start, &dash, end, &extra) != 3 || dash != '-' ||
+        *start >= *end || !isdigit((unsigned char) colon[1])) {
+        return false;
+    }
+    *name = stString_getSubString(region, 0, colon - region);
+    return true;
 }
-stSortedSet *compareMAFs_AB(const char *mafFileA, const char *mafFileB, uint64_t *numberOfPairs,
-                            stSet *legitSequences, stHash *intervalsHash, stHash *wigglePairHash,
-                            bool isAtoB, Options *options, stHash *sequenceLengthHash) {
-    // count the number of pairs in mafFileA
-    if (*numberOfPairs == 0) {
+void loadBlockIndexes(Options *options) {
+    // load (or build) the block index of every input maf for the --region options, before any
+    // comparison threads start so that they may share the indexes read only.
+    options->blockIndexes = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free,
+                                              (void(*)(void *)) mafBlockIndex_destroy);
+    char *spaceSepFiles = stringReplace(options->mafFile2, ',', ' ');
+    char *currentLocation = spaceSepFiles;
+    char *currentWord = stString_copy(options->mafFile1);
+    do {
+        if (stHash_search(options->blockIndexes, currentWord) == NULL) {
+            st_logDebug("Loading the block index of %s\n", currentWord);
+            stHash_insert(options->blockIndexes, stString_copy(currentWord),
+                          options->noCache ? mafBlockIndex_build(currentWord) : mafBlockIndex_load(currentWord));
+        }
+        free(currentWord);
+    } while ((currentWord = stString_getNextWord(&currentLocation)) != NULL);
+    free(spaceSepFiles);
+}
+static mafBlockIndex_t* getBlockIndex(Options *options, const char *filename) {
+    mafBlockIndex_t *mbi = (options->blockIndexes == NULL) ? NULL : stHash_search(options->blockIndexes,
+                                                                                  (void *) filename);
+    if (mbi == NULL) {
+        fprintf(stderr, "Error, no block index was loaded for %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    return mbi;
+}
+uint64_t countPairsToSample(const char *mafFileA, stSet *legitSequences, Options *options) {
+    // the number of pairs in mafFileA, remembered in its FILE.pairs cache unless --noCache
+    if (options->noCache) {
+        return countPairsInMafThreaded(mafFileA, legitSequences, options->numThreads);
+    }
+    return countPairsInMafCached(mafFileA, legitSequences, options->numThreads);
+}
+void checkSampledNumberOfPairs(const char *mafFileA, stSet *legitSequences, Options *options, bool isCounted,
+                               uint64_t verifiedNumberOfPairs, uint64_t *numberOfPairs) {
+    /*
+     * compare the number of pairs seen while sampling mafFileA with the *numberOfPairs the
+     * sample was drawn with. A number given by --numberOfPairs is an error if it is wrong, but a
+     * counted one (isCounted) can only be wrong when it came from a stale FILE.pairs cache, which
+     * is then corrected so that later runs don't repeat the mistake. The sample stands, drawn at a
+     * slightly different rate, and the run carries on with the number seen.
+     */
+    if (verifiedNumberOfPairs == *numberOfPairs) {
+        return;
+    }
+    if (!isCounted) {
+        fprintf(stderr, "Error, differing numberOfPairs values, %"PRIu64" != %"PRIu64"\n",
+                verifiedNumberOfPairs, *numberOfPairs);
+        exit(EXIT_FAILURE);
+    }
+    st_logInfo("The cached number of pairs in %s, %" PRIu64 ", was stale, it has %" PRIu64 "\n",
+               mafFileA, *numberOfPairs, verifiedNumberOfPairs);
+    if (!options->noCache) {
+        writePairCountCache(mafFileA, legitSequences, verifiedNumberOfPairs);
+    }
+    *numberOfPairs = verifiedNumberOfPairs;
+}
+stSortedSet* sampleMafPairs(const char *mafFileA, uint64_t *numberOfPairs, stSet *legitSequences,
+                            Options *options, stHash *sequenceLengthHash) {
+    // count the number of pairs in mafFileA and then sample from them. The returned set
+    // is ordered by aPair_cmpFunction().
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
+    if (options->regions != NULL) {
+        // only pairs with a member in the --region(s) are counted and sampled
+        mafBlockIndex_t *mbi = getBlockIndex(options, mafFileA);
+        *numberOfPairs = countPairsInRegions(mafFileA, mbi, legitSequences, options->regions);
+        if (*numberOfPairs != 0) {
+            samplePairsFromRegions(mafFileA, mbi, pairs,
+                                   ((double) options->numberOfSamples) / (double) *numberOfPairs,
+                                   legitSequences, options->regions, sequenceLengthHash);
+        }
+        return pairs;
+    }
+    bool isCounted = (*numberOfPairs == 0);
+    if (isCounted) {
         // can be manually set via the command line
-        *numberOfPairs = countPairsInMaf(mafFileA, legitSequences);
+        *numberOfPairs = countPairsToSample(mafFileA, legitSequences, options);
     }
     if (*numberOfPairs == 0) {
-        return stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
+        return pairs;
     }
     double acceptProbability = ((double) options->numberOfSamples) / (double) *numberOfPairs;
-    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
     // sample pairs from mafFileA
     uint64_t verifiedNumberOfPairs = 0;
     samplePairsFromMaf(mafFileA, pairs, acceptProbability, legitSequences, &verifiedNumberOfPairs,
                        sequenceLengthHash);
-    if (verifiedNumberOfPairs != *numberOfPairs) {
-        fprintf(stderr, "Error, differing numberOfPairs values, %"PRIu64" != %"PRIu64"\n",
-                verifiedNumberOfPairs, *numberOfPairs);
-        exit(EXIT_FAILURE);
+    checkSampledNumberOfPairs(mafFileA, legitSequences, options, isCounted, verifiedNumberOfPairs,
+                              numberOfPairs);
+    return pairs;
+}
+stSortedSet* compareSampledPairs(stSortedSet *pairs, const char *mafFileB, stSet *legitSequences,
+                                 bedIndex_t *bedIndex, stHash *wigglePairHash, bool isAtoB,
+                                 Options *options) {
+    // perform homology tests on mafFileB using pairs sampled from some other maf.
+    // Does not take ownership of pairs.
+    stSortedSet *resultPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
+    if (stSortedSet_size(pairs) == 0) {
+        return resultPairs;
     }
-    // perform homology tests on mafFileB using sampled pairs from mafFileA
     stSet *positivePairs = stSet_construct(); // comparison by pointer
-    performHomologyTests(mafFileB, pairs, positivePairs, legitSequences, intervalsHash, options->near);
-    stSortedSet *resultPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
-    enumerateHomologyResults(pairs, resultPairs, intervalsHash, positivePairs, wigglePairHash, isAtoB,
-                             options->wiggleBinLength);
+    if (options->regions != NULL) {
+        performHomologyTestsInRegions(mafFileB, getBlockIndex(options, mafFileB), options->regions, pairs,
+                                      positivePairs, legitSequences, bedIndex, options->near);
+    } else {
+        performHomologyTests(mafFileB, pairs, positivePairs, legitSequences, bedIndex, options->near);
+    }
+    enumerateHomologyResults(pairs, resultPairs, bedIndex, positivePairs, wigglePairHash, isAtoB,
+                             options->wiggleBinLength, legitSequences, options->numThreads);
     // clean up
-    stSortedSet_destruct(pairs);
     stSet_destruct(positivePairs);
     return resultPairs;
 }
+stSortedSet *compareMAFs_AB(const char *mafFileA, const char *mafFileB, uint64_t *numberOfPairs,
+                            stSet *legitSequences, bedIndex_t *bedIndex, stHash *wigglePairHash,
+                            bool isAtoB, Options *options, stHash *sequenceLengthHash) {
+    stSortedSet *pairs = sampleMafPairs(mafFileA, numberOfPairs, legitSequences, options, sequenceLengthHash);
+    stSortedSet *resultPairs = compareSampledPairs(pairs, mafFileB, legitSequences, bedIndex,
+                                                   wigglePairHash, isAtoB, options);
+    // clean up
+    stSortedSet_destruct(pairs);
+    return resultPairs;
+}
+Comparison* comparison_construct(const char *mafFile2, const char *outputFile) {
+    Comparison *c = st_calloc(1, sizeof(*c));
+    c->mafFile2 = stString_copy(mafFile2);
+    c->outputFile = stString_copy(outputFile);
+    c->wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey,
+                                          free, (void(*)(void *))wiggleContainer_destruct);
+    return c;
+}
+void comparison_destruct(Comparison *c) {
+    if (c == NULL) {
+        return;
+    }
+    free(c->mafFile2);
+    free(c->outputFile);
+    if (c->legitSequences != NULL) {
+        stSet_destruct(c->legitSequences);
+    }
+    stHash_destruct(c->wigglePairHash);
+    if (c->results_12 != NULL) {
+        stSortedSet_destruct(c->results_12);
+    }
+    if (c->results_21 != NULL) {
+        stSortedSet_destruct(c->results_21);
+    }
+    free(c);
+}
+typedef struct _comparisonBatch {
+    // state shared by all of the threads of compareBatch()
+    Options *options;
+    stSortedSet *sampledPairs_12;
+    ExactRuns *sampledRuns_12; // in place of sampledPairs_12 with --maxMemory
+    uint64_t memoryBytes; // the share of --maxMemory of each comparison
+    stSet *legitSequences; // those mafFile1 was sampled over, each comparison keeps its own subset
+    bedIndex_t *bedIndex;
+    stHash *sequenceLengthHash;
+    bool reseed;
+    uint64_t nextToSample; // index of the comparison whose turn it is to sample its mafFile2
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+} ComparisonBatch;
+typedef struct _comparisonThreadArgs {
+    ComparisonBatch *batch;
+    Comparison *comparison;
+    uint64_t index;
+} ComparisonThreadArgs;
+static stSortedSet* pairsInLegitSequences(stSortedSet *pairs, stSet *sampledSequences, stSet *legitSequences) {
+    // the pairs with both sequences in legitSequences, a subset of sampledSequences. Returns pairs
+    // itself when the two sets are the same, otherwise a new set that does not own its pairs.
+    if (stSet_size(legitSequences) == stSet_size(sampledSequences)) {
+        return pairs;
+    }
+    stSortedSet *legitPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, NULL);
+    stSortedSetIterator *sit = stSortedSet_getIterator(pairs);
+    APair *pair = NULL;
+    while ((pair = stSortedSet_getNext(sit)) != NULL) {
+        if (stSet_search(legitSequences, pair->seq1) != NULL && stSet_search(legitSequences, pair->seq2) != NULL) {
+            stSortedSet_insert(legitPairs, pair);
+        }
+    }
+    stSortedSet_destructIterator(sit);
+    return legitPairs;
+}
+static void* compareBatchMember(void *a) {
+    /*
+     * Fill out one Comparison: test the shared maf1 samples that fall in the comparison's
+     * legit sequences against mafFile2, sample mafFile2 and test those samples against maf1.
+     * Sampling uses the process wide random number generator so it is done one comparison at
+     * a time, in input order, which keeps runs reproducible for a given seed.
+     */
+    ComparisonThreadArgs *args = (ComparisonThreadArgs *) a;
+    ComparisonBatch *batch = args->batch;
+    Comparison *c = args->comparison;
+    Options *options = batch->options;
+    stSortedSet *sampledPairs_21 = NULL;
+    ExactRuns *sampledRuns_21 = NULL;
+    c->numPairs1 = options->numPairs1;
+    if (batch->sampledRuns_12 != NULL) {
+        c->results_12 = compareSpilledPairs(batch->sampledRuns_12, c->mafFile2, batch->legitSequences,
+                                            c->legitSequences, batch->bedIndex, c->wigglePairHash, true,
+                                            options, batch->memoryBytes, NULL);
+    } else {
+        stSortedSet *pairs = pairsInLegitSequences(batch->sampledPairs_12, batch->legitSequences,
+                                                   c->legitSequences);
+        c->results_12 = compareSampledPairs(pairs, c->mafFile2, c->legitSequences,
+                                            batch->bedIndex, c->wigglePairHash, true, options);
+        if (pairs != batch->sampledPairs_12) {
+            stSortedSet_destruct(pairs);
+        }
+    }
+    if (g_isVerboseFailures) {
+        // only allowed with a single comparison, so the output is not interleaved
+        fprintf(stderr, "# Sampling from %s, comparing to %s\n", c->mafFile2, options->mafFile1);
+        fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
+    }
+    pthread_mutex_lock(&(batch->lock));
+    while (batch->nextToSample != args->index) {
+        pthread_cond_wait(&(batch->turn), &(batch->lock));
+    }
+    if (batch->reseed) {
+        st_randomSeed(options->randomSeed);
+    }
+    if (batch->sampledRuns_12 != NULL) {
+        sampledRuns_21 = sampleMafPairsToRuns(c->mafFile2, &(c->numPairs2), c->legitSequences,
+                                              options, batch->sequenceLengthHash, batch->memoryBytes);
+    } else {
+        sampledPairs_21 = sampleMafPairs(c->mafFile2, &(c->numPairs2), c->legitSequences,
+                                         options, batch->sequenceLengthHash);
+    }
+    ++(batch->nextToSample);
+    pthread_cond_broadcast(&(batch->turn));
+    pthread_mutex_unlock(&(batch->lock));
+    if (sampledRuns_21 != NULL) {
+        c->results_21 = compareSpilledPairs(sampledRuns_21, options->mafFile1, c->legitSequences,
+                                            c->legitSequences, batch->bedIndex, c->wigglePairHash, false,
+                                            options, batch->memoryBytes, NULL);
+        exactRuns_destruct(sampledRuns_21);
+    } else {
+        c->results_21 = compareSampledPairs(sampledPairs_21, options->mafFile1, c->legitSequences,
+                                            batch->bedIndex, c->wigglePairHash, false, options);
+        stSortedSet_destruct(sampledPairs_21);
+    }
+    return NULL;
+}
+void compareBatch(Options *options, stSortedSet *sampledPairs_12, ExactRuns *sampledRuns_12,
+                  Comparison **comparisons, uint64_t numComparisons, stSet *legitSequences,
+                  bedIndex_t *bedIndex, stHash *sequenceLengthHash) {
+    /*
+     * Compare the pairs sampled from options->mafFile1 against each comparison's mafFile2,
+     * and vice versa. With more than one comparison each runs in its own thread, all sharing
+     * the (read only) sampledPairs_12, which were sampled over legitSequences, the sequences of
+     * maf1. Each comparison tests and tallies only those of its pairs in its own legitSequences,
+     * so one mafFile2 lacking a sequence does not change the others. The random number
+     * generator is reseeded with options->randomSeed before each mafFile2 is sampled so that
+     * every report matches that of a single comparison run with the same --readSamples file.
+     * With --maxMemory the samples of
+     * maf1 are given as sampledRuns_12 instead, see comparatorSpill.h, and the comparisons
+     * share the budget equally.
+     */
+    ComparisonBatch batch;
+    batch.options = options;
+    batch.sampledPairs_12 = sampledPairs_12;
+    batch.sampledRuns_12 = sampledRuns_12;
+    batch.memoryBytes = options->maxMemory / numComparisons;
+    batch.legitSequences = legitSequences;
+    batch.bedIndex = bedIndex;
+    batch.sequenceLengthHash = sequenceLengthHash;
+    batch.reseed = (numComparisons > 1);
+    batch.nextToSample = 0;
+    pthread_mutex_init(&(batch.lock), NULL);
+    pthread_cond_init(&(batch.turn), NULL);
+    ComparisonThreadArgs *args = st_malloc(sizeof(*args) * numComparisons);
+    for (uint64_t i = 0; i < numComparisons; ++i) {
+        args[i].batch = &batch;
+        args[i].comparison = comparisons[i];
+        args[i].index = i;
+    }
+    if (numComparisons == 1) {
+        compareBatchMember(&(args[0]));
+    } else {
+        pthread_t *threads = st_malloc(sizeof(*threads) * numComparisons);
+        for (uint64_t i = 0; i < numComparisons; ++i) {
+            if (pthread_create(&(threads[i]), NULL, compareBatchMember, &(args[i])) != 0) {
+                fprintf(stderr, "Error, unable to create thread for comparison against %s\n",
+                        comparisons[i]->mafFile2);
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (uint64_t i = 0; i < numComparisons; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        free(threads);
+    }
+    // clean up
+    free(args);
+    pthread_cond_destroy(&(batch.turn));
+    pthread_mutex_destroy(&(batch.lock));
+}
 ResultPair *aggregateResult(void *(*getNextPair)(void *, void *), stSortedSet *set, void *seqName,
                             const char *name1, const char *name2) {
     /* loop through all ResultPairs available via the getNextPair() iterator and aggregate their
@@ -1319,6 +2229,10 @@ ResultPair *aggregateResult(void *(*getNextPair)(void *, void *), stSortedSet *s
         resultPair2->totalA += resultPair->totalA;
         resultPair2->totalB += resultPair->totalB;
         resultPair2->totalNeither += resultPair->totalNeither;
+        resultPair2->numStrata += resultPair->numStrata;
+        resultPair2->numPairs += resultPair->numPairs;
+        resultPair2->weightedTrue += resultPair->weightedTrue;
+        resultPair2->weightedVariance += resultPair->weightedVariance;
     }
     stSortedSet_destructIterator(iterator);
     return resultPair2;
@@ -1440,11 +2354,27 @@ void reportResult(const char *tagName, double total, double totalTrue, FILE *fil
                   tagName, (uint64_t) total, (uint64_t) totalTrue,
                   (uint64_t) (total - totalTrue), total == 0 ? 0.0 : totalTrue / total);
 }
+static void reportResultAll(ResultPair *rp, FILE *fileHandle, unsigned tabLevel, double z) {
+    // the "all" result. If z is positive the sample was stratified, and the average and its
+    // interval are the stratified estimate, see stratifiedInterval().
+    if (z <= 0.0) {
+        reportResult("all", rp->total, rp->inAll, fileHandle, tabLevel);
+        return;
+    }
+    double average, lower, upper;
+    stratifiedInterval(rp, z, &average, &lower, &upper);
+    findentprintf(fileHandle, tabLevel, "<all totalTests=\"%" PRIu64 "\" totalTrue=\"%" PRIu64 "\" "
+                  "totalFalse=\"%" PRIu64 "\" average=\"%f\" ciLower=\"%f\" ciUpper=\"%f\"/>\n",
+                  rp->total, rp->inAll, rp->total - rp->inAll, average, lower, upper);
+}
 void reportResults(stSortedSet *results_AB, const char *mafFileA, const char *mafFileB, FILE *fileHandle,
-                   uint64_t near, stSet *legitSequences, const char *bedFiles) {
+                   uint64_t near, stSet *legitSequences, const char *bedFiles, double ciLevel) {
     /*
-     * Report results in an XML formatted document.
+     * Report results in an XML formatted document. If ciLevel is positive the results come from
+     * --ciWidth, and every "all" result carries the interval of its average at that confidence
+     * level: the Wilson interval for a single pair of sequences, the stratified one otherwise.
      */
+    double z = (ciLevel > 0.0) ? normalQuantileForLevel(ciLevel) : 0.0;
     stSortedSetIterator *iterator = NULL;
     ResultPair *resultPair;
     unsigned tabLevel = 1;
@@ -1452,7 +2382,7 @@ void reportResults(stSortedSet *results_AB, const char *mafFileA, const char *ma
     addReferencesAndDups(results_AB, legitSequences);
     findentprintf(fileHandle, tabLevel++, "<homologyTests fileA=\"%s\" fileB=\"%s\">\n", mafFileA, mafFileB);
     findentprintf(fileHandle, tabLevel++, "<aggregateResults>\n");
-    reportResult("all", aggregateResults->total, aggregateResults->inAll, fileHandle, tabLevel);
+    reportResultAll(aggregateResults, fileHandle, tabLevel, z);
     if (bedFiles != NULL){
         reportResult("both", aggregateResults->totalBoth, aggregateResults->inBoth, fileHandle, tabLevel);
         reportResult("A", aggregateResults->totalA, aggregateResults->inA, fileHandle, tabLevel);
@@ -1466,7 +2396,7 @@ void reportResults(stSortedSet *results_AB, const char *mafFileA, const char *ma
         findentprintf(fileHandle, tabLevel++, "<homologyTest sequenceA=\"%s\" sequenceB=\"%s\">\n",
                       resultPair->seq1, resultPair->seq2);
         findentprintf(fileHandle, tabLevel++, "<aggregateResults>\n");
-        reportResult("all", resultPair->total, resultPair->inAll, fileHandle, tabLevel);
+        reportResultAll(resultPair, fileHandle, tabLevel, z);
         if (bedFiles != NULL){
             reportResult("both", resultPair->totalBoth, resultPair->inBoth, fileHandle, tabLevel);
             reportResult("A", resultPair->totalA, resultPair->inA, fileHandle, tabLevel);
@@ -1479,7 +2409,7 @@ void reportResults(stSortedSet *results_AB, const char *mafFileA, const char *ma
         findentprintf(fileHandle, tabLevel++, "<singleHomologyTest sequenceA=\"%s\" sequenceB=\"%s\">\n",
                       resultPair->seq1, resultPair->seq2);
         findentprintf(fileHandle, tabLevel++, "<aggregateResults>\n");
-        reportResult("all", resultPair->total, resultPair->inAll, fileHandle, tabLevel);
+        reportResultAll(resultPair, fileHandle, tabLevel, z);
         if (bedFiles != NULL){
             reportResult("both", resultPair->totalBoth, resultPair->inBoth, fileHandle, tabLevel);
             reportResult("A", resultPair->totalA, resultPair->inA, fileHandle, tabLevel);
@@ -1535,6 +2465,26 @@ void populateNames(const char *filename, stSet *set, stHash *sequenceLengthHash)
     // clean up
     maf_destroyMfa(mfa);
 }
+void populateNamesFromIndex(const char *filename, mafBlockIndex_t *mbi, stSet *set, stHash *sequenceLengthHash) {
+    /*
+     * populateNames() from the block index of a MAF file rather than the file itself.
+     */
+    for (uint64_t i = 0; i < mafBlockIndex_getNumberOfSequences(mbi); ++i) {
+        char *name = mafBlockIndex_getSequenceName(mbi, i);
+        uint64_t length = mafBlockIndex_getSourceLength(mbi, i);
+        int64_t *known = stHash_search(sequenceLengthHash, name);
+        if (known == NULL) {
+            stHash_insert(sequenceLengthHash, stString_copy(name), buildInt64(length));
+        } else if ((uint64_t) *known != length) {
+            fprintf(stderr, "Inconsistency detected in a maf. Previous source length for sequence "
+                    "%s was %" PRIi64 " but is %" PRIu64 " in %s\n", name, *known, length, filename);
+            exit(EXIT_FAILURE);
+        }
+        if (stSet_search(set, name) == NULL) {
+            stSet_insert(set, stString_copy(name));
+        }
+    }
+}
 void writeXMLHeader(FILE *fileHandle){
     fprintf(fileHandle, "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\" ?>\n");
     return;
@@ -1561,8 +2511,10 @@ bool patternMatches(char *a, char *b) {
         return strcmp(a, b) == 0;
     }
 }
-void buildWigglePairHash(stHash *sequenceLengthHash, stList *wigglePairPatternList, stHash *wigglePairHash,
-                         uint64_t wiggleBinLength, uint64_t wiggleRegionStart, uint64_t wiggleRegionStop) {
+void buildWigglePairHash(stHash *sequenceLengthHash, stSet *legitSequences, stList *wigglePairPatternList,
+                         stHash *wigglePairHash, uint64_t wiggleBinLength, uint64_t wiggleRegionStart,
+                         uint64_t wiggleRegionStop) {
+    // wiggle pairs are only built between legitSequences, the only ones a comparison samples
     stHashIterator *hit1 = NULL;
     stHashIterator *hit2 = NULL;
     char *key1 = NULL;
@@ -1574,10 +2526,12 @@ void buildWigglePairHash(stHash *sequenceLengthHash, stList *wigglePairPatternLi
         // for every wiggle pair
         hit1 = stHash_getIterator(sequenceLengthHash);
         while ((key1 = stHash_getNext(hit1)) != NULL) {
-            if (patternMatches(stList_get(wigglePairPatternList, i), key1)) {
+            if (stSet_search(legitSequences, key1) != NULL &&
+                patternMatches(stList_get(wigglePairPatternList, i), key1)) {
                 hit2 = stHash_getIterator(sequenceLengthHash);
                 while ((key2 = stHash_getNext(hit2)) != NULL) {
-                    if (patternMatches(stList_get(wigglePairPatternList, i + 1), key2)) {
+                    if (stSet_search(legitSequences, key2) != NULL &&
+                        patternMatches(stList_get(wigglePairPatternList, i + 1), key2)) {
                         if (wiggleRegionStop == 0) {
                             // if the option is not set, use the source length field
                             regionLength = *(uint64_t*)stHash_search(sequenceLengthHash, key1);
@@ -1601,24 +2555,17 @@ void buildWigglePairHash(stHash *sequenceLengthHash, stList *wigglePairPatternLi
     }
 }
 void buildSeqNamesSet(Options *options, stSet *seqNamesSet, stHash *sequenceLengthHash) {
+    // the sequences mafFile1 is sampled over: those of mafFile1, or --legitSequences. Each
+    // comparison then narrows them down to those also in its mafFile2, see
+    // buildComparisonSeqNamesSet().
     uint64_t length = 0;
     if (options->legitSequences == NULL) {
-        // read the input maf files and construct the set and hash from them
-        stSet *seqNamesSet1 = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
-        stSet *seqNamesSet2 = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
-        populateNames(options->mafFile1, seqNamesSet1, sequenceLengthHash);
-        populateNames(options->mafFile2, seqNamesSet2, sequenceLengthHash);
-        stSet *seqNamesSetTmp = stSet_getIntersection(seqNamesSet1, seqNamesSet2);
-        stSetIterator *sit = stSet_getIterator(seqNamesSetTmp);
-        char *key = NULL;
-        while ((key = stSet_getNext(sit)) != NULL) {
-            // the intersection does not make copies and seqNamesSet1 and 2 need to be free'd
-            stSet_insert(seqNamesSet, stString_copy(key));
+        if (options->blockIndexes != NULL) {
+            populateNamesFromIndex(options->mafFile1, getBlockIndex(options, options->mafFile1), seqNamesSet,
+                                   sequenceLengthHash);
+        } else {
+            populateNames(options->mafFile1, seqNamesSet, sequenceLengthHash);
         }
-        stSet_destructIterator(sit);
-        stSet_destruct(seqNamesSet1);
-        stSet_destruct(seqNamesSet2);
-        stSet_destruct(seqNamesSetTmp);
     } else {
         // trust the command line input from the user, and use those to build the set and hash
         char *spaceSep = stringReplace(options->legitSequences, ',', ' ');
@@ -1654,3 +2601,31 @@ void buildSeqNamesSet(Options *options, stSet *seqNamesSet, stHash *sequenceLeng
         free(spaceSep);
     }
 }
+void buildComparisonSeqNamesSet(Options *options, stSet *seqNamesSet, Comparison *c, stHash *sequenceLengthHash) {
+    // set c->legitSequences to the sequences of seqNamesSet (see buildSeqNamesSet()) that are
+    // also in c->mafFile2, or to all of them when they were given by --legitSequences. The
+    // pairs of each comparison are tested and tallied over these alone, so that a comparison's
+    // report is the same whether or not it is run in a batch.
+    c->legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet *seqNamesSet2 = NULL;
+    if (options->legitSequences == NULL) {
+        seqNamesSet2 = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+        if (options->blockIndexes != NULL) {
+            populateNamesFromIndex(c->mafFile2, getBlockIndex(options, c->mafFile2), seqNamesSet2,
+                                   sequenceLengthHash);
+        } else {
+            populateNames(c->mafFile2, seqNamesSet2, sequenceLengthHash);
+        }
+    }
+    stSetIterator *sit = stSet_getIterator(seqNamesSet);
+    char *key = NULL;
+    while ((key = stSet_getNext(sit)) != NULL) {
+        if (seqNamesSet2 == NULL || stSet_search(seqNamesSet2, key) != NULL) {
+            stSet_insert(c->legitSequences, stString_copy(key));
+        }
+    }
+    stSet_destructIterator(sit);
+    if (seqNamesSet2 != NULL) {
+        stSet_destruct(seqNamesSet2);
+    }
+}
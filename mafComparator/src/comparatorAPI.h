@@ -40,6 +40,8 @@
 #include "bioioC.h"
 #include "sonLib.h"
 #include "sharedMaf.h"
+#include "bedIndex.h"
+#include "mafBlockIndex.h"
 
 typedef struct _options {
     // used to hold all the command line options
@@ -53,12 +55,26 @@ typedef struct _options {
     uint64_t wiggleRegionStop;
     char *legitSequences; // the intersection of sequence names between inputs
     char *numPairsString;
+    char *writeSamples; // file to store the pairs sampled from mafFile1
+    char *readSamples; // file of previously sampled pairs to use in place of mafFile1 sampling
     uint64_t numberOfSamples;
     uint64_t randomSeed;
     uint64_t near;
     uint64_t numPairs1;
     uint64_t numPairs2;
     uint64_t wiggleBinLength;
+    uint64_t numThreads; // threads used to tally the results of each homology test pass
+    bool exact; // test every pair rather than a sample, see comparatorExact.h
+    uint64_t sortMemory; // bytes of pairs held in memory by --exact before sorting them to disk
+    char *tempDir; // where --exact keeps its sorted runs
+    double ciWidth; // sample in rounds until every pair's interval is this narrow, 0 to sample once
+    double ciLevel; // the confidence level of the --ciWidth intervals
+    char *region; // --region seq:start-end
+    char *regionBed; // comma separated bed files of regions
+    bedIndex_t *regions; // --region and --regionBed together, NULL to compare whole files
+    stHash *blockIndexes; // maf file name to mafBlockIndex_t, see loadBlockIndexes()
+    uint64_t maxMemory; // bytes of sampled pairs held in memory, 0 for no limit, see comparatorSpill.h
+    bool noCache; // neither read nor write the FILE.pairs and FILE.mbi files beside the mafs
 } Options;
 typedef struct _pair {
     // used for sampling pairs of aligned positions
@@ -88,6 +104,15 @@ typedef struct _resultPair {
     uint64_t totalA;
     uint64_t totalB;
     uint64_t totalNeither;
+    // with --ciWidth each pair of sequences is sampled with its own accept probability, so the
+    // counts above are not a uniform sample once strata are combined. These hold the stratified
+    // estimate instead, summed over the numStrata strata of the result: the pairs of aligned
+    // positions of the sampled maf, and the sums of numPairs * proportion and of
+    // numPairs^2 * the variance of the proportion. All 0 otherwise.
+    uint64_t numStrata;
+    double numPairs;
+    double weightedTrue;
+    double weightedVariance;
 } ResultPair;
 typedef struct _wiggleContainer {
     // contains arrays of counts, used by the --wigglePair option
@@ -102,18 +127,50 @@ typedef struct _wiggleContainer {
     uint64_t *absentAtoB;
     uint64_t *absentBtoA;
 } WiggleContainer;
+typedef struct _comparison {
+    // the results for one mafFile2 of a (possibly batched) comparison against mafFile1
+    char *mafFile2;
+    char *outputFile;
+    stSet *legitSequences; // the sequences of mafFile1 also in mafFile2, see buildComparisonSeqNamesSet()
+    uint64_t numPairs1;
+    uint64_t numPairs2;
+    stHash *wigglePairHash;
+    stSortedSet *results_12; // pairs sampled from mafFile1 tested in mafFile2
+    stSortedSet *results_21; // pairs sampled from mafFile2 tested in mafFile1
+    uint64_t numRounds_12; // sampling rounds of mafFile1 (and of mafFile2) taken by --ciWidth
+    uint64_t numRounds_21;
+} Comparison;
+typedef struct _sequenceTable SequenceTable;
+typedef struct _resultAccumulator ResultAccumulator;
+typedef struct _exactRuns ExactRuns; // see comparatorExact.h
 bool g_isVerboseFailures;
 
 Options* options_construct(void);
 void options_destruct(Options* o);
 void populateNames(const char *mAFFile, stSet *set, stHash *seqLengthHash);
+void populateNamesFromIndex(const char *filename, mafBlockIndex_t *mbi, stSet *set, stHash *sequenceLengthHash);
 stSortedSet* compareMAFs_AB(const char *mAFFileA, const char *mAFFileB, uint64_t *numberOfPairsInFile,
-                            stSet *legitimateSequences, stHash *intervalsHash, stHash *wigHash, bool isAtoB,
+                            stSet *legitimateSequences, bedIndex_t *bedIndex, stHash *wigHash, bool isAtoB,
+                            Options *options, stHash *sequenceLengthHash);
+uint64_t countPairsToSample(const char *mafFileA, stSet *legitSequences, Options *options);
+void checkSampledNumberOfPairs(const char *mafFileA, stSet *legitSequences, Options *options, bool isCounted,
+                               uint64_t verifiedNumberOfPairs, uint64_t *numberOfPairs);
+stSortedSet* sampleMafPairs(const char *mafFileA, uint64_t *numberOfPairs, stSet *legitSequences,
                             Options *options, stHash *sequenceLengthHash);
+stSortedSet* compareSampledPairs(stSortedSet *pairs, const char *mafFileB, stSet *legitSequences,
+                                 bedIndex_t *bedIndex, stHash *wigglePairHash, bool isAtoB,
+                                 Options *options);
+bool parseRegion(const char *region, char **name, uint64_t *start, uint64_t *end);
+void loadBlockIndexes(Options *options);
+Comparison* comparison_construct(const char *mafFile2, const char *outputFile);
+void comparison_destruct(Comparison *c);
+void compareBatch(Options *options, stSortedSet *sampledPairs_12, ExactRuns *sampledRuns_12,
+                  Comparison **comparisons, uint64_t numComparisons, stSet *legitSequences,
+                  bedIndex_t *bedIndex, stHash *sequenceLengthHash);
 void findentprintf(FILE *fp, unsigned indent, char const *fmt, ...);
 void reportResults(stSortedSet *results_AB, const char *mAFFileA, const char *mAFFileB,
                    FILE *fileHandle, uint64_t near, stSet *legitimateSequences,
-                   const char *bedFiles);
+                   const char *bedFiles, double ciLevel);
 APair* aPair_init(void);
 void aPair_fillOut(APair *aPair, char *seq1, char *seq2, uint64_t pos1, uint64_t pos2);
 APair* aPair_construct(const char *seq1, const char *seq2, uint64_t pos1, uint64_t pos2);
@@ -148,21 +205,31 @@ uint64_t* buildChooseTwoArray(void);
 uint64_t countPairsInMaf(const char *filename, stSet *legitPairs);
 uint64_t countPairsInColumn(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, uint64_t *chooseTwoArray);
 uint64_t countLegitGaplessPositions(char **mat, uint64_t c, uint64_t numRows, bool *legitRows);
-void countPairs(APair *pair, stHash *intervalsHash, int64_t *counter,
+void countPairs(APair *pair, bedIndex_t *bedIndex, int64_t *counter,
                 stSortedSet *legitPairs, void *a, uint64_t near);
 
 void pairIndicesToArrayIndex(uint64_t r, uint64_t c, uint64_t n, uint64_t *i);
 void arrayIndexToPairIndices(uint64_t i, uint64_t n, uint64_t *r, uint64_t *c);
-void samplePairs(APair *thisPair, stHash *intervalsHash, stSortedSet *pairs,
+void samplePairs(APair *thisPair, bedIndex_t *bedIndex, stSortedSet *pairs,
                  double *acceptProbability, stHash *legitPairs, uint64_t near);
-bool inInterval(stHash *intervalsHash, char *seq, uint64_t pos);
 uint64_t findLowerBound(uint64_t pos, uint64_t near);
-void recordNearPair(APair *thisPair, stSortedSet *sampledPairs, uint64_t near, stSet *positivePairs);
+void recordNearPair(APair *thisPair, stSortedSet *sampledPairs, stSortedSet *sampledPairsByPos2, uint64_t near,
+                    stSet *positivePairs);
 void samplePairsFromMaf(const char *filename, stSortedSet *pairs, double acceptProbability,
                         stSet *legitSequences, uint64_t *numPairs, stHash *sequenceLengthHash);
 void samplePairsFromColumn(double acceptProbability, stSortedSet *sampledPairs,
                            uint64_t numSeqs, uint64_t *chooseTwoArray,
                            char **nameArray, uint64_t *columnPositions);
+void samplePairsFromRun(double acceptProbability, stSortedSet *pairs, uint64_t numSeqs, uint64_t runLength,
+                        uint64_t *chooseTwoArray, char **nameArray, uint64_t *runPositions, int *runStrandInts);
+void samplePairsFromRunBruteForce(double acceptProbability, stSortedSet *pairs,
+                                  uint64_t *chooseTwoArray,
+                                  char **nameArray, uint64_t *positions, int *strandInts,
+                                  uint64_t numSeqs, uint64_t numPairs, uint64_t runLength);
+void samplePairsFromRunAnalytic(double acceptProbability, stSortedSet *pairs,
+                                uint64_t *chooseTwoArray,
+                                char **nameArray, uint64_t *positions, int *strandInts,
+                                uint64_t numSeqs, uint64_t pairsPerColumn, uint64_t runLength);
 void samplePairsFromColumnBruteForce(double acceptProbability, stSortedSet *sampledPairs,
                                      uint64_t *chooseTwoArray,
                                      char **nameArray, uint64_t *positions, uint64_t numSeqs,
@@ -175,18 +242,41 @@ void samplePairsFromColumnNaive(char **mat, uint64_t c, bool *legitRows, double
                                 stSortedSet *sampledPairs, uint64_t *chooseTwoArray,
                                 char **nameArray, uint64_t *positions, uint64_t numSeqs,
                                 uint64_t numPairs);
-void walkBlockTestingHomology(mafBlock_t *mb, stSortedSet *sampledPairs, stSet *positivePairs,
-                              stSet *legitSequences, stHash *intervalsHash, uint64_t near);
+void walkBlockTestingHomology(mafBlock_t *mb, stSortedSet *sampledPairs, stSortedSet *sampledPairsByPos2,
+                              stSet *positivePairs, stSet *legitSequences, bedIndex_t *bedIndex, uint64_t near);
 void testHomologyOnColumn(char **mat, uint64_t c, uint64_t numSeqs, bool *legitRows, char **names,
-                          stSortedSet *sampledPairs, stSet *positivePairs, mafLine_t **mlArray,
-                          uint64_t *allPositions, stHash *intervalsHash, uint64_t near);
+                          stSortedSet *sampledPairs, stSortedSet *sampledPairsByPos2, stSet *positivePairs,
+                          mafLine_t **mlArray, uint64_t *allPositions, bedIndex_t *bedIndex, uint64_t near);
 void performHomologyTests(const char *filename, stSortedSet *sampledPairs, stSet *positivePairs,
-                          stSet *legitSequences, stHash *intervalsHash, uint64_t near);
-void homologyTests1(APair *thisPair, stHash *intervalsHash, stSortedSet *pairs,
+                          stSet *legitSequences, bedIndex_t *bedIndex, uint64_t near);
+bool pairInRegions(APair *pair, bedIndex_t *regions);
+uint64_t walkBlockCountingRegionPairs(mafBlock_t *mb, stSet *legitSequences, bedIndex_t *regions,
+                                      uint64_t *chooseTwoArray);
+uint64_t countPairsInRegions(const char *filename, mafBlockIndex_t *mbi, stSet *legitSequences,
+                             bedIndex_t *regions);
+void samplePairsFromRegions(const char *filename, mafBlockIndex_t *mbi, stSortedSet *pairs,
+                            double acceptProbability, stSet *legitSequences, bedIndex_t *regions,
+                            stHash *sequenceLengthHash);
+void performHomologyTestsInRegions(const char *filename, mafBlockIndex_t *mbi, bedIndex_t *regions,
+                                   stSortedSet *sampledPairs, stSet *positivePairs, stSet *legitSequences,
+                                   bedIndex_t *bedIndex, uint64_t near);
+void homologyTests1(APair *thisPair, bedIndex_t *bedIndex, stSortedSet *pairs,
                     stSet *positivePairs, stSet *legitPairs, int64_t near);
-void enumerateHomologyResults(stSortedSet *sampledPairs, stSortedSet *resultPairs, stHash *intervalsHash,
+void enumerateHomologyResults(stSortedSet *sampledPairs, stSortedSet *resultPairs, bedIndex_t *bedIndex,
                               stSet *positivePairs, stHash *wigglePairHash, bool isAtoB,
-                              uint64_t wiggleBinLength);
+                              uint64_t wiggleBinLength, stSet *legitSequences, uint64_t numThreads);
+void resultPair_add(ResultPair *dest, ResultPair *src);
+SequenceTable* sequenceTable_construct(stSet *legitSequences, bedIndex_t *bedIndex, stHash *wigglePairHash);
+void sequenceTable_destruct(SequenceTable *st);
+uint64_t sequenceTable_getNumberOfSequences(SequenceTable *st);
+int64_t sequenceTable_getId(SequenceTable *st, const char *name);
+char* sequenceTable_getName(SequenceTable *st, uint64_t id);
+ResultAccumulator* resultAccumulator_construct(SequenceTable *st, uint64_t wiggleBinLength, bool isAtoB,
+                                               bool privateBins);
+void resultAccumulator_destruct(ResultAccumulator *ra);
+void resultAccumulator_tally(ResultAccumulator *ra, uint64_t seq1, uint64_t pos1, uint64_t seq2,
+                             uint64_t pos2, bool foundPair);
+void resultAccumulator_merge(ResultAccumulator *ra, stSortedSet *resultPairs);
 ResultPair *aggregateResult(void *(*getNextPair)(void *, void *), stSortedSet *set, void *seqName,
                             const char *name1, const char *name2);
 void* addReferencesAndDups_getDups(void *iterator, void *seqName);
@@ -208,18 +298,26 @@ void printAllStrandInts(int *allStrandInts, mafBlock_t *mb);
 uint64_t countLegitPositions(char **mat, uint64_t c, uint64_t numRows);
 mafLine_t** cullMlArrayByColumn(char **mat, uint64_t c, mafLine_t **mlArray, bool *legitRows, uint64_t numRows, uint64_t numLegitGaplessPositions);
 uint64_t* cullPositionsByColumn(char **mat, uint64_t c, uint64_t *positions, bool *legitRows, uint64_t numRows, uint64_t numLegitGaplessPositions);
+int* cullStrandIntsByColumn(char **mat, uint64_t c, int *strandInts, bool *legitRows,
+                            uint64_t numRows, uint64_t numLegitGaplessPositions);
+bool* findGapPatternBreaks(char **mat, uint64_t seqFieldLength, uint64_t numRows, bool *legitRows);
 void walkBlockSamplingPairs(const char *filename, mafBlock_t *mb, stSortedSet *sampledPairs, double acceptProbability, stSet *legitSequences, uint64_t *chooseTwoArray, uint64_t *numPairs, stHash *sequenceLengthHash);
 int aPair_cmpFunction(APair *aPair1, APair *aPair2);
+int aPair_cmpFunction_pos2(APair *p1, APair *p2);
+stSortedSet* constructPairsByPos2(stSortedSet *sampledPairs, uint64_t near);
 uint64_t sumBoolArray(bool *legitRows, uint64_t numSeqs);
 mafLine_t** createMafLineArray(mafBlock_t *mb, uint64_t numLegit, bool *legitRows);
 void updatePositions(char **mat, uint64_t c, uint64_t *positions, int *strandInts, uint64_t numSeqs);
+void updatePositionsByRun(char **mat, uint64_t c, uint64_t runLength, uint64_t *allPositions,
+                          int *allStrandInts, uint64_t numSeqs, bool *legitRows);
 void printSortedSet(stSortedSet *pairs);
 unsigned countChars(char *s, char c);
 bool patternMatches(char *a, char *b);
-void buildWigglePairHash(stHash *sequenceLengthHash, stList *wigglePairPatternList,
+void buildWigglePairHash(stHash *sequenceLengthHash, stSet *legitSequences, stList *wigglePairPatternList,
                          stHash *wigglePairHash, uint64_t wiggleBinLength, uint64_t wiggleRegionStart,
                          uint64_t wiggleRegionStop);
 void reportResultsForWiggles(stHash *wigglePairHash, FILE *fileHandle);
 void buildSeqNamesSet(Options *options, stSet *seqNamesSet, stHash *sequenceLengthHash);
+void buildComparisonSeqNamesSet(Options *options, stSet *seqNamesSet, Comparison *c, stHash *sequenceLengthHash);
 bool positionIsInWiggleRegion(WiggleContainer *wc, uint64_t *refPos);
 #endif /* _COMPARATOR_API_H_ */
@@ -0,0 +1,402 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sonLib.h"
+#include "common.h"
+#include "sharedMaf.h"
+#include "comparatorAPI.h"
+#include "comparatorAdaptive.h"
+
+static const double kAdaptivePilotFraction = 8.0; // the first round aims for 1/8th of the worst case
+static const double kAdaptiveOvershoot = 1.2; // later rounds aim this far past the predicted need
+static const double kAdaptiveGrowth = 1.5; // ... and grow a stratum's tests by at least this factor
+
+typedef struct _stratum {
+    // one pair of sequences of the sampled maf
+    uint64_t key; // seq1 * numberOfSequences + seq2, SequenceTable ids with seq1 <= seq2
+    uint64_t numPairs; // pairs of aligned positions of the stratum in the sampled maf
+    uint64_t tested; // distinct pairs tested so far
+    uint64_t found; // ... and of those, the number found in the other maf
+    double wanted; // new tests wanted from the coming round
+    double acceptProbability; // of each untested pair in the coming round
+    bool done;
+} Stratum;
+typedef struct _adaptiveSampler {
+    const char *filename;
+    SequenceTable *st;
+    stHash *sequenceLengthHash;
+    stHash *strataHash; // keyed on Stratum.key
+    stList *strata; // the strata in order of discovery, owns them
+    stSortedSet *testedPairs; // every pair sampled so far, ordered by aPair_cmpFunction()
+    uint64_t numPairs;
+} AdaptiveSampler;
+
+double normalQuantileForLevel(double level) {
+    // the z for which a two sided normal interval of +/- z holds `level' of the probability,
+    // i.e. erfc(z / sqrt(2)) == 1 - level, found by bisection.
+    assert(level > 0.0 && level < 1.0);
+    double lo = 0.0, hi = 40.0;
+    for (int i = 0; i < 200; ++i) {
+        double mid = (lo + hi) / 2.0;
+        if (erfc(mid / sqrt(2.0)) > 1.0 - level) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo + hi) / 2.0;
+}
+static double wilsonWidth(double p, double n, double z) {
+    double z2 = z * z;
+    return 2.0 * z * sqrt(p * (1.0 - p) / n + z2 / (4.0 * n * n)) / (1.0 + z2 / n);
+}
+void wilsonInterval(uint64_t successes, uint64_t n, double z, double *lower, double *upper) {
+    // the Wilson score interval of the proportion successes / n. Unlike the normal approximation
+    // it is well behaved for proportions near 0 or 1, which is where most homology tests land.
+    if (n == 0) {
+        *lower = 0.0;
+        *upper = 1.0;
+        return;
+    }
+    double p = (double) successes / n;
+    double z2 = z * z;
+    double centre = (p + z2 / (2.0 * n)) / (1.0 + z2 / n);
+    double halfWidth = wilsonWidth(p, (double) n, z) / 2.0;
+    *lower = (centre - halfWidth < 0.0) ? 0.0 : centre - halfWidth;
+    *upper = (centre + halfWidth > 1.0) ? 1.0 : centre + halfWidth;
+}
+uint64_t wilsonSamplesNeeded(uint64_t successes, uint64_t n, double z, double width) {
+    // the smallest number of tests whose Wilson interval is no wider than width, supposing the
+    // proportion holds at its current estimate. The estimate is pulled towards 1/2 as in the
+    // Agresti-Coull interval so that a run of early successes does not promise a tiny need.
+    assert(width > 0.0);
+    double z2 = z * z;
+    double p = (successes + z2 / 2.0) / (n + z2);
+    uint64_t hi = 1;
+    while (wilsonWidth(p, (double) hi, z) > width) {
+        hi *= 2;
+    }
+    uint64_t lo = hi / 2; // wilsonWidth(p, lo) > width, or lo is 0
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (wilsonWidth(p, (double) mid, z) > width) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return hi;
+}
+void setStratifiedEstimate(ResultPair *rp, uint64_t numPairs, double z) {
+    // make rp, the results of a single stratum of numPairs pairs, a term of a stratified
+    // estimate. The variance uses the Agresti-Coull adjusted proportion, so that a stratum whose
+    // tests all agree still contributes some uncertainty, and the finite population correction,
+    // so that an exhaustively tested stratum contributes none.
+    double n = (double) rp->total;
+    double z2 = z * z;
+    double p = (rp->total == 0) ? 0.0 : (double) rp->inAll / n;
+    double pAdjusted = (rp->inAll + z2 / 2.0) / (n + z2);
+    double fpc = (numPairs == 0 || rp->total >= numPairs) ? 0.0 : 1.0 - n / (double) numPairs;
+    rp->numStrata = 1;
+    rp->numPairs = (double) numPairs;
+    rp->weightedTrue = rp->numPairs * p;
+    rp->weightedVariance = rp->numPairs * rp->numPairs * pAdjusted * (1.0 - pAdjusted) / (n + z2) * fpc;
+}
+void stratifiedInterval(ResultPair *rp, double z, double *average, double *lower, double *upper) {
+    // the estimate of the proportion of true tests over all of the pairs that rp stands for,
+    // and its normal interval at z. A single stratum is a uniform sample, and gets the Wilson
+    // interval of its counts.
+    if (rp->numStrata <= 1 || rp->numPairs == 0.0) {
+        *average = (rp->total == 0) ? 0.0 : (double) rp->inAll / rp->total;
+        wilsonInterval(rp->inAll, rp->total, z, lower, upper);
+        return;
+    }
+    *average = rp->weightedTrue / rp->numPairs;
+    double halfWidth = z * sqrt(rp->weightedVariance) / rp->numPairs;
+    *lower = (*average - halfWidth < 0.0) ? 0.0 : *average - halfWidth;
+    *upper = (*average + halfWidth > 1.0) ? 1.0 : *average + halfWidth;
+}
+static uint64_t stratumKey(const void *k) {
+    return *(const uint64_t *) k;
+}
+static int stratumEqualKey(const void *k1, const void *k2) {
+    return *(const uint64_t *) k1 == *(const uint64_t *) k2;
+}
+static Stratum* getStratum(AdaptiveSampler *as, uint64_t id1, uint64_t id2) {
+    uint64_t key = (id1 <= id2) ? id1 * sequenceTable_getNumberOfSequences(as->st) + id2 :
+        id2 * sequenceTable_getNumberOfSequences(as->st) + id1;
+    Stratum *s = stHash_search(as->strataHash, &key);
+    if (s == NULL) {
+        s = st_calloc(1, sizeof(*s));
+        s->key = key;
+        stHash_insert(as->strataHash, &(s->key), s);
+        stList_append(as->strata, s);
+    }
+    return s;
+}
+static void sampleStratumRun(AdaptiveSampler *as, Stratum *s, stSortedSet *newPairs, char *name1, char *name2,
+                             uint64_t pos1, uint64_t pos2, int strand1, int strand2, uint64_t runLength) {
+    // accept each of the runLength pairs of a run with the stratum's accept probability by drawing
+    // the geometric gaps between accepted offsets, so the cost is in the pairs taken rather than in
+    // the length of the run. Pairs tested in an earlier round are not taken again.
+    double q = s->acceptProbability;
+    double logMiss = (q < 1.0) ? log1p(-q) : 0.0;
+    uint64_t offset = 0;
+    APair key;
+    while (offset < runLength) {
+        if (q < 1.0) {
+            double skip = floor(log(1.0 - st_random()) / logMiss);
+            if (skip >= (double) (runLength - offset)) {
+                break;
+            }
+            offset += (uint64_t) skip;
+        }
+        aPair_fillOut(&key, name1, name2, pos1 + strand1 * (int64_t) offset, pos2 + strand2 * (int64_t) offset);
+        if (stSortedSet_search(as->testedPairs, &key) == NULL && stSortedSet_search(newPairs, &key) == NULL) {
+            stSortedSet_insert(newPairs, aPair_construct(key.seq1, key.seq2, key.pos1, key.pos2));
+        }
+        ++offset;
+    }
+}
+static void walkBlockStratified(AdaptiveSampler *as, mafBlock_t *mb, stSortedSet *newPairs, uint64_t *numPairs) {
+    // count the pairs of each stratum in the block or, if newPairs is not NULL, sample them.
+    uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
+    if (numSeqs < 2) {
+        return;
+    }
+    validateMafBlockSourceLengths(as->filename, mb, as->sequenceLengthHash);
+    uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
+    char **names = maf_mafBlock_getSpeciesArray(mb);
+    char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
+    int64_t *ids = st_malloc(sizeof(*ids) * numSeqs);
+    bool *legitRows = st_malloc(sizeof(*legitRows) * numSeqs);
+    for (uint64_t r = 0; r < numSeqs; ++r) {
+        ids[r] = sequenceTable_getId(as->st, names[r]);
+        legitRows[r] = (ids[r] != -1);
+    }
+    uint64_t *allPositions = maf_mafBlock_getPosCoordStartArray(mb);
+    int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
+    bool *patternBreaks = findGapPatternBreaks(mat, seqFieldLength, numSeqs, legitRows);
+    uint64_t *gapless = st_malloc(sizeof(*gapless) * numSeqs);
+    uint64_t runLength;
+    for (uint64_t c = 0; c < seqFieldLength; c += runLength) {
+        for (runLength = 1; c + runLength < seqFieldLength && !patternBreaks[c + runLength]; ++runLength);
+        uint64_t n = 0;
+        for (uint64_t r = 0; r < numSeqs; ++r) {
+            if (legitRows[r] && mat[r][c] != '-') {
+                gapless[n++] = r;
+            }
+        }
+        for (uint64_t a = 0; a + 1 < n; ++a) {
+            for (uint64_t b = a + 1; b < n; ++b) {
+                uint64_t r1 = gapless[a], r2 = gapless[b];
+                Stratum *s = getStratum(as, ids[r1], ids[r2]);
+                *numPairs += runLength;
+                if (newPairs == NULL) {
+                    s->numPairs += runLength;
+                } else if (s->acceptProbability > 0.0) {
+                    sampleStratumRun(as, s, newPairs, names[r1], names[r2], allPositions[r1], allPositions[r2],
+                                     allStrandInts[r1], allStrandInts[r2], runLength);
+                }
+            }
+        }
+        updatePositionsByRun(mat, c, runLength, allPositions, allStrandInts, numSeqs, legitRows);
+    }
+    // clean up
+    free(gapless);
+    free(patternBreaks);
+    free(allPositions);
+    free(allStrandInts);
+    free(legitRows);
+    free(ids);
+    for (uint64_t i = 0; i < numSeqs; ++i) {
+        free(names[i]);
+    }
+    free(names);
+    maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
+}
+static void walkMafStratified(AdaptiveSampler *as, stSortedSet *newPairs) {
+    mafFileApi_t *mfa = maf_newMfa(as->filename, "r");
+    mafBlock_t *mb = NULL;
+    uint64_t numPairs = 0;
+    while ((mb = maf_readBlock(mfa)) != NULL) {
+        walkBlockStratified(as, mb, newPairs, &numPairs);
+        maf_destroyMafBlockList(mb);
+    }
+    maf_destroyMfa(mfa);
+    if (newPairs == NULL) {
+        as->numPairs = numPairs;
+    } else if (numPairs != as->numPairs) {
+        fprintf(stderr, "Error, differing numberOfPairs values, %" PRIu64 " != %" PRIu64 "\n",
+                numPairs, as->numPairs);
+        exit(EXIT_FAILURE);
+    }
+}
+static bool planRound(AdaptiveSampler *as, double z, double width, uint64_t budget) {
+    // set the accept probability of every stratum for the coming round, returns false if there
+    // is nothing left to sample. When the strata together want more tests than the budget
+    // allows their wants are scaled down in proportion.
+    double totalWanted = 0.0;
+    double lower, upper;
+    for (int64_t i = 0; i < stList_length(as->strata); ++i) {
+        Stratum *s = stList_get(as->strata, i);
+        s->wanted = 0.0;
+        s->acceptProbability = 0.0;
+        if (s->done) {
+            continue;
+        }
+        if (s->tested >= s->numPairs) {
+            s->done = true;
+            continue;
+        }
+        if (s->tested > 0) {
+            wilsonInterval(s->found, s->tested, z, &lower, &upper);
+            if (upper - lower <= width) {
+                s->done = true;
+                continue;
+            }
+        }
+        double need = (double) wilsonSamplesNeeded(s->found, s->tested, z, width);
+        double target = (s->tested == 0) ? need / kAdaptivePilotFraction : kAdaptiveOvershoot * need;
+        if (target < kAdaptiveGrowth * s->tested) {
+            target = kAdaptiveGrowth * s->tested;
+        }
+        if (target > (double) s->numPairs) {
+            target = (double) s->numPairs;
+        }
+        s->wanted = (target < s->tested + 1.0) ? 1.0 : target - s->tested;
+        totalWanted += s->wanted;
+    }
+    if (totalWanted == 0.0 || budget == 0) {
+        return false;
+    }
+    double scale = (totalWanted > (double) budget) ? (double) budget / totalWanted : 1.0;
+    for (int64_t i = 0; i < stList_length(as->strata); ++i) {
+        Stratum *s = stList_get(as->strata, i);
+        if (s->wanted > 0.0) {
+            s->acceptProbability = scale * s->wanted / (double) (s->numPairs - s->tested);
+            if (s->acceptProbability > 1.0) {
+                s->acceptProbability = 1.0;
+            }
+        }
+    }
+    return true;
+}
+static void tallyRound(AdaptiveSampler *as, stSortedSet *roundResults, stSortedSet *resultPairs) {
+    // add the results of a round to those of its strata and to resultPairs. Takes ownership of
+    // roundResults. A stratum whose every pair was offered this round has been tested exhaustively.
+    ResultPair *rp = NULL;
+    while ((rp = stSortedSet_getFirst(roundResults)) != NULL) {
+        stSortedSet_remove(roundResults, rp);
+        Stratum *s = getStratum(as, sequenceTable_getId(as->st, rp->seq1), sequenceTable_getId(as->st, rp->seq2));
+        s->tested += rp->total;
+        s->found += rp->inAll;
+        ResultPair *dest = stSortedSet_search(resultPairs, rp);
+        if (dest == NULL) {
+            stSortedSet_insert(resultPairs, rp);
+        } else {
+            resultPair_add(dest, rp);
+            resultPair_destruct(rp);
+        }
+    }
+    stSortedSet_destruct(roundResults);
+    for (int64_t i = 0; i < stList_length(as->strata); ++i) {
+        Stratum *s = stList_get(as->strata, i);
+        if (s->acceptProbability >= 1.0) {
+            s->done = true;
+        }
+    }
+}
+stSortedSet* compareAdaptive(const char *mafFileA, const char *mafFileB, uint64_t *numberOfPairs,
+                             stSet *legitSequences, bedIndex_t *bedIndex, stHash *wigglePairHash,
+                             bool isAtoB, Options *options, stHash *sequenceLengthHash,
+                             uint64_t *numRounds) {
+    /*
+     * Sample pairs from mafFileA and test them in mafFileB in rounds until the Wilson interval
+     * (at options->ciLevel) of every ResultPair is no wider than options->ciWidth, or until
+     * options->numberOfSamples pairs have been tested. Each round costs one pass over each maf,
+     * plus an initial pass over mafFileA to count the pairs of every stratum.
+     */
+    double z = normalQuantileForLevel(options->ciLevel);
+    AdaptiveSampler as;
+    as.filename = mafFileA;
+    as.st = sequenceTable_construct(legitSequences, bedIndex, NULL);
+    as.sequenceLengthHash = sequenceLengthHash;
+    as.strataHash = stHash_construct3(stratumKey, stratumEqualKey, NULL, NULL);
+    as.strata = stList_construct3(0, free);
+    as.testedPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction,
+                                            (void(*)(void *)) aPair_destruct);
+    as.numPairs = 0;
+    stSortedSet *resultPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly,
+                                                      (void(*)(void *)) aPair_destruct);
+    walkMafStratified(&as, NULL);
+    *numberOfPairs = as.numPairs;
+    st_logInfo("%s has %" PRIu64 " pairs in %" PRIi64 " sequence pairs\n", mafFileA, as.numPairs,
+               stList_length(as.strata));
+    uint64_t numTested = 0;
+    *numRounds = 0;
+    while (planRound(&as, z, options->ciWidth,
+                     (numTested < options->numberOfSamples) ? options->numberOfSamples - numTested : 0)) {
+        stSortedSet *newPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, NULL);
+        walkMafStratified(&as, newPairs);
+        stSortedSet *roundResults = compareSampledPairs(newPairs, mafFileB, legitSequences, bedIndex,
+                                                        wigglePairHash, isAtoB, options);
+        tallyRound(&as, roundResults, resultPairs);
+        numTested += stSortedSet_size(newPairs);
+        // newPairs does not own its pairs, they are handed on to testedPairs
+        stSortedSetIterator *sit = stSortedSet_getIterator(newPairs);
+        APair *pair = NULL;
+        while ((pair = stSortedSet_getNext(sit)) != NULL) {
+            stSortedSet_insert(as.testedPairs, pair);
+        }
+        stSortedSet_destructIterator(sit);
+        stSortedSet_destruct(newPairs);
+        ++(*numRounds);
+        st_logInfo("Round %" PRIu64 " sampling %s has tested %" PRIu64 " pairs\n", *numRounds, mafFileA,
+                   numTested);
+    }
+    // each result is a single stratum, weight it by the stratum's share of the pairs. Strata
+    // that were never tested have no result and are left out of the aggregates.
+    stSortedSetIterator *rit = stSortedSet_getIterator(resultPairs);
+    ResultPair *rp = NULL;
+    while ((rp = stSortedSet_getNext(rit)) != NULL) {
+        Stratum *s = getStratum(&as, sequenceTable_getId(as.st, rp->seq1), sequenceTable_getId(as.st, rp->seq2));
+        setStratifiedEstimate(rp, s->numPairs, z);
+    }
+    stSortedSet_destructIterator(rit);
+    // clean up
+    stSortedSet_destruct(as.testedPairs);
+    stHash_destruct(as.strataHash);
+    stList_destruct(as.strata);
+    sequenceTable_destruct(as.st);
+    return resultPairs;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#ifndef _COMPARATOR_ADAPTIVE_H_
+#define _COMPARATOR_ADAPTIVE_H_
+
+#include <stdint.h>
+#include "sonLib.h"
+#include "comparatorAPI.h"
+
+/*
+ * The --ciWidth mode samples in rounds rather than all at once. Each pair of sequences (a
+ * stratum) in the sampled maf is given its own accept probability, sized from its running
+ * estimate so that rare pairs are tested as thoroughly as common ones, and after each round a
+ * Wilson score interval is computed for the proportion of true tests of each pair. Sampling
+ * stops once every interval is narrower than the requested width, once every pair of aligned
+ * positions of a stratum has been tested, or once --samples tests have been made.
+ */
+double normalQuantileForLevel(double level);
+void wilsonInterval(uint64_t successes, uint64_t n, double z, double *lower, double *upper);
+uint64_t wilsonSamplesNeeded(uint64_t successes, uint64_t n, double z, double width);
+void setStratifiedEstimate(ResultPair *rp, uint64_t numPairs, double z);
+void stratifiedInterval(ResultPair *rp, double z, double *average, double *lower, double *upper);
+stSortedSet* compareAdaptive(const char *mafFileA, const char *mafFileB, uint64_t *numberOfPairs,
+                             stSet *legitSequences, bedIndex_t *bedIndex, stHash *wigglePairHash,
+                             bool isAtoB, Options *options, stHash *sequenceLengthHash,
+                             uint64_t *numRounds);
+
+#endif // _COMPARATOR_ADAPTIVE_H_
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h> // getpid
+#include "sonLib.h"
+#include "common.h"
+#include "sharedMaf.h"
+#include "comparatorAPI.h"
+#include "comparatorCount.h"
+
+static const uint64_t kCountMinChunkLength = 1 << 20; // files are not split finer than this
+static const int64_t kCountCacheMaxEntries = 16; // legit sequence sets remembered per maf
+
+typedef struct _countChunk {
+    const char *filename;
+    stSet *legitSequences;
+    uint64_t *chooseTwoArray;
+    uint64_t start;
+    uint64_t end;
+    uint64_t numPairs;
+} CountChunk;
+
+static bool statMaf(const char *filename, uint64_t *size, int64_t *modified) {
+    struct stat s;
+    if (stat(filename, &s) != 0) {
+        return false;
+    }
+    *size = (uint64_t) s.st_size;
+    *modified = (int64_t) s.st_mtime;
+    return true;
+}
+static uint64_t nextBlockBoundary(FILE *fh, uint64_t target, uint64_t size) {
+    /*
+     * the first offset at or after target that directly follows a blank line which itself
+     * follows a non-blank line, which is where maf_readBlock() leaves off after a block (or
+     * after a header followed by a blank line). Returns size if there is no such offset.
+     */
+    int c;
+    if (target == 0 || fseek(fh, (long) target - 1, SEEK_SET) != 0) {
+        return size;
+    }
+    // finish the line that target falls in, unless target starts a line
+    while ((c = getc(fh)) != EOF && c != '\n');
+    bool sawNonBlank = false;
+    while (c != EOF) {
+        bool isBlank = true;
+        while ((c = getc(fh)) != EOF && c != '\n') {
+            if (!isspace(c)) {
+                isBlank = false;
+            }
+        }
+        if (isBlank && sawNonBlank && c == '\n') {
+            return (uint64_t) ftell(fh);
+        }
+        sawNonBlank = !isBlank;
+    }
+    return size;
+}
+uint64_t* splitMafAtBlocks(const char *filename, uint64_t numChunks) {
+    // returns numChunks + 1 non-decreasing offsets, the first 0 and the last the size of the
+    // file, such that chunk i, [offsets[i], offsets[i + 1]), holds whole blocks.
+    uint64_t size;
+    int64_t modified;
+    if (!statMaf(filename, &size, &modified)) {
+        fprintf(stderr, "Error, unable to stat %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t *offsets = (uint64_t*) st_malloc(sizeof(*offsets) * (numChunks + 1));
+    FILE *fh = de_fopen(filename, "rb");
+    offsets[0] = 0;
+    for (uint64_t i = 1; i < numChunks; ++i) {
+        offsets[i] = nextBlockBoundary(fh, (uint64_t) ((double) size * i / numChunks), size);
+        if (offsets[i] < offsets[i - 1]) {
+            offsets[i] = offsets[i - 1];
+        }
+    }
+    offsets[numChunks] = size;
+    fclose(fh);
+    return offsets;
+}
+uint64_t countPairsInMafRange(const char *filename, stSet *legitSequences, uint64_t start, uint64_t end,
+                              uint64_t *chooseTwoArray) {
+    /*
+     * countPairsInMaf() over the blocks of the chunk [start, end) of the file, as given by
+     * splitMafAtBlocks(). The line numbers of format errors in a chunk that does not start the
+     * file are counted from the start of the chunk.
+     */
+    uint64_t counter = 0;
+    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    mafBlock_t *mb = NULL;
+    if (start > 0) {
+        maf_mafFileApi_seek(mfa, (int64_t) start, 1);
+    }
+    while (true) {
+        // -1 only for the first block of a file whose header runs straight into it
+        int64_t offset = maf_mafFileApi_tell(mfa);
+        if (offset != -1 && (uint64_t) offset >= end) {
+            break;
+        }
+        if ((mb = maf_readBlock(mfa)) == NULL) {
+            break;
+        }
+        counter += walkBlockCountingPairs(mb, legitSequences, chooseTwoArray);
+        maf_destroyMafBlockList(mb);
+    }
+    maf_destroyMfa(mfa);
+    return counter;
+}
+static void* countChunk_run(void *a) {
+    CountChunk *chunk = (CountChunk *) a;
+    chunk->numPairs = countPairsInMafRange(chunk->filename, chunk->legitSequences, chunk->start, chunk->end,
+                                           chunk->chooseTwoArray);
+    return NULL;
+}
+uint64_t countPairsInMafThreaded(const char *filename, stSet *legitSequences, uint64_t numThreads) {
+    // countPairsInMaf() with the file split into (at most) numThreads chunks counted in parallel.
+    uint64_t size;
+    int64_t modified;
+    if (!statMaf(filename, &size, &modified)) {
+        fprintf(stderr, "Error, unable to stat %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t numChunks = size / kCountMinChunkLength;
+    if (numChunks > numThreads) {
+        numChunks = numThreads;
+    }
+    if (numChunks < 2) {
+        return countPairsInMaf(filename, legitSequences);
+    }
+    uint64_t *offsets = splitMafAtBlocks(filename, numChunks);
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    CountChunk *chunks = (CountChunk*) st_malloc(sizeof(*chunks) * numChunks);
+    pthread_t *threads = (pthread_t*) st_malloc(sizeof(*threads) * numChunks);
+    for (uint64_t i = 0; i < numChunks; ++i) {
+        chunks[i].filename = filename;
+        chunks[i].legitSequences = legitSequences;
+        chunks[i].chooseTwoArray = chooseTwoArray;
+        chunks[i].start = offsets[i];
+        chunks[i].end = offsets[i + 1];
+        chunks[i].numPairs = 0;
+        if (pthread_create(&(threads[i]), NULL, countChunk_run, &(chunks[i])) != 0) {
+            fprintf(stderr, "Error, unable to create thread to count pairs in %s\n", filename);
+            exit(EXIT_FAILURE);
+        }
+    }
+    uint64_t counter = 0;
+    for (uint64_t i = 0; i < numChunks; ++i) {
+        pthread_join(threads[i], NULL);
+        counter += chunks[i].numPairs;
+    }
+    // clean up
+    free(threads);
+    free(chunks);
+    free(chooseTwoArray);
+    free(offsets);
+    return counter;
+}
+static uint64_t legitSequencesKey(stSet *legitSequences) {
+    // FNV-1a hash of the sorted names of the set, 0 for the NULL set (every sequence is legit)
+    if (legitSequences == NULL) {
+        return 0;
+    }
+    uint64_t h = 14695981039346656037ULL;
+    stList *names = stSet_getList(legitSequences);
+    stList_sort(names, (int(*)(const void *, const void *)) strcmp);
+    for (int64_t i = 0; i < stList_length(names); ++i) {
+        const unsigned char *name = stList_get(names, i);
+        // each name is hashed with its terminating nul so that the boundaries count
+        do {
+            h ^= *name;
+            h *= 1099511628211ULL;
+        } while (*name++ != '\0');
+    }
+    stList_destruct(names);
+    return h;
+}
+static char* pairCountCacheName(const char *filename) {
+    return stString_print("%s.pairs", filename);
+}
+typedef struct _pairCountEntry {
+    uint64_t size;
+    int64_t modified;
+    uint64_t fingerprint;
+    uint64_t legitKey;
+    uint64_t numPairs;
+} PairCountEntry;
+static stList* readPairCountEntries(const char *cacheName) {
+    // the well formed entries of a cache file, oldest first. Missing files have none.
+    stList *entries = stList_construct3(0, free);
+    FILE *fh = fopen(cacheName, "r");
+    if (fh == NULL) {
+        return entries;
+    }
+    PairCountEntry e;
+    char line[256];
+    while (fgets(line, sizeof(line), fh) != NULL) {
+        if (sscanf(line, "%" SCNu64 " %" SCNi64 " %" SCNu64 " %" SCNu64 " %" SCNu64,
+                   &e.size, &e.modified, &e.fingerprint, &e.legitKey, &e.numPairs) == 5) {
+            PairCountEntry *copy = st_malloc(sizeof(*copy));
+            *copy = e;
+            stList_append(entries, copy);
+        }
+    }
+    fclose(fh);
+    return entries;
+}
+bool readPairCountCache(const char *filename, stSet *legitSequences, uint64_t *numPairs) {
+    // true, with *numPairs set, if the cache holds a count for the maf as it is now.
+    uint64_t size;
+    int64_t modified;
+    if (!statMaf(filename, &size, &modified)) {
+        return false;
+    }
+    char *cacheName = pairCountCacheName(filename);
+    stList *entries = readPairCountEntries(cacheName);
+    free(cacheName);
+    bool found = false;
+    if (stList_length(entries) > 0) {
+        uint64_t fingerprint = fileFingerprint(filename, size);
+        uint64_t legitKey = legitSequencesKey(legitSequences);
+        for (int64_t i = 0; i < stList_length(entries); ++i) {
+            PairCountEntry *e = stList_get(entries, i);
+            if (e->size == size && e->modified == modified && e->fingerprint == fingerprint &&
+                e->legitKey == legitKey) {
+                *numPairs = e->numPairs;
+                found = true;
+            }
+        }
+    }
+    stList_destruct(entries);
+    return found;
+}
+void writePairCountCache(const char *filename, stSet *legitSequences, uint64_t numPairs) {
+    /*
+     * add the count to the cache, dropping the entries for other versions of the maf. The file
+     * is replaced by a rename so that concurrent runs see either the old or the new cache. A
+     * cache that can't be written is not an error, the maf is just counted again next time.
+     */
+    uint64_t size;
+    int64_t modified;
+    if (!statMaf(filename, &size, &modified)) {
+        return;
+    }
+    uint64_t fingerprint = fileFingerprint(filename, size);
+    uint64_t legitKey = legitSequencesKey(legitSequences);
+    char *cacheName = pairCountCacheName(filename);
+    char *tmpName = stString_print("%s.%" PRIi64 ".tmp", cacheName, (int64_t) getpid());
+    stList *entries = readPairCountEntries(cacheName);
+    stList *kept = stList_construct();
+    for (int64_t i = 0; i < stList_length(entries); ++i) {
+        PairCountEntry *e = stList_get(entries, i);
+        if (e->size == size && e->modified == modified && e->fingerprint == fingerprint &&
+            e->legitKey != legitKey) {
+            stList_append(kept, e);
+        }
+    }
+    FILE *fh = fopen(tmpName, "w");
+    if (fh != NULL) {
+        bool ok = fprintf(fh, "# size modified fingerprint legitSequencesKey numberOfPairs\n") > 0;
+        for (int64_t i = (stList_length(kept) >= kCountCacheMaxEntries) ?
+                 stList_length(kept) - kCountCacheMaxEntries + 1 : 0; ok && i < stList_length(kept); ++i) {
+            PairCountEntry *e = stList_get(kept, i);
+            ok = fprintf(fh, "%" PRIu64 " %" PRIi64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                         e->size, e->modified, e->fingerprint, e->legitKey, e->numPairs) > 0;
+        }
+        ok = ok && fprintf(fh, "%" PRIu64 " %" PRIi64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                           size, modified, fingerprint, legitKey, numPairs) > 0;
+        ok = (fclose(fh) == 0) && ok;
+        if (!ok || rename(tmpName, cacheName) != 0) {
+            remove(tmpName);
+        }
+    }
+    // clean up
+    stList_destruct(kept);
+    stList_destruct(entries);
+    free(tmpName);
+    free(cacheName);
+}
+uint64_t countPairsInMafCached(const char *filename, stSet *legitSequences, uint64_t numThreads) {
+    // countPairsInMafThreaded(), remembered from one run to the next
+    uint64_t numPairs;
+    if (readPairCountCache(filename, legitSequences, &numPairs)) {
+        st_logDebug("Read the number of pairs in %s from its cache\n", filename);
+        return numPairs;
+    }
+    numPairs = countPairsInMafThreaded(filename, legitSequences, numThreads);
+    writePairCountCache(filename, legitSequences, numPairs);
+    return numPairs;
+}
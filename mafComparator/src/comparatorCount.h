@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#ifndef _COMPARATOR_COUNT_H_
+#define _COMPARATOR_COUNT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sonLib.h"
+
+/*
+ * Counting the pairs of a maf is a sum over its blocks, so the file is split by byte range
+ * into chunks that each begin where maf_readBlock() would leave off after a block, and the
+ * chunks are counted on their own threads. Counts are cached beside the maf in FILE.pairs,
+ * one line per legit sequence set, keyed by the maf's size, modification time and
+ * fileFingerprint() so that a changed maf is counted anew.
+ */
+uint64_t* splitMafAtBlocks(const char *filename, uint64_t numChunks);
+uint64_t countPairsInMafRange(const char *filename, stSet *legitSequences, uint64_t start, uint64_t end,
+                              uint64_t *chooseTwoArray);
+uint64_t countPairsInMafThreaded(const char *filename, stSet *legitSequences, uint64_t numThreads);
+bool readPairCountCache(const char *filename, stSet *legitSequences, uint64_t *numPairs);
+void writePairCountCache(const char *filename, stSet *legitSequences, uint64_t numPairs);
+uint64_t countPairsInMafCached(const char *filename, stSet *legitSequences, uint64_t numThreads);
+
+#endif // _COMPARATOR_COUNT_H_
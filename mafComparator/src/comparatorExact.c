@@ -0,0 +1,538 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h> // getpid
+#include "sonLib.h"
+#include "common.h"
+#include "sharedMaf.h"
+#include "comparatorAPI.h"
+#include "comparatorExact.h"
+
+static const uint64_t kExactReadBufferLength = 4096; // records buffered per run while merging
+static const uint64_t kExactMergeFanIn = 64; // runs are merged into one once there are this many
+static const uint64_t kExactMinSliceLength = 65536; // smallest share of a buffer sorted by a thread
+
+typedef struct _exactRun {
+    // a sorted, duplicate free run of pairs in an unlinked temporary file
+    FILE *fh;
+    uint64_t numPairs;
+    pthread_mutex_t lock; // readers each keep their own place in the file, see exactRunReader_fill()
+} ExactRun;
+struct _exactRuns {
+    char *tempDir;
+    uint64_t numThreads;
+    ExactPair *buffer;
+    uint64_t capacity;
+    uint64_t length;
+    stList *runs;
+    bool isFinished;
+};
+typedef struct _exactRunReader {
+    ExactRun *run;
+    ExactPair *buffer;
+    uint64_t length;
+    uint64_t next;
+    uint64_t offset; // pairs of the run read so far
+} ExactRunReader;
+struct _exactPairStream {
+    ExactRunReader *readers;
+    uint64_t numReaders;
+    uint64_t *heap; // indices of readers, ordered by their next pair
+    uint64_t heapLength;
+    ExactPair last;
+    bool hasLast;
+};
+typedef struct _sortSlice {
+    ExactPair *pairs;
+    uint64_t length;
+} SortSlice;
+
+int exactPair_cmp(const void *a, const void *b) {
+    // the same order as aPair_cmpFunction(), since ids are assigned in name order
+    const ExactPair *p1 = (const ExactPair *) a;
+    const ExactPair *p2 = (const ExactPair *) b;
+    if (p1->seq1 != p2->seq1) {
+        return (p1->seq1 < p2->seq1) ? -1 : 1;
+    }
+    if (p1->pos1 != p2->pos1) {
+        return (p1->pos1 < p2->pos1) ? -1 : 1;
+    }
+    if (p1->seq2 != p2->seq2) {
+        return (p1->seq2 < p2->seq2) ? -1 : 1;
+    }
+    if (p1->pos2 != p2->pos2) {
+        return (p1->pos2 < p2->pos2) ? -1 : 1;
+    }
+    return 0;
+}
+static ExactRun* exactRun_construct(const char *tempDir) {
+    // the file is removed as soon as it is open, so it goes away with the process
+    static uint64_t runCount = 0;
+    char *filename = stString_print("%s/mafComparator.%d.%" PRIu64 ".run", tempDir, (int) getpid(), runCount++);
+    ExactRun *run = st_malloc(sizeof(*run));
+    run->fh = fopen(filename, "w+b");
+    if (run->fh == NULL) {
+        fprintf(stderr, "Error, unable to create temporary file %s, see --tempDir\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    remove(filename);
+    free(filename);
+    run->numPairs = 0;
+    pthread_mutex_init(&(run->lock), NULL);
+    return run;
+}
+static void exactRun_destruct(ExactRun *run) {
+    fclose(run->fh);
+    pthread_mutex_destroy(&(run->lock));
+    free(run);
+}
+static void exactRun_write(ExactRun *run, ExactPair *pairs, uint64_t n) {
+    if (fwrite(pairs, sizeof(*pairs), n, run->fh) != n) {
+        fprintf(stderr, "Error, unable to write to a temporary file, see --tempDir\n");
+        exit(EXIT_FAILURE);
+    }
+    run->numPairs += n;
+}
+static bool exactRunReader_fill(ExactRunReader *r) {
+    // the file position is shared by every stream of the run, so each read seeks to the
+    // reader's own place first
+    pthread_mutex_lock(&(r->run->lock));
+    if (fseek(r->run->fh, (long) (r->offset * sizeof(*(r->buffer))), SEEK_SET) != 0) {
+        fprintf(stderr, "Error, unable to seek in a temporary file\n");
+        exit(EXIT_FAILURE);
+    }
+    r->length = fread(r->buffer, sizeof(*(r->buffer)), kExactReadBufferLength, r->run->fh);
+    if (r->length == 0 && ferror(r->run->fh)) {
+        fprintf(stderr, "Error, unable to read from a temporary file\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_unlock(&(r->run->lock));
+    r->offset += r->length;
+    r->next = 0;
+    return r->length > 0;
+}
+static bool exactPairStream_less(ExactPairStream *s, uint64_t i, uint64_t j) {
+    ExactRunReader *a = &(s->readers[s->heap[i]]);
+    ExactRunReader *b = &(s->readers[s->heap[j]]);
+    return exactPair_cmp(&(a->buffer[a->next]), &(b->buffer[b->next])) < 0;
+}
+static void exactPairStream_siftDown(ExactPairStream *s, uint64_t i) {
+    while (true) {
+        uint64_t smallest = i;
+        uint64_t l = 2 * i + 1;
+        uint64_t r = l + 1;
+        if (l < s->heapLength && exactPairStream_less(s, l, smallest)) {
+            smallest = l;
+        }
+        if (r < s->heapLength && exactPairStream_less(s, r, smallest)) {
+            smallest = r;
+        }
+        if (smallest == i) {
+            return;
+        }
+        uint64_t t = s->heap[i];
+        s->heap[i] = s->heap[smallest];
+        s->heap[smallest] = t;
+        i = smallest;
+    }
+}
+static ExactPairStream* exactPairStream_constructFromList(stList *runs) {
+    // the runs are read from their beginnings, they remain owned by the caller
+    ExactPairStream *s = st_calloc(1, sizeof(*s));
+    s->numReaders = stList_length(runs);
+    s->readers = st_calloc(s->numReaders + 1, sizeof(*(s->readers)));
+    s->heap = st_malloc(sizeof(*(s->heap)) * (s->numReaders + 1));
+    for (uint64_t i = 0; i < s->numReaders; ++i) {
+        ExactRunReader *r = &(s->readers[i]);
+        r->run = stList_get(runs, i);
+        r->buffer = st_malloc(sizeof(*(r->buffer)) * kExactReadBufferLength);
+        r->offset = 0;
+        if (exactRunReader_fill(r)) {
+            s->heap[s->heapLength++] = i;
+        }
+    }
+    for (uint64_t i = s->heapLength / 2; i-- > 0; ) {
+        exactPairStream_siftDown(s, i);
+    }
+    return s;
+}
+ExactPairStream* exactPairStream_construct(ExactRuns *runs) {
+    // stream the distinct pairs added to runs, in order. runs may be streamed any number of
+    // times, by any number of streams at once.
+    if (!runs->isFinished) {
+        fprintf(stderr, "Error, exactPairStream_construct() called before exactRuns_finish()\n");
+        exit(EXIT_FAILURE);
+    }
+    return exactPairStream_constructFromList(runs->runs);
+}
+bool exactPairStream_next(ExactPairStream *s, ExactPair *pair) {
+    // fill out pair with the next distinct pair, returns false once the runs are exhausted
+    while (s->heapLength > 0) {
+        ExactRunReader *r = &(s->readers[s->heap[0]]);
+        *pair = r->buffer[r->next++];
+        if (r->next == r->length && !exactRunReader_fill(r)) {
+            s->heap[0] = s->heap[--(s->heapLength)];
+        }
+        exactPairStream_siftDown(s, 0);
+        if (s->hasLast && exactPair_cmp(pair, &(s->last)) == 0) {
+            continue;
+        }
+        s->last = *pair;
+        s->hasLast = true;
+        return true;
+    }
+    return false;
+}
+void exactPairStream_destruct(ExactPairStream *s) {
+    for (uint64_t i = 0; i < s->numReaders; ++i) {
+        free(s->readers[i].buffer);
+    }
+    free(s->readers);
+    free(s->heap);
+    free(s);
+}
+ExactRuns* exactRuns_construct(const char *tempDir, uint64_t memoryBytes, uint64_t numThreads) {
+    // memoryBytes bounds the pairs held in memory before they are sorted into a run
+    ExactRuns *runs = st_calloc(1, sizeof(*runs));
+    runs->tempDir = stString_copy(tempDir);
+    runs->numThreads = (numThreads < 1) ? 1 : numThreads;
+    runs->capacity = memoryBytes / sizeof(ExactPair);
+    if (runs->capacity < kExactReadBufferLength) {
+        runs->capacity = kExactReadBufferLength;
+    }
+    runs->buffer = st_malloc(sizeof(*(runs->buffer)) * runs->capacity);
+    runs->runs = stList_construct3(0, (void(*)(void *)) exactRun_destruct);
+    return runs;
+}
+void exactRuns_destruct(ExactRuns *runs) {
+    free(runs->tempDir);
+    free(runs->buffer);
+    stList_destruct(runs->runs);
+    free(runs);
+}
+uint64_t exactRuns_getNumberOfRuns(ExactRuns *runs) {
+    return stList_length(runs->runs);
+}
+static void* sortSlice(void *a) {
+    SortSlice *slice = (SortSlice *) a;
+    qsort(slice->pairs, slice->length, sizeof(*(slice->pairs)), exactPair_cmp);
+    return NULL;
+}
+static void exactRuns_mergeAll(ExactRuns *runs) {
+    // replace all of the runs by a single run of their distinct pairs
+    ExactRun *merged = exactRun_construct(runs->tempDir);
+    ExactPairStream *s = exactPairStream_constructFromList(runs->runs);
+    ExactPair *out = st_malloc(sizeof(*out) * kExactReadBufferLength);
+    uint64_t n = 0;
+    while (exactPairStream_next(s, &(out[n]))) {
+        if (++n == kExactReadBufferLength) {
+            exactRun_write(merged, out, n);
+            n = 0;
+        }
+    }
+    exactRun_write(merged, out, n);
+    free(out);
+    exactPairStream_destruct(s);
+    while (stList_length(runs->runs) > 0) {
+        exactRun_destruct(stList_pop(runs->runs));
+    }
+    stList_append(runs->runs, merged);
+}
+static void exactRuns_flush(ExactRuns *runs) {
+    /*
+     * Sort the buffered pairs into a new run. The buffer is cut into one slice per thread, the
+     * slices are sorted concurrently and then merged as they are written, dropping duplicates.
+     */
+    if (runs->length == 0) {
+        return;
+    }
+    uint64_t numSlices = runs->length / kExactMinSliceLength;
+    if (numSlices > runs->numThreads) {
+        numSlices = runs->numThreads;
+    }
+    if (numSlices < 1) {
+        numSlices = 1;
+    }
+    SortSlice *slices = st_malloc(sizeof(*slices) * numSlices);
+    for (uint64_t t = 0; t < numSlices; ++t) {
+        uint64_t start = (runs->length * t) / numSlices;
+        slices[t].pairs = runs->buffer + start;
+        slices[t].length = (runs->length * (t + 1)) / numSlices - start;
+    }
+    if (numSlices == 1) {
+        sortSlice(&(slices[0]));
+    } else {
+        pthread_t *threads = st_malloc(sizeof(*threads) * numSlices);
+        for (uint64_t t = 0; t < numSlices; ++t) {
+            if (pthread_create(&(threads[t]), NULL, sortSlice, &(slices[t])) != 0) {
+                fprintf(stderr, "Error, unable to create thread to sort pairs\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (uint64_t t = 0; t < numSlices; ++t) {
+            pthread_join(threads[t], NULL);
+        }
+        free(threads);
+    }
+    ExactRun *run = exactRun_construct(runs->tempDir);
+    ExactPair *out = st_malloc(sizeof(*out) * kExactReadBufferLength);
+    uint64_t n = 0;
+    while (true) {
+        int64_t best = -1;
+        for (uint64_t t = 0; t < numSlices; ++t) {
+            if (slices[t].length > 0 &&
+                (best == -1 || exactPair_cmp(slices[t].pairs, slices[best].pairs) < 0)) {
+                best = t;
+            }
+        }
+        if (best == -1) {
+            break;
+        }
+        ExactPair *p = slices[best].pairs++;
+        --(slices[best].length);
+        if (n > 0 && exactPair_cmp(p, &(out[n - 1])) == 0) {
+            continue;
+        }
+        if (n == kExactReadBufferLength) {
+            // keep the last written pair around for the duplicate check
+            exactRun_write(run, out, n - 1);
+            out[0] = out[n - 1];
+            n = 1;
+        }
+        out[n++] = *p;
+    }
+    exactRun_write(run, out, n);
+    free(out);
+    free(slices);
+    stList_append(runs->runs, run);
+    runs->length = 0;
+    if ((uint64_t) stList_length(runs->runs) >= kExactMergeFanIn) {
+        exactRuns_mergeAll(runs);
+    }
+}
+void exactRuns_add(ExactRuns *runs, uint64_t seq1, uint64_t pos1, uint64_t seq2, uint64_t pos2) {
+    // add a pair, canonicalized so that seq1 < seq2 or seq1 == seq2 and pos1 <= pos2
+    assert(!runs->isFinished);
+    if (runs->length == runs->capacity) {
+        exactRuns_flush(runs);
+    }
+    ExactPair *p = &(runs->buffer[runs->length++]);
+    if (seq1 > seq2 || (seq1 == seq2 && pos1 > pos2)) {
+        p->seq1 = seq2;
+        p->pos1 = pos2;
+        p->seq2 = seq1;
+        p->pos2 = pos1;
+    } else {
+        p->seq1 = seq1;
+        p->pos1 = pos1;
+        p->seq2 = seq2;
+        p->pos2 = pos2;
+    }
+}
+void exactRuns_finish(ExactRuns *runs) {
+    // sort the last of the pairs and release the buffer, no more pairs may be added
+    if (runs->isFinished) {
+        return;
+    }
+    exactRuns_flush(runs);
+    free(runs->buffer);
+    runs->buffer = NULL;
+    runs->isFinished = true;
+}
+static void addBlockPairs(ExactRuns *runs, const char *filename, mafBlock_t *mb, SequenceTable *st,
+                          stHash *sequenceLengthHash, uint64_t *numPairs) {
+    // add every aligned pair of legit sequences in the block, column by column
+    uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
+    if (numSeqs < 2) {
+        return;
+    }
+    validateMafBlockSourceLengths(filename, mb, sequenceLengthHash);
+    uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
+    char **names = maf_mafBlock_getSpeciesArray(mb);
+    char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
+    int64_t *ids = st_malloc(sizeof(*ids) * numSeqs);
+    uint64_t numLegit = 0;
+    for (uint64_t r = 0; r < numSeqs; ++r) {
+        ids[r] = sequenceTable_getId(st, names[r]);
+        numLegit += (ids[r] != -1);
+    }
+    if (numLegit > 1) {
+        uint64_t *allPositions = maf_mafBlock_getPosCoordStartArray(mb);
+        int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
+        uint64_t *rows = st_malloc(sizeof(*rows) * numSeqs);
+        for (uint64_t c = 0; c < seqFieldLength; ++c) {
+            uint64_t n = 0;
+            for (uint64_t r = 0; r < numSeqs; ++r) {
+                if (ids[r] != -1 && mat[r][c] != '-') {
+                    rows[n++] = r;
+                }
+            }
+            for (uint64_t i = 0; i < n; ++i) {
+                for (uint64_t j = i + 1; j < n; ++j) {
+                    exactRuns_add(runs, ids[rows[i]], allPositions[rows[i]], ids[rows[j]], allPositions[rows[j]]);
+                }
+            }
+            *numPairs += chooseTwo(n);
+            updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
+        }
+        free(rows);
+        free(allPositions);
+        free(allStrandInts);
+    }
+    // clean up
+    free(ids);
+    for (uint64_t i = 0; i < numSeqs; ++i) {
+        free(names[i]);
+    }
+    free(names);
+    maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
+}
+ExactRuns* exactRuns_fromMaf(const char *filename, SequenceTable *st, stHash *sequenceLengthHash,
+                             const char *tempDir, uint64_t memoryBytes, uint64_t numThreads,
+                             uint64_t *numPairs) {
+    // sort all of the pairs of legit sequences in filename into runs. numPairs is incremented by
+    // the number of pairs in the file, duplicates included, as countPairsInMaf() would.
+    ExactRuns *runs = exactRuns_construct(tempDir, memoryBytes, numThreads);
+    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    mafBlock_t *mb = NULL;
+    while ((mb = maf_readBlock(mfa)) != NULL) {
+        addBlockPairs(runs, filename, mb, st, sequenceLengthHash, numPairs);
+        maf_destroyMafBlockList(mb);
+    }
+    maf_destroyMfa(mfa);
+    exactRuns_finish(runs);
+    return runs;
+}
+static void reportFailedPair(SequenceTable *st, ExactPair *p) {
+    fprintf(stderr, "sampled pair not present in comparison: (%s, %" PRIu64 "):(%s, %" PRIu64 ")\n",
+            sequenceTable_getName(st, p->seq1), p->pos1, sequenceTable_getName(st, p->seq2), p->pos2);
+}
+static void joinExactPairs(ExactRuns *runs1, ExactRuns *runs2, SequenceTable *st, Comparison *c,
+                           uint64_t wiggleBinLength) {
+    // merge-join the distinct pairs of both mafs, a pair is present in the other maf iff
+    // it is in both streams.
+    ResultAccumulator *ra12 = resultAccumulator_construct(st, wiggleBinLength, true, false);
+    ResultAccumulator *ra21 = resultAccumulator_construct(st, wiggleBinLength, false, false);
+    ExactPairStream *s1 = exactPairStream_construct(runs1);
+    ExactPairStream *s2 = exactPairStream_construct(runs2);
+    ExactPair p1, p2;
+    bool has1 = exactPairStream_next(s1, &p1);
+    bool has2 = exactPairStream_next(s2, &p2);
+    while (has1 || has2) {
+        int cmp = !has2 ? -1 : (!has1 ? 1 : exactPair_cmp(&p1, &p2));
+        if (cmp <= 0) {
+            resultAccumulator_tally(ra12, p1.seq1, p1.pos1, p1.seq2, p1.pos2, cmp == 0);
+            if (cmp != 0 && g_isVerboseFailures) {
+                reportFailedPair(st, &p1);
+            }
+            has1 = exactPairStream_next(s1, &p1);
+        }
+        if (cmp >= 0) {
+            resultAccumulator_tally(ra21, p2.seq1, p2.pos1, p2.seq2, p2.pos2, cmp == 0);
+            if (cmp != 0 && g_isVerboseFailures) {
+                reportFailedPair(st, &p2);
+            }
+            has2 = exactPairStream_next(s2, &p2);
+        }
+    }
+    c->results_12 = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
+    c->results_21 = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
+    resultAccumulator_merge(ra12, c->results_12);
+    resultAccumulator_merge(ra21, c->results_21);
+    // clean up
+    exactPairStream_destruct(s1);
+    exactPairStream_destruct(s2);
+    resultAccumulator_destruct(ra12);
+    resultAccumulator_destruct(ra21);
+}
+static bool stringSetsAreEqual(stSet *a, stSet *b) {
+    if (stSet_size(a) != stSet_size(b)) {
+        return false;
+    }
+    stSetIterator *sit = stSet_getIterator(a);
+    char *name = NULL;
+    bool equal = true;
+    while (equal && (name = stSet_getNext(sit)) != NULL) {
+        equal = stSet_search(b, name) != NULL;
+    }
+    stSet_destructIterator(sit);
+    return equal;
+}
+void compareExact(Options *options, Comparison **comparisons, uint64_t numComparisons,
+                  bedIndex_t *bedIndex, stHash *sequenceLengthHash) {
+    /*
+     * Fill out every comparison with the results of testing every pair of options->mafFile1 in
+     * the comparison's mafFile2 and vice versa, over the comparison's own legit sequences. The
+     * pairs of mafFile1 are sorted once for each run of comparisons sharing the same legit
+     * sequences, usually all of them, and then joined against each mafFile2 in turn. Sets each
+     * numPairs1 and numPairs2.
+     */
+    SequenceTable *ids = NULL;
+    ExactRuns *runs1 = NULL;
+    stSet *runs1Sequences = NULL;
+    uint64_t numPairs1 = 0;
+    for (uint64_t i = 0; i < numComparisons; ++i) {
+        Comparison *c = comparisons[i];
+        if (runs1 == NULL || !stringSetsAreEqual(runs1Sequences, c->legitSequences)) {
+            if (runs1 != NULL) {
+                exactRuns_destruct(runs1);
+                sequenceTable_destruct(ids);
+            }
+            runs1Sequences = c->legitSequences;
+            ids = sequenceTable_construct(runs1Sequences, bedIndex, NULL);
+            if (sequenceTable_getNumberOfSequences(ids) > UINT32_MAX) {
+                fprintf(stderr, "Error, too many legit sequences for --exact\n");
+                exit(EXIT_FAILURE);
+            }
+            numPairs1 = 0;
+            runs1 = exactRuns_fromMaf(options->mafFile1, ids, sequenceLengthHash, options->tempDir,
+                                      options->sortMemory, options->numThreads, &numPairs1);
+            st_logInfo("Sorted the %" PRIu64 " pairs of %s into %" PRIu64 " runs\n", numPairs1,
+                       options->mafFile1, exactRuns_getNumberOfRuns(runs1));
+        }
+        c->numPairs1 = numPairs1;
+        c->numPairs2 = 0;
+        ExactRuns *runs2 = exactRuns_fromMaf(c->mafFile2, ids, sequenceLengthHash, options->tempDir,
+                                             options->sortMemory, options->numThreads, &(c->numPairs2));
+        st_logInfo("Sorted the %" PRIu64 " pairs of %s into %" PRIu64 " runs\n", c->numPairs2,
+                   c->mafFile2, exactRuns_getNumberOfRuns(runs2));
+        SequenceTable *st = sequenceTable_construct(c->legitSequences, bedIndex, c->wigglePairHash);
+        joinExactPairs(runs1, runs2, st, c, options->wiggleBinLength);
+        sequenceTable_destruct(st);
+        exactRuns_destruct(runs2);
+    }
+    // clean up
+    if (runs1 != NULL) {
+        exactRuns_destruct(runs1);
+        sequenceTable_destruct(ids);
+    }
+}
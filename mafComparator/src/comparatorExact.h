@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#ifndef _COMPARATOR_EXACT_H_
+#define _COMPARATOR_EXACT_H_
+
+#include <stdint.h>
+#include "sonLib.h"
+#include "comparatorAPI.h"
+
+/*
+ * The --exact mode tests every aligned pair rather than a sample of them. The pairs of
+ * legit sequences in each maf are written as fixed width records, canonicalized as in
+ * aPair_fillOut(), and sorted within a memory budget into runs held in unlinked temporary
+ * files. A k-way merge of the runs yields the distinct pairs of each maf in
+ * aPair_cmpFunction() order, so a merge-join of the two mafs' streams decides every
+ * homology test of both directions in one pass. Records are in host byte order; the runs
+ * never outlive the process.
+ */
+typedef struct _exactPair {
+    uint64_t pos1;
+    uint64_t pos2;
+    uint32_t seq1; // SequenceTable ids, seq1 <= seq2
+    uint32_t seq2;
+} ExactPair;
+typedef struct _exactPairStream ExactPairStream;
+
+int exactPair_cmp(const void *a, const void *b);
+ExactRuns* exactRuns_construct(const char *tempDir, uint64_t memoryBytes, uint64_t numThreads);
+void exactRuns_add(ExactRuns *runs, uint64_t seq1, uint64_t pos1, uint64_t seq2, uint64_t pos2);
+void exactRuns_finish(ExactRuns *runs);
+void exactRuns_destruct(ExactRuns *runs);
+uint64_t exactRuns_getNumberOfRuns(ExactRuns *runs);
+ExactRuns* exactRuns_fromMaf(const char *filename, SequenceTable *st, stHash *sequenceLengthHash,
+                             const char *tempDir, uint64_t memoryBytes, uint64_t numThreads,
+                             uint64_t *numPairs);
+ExactPairStream* exactPairStream_construct(ExactRuns *runs);
+bool exactPairStream_next(ExactPairStream *s, ExactPair *pair);
+void exactPairStream_destruct(ExactPairStream *s);
+void compareExact(Options *options, Comparison **comparisons, uint64_t numComparisons,
+                  bedIndex_t *bedIndex, stHash *sequenceLengthHash);
+
+#endif // _COMPARATOR_EXACT_H_
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sonLib.h"
+#include "common.h"
+#include "comparatorAPI.h"
+#include "comparatorSampleFile.h"
+
+const char kSampleFileMagic[8] = {'M', 'A', 'F', 'C', 'M', 'P', 'S', 'P'};
+const uint32_t kSampleFileVersion = 2;
+static const uint32_t kSampleFileByteOrder = 0x01020304;
+
+static uint64_t padToEight(uint64_t n) {
+    return (n + 7) & ~((uint64_t) 7);
+}
+static int sampleFile_cmpNames(const void *a, const void *b) {
+    return strcmp((const char *) a, (const char *) b);
+}
+static void sampleFile_statMaf(const char *mafFilename, uint64_t *size, int64_t *modified,
+                               uint64_t *fingerprint) {
+    struct stat s;
+    if (stat(mafFilename, &s) != 0) {
+        fprintf(stderr, "Error, unable to stat %s\n", mafFilename);
+        exit(EXIT_FAILURE);
+    }
+    *size = (uint64_t) s.st_size;
+    *modified = (int64_t) s.st_mtime;
+    *fingerprint = fileFingerprint(mafFilename, *size);
+}
+static void sampleFile_write(const void *p, size_t size, size_t n, FILE *f, const char *filename) {
+    if (fwrite(p, size, n, f) != n) {
+        fprintf(stderr, "Error, unable to write to samples file %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+}
+void writeSampledPairsFile(const char *filename, const char *mafFilename, stSortedSet *sampledPairs,
+                           stSet *legitSequences, stHash *sequenceLengthHash, uint64_t randomSeed,
+                           uint64_t numberOfSamples, uint64_t numberOfPairs) {
+    /*
+     * Write the pairs sampled from mafFilename over legitSequences along with everything
+     * needed to use them in place of sampling (see comparatorSampleFile.h for the layout).
+     */
+    stList *names = stSet_getList(legitSequences);
+    stList_sort(names, sampleFile_cmpNames);
+    if (stList_length(names) > UINT32_MAX) {
+        fprintf(stderr, "Error, too many sequences (%" PRIi64 ") to write samples file %s\n",
+                stList_length(names), filename);
+        exit(EXIT_FAILURE);
+    }
+    // name -> index into the sequence table. Since names are sorted the index order
+    // agrees with the strcmp() order used by aPair_cmpFunction().
+    stHash *nameIndexHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, free);
+    SampleFileSequence *sequences = st_calloc(stList_length(names) + 1, sizeof(*sequences));
+    uint64_t namesLength = 0;
+    for (int64_t i = 0; i < stList_length(names); ++i) {
+        char *name = stList_get(names, i);
+        int64_t *length = stHash_search(sequenceLengthHash, name);
+        if (length == NULL) {
+            fprintf(stderr, "Error, no source length known for sequence %s\n", name);
+            exit(EXIT_FAILURE);
+        }
+        sequences[i].sourceLength = (uint64_t) *length;
+        sequences[i].nameOffset = namesLength;
+        namesLength += strlen(name) + 1;
+        stHash_insert(nameIndexHash, name, buildUInt64(i));
+    }
+    SampleFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kSampleFileMagic, sizeof(header.magic));
+    header.version = kSampleFileVersion;
+    header.byteOrder = kSampleFileByteOrder;
+    header.randomSeed = randomSeed;
+    header.numberOfSamples = numberOfSamples;
+    header.numberOfPairs = numberOfPairs;
+    sampleFile_statMaf(mafFilename, &header.mafSize, &header.mafModified, &header.mafFingerprint);
+    header.numberOfSequences = stList_length(names);
+    header.numberOfSampledPairs = stSortedSet_size(sampledPairs);
+    header.namesLength = padToEight(namesLength);
+    FILE *f = de_fopen(filename, "wb");
+    sampleFile_write(&header, sizeof(header), 1, f, filename);
+    sampleFile_write(sequences, sizeof(*sequences), header.numberOfSequences, f, filename);
+    for (int64_t i = 0; i < stList_length(names); ++i) {
+        char *name = stList_get(names, i);
+        sampleFile_write(name, 1, strlen(name) + 1, f, filename);
+    }
+    const char padding[8] = {0};
+    sampleFile_write(padding, 1, header.namesLength - namesLength, f, filename);
+    stSortedSetIterator *sit = stSortedSet_getIterator(sampledPairs);
+    APair *pair = NULL;
+    SampleFilePair record;
+    memset(&record, 0, sizeof(record));
+    while ((pair = stSortedSet_getNext(sit)) != NULL) {
+        uint64_t *index1 = stHash_search(nameIndexHash, pair->seq1);
+        uint64_t *index2 = stHash_search(nameIndexHash, pair->seq2);
+        if (index1 == NULL || index2 == NULL) {
+            fprintf(stderr, "Error, sampled pair (%s, %s) contains a sequence that is not legit\n",
+                    pair->seq1, pair->seq2);
+            exit(EXIT_FAILURE);
+        }
+        record.seq1 = (uint32_t) *index1;
+        record.seq2 = (uint32_t) *index2;
+        record.pos1 = pair->pos1;
+        record.pos2 = pair->pos2;
+        sampleFile_write(&record, sizeof(record), 1, f, filename);
+    }
+    // clean up
+    stSortedSet_destructIterator(sit);
+    if (fclose(f) != 0) {
+        fprintf(stderr, "Error, unable to close samples file %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    stHash_destruct(nameIndexHash);
+    stList_destruct(names);
+    free(sequences);
+}
+static void sampleFile_badFormat(const char *filename, const char *reason) {
+    fprintf(stderr, "Error, %s is not a valid samples file: %s\n", filename, reason);
+    exit(EXIT_FAILURE);
+}
+static int sampleFilePair_cmp(const SampleFilePair *a, const SampleFilePair *b) {
+    if (a->seq1 != b->seq1) {
+        return a->seq1 < b->seq1 ? -1 : 1;
+    }
+    if (a->pos1 != b->pos1) {
+        return a->pos1 < b->pos1 ? -1 : 1;
+    }
+    if (a->seq2 != b->seq2) {
+        return a->seq2 < b->seq2 ? -1 : 1;
+    }
+    if (a->pos2 != b->pos2) {
+        return a->pos2 < b->pos2 ? -1 : 1;
+    }
+    return 0;
+}
+stSortedSet* readSampledPairsFile(const char *filename, const char *mafFilename, stSet *legitSequences,
+                                  stHash *sequenceLengthHash, uint64_t *randomSeed, uint64_t *numberOfSamples,
+                                  uint64_t *numberOfPairs) {
+    /*
+     * Map a samples file written by writeSampledPairsFile() for mafFilename and rebuild the
+     * sampled pair set. The sampled sequences and their source lengths are added to
+     * legitSequences and sequenceLengthHash, respectively. A file written for a different
+     * version of the maf is an error.
+     */
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        if (errno == ENOENT) {
+            fprintf(stderr, "ERROR, file %s does not exist.\n", filename);
+        } else {
+            fprintf(stderr, "ERROR, unable to open file %s for reading\n", filename);
+        }
+        exit(EXIT_FAILURE);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error, unable to stat samples file %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t fileLength = (uint64_t) st.st_size;
+    if (fileLength < sizeof(SampleFileHeader)) {
+        sampleFile_badFormat(filename, "file is truncated");
+    }
+    char *map = mmap(NULL, fileLength, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error, unable to mmap samples file %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    const SampleFileHeader *header = (const SampleFileHeader *) map;
+    if (memcmp(header->magic, kSampleFileMagic, sizeof(header->magic)) != 0) {
+        sampleFile_badFormat(filename, "bad magic number");
+    }
+    if (header->byteOrder != kSampleFileByteOrder) {
+        sampleFile_badFormat(filename, "file was written on a host with a different byte order");
+    }
+    if (header->version != kSampleFileVersion) {
+        sampleFile_badFormat(filename, "unsupported version");
+    }
+    if (header->numberOfSequences > UINT32_MAX ||
+        header->numberOfSampledPairs > fileLength / sizeof(SampleFilePair) ||
+        header->namesLength > fileLength ||
+        fileLength != (sizeof(*header) + header->numberOfSequences * sizeof(SampleFileSequence)
+                       + header->namesLength + header->numberOfSampledPairs * sizeof(SampleFilePair))) {
+        sampleFile_badFormat(filename, "section lengths do not match file length");
+    }
+    uint64_t mafSize, mafFingerprint;
+    int64_t mafModified;
+    sampleFile_statMaf(mafFilename, &mafSize, &mafModified, &mafFingerprint);
+    if (header->mafSize != mafSize || header->mafModified != mafModified ||
+        header->mafFingerprint != mafFingerprint) {
+        fprintf(stderr, "Error, samples file %s was not written for %s as it is now, "
+                "the maf is different or has been modified since\n", filename, mafFilename);
+        exit(EXIT_FAILURE);
+    }
+    const SampleFileSequence *sequences = (const SampleFileSequence *) (map + sizeof(*header));
+    const char *namePool = (const char *) (sequences + header->numberOfSequences);
+    const SampleFilePair *records = (const SampleFilePair *) (namePool + header->namesLength);
+    if (header->namesLength > 0 && namePool[header->namesLength - 1] != '\0') {
+        sampleFile_badFormat(filename, "unterminated name pool");
+    }
+    const char **names = st_malloc(sizeof(*names) * (header->numberOfSequences + 1));
+    for (uint64_t i = 0; i < header->numberOfSequences; ++i) {
+        if (sequences[i].nameOffset >= header->namesLength) {
+            sampleFile_badFormat(filename, "name offset out of range");
+        }
+        names[i] = namePool + sequences[i].nameOffset;
+        if (stSet_search(legitSequences, (void *) names[i]) == NULL) {
+            stSet_insert(legitSequences, stString_copy(names[i]));
+        }
+        if (stHash_search(sequenceLengthHash, (void *) names[i]) == NULL) {
+            stHash_insert(sequenceLengthHash, stString_copy(names[i]),
+                          buildInt64((int64_t) sequences[i].sourceLength));
+        }
+    }
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction,
+                                                (void(*)(void *)) aPair_destruct);
+    for (uint64_t i = 0; i < header->numberOfSampledPairs; ++i) {
+        if (records[i].seq1 >= header->numberOfSequences || records[i].seq2 >= header->numberOfSequences) {
+            sampleFile_badFormat(filename, "sequence index out of range");
+        }
+        if (i > 0 && sampleFilePair_cmp(&records[i - 1], &records[i]) >= 0) {
+            sampleFile_badFormat(filename, "sampled pairs are not sorted");
+        }
+        stSortedSet_insert(pairs, aPair_construct(names[records[i].seq1], names[records[i].seq2],
+                                                  records[i].pos1, records[i].pos2));
+    }
+    *randomSeed = header->randomSeed;
+    *numberOfSamples = header->numberOfSamples;
+    *numberOfPairs = header->numberOfPairs;
+    // clean up
+    free(names);
+    munmap(map, fileLength);
+    return pairs;
+}
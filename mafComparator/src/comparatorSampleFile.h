@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#ifndef _COMPARATOR_SAMPLE_FILE_H_
+#define _COMPARATOR_SAMPLE_FILE_H_
+
+#include <stdint.h>
+#include "sonLib.h"
+
+/*
+ * A samples file holds the pairs sampled from one maf so that the (expensive) counting
+ * and sampling of that maf can be skipped in subsequent comparisons against it. The
+ * sequences stored are those the maf was sampled over, which each comparison intersects
+ * with its own maf2, and the maf's size, modification time and fileFingerprint() are kept
+ * so that a samples file is not used with a maf that has since changed.
+ * The layout is a fixed header, a table of the sampled sequences sorted by name, a pool of
+ * NUL terminated names and then the sampled pairs as fixed width records sorted in
+ * aPair_cmpFunction() order. Every section starts on an eight byte boundary so that the
+ * file may be used directly via mmap(). Integers are stored in host byte order; files
+ * written on a host of different endianness are rejected.
+ */
+extern const char kSampleFileMagic[8];
+extern const uint32_t kSampleFileVersion;
+
+typedef struct _sampleFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder; // kSampleFileByteOrder as written by the host
+    uint64_t randomSeed;
+    uint64_t numberOfSamples;
+    uint64_t numberOfPairs; // total number of pairs in the sampled maf
+    uint64_t mafSize;
+    int64_t mafModified;
+    uint64_t mafFingerprint;
+    uint64_t numberOfSequences;
+    uint64_t numberOfSampledPairs;
+    uint64_t namesLength; // length of the name pool in bytes, including padding
+} SampleFileHeader;
+typedef struct _sampleFileSequence {
+    uint64_t sourceLength;
+    uint64_t nameOffset; // offset of the name within the name pool
+} SampleFileSequence;
+typedef struct _sampleFilePair {
+    // seq1 and seq2 are indices into the sequence table, seq1 <= seq2
+    uint32_t seq1;
+    uint32_t seq2;
+    uint64_t pos1;
+    uint64_t pos2;
+} SampleFilePair;
+
+void writeSampledPairsFile(const char *filename, const char *mafFilename, stSortedSet *sampledPairs,
+                           stSet *legitSequences, stHash *sequenceLengthHash, uint64_t randomSeed,
+                           uint64_t numberOfSamples, uint64_t numberOfPairs);
+stSortedSet* readSampledPairsFile(const char *filename, const char *mafFilename, stSet *legitSequences,
+                                  stHash *sequenceLengthHash, uint64_t *randomSeed, uint64_t *numberOfSamples,
+                                  uint64_t *numberOfPairs);
+
+#endif // _COMPARATOR_SAMPLE_FILE_H_
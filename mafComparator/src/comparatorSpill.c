@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sonLib.h"
+#include "common.h"
+#include "sharedMaf.h"
+#include "comparatorAPI.h"
+#include "comparatorCount.h"
+#include "comparatorExact.h"
+#include "comparatorSpill.h"
+
+// roughly what one sampled pair costs while it is tested: the APair and its two names, its
+// nodes in the batch's sorted sets and its entry in the set of positive pairs
+static const uint64_t kSpillBytesPerPair = 256;
+static const uint64_t kSpillMinBatchLength = 1024;
+
+typedef struct _spillWindow {
+    // the pairs of the batch being tested and those kept around them, in order
+    ExactPair *pairs;
+    uint64_t length;
+    uint64_t capacity;
+} SpillWindow;
+
+static void spillWindow_reserve(SpillWindow *w, uint64_t capacity) {
+    w->capacity = capacity;
+    w->pairs = realloc(w->pairs, sizeof(*(w->pairs)) * w->capacity);
+    if (w->pairs == NULL) {
+        fprintf(stderr, "Error, realloc failed in spillWindow_reserve()\n");
+        exit(EXIT_FAILURE);
+    }
+}
+static void spillWindow_append(SpillWindow *w, ExactPair *p) {
+    if (w->length == w->capacity) {
+        // the window starts at a whole batch, beyond that it only grows for the --near context
+        spillWindow_reserve(w, w->capacity + w->capacity / 4);
+    }
+    w->pairs[w->length++] = *p;
+}
+ExactRuns* sampleMafPairsToRuns(const char *mafFileA, uint64_t *numberOfPairs, stSet *legitSequences,
+                                Options *options, stHash *sequenceLengthHash, uint64_t memoryBytes) {
+    /*
+     * sampleMafPairs() into runs sorted within memoryBytes. Each block is sampled into a set of
+     * its own, drawing the same random numbers as samplePairsFromMaf() would, and the set is then
+     * emptied into the runs, so for a given seed the sample is the same as that held in memory.
+     */
+    bedIndex_t *noIntervals = bed_newIndex(); // only the ids of the table are used
+    bed_finalizeIndex(noIntervals);
+    SequenceTable *ids = sequenceTable_construct(legitSequences, noIntervals, NULL);
+    if (sequenceTable_getNumberOfSequences(ids) > UINT32_MAX) {
+        fprintf(stderr, "Error, too many legit sequences for --maxMemory\n");
+        exit(EXIT_FAILURE);
+    }
+    // the whole budget goes to the sort buffer, exactRuns_finish() frees it before the runs are
+    // returned so none of it is held while they are tested
+    ExactRuns *runs = exactRuns_construct(options->tempDir, memoryBytes, options->numThreads);
+    bool isCounted = (*numberOfPairs == 0);
+    if (isCounted) {
+        // can be manually set via the command line
+        *numberOfPairs = countPairsToSample(mafFileA, legitSequences, options);
+    }
+    if (*numberOfPairs != 0) {
+        double acceptProbability = ((double) options->numberOfSamples) / (double) *numberOfPairs;
+        uint64_t verifiedNumberOfPairs = 0;
+        uint64_t *chooseTwoArray = buildChooseTwoArray();
+        mafFileApi_t *mfa = maf_newMfa(mafFileA, "r");
+        mafBlock_t *mb = NULL;
+        APair *pair = NULL;
+        while ((mb = maf_readBlock(mfa)) != NULL) {
+            stSortedSet *blockPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
+            walkBlockSamplingPairs(mafFileA, mb, blockPairs, acceptProbability, legitSequences, chooseTwoArray,
+                                   &verifiedNumberOfPairs, sequenceLengthHash);
+            stSortedSetIterator *sit = stSortedSet_getIterator(blockPairs);
+            while ((pair = stSortedSet_getNext(sit)) != NULL) {
+                exactRuns_add(runs, sequenceTable_getId(ids, pair->seq1), pair->pos1,
+                              sequenceTable_getId(ids, pair->seq2), pair->pos2);
+            }
+            stSortedSet_destructIterator(sit);
+            stSortedSet_destruct(blockPairs);
+            maf_destroyMafBlockList(mb);
+        }
+        free(chooseTwoArray);
+        maf_destroyMfa(mfa);
+        checkSampledNumberOfPairs(mafFileA, legitSequences, options, isCounted, verifiedNumberOfPairs,
+                                  numberOfPairs);
+    }
+    exactRuns_finish(runs);
+    st_logInfo("Sorted the pairs sampled from %s into %" PRIu64 " runs\n", mafFileA,
+               exactRuns_getNumberOfRuns(runs));
+    sequenceTable_destruct(ids);
+    bed_destroyIndex(noIntervals);
+    return runs;
+}
+uint64_t spill_getBatchLength(uint64_t memoryBytes) {
+    // the number of sampled pairs tested at a time within memoryBytes
+    uint64_t n = memoryBytes / kSpillBytesPerPair;
+    return (n < kSpillMinBatchLength) ? kSpillMinBatchLength : n;
+}
+static void testSpillBatch(SpillWindow *w, uint64_t coreStart, uint64_t coreEnd, SequenceTable *ids,
+                           const char *mafFileB, stSortedSet *resultPairs, stSet *legitSequences,
+                           bedIndex_t *bedIndex, stHash *wigglePairHash, bool isAtoB, Options *options) {
+    // test every pair of the window in mafFileB but tally only those in [coreStart, coreEnd)
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
+    stSortedSet *corePairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, NULL);
+    for (uint64_t i = 0; i < w->length; ++i) {
+        ExactPair *p = &(w->pairs[i]);
+        char *seq1 = sequenceTable_getName(ids, p->seq1);
+        char *seq2 = sequenceTable_getName(ids, p->seq2);
+        if (stSet_search(legitSequences, seq1) == NULL || stSet_search(legitSequences, seq2) == NULL) {
+            continue;
+        }
+        APair *pair = aPair_construct(seq1, seq2, p->pos1, p->pos2);
+        stSortedSet_insert(pairs, pair);
+        if (i >= coreStart && i < coreEnd) {
+            stSortedSet_insert(corePairs, pair);
+        }
+    }
+    stSet *positivePairs = stSet_construct(); // comparison by pointer
+    performHomologyTests(mafFileB, pairs, positivePairs, legitSequences, bedIndex, options->near);
+    enumerateHomologyResults(corePairs, resultPairs, bedIndex, positivePairs, wigglePairHash, isAtoB,
+                             options->wiggleBinLength, legitSequences, options->numThreads);
+    // clean up
+    stSet_destruct(positivePairs);
+    stSortedSet_destruct(corePairs);
+    stSortedSet_destruct(pairs);
+}
+stSortedSet* compareSpilledPairs(ExactRuns *runs, const char *mafFileB, stSet *sampledSequences,
+                                 stSet *legitSequences, bedIndex_t *bedIndex, stHash *wigglePairHash,
+                                 bool isAtoB, Options *options, uint64_t memoryBytes, uint64_t *numBatches) {
+    /*
+     * compareSampledPairs() for pairs sampled by sampleMafPairsToRuns(), testing at most
+     * spill_getBatchLength(memoryBytes) pairs (and their --near context) at a time. Batches are
+     * tallied in order, so the results and the --printFailed output are those of a single
+     * batch. numBatches, if not NULL, is set to the number of passes made over mafFileB.
+     * sampledSequences are those the runs were sampled over, only the pairs with both
+     * sequences in legitSequences, a subset of them, are tested.
+     */
+    stSortedSet *resultPairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
+    SequenceTable *ids = sequenceTable_construct(sampledSequences, bedIndex, NULL);
+    uint64_t batchLength = spill_getBatchLength(memoryBytes);
+    uint64_t reach = 2 * options->near;
+    SpillWindow w = {NULL, 0, 0};
+    spillWindow_reserve(&w, batchLength);
+    ExactPairStream *s = exactPairStream_construct(runs);
+    ExactPair next;
+    bool hasNext = exactPairStream_next(s, &next);
+    uint64_t coreStart = 0; // w.pairs[0, coreStart) were tallied in the last batch
+    uint64_t n = 0;
+    while (w.length > coreStart || hasNext) {
+        while (w.length - coreStart < batchLength && hasNext) {
+            spillWindow_append(&w, &next);
+            hasNext = exactPairStream_next(s, &next);
+        }
+        uint64_t coreEnd = w.length;
+        ExactPair last = w.pairs[coreEnd - 1];
+        while (hasNext && next.seq1 == last.seq1 && next.pos1 <= last.pos1 + reach) {
+            spillWindow_append(&w, &next);
+            hasNext = exactPairStream_next(s, &next);
+        }
+        testSpillBatch(&w, coreStart, coreEnd, ids, mafFileB, resultPairs, legitSequences, bedIndex,
+                       wigglePairHash, isAtoB, options);
+        ++n;
+        if (coreEnd == w.length && !hasNext) {
+            break;
+        }
+        // keep the pairs within reach of the next batch's first pair
+        ExactPair *first = (coreEnd < w.length) ? &(w.pairs[coreEnd]) : &next;
+        uint64_t keep = coreEnd;
+        while (keep > 0 && w.pairs[keep - 1].seq1 == first->seq1 && w.pairs[keep - 1].pos1 + reach >= first->pos1) {
+            --keep;
+        }
+        memmove(w.pairs, w.pairs + keep, sizeof(*(w.pairs)) * (w.length - keep));
+        w.length -= keep;
+        coreStart = coreEnd - keep;
+    }
+    st_logInfo("Tested the pairs sampled for %s in %" PRIu64 " batches\n", mafFileB, n);
+    if (numBatches != NULL) {
+        *numBatches = n;
+    }
+    // clean up
+    free(w.pairs);
+    exactPairStream_destruct(s);
+    sequenceTable_destruct(ids);
+    return resultPairs;
+}
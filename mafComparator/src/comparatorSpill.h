@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#ifndef _COMPARATOR_SPILL_H_
+#define _COMPARATOR_SPILL_H_
+
+#include <stdint.h>
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorExact.h"
+
+/*
+ * --maxMemory bounds the memory taken by sampled pairs. Pairs are sampled one block at a time
+ * and added to ExactRuns, which sorts them into runs on disk whenever its buffer fills. For
+ * the homology tests the merged runs are read back in batches of as many pairs as the budget
+ * allows, and each batch is tested in one pass over the other maf and tallied before the next
+ * is read. With --near a batch also holds, untallied, the pairs within 2 * near of its ends so
+ * that its pairs see the same neighbours as they would in a single batch.
+ *
+ * The two phases take the budget in turn rather than sharing it: sampleMafPairsToRuns() gives
+ * all of memoryBytes to the sort buffer and frees it before returning, and compareSpilledPairs()
+ * then holds one batch of spill_getBatchLength(memoryBytes) pairs, plus any --near context,
+ * at a time, so peak use is about memoryBytes rather than twice it. With a batched --maf2 each
+ * comparison does the same within its own share of --maxMemory, see compareBatch().
+ */
+ExactRuns* sampleMafPairsToRuns(const char *mafFileA, uint64_t *numberOfPairs, stSet *legitSequences,
+                                Options *options, stHash *sequenceLengthHash, uint64_t memoryBytes);
+uint64_t spill_getBatchLength(uint64_t memoryBytes);
+stSortedSet* compareSpilledPairs(ExactRuns *runs, const char *mafFileB, stSet *sampledSequences,
+                                 stSet *legitSequences, bedIndex_t *bedIndex, stHash *wigglePairHash,
+                                 bool isAtoB, Options *options, uint64_t memoryBytes, uint64_t *numBatches);
+
+#endif // _COMPARATOR_SPILL_H_
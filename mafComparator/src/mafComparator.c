@@ -26,7 +26,6 @@
  */
 
 #include <assert.h>
-#include <errno.h> // file existence via ENOENT
 #include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -39,6 +38,10 @@
 
 #include "sonLib.h"
 #include "comparatorAPI.h"
+#include "comparatorAdaptive.h"
+#include "comparatorExact.h"
+#include "comparatorSampleFile.h"
+#include "comparatorSpill.h"
 #include "common.h"
 #include "buildVersion.h"
 
@@ -70,95 +73,15 @@ bool g_isVerboseFailures = false;
  * in A.
  */
 
-void parseBedFiles(const char *commaSepFiles, stHash *bedFileHash);
-void parseBedFile(const char *filepath, stHash *intervalsHash);
 void listifercatePairs(char *s, stList *list);
 void listifercateKeyValuePairs(char *s, stList *list);
+void listifercateCommaList(char *s, stList *list);
 void hashifercateList(stList *list, stHash *hash);
 void usage(void);
 void version(void);
 int parseOptions(int argc, char **argv, Options* options);
+void writeComparisonReport(Options *options, Comparison *c);
 
-void parseBedFiles(const char *commaSepFiles, stHash *bedFileHash) {
-    /*
-     * takes input from the command line, swaps spaces, ' ', for commas
-     * and passes each bed file to parseBedFile().
-     */
-    st_logDebug("Starting to parse bed files\n");
-    char *spaceSepFiles = stringReplace(commaSepFiles, ',', ' ');
-    char *currentLocation = spaceSepFiles;
-    char *currentWord = NULL;
-    while ((currentWord = stString_getNextWord(&currentLocation)) != NULL) {
-        parseBedFile(currentWord, bedFileHash);
-        free(currentWord);
-    }
-    free(spaceSepFiles);
-    st_logDebug("Done parsing bed files\n");
-}
-void parseBedFile(const char *filepath, stHash *intervalsHash) {
-    /*
-     * takes a filepath and the intervalsHash, opens and reads the file,
-     * adding intervals taken from each bed line to the intervalsHash.
-     */
-    FILE *fileHandle = fopen(filepath, "r");
-    st_logDebug("Parsing the bed file: %s\n", filepath);
-    if (fileHandle == NULL) {
-        if (errno == ENOENT)
-            fprintf(stderr, "ERROR, file %s does not exist.\n", filepath);
-        else
-            fprintf(stderr, "ERROR, unable to open %s\n", filepath);
-        exit(EXIT_FAILURE);
-    }
-    int64_t nBytes = 100;
-    char *cA2 = st_malloc(nBytes + 1);
-    int64_t bytesRead = benLine(&cA2, &nBytes, fileHandle);
-    while (bytesRead != -1) {
-        if (bytesRead > 0) {
-            int64_t start = 0, stop = 0;
-            char *cA3 = stString_copy(cA2);
-            assert(3 == sscanf(cA2, "%s %" PRIi64 " %" PRIi64 "", cA3, &start, &stop));
-            stSortedSet *intervals = stHash_search(intervalsHash, cA3);
-            if (intervals == NULL) {
-                intervals = stSortedSet_construct3(
-                        (int(*)(const void *, const void *)) stIntTuple_cmpFn,
-                        (void(*)(void *)) stIntTuple_destruct);
-                stHash_insert(intervalsHash, stString_copy(cA3), intervals);
-            }
-            stIntTuple *j = stIntTuple_construct2(start, stop);
-            stIntTuple *k = stSortedSet_searchLessThanOrEqual(intervals,
-                    j);
-            if (k != NULL) {
-                if (stIntTuple_get(k, 1) > start) {
-                    st_errAbort(
-                            "Found an overlapping interval in the bed file: %s %" PRIi64 " "
-                            "%" PRIi64 " overlaps %s %" PRIi64 " %" PRIi64 "",
-                            cA3, start, stop, cA2,
-                            stIntTuple_get(k, 0),
-                            stIntTuple_get(k, 1));
-                }
-            }
-            k = stSortedSet_searchGreaterThanOrEqual(intervals, j);
-            if (k != NULL) {
-                if (stIntTuple_get(k, 1) < stop) {
-                    st_errAbort(
-                            "Found an overlapping interval in the bed file: %s %" PRIi64 " "
-                            "%" PRIi64 " overlaps %s %" PRIi64 " %" PRIi64 "",
-                            cA3, start, stop, cA2,
-                            stIntTuple_get(k, 0),
-                            stIntTuple_get(k, 1));
-                }
-            }
-            assert(stSortedSet_search(intervals, j) == NULL);
-            st_logDebug("Adding in an interval: %s %" PRIi64 " %" PRIi64 "\n", cA3, start, stop);
-            stSortedSet_insert(intervals, j);
-            free(cA3);
-        }
-        bytesRead = benLine(&cA2, &nBytes, fileHandle);
-    }
-    free(cA2);
-    fclose(fileHandle);
-    st_logDebug("Finished parsing the bed file: %s\n", filepath);
-}
 void listifercatePairs(char *s, stList *list) {
     // take a csv string and turn it into a list of strings.
     if (s == NULL) {
@@ -198,6 +121,19 @@ void listifercateKeyValuePairs(char *s, stList *list) {
     }
     free(spaceSep);
 }
+void listifercateCommaList(char *s, stList *list) {
+    // take a csv string and turn it into a list of strings.
+    if (s == NULL) {
+        return;
+    }
+    char *spaceSep = stringReplace(s, ',', ' ');
+    char *currentLocation = spaceSep;
+    char *currentWord = NULL;
+    while ((currentWord = stString_getNextWord(&currentLocation)) != NULL) {
+        stList_append(list, currentWord);
+    }
+    free(spaceSep);
+}
 void hashifercateList(stList *list, stHash *hash) {
     // given an stList containing strings that are ordered in pairs,
     // build an stHash keyed on a concatenation of the pairs (hyphen
@@ -229,7 +165,9 @@ void version(void) {
 }
 void usage(void) {
     version();
-    fprintf(stderr, "Usage: $ mafComparator --maf1=FILE1 --maf2=FILE2 --out=OUT.xml [options]\n\n");
+    fprintf(stderr, "Usage: $ mafComparator --maf1=FILE1 --maf2=FILE2 --out=OUT.xml [options]\n");
+    fprintf(stderr, "       $ mafComparator --maf1=FILE1 --maf2=FILE2,FILE3,... --out=OUT2.xml,OUT3.xml,... "
+            "[options]\n\n");
     fprintf(stderr, "This program takes two MAF files and compares them to one another.\n"
             "Specifically, for each ordered pair of sequences in the first MAF it \n"
             "samples a predefined number of sample homology tests (see below), then \n"
@@ -243,8 +181,11 @@ void usage(void) {
                  "alignments, this is the truth.");
     usageMessage('\0', "maf2", "The location of the second MAF file. "
                  "If comparing true to predicted "
-                 "alignments, this is the prediction.");
-    usageMessage('\0', "out", "The output XML formatted results file.");
+                 "alignments, this is the prediction. May be a comma separated list of MAF files, in "
+                 "which case maf1 is sampled once and each maf2 is compared against it in its own "
+                 "thread, writing one report per maf2 (see --out).");
+    usageMessage('\0', "out", "The output XML formatted results file. When --maf2 is a comma separated "
+                 "list this must be a comma separated list of the same length, one report per maf2.");
     usageMessage('\0', "samples", "The ideal number of sample homology tests to perform for the "
                  "two comparisons (i.e. file1 -> file and file2 -> file1). This "
                  "number is an ideal because pairs are sampled and thus the "
@@ -280,15 +221,68 @@ void usage(void) {
                  "checked by mafComparator as it runs, a discrpency will cause an error. If these values "
                  "are known prior to the analysis (either because the analysis has been run before or by "
                  "use of the mafPairCounter program) this option provides about a 15% speedup. Example: "
-                 "--numberOfPairs 2847390129,228470192212");
+                 "--numberOfPairs 2847390129,228470192212 . When --maf2 is a list only the maf1 value may "
+                 "be given. Example: --numberOfPairs 2847390129");
     usageMessage('\0', "legitSequences", "A list of comma separated key value pairs, which themselves "
                  "are colon (:) separated. Each pair is a sequence name and source length. These values "
                  "are normally determined by reading all sequences and source lengths from maf1 and then "
-                 "again from maf2 and then finding the intersection of the two sets. The source lengths "
+                 "again from maf2 and then finding the intersection of the two sets. maf1 is sampled over "
+                 "all of its sequences, and each maf2 of a list only tests and tallies the pairs of its own "
+                 "intersection. The source lengths "
                  "are verified by mafComparator is it runs and discrepncies will cause errors. If this "
                  "option is invoked it can result in a speedup of about 15%. Example: --legitSequences "
                  "apple.chr1:100,apple.chr2:102,pineapple.chr1:2010 ...");
 
+    usageMessage('\0', "writeSamples", "Write the pairs sampled from maf1, along with the seed, number "
+                 "of samples, number of pairs, the sequences of maf1 sampled over and a fingerprint of "
+                 "maf1, to the given binary file so that later comparisons against maf1 may skip counting "
+                 "and sampling it (see --readSamples).");
+    usageMessage('\0', "readSamples", "Read the pairs sampled from maf1 from a file previously written "
+                 "with --writeSamples instead of counting and sampling maf1. The seed, number of samples, "
+                 "number of pairs in maf1 and sequences of maf1 (with source lengths) are all taken from "
+                 "the file, so this option may not be combined with --legitSequences. Each maf2 keeps the "
+                 "sampled pairs whose sequences it also has. A file written for a different or since "
+                 "modified maf1 is an error. maf1 is still read when testing the pairs sampled from maf2.");
+    usageMessage('\0', "threads", "The number of threads used to tally the results of each set of "
+                 "homology tests, default=1. Each thread counts a share of the sampled pairs into its own "
+                 "tables which are merged at the end, the results do not depend on the number of threads. "
+                 "With --exact the threads also sort the pairs.");
+    usageMessage('\0', "exact", "Test every pair of aligned positions in both files rather than a sample "
+                 "of them. The pairs are sorted on disk, so the size of the alignments is limited by the "
+                 "space in --tempDir rather than by memory. Duplicate pairs within a file are tested once. "
+                 "May not be combined with --near, --numberOfPairs, --readSamples or --writeSamples.");
+    usageMessage('\0', "sortMemory", "With --exact, the number of megabytes of pairs to hold in memory "
+                 "before sorting them into a run on disk, default=1024.");
+    usageMessage('\0', "maxMemory", "The number of megabytes that sampled pairs may take. Pairs are sampled "
+                 "into sorted runs on disk rather than held in memory, and are tested against the other "
+                 "maf in batches that fit the budget, one pass over that maf per batch. The results are "
+                 "the same as without the option. The budget is shared by the comparisons of a batched "
+                 "--maf2. May not be combined with --exact, --ciWidth, --region, --regionBed, --readSamples "
+                 "or --writeSamples.");
+    usageMessage('\0', "tempDir", "With --exact or --maxMemory, the directory to keep the sorted runs in. "
+                 "The files are removed as soon as they are created so they never outlive the run. default=$TMPDIR or /tmp.");
+    usageMessage('\0', "ciWidth", "Sample adaptively rather than all at once: pairs are sampled and "
+                 "tested in rounds, each pair of sequences with its own sampling rate so that rare pairs "
+                 "are tested as well as common ones, until the Wilson confidence interval of the proportion "
+                 "of true tests of every pair of sequences is no wider than this value (e.g. 0.02). "
+                 "--samples then caps the number of tests of each comparison. Each direction reads the "
+                 "sampled maf once to count its pairs and then both mafs once per round, so a comparison "
+                 "costs about as many passes over each file as it takes rounds (reported as roundsMaf1 and "
+                 "roundsMaf2). The intervals are reported as ciLower and ciUpper. Results that combine "
+                 "several pairs of sequences weight each by its share of the pairs of the sampled maf, "
+                 "with the matching stratified interval. May not be combined with --exact, "
+                 "--numberOfPairs, --readSamples, --writeSamples, --bedFiles or --wigglePairs.");
+    usageMessage('\0', "ciLevel", "The confidence level of the --ciWidth intervals, default=0.95.");
+    usageMessage('\0', "region", "Compare only the pairs with at least one member in the region seq:start-end "
+                 "(zero based, half open, as in a bed file). Only the blocks of each file that overlap the "
+                 "region are read, found with a block index that is saved beside each maf as FILE.mbi "
+                 "for later runs. May not be combined with --exact, --ciWidth, --numberOfPairs, "
+                 "--readSamples or --writeSamples.");
+    usageMessage('\0', "regionBed", "As --region, for the regions in comma separated bed file(s). May be "
+                 "used along with --region.");
+    usageMessage('\0', "noCache", "Count the pairs of each maf and build its --region block index even if "
+                 "they are known from a previous run, and don't write the FILE.pairs and FILE.mbi files "
+                 "that remember them beside the maf.");
     usageMessage('\0', "logLevel", "Set the log level. [off, critical, info, debug] "
                  "in ascending order.");
     usageMessage('\0', "printFailed", "Print tab-delimited details about failed "
@@ -316,6 +310,18 @@ int parseOptions(int argc, char **argv, Options* options) {
         {"wiggleRegionStop", required_argument, 0, 0},
         {"numberOfPairs", required_argument, 0, 0},
         {"legitSequences", required_argument, 0, 0},
+        {"writeSamples", required_argument, 0, 0},
+        {"readSamples", required_argument, 0, 0},
+        {"threads", required_argument, 0, 0},
+        {"exact", no_argument, 0, 0},
+        {"sortMemory", required_argument, 0, 0},
+        {"tempDir", required_argument, 0, 0},
+        {"maxMemory", required_argument, 0, 0},
+        {"ciWidth", required_argument, 0, 0},
+        {"ciLevel", required_argument, 0, 0},
+        {"region", required_argument, 0, 0},
+        {"regionBed", required_argument, 0, 0},
+        {"noCache", no_argument, 0, 0},
         {"printFailed", no_argument, 0, 'p'},
         {"version", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
@@ -378,6 +384,76 @@ int parseOptions(int argc, char **argv, Options* options) {
                 options->numPairsString = stString_copy(optarg);
                 break;
             }
+            if (strcmp("writeSamples", longOptions[longIndex].name) == 0) {
+                options->writeSamples = stString_copy(optarg);
+                break;
+            }
+            if (strcmp("readSamples", longOptions[longIndex].name) == 0) {
+                options->readSamples = stString_copy(optarg);
+                break;
+            }
+            if (strcmp("threads", longOptions[longIndex].name) == 0) {
+                i = sscanf(optarg, "%" PRIu64, &(options->numThreads));
+                if (i != 1 || options->numThreads < 1) {
+                    fprintf(stderr, "Error, --threads must be a positive integer, not %s\n", optarg);
+                    exit(2);
+                }
+                break;
+            }
+            if (strcmp("exact", longOptions[longIndex].name) == 0) {
+                options->exact = true;
+                break;
+            }
+            if (strcmp("sortMemory", longOptions[longIndex].name) == 0) {
+                i = sscanf(optarg, "%" PRIu64, &(options->sortMemory));
+                if (i != 1 || options->sortMemory < 1) {
+                    fprintf(stderr, "Error, --sortMemory must be a positive integer, not %s\n", optarg);
+                    exit(2);
+                }
+                options->sortMemory <<= 20;
+                break;
+            }
+            if (strcmp("maxMemory", longOptions[longIndex].name) == 0) {
+                i = sscanf(optarg, "%" PRIu64, &(options->maxMemory));
+                if (i != 1 || options->maxMemory < 1) {
+                    fprintf(stderr, "Error, --maxMemory must be a positive integer, not %s\n", optarg);
+                    exit(2);
+                }
+                options->maxMemory <<= 20;
+                break;
+            }
+            if (strcmp("noCache", longOptions[longIndex].name) == 0) {
+                options->noCache = true;
+                break;
+            }
+            if (strcmp("tempDir", longOptions[longIndex].name) == 0) {
+                options->tempDir = stString_copy(optarg);
+                break;
+            }
+            if (strcmp("ciWidth", longOptions[longIndex].name) == 0) {
+                i = sscanf(optarg, "%lf", &(options->ciWidth));
+                if (i != 1 || !(options->ciWidth > 0.0 && options->ciWidth <= 1.0)) {
+                    fprintf(stderr, "Error, --ciWidth must be a number in (0, 1], not %s\n", optarg);
+                    exit(2);
+                }
+                break;
+            }
+            if (strcmp("ciLevel", longOptions[longIndex].name) == 0) {
+                i = sscanf(optarg, "%lf", &(options->ciLevel));
+                if (i != 1 || !(options->ciLevel > 0.0 && options->ciLevel < 1.0)) {
+                    fprintf(stderr, "Error, --ciLevel must be a number in (0, 1), not %s\n", optarg);
+                    exit(2);
+                }
+                break;
+            }
+            if (strcmp("region", longOptions[longIndex].name) == 0) {
+                options->region = stString_copy(optarg);
+                break;
+            }
+            if (strcmp("regionBed", longOptions[longIndex].name) == 0) {
+                options->regionBed = stString_copy(optarg);
+                break;
+            }
         case 'a':
             options->logLevelString = stString_copy(optarg);
             break;
@@ -453,34 +529,151 @@ int parseOptions(int argc, char **argv, Options* options) {
             exit(2);
         }
     }
+    uint64_t numComparisons = countChars(options->mafFile2, ',') + 1;
+    if (countChars(options->outputFile, ',') + 1 != numComparisons) {
+        fprintf(stderr, "\nError, --out must contain one output file per --maf2 file, separated by commas.\n");
+        exit(2);
+    }
+    if (numComparisons > 1 && g_isVerboseFailures) {
+        fprintf(stderr, "\nError, --printFailed may only be used with a single --maf2 file.\n");
+        exit(2);
+    }
     if (options->numPairsString != NULL) {
-        if (countChars(options->numPairsString, ',') != 1) {
+        stList *numbers = stList_construct3(0, free);
+        listifercateCommaList(options->numPairsString, numbers);
+        if (numComparisons == 1 && stList_length(numbers) != 2) {
             fprintf(stderr, "\nError, --numberOfPairs must contain two values separated by a comma.\n");
             exit(2);
         }
-        stList *numbers = stList_construct3(0, free);
-        listifercatePairs(options->numPairsString, numbers);
-        if (stList_length(numbers) != 2) {
-            fprintf(stderr, "\nError, --numberOfPairs must contain two values separated by a comma.\n");
+        if (numComparisons > 1 && stList_length(numbers) != 1) {
+            fprintf(stderr, "\nError, --numberOfPairs must contain only the maf1 value when --maf2 "
+                    "contains more than one file.\n");
             exit(2);
         }
         i = sscanf(stList_get(numbers, 0), "%" PRIu64, &(options->numPairs1));
         assert(i == 1);
-        i = sscanf(stList_get(numbers, 1), "%" PRIu64, &(options->numPairs2));
-        assert(i == 1);
+        if (numComparisons == 1) {
+            i = sscanf(stList_get(numbers, 1), "%" PRIu64, &(options->numPairs2));
+            assert(i == 1);
+        }
         stList_destruct(numbers);
     }
+    if (options->readSamples != NULL && options->legitSequences != NULL) {
+        fprintf(stderr, "\nError, --readSamples and --legitSequences may not be used together, "
+                "the legit sequences are stored in the samples file.\n");
+        exit(2);
+    }
+    if (options->exact && (options->near != 0 || options->numPairsString != NULL ||
+                           options->readSamples != NULL || options->writeSamples != NULL)) {
+        fprintf(stderr, "\nError, --exact may not be used with --near, --numberOfPairs, --readSamples "
+                "or --writeSamples.\n");
+        exit(2);
+    }
+    if (options->ciWidth > 0.0 && (options->exact || options->numPairsString != NULL ||
+                                   options->readSamples != NULL || options->writeSamples != NULL ||
+                                   options->bedFiles != NULL || options->wigglePairs != NULL)) {
+        // the bed region and wiggle counts are raw tallies that can't be weighted by stratum
+        fprintf(stderr, "\nError, --ciWidth may not be used with --exact, --numberOfPairs, --readSamples, "
+                "--writeSamples, --bedFiles or --wigglePairs.\n");
+        exit(2);
+    }
+    if ((options->region != NULL || options->regionBed != NULL) &&
+        (options->exact || options->ciWidth > 0.0 || options->numPairsString != NULL ||
+         options->readSamples != NULL || options->writeSamples != NULL)) {
+        fprintf(stderr, "\nError, --region and --regionBed may not be used with --exact, --ciWidth, "
+                "--numberOfPairs, --readSamples or --writeSamples.\n");
+        exit(2);
+    }
+    if (options->maxMemory != 0 &&
+        (options->exact || options->ciWidth > 0.0 || options->region != NULL || options->regionBed != NULL ||
+         options->readSamples != NULL || options->writeSamples != NULL)) {
+        fprintf(stderr, "\nError, --maxMemory may not be used with --exact, --ciWidth, --region, --regionBed, "
+                "--readSamples or --writeSamples.\n");
+        exit(2);
+    }
+    if (options->region != NULL) {
+        char *name = NULL;
+        uint64_t start, end;
+        if (!parseRegion(options->region, &name, &start, &end)) {
+            fprintf(stderr, "\nError, --region must be of the form seq:start-end with start < end, not %s\n",
+                    options->region);
+            exit(2);
+        }
+        free(name);
+    }
+    if (options->tempDir == NULL) {
+        options->tempDir = stString_copy((getenv("TMPDIR") != NULL) ? getenv("TMPDIR") : "/tmp");
+    }
     FILE *fileHandle = de_fopen(options->mafFile1, "r");
     fclose(fileHandle);
-    fileHandle = de_fopen(options->mafFile2, "r");
-    fclose(fileHandle);
+    stList *mafFile2s = stList_construct3(0, free);
+    listifercateCommaList(options->mafFile2, mafFile2s);
+    for (int64_t j = 0; j < stList_length(mafFile2s); ++j) {
+        fileHandle = de_fopen(stList_get(mafFile2s, j), "r");
+        fclose(fileHandle);
+    }
+    stList_destruct(mafFile2s);
     return optind;
 }
+void writeComparisonReport(Options *options, Comparison *c) {
+    // write the XML report for the comparison of options->mafFile1 and c->mafFile2 to c->outputFile
+    FILE *fileHandle = de_fopen(c->outputFile, "w");
+    writeXMLHeader(fileHandle);
+    char bedString[kMaxStringLength];
+    if (options->bedFiles != NULL) {
+        sprintf(bedString, " bedFiles=\"%s\"", options->bedFiles);
+    } else {
+        bedString[0] = '\0';
+    }
+    char wiggleString[kMaxStringLength];
+    if (options->wigglePairs != NULL) {
+        sprintf(wiggleString, " wigglePairs=\"%s\" wiggleBinLength=\"%" PRIu64 "\"",
+                options->wigglePairs, options->wiggleBinLength);
+    } else {
+        wiggleString[0] = '\0';
+    }
+    char ciString[kMaxStringLength];
+    if (options->ciWidth > 0.0) {
+        sprintf(ciString, " ciWidth=\"%f\" ciLevel=\"%f\" roundsMaf1=\"%" PRIu64 "\" roundsMaf2=\"%" PRIu64 "\"",
+                options->ciWidth, options->ciLevel, c->numRounds_12, c->numRounds_21);
+    } else {
+        ciString[0] = '\0';
+    }
+    char regionString[kMaxStringLength];
+    regionString[0] = '\0';
+    if (options->region != NULL) {
+        sprintf(regionString, " region=\"%s\"", options->region);
+    }
+    if (options->regionBed != NULL) {
+        sprintf(regionString + strlen(regionString), " regionBed=\"%s\"", options->regionBed);
+    }
+    char wiggleRegionString[kMaxStringLength];
+    if (options->wiggleRegionStop != 0) {
+        sprintf(wiggleRegionString, " wiggleRegionStart=\"%" PRIu64 "\" wiggleRegionStop=\"%" PRIu64 "\"",
+                options->wiggleRegionStart, options->wiggleRegionStop);
+    } else {
+        wiggleRegionString[0] = '\0';
+    }
+    fprintf(fileHandle, "<alignmentComparisons numberOfSamples=\"%" PRIu64 "\" "
+            "near=\"%" PRIu64 "\" seed=\"%" PRIu64 "\" maf1=\"%s\" maf2=\"%s\" "
+            "numberOfPairsInMaf1=\"%" PRIu64 "\" "
+            "numberOfPairsInMaf2=\"%" PRIu64 "\"%s%s%s%s%s%s version=\"%s\" "
+            "buildDate=\"%s\" buildBranch=\"%s\" buildCommit=\"%s\">\n",
+            options->numberOfSamples, options->near, options->randomSeed, options->mafFile1, c->mafFile2,
+            c->numPairs1, c->numPairs2, bedString, wiggleString, wiggleRegionString,
+            options->exact ? " exact=\"true\"" : "", ciString, regionString,
+            g_version, g_build_date, g_build_git_branch, g_build_git_sha);
+    reportResults(c->results_12, options->mafFile1, c->mafFile2, fileHandle, options->near,
+                  c->legitSequences, options->bedFiles, options->ciWidth > 0.0 ? options->ciLevel : 0.0);
+    reportResults(c->results_21, c->mafFile2, options->mafFile1, fileHandle, options->near,
+                  c->legitSequences, options->bedFiles, options->ciWidth > 0.0 ? options->ciLevel : 0.0);
+    reportResultsForWiggles(c->wigglePairHash, fileHandle);
+    fprintf(fileHandle, "</alignmentComparisons>\n");
+    fclose(fileHandle);
+}
 int main(int argc, char **argv) {
     Options *options = options_construct();
-    FILE *fileHandle = NULL;
-    stHash *intervalsHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free,
-                                              (void(*)(void *)) stSortedSet_destruct);
+    bedIndex_t *bedIndex = bed_newIndex();
     // (0) Parse the inputs
     parseOptions(argc, argv, options);
     stList *wigglePairPatternList = stList_construct3(0, free);
@@ -490,88 +683,126 @@ int main(int argc, char **argv) {
     st_logDebug("Seeding the random number generator with the value %lo\n", options->randomSeed);
     st_randomSeed(options->randomSeed);
     // Check the inputs.
-    // Parse the bed file hashes
+    // Parse the bed files into the interval index
     if(options->bedFiles != NULL) {
-        parseBedFiles(options->bedFiles, intervalsHash);
+        st_logDebug("Starting to parse bed files\n");
+        bed_readFiles(bedIndex, options->bedFiles);
+        st_logDebug("Done parsing bed files\n");
     } else {
         st_logDebug("No bed files specified\n");
     }
+    bed_finalizeIndex(bedIndex);
+    if (options->region != NULL || options->regionBed != NULL) {
+        options->regions = bed_newIndex();
+        if (options->region != NULL) {
+            char *name = NULL;
+            uint64_t start, end;
+            parseRegion(options->region, &name, &start, &end);
+            bed_addInterval(options->regions, name, start, end);
+            free(name);
+        }
+        if (options->regionBed != NULL) {
+            bed_readFiles(options->regions, options->regionBed);
+        }
+        bed_finalizeIndex(options->regions);
+        loadBlockIndexes(options);
+    }
     // Log (some of) the inputs
     st_logInfo("MAF file 1 name : %s\n", options->mafFile1);
     st_logInfo("MAF file 2 name : %s\n", options->mafFile2);
     st_logInfo("Output stats file : %s\n", options->outputFile);
-    st_logInfo("Bed files parsed : %" PRIi64 "\n", stHash_size(intervalsHash));
+    st_logInfo("Bed file sequences parsed : %" PRIu64 "\n", bed_getNumberOfSequences(bedIndex));
     st_logInfo("Number of samples %" PRIu64 "\n", options->numberOfSamples);
     // note that random seed has already been logged.
     // Create sequence name hashtable from the first MAF file.
     stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
     stSet *seqNamesSet = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
-    buildSeqNamesSet(options, seqNamesSet, sequenceLengthHash);
-    // build final wiggle things
-    stHash *wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey,
-                                               free, (void(*)(void *))wiggleContainer_destruct);
-    buildWigglePairHash(sequenceLengthHash, wigglePairPatternList, wigglePairHash, options->wiggleBinLength,
-                        options->wiggleRegionStart, options->wiggleRegionStop);
+    stSortedSet *sampledPairs_12 = NULL;
+    if (options->readSamples != NULL) {
+        // the sequences maf1 was sampled over, pair count, number of samples and seed all come from
+        // the samples file, which must have been written for maf1 as it is now
+        sampledPairs_12 = readSampledPairsFile(options->readSamples, options->mafFile1, seqNamesSet,
+                                               sequenceLengthHash, &(options->randomSeed),
+                                               &(options->numberOfSamples), &(options->numPairs1));
+        st_logInfo("Read %" PRIi64 " sampled pairs from %s, reseeding with %" PRIu64 "\n",
+                   stSortedSet_size(sampledPairs_12), options->readSamples, options->randomSeed);
+        st_randomSeed(options->randomSeed);
+    } else {
+        buildSeqNamesSet(options, seqNamesSet, sequenceLengthHash);
+    }
+    // build one comparison per mafFile2, each with its own final wiggle things
+    stList *mafFile2s = stList_construct3(0, free);
+    stList *outputFiles = stList_construct3(0, free);
+    listifercateCommaList(options->mafFile2, mafFile2s);
+    listifercateCommaList(options->outputFile, outputFiles);
+    uint64_t numComparisons = stList_length(mafFile2s);
+    Comparison **comparisons = st_malloc(sizeof(*comparisons) * numComparisons);
+    for (uint64_t i = 0; i < numComparisons; ++i) {
+        comparisons[i] = comparison_construct(stList_get(mafFile2s, i), stList_get(outputFiles, i));
+        comparisons[i]->numPairs1 = options->numPairs1;
+        comparisons[i]->numPairs2 = options->numPairs2;
+        buildComparisonSeqNamesSet(options, seqNamesSet, comparisons[i], sequenceLengthHash);
+        buildWigglePairHash(sequenceLengthHash, comparisons[i]->legitSequences, wigglePairPatternList,
+                            comparisons[i]->wigglePairHash, options->wiggleBinLength, options->wiggleRegionStart,
+                            options->wiggleRegionStop);
+    }
     // Do comparisons.
     if (g_isVerboseFailures) {
         fprintf(stderr, "# Sampling from %s, comparing to %s\n", options->mafFile1, options->mafFile2);
         fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
     }
-    stSortedSet *results_12 = compareMAFs_AB(options->mafFile1, options->mafFile2, &(options->numPairs1),
-                                             seqNamesSet, intervalsHash, wigglePairHash, true, options,
+    if (options->exact) {
+        compareExact(options, comparisons, numComparisons, bedIndex, sequenceLengthHash);
+    } else if (options->ciWidth > 0.0) {
+        // maf1 is resampled for each comparison since how much it needs, and over which sequences,
+        // depends on the mafFile2
+        for (uint64_t i = 0; i < numComparisons; ++i) {
+            Comparison *c = comparisons[i];
+            c->results_12 = compareAdaptive(options->mafFile1, c->mafFile2, &(c->numPairs1), c->legitSequences,
+                                            bedIndex, c->wigglePairHash, true, options, sequenceLengthHash,
+                                            &(c->numRounds_12));
+            if (g_isVerboseFailures) {
+                fprintf(stderr, "# Sampling from %s, comparing to %s\n", c->mafFile2, options->mafFile1);
+                fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
+            }
+            c->results_21 = compareAdaptive(c->mafFile2, options->mafFile1, &(c->numPairs2), c->legitSequences,
+                                            bedIndex, c->wigglePairHash, false, options, sequenceLengthHash,
+                                            &(c->numRounds_21));
+        }
+    } else if (options->maxMemory != 0) {
+        ExactRuns *sampledRuns_12 = sampleMafPairsToRuns(options->mafFile1, &(options->numPairs1), seqNamesSet,
+                                                         options, sequenceLengthHash, options->maxMemory);
+        compareBatch(options, NULL, sampledRuns_12, comparisons, numComparisons, seqNamesSet, bedIndex,
+                     sequenceLengthHash);
+        exactRuns_destruct(sampledRuns_12);
+    } else {
+        if (sampledPairs_12 == NULL) {
+            sampledPairs_12 = sampleMafPairs(options->mafFile1, &(options->numPairs1), seqNamesSet, options,
                                              sequenceLengthHash);
-    if (g_isVerboseFailures) {
-        fprintf(stderr, "# Sampling from %s, comparing to %s\n", options->mafFile2, options->mafFile1);
-        fprintf(stderr, "# seq1\tabsPos1\torigPos1\tseq2\tabsPos2\torigPos2\n");
+        }
+        if (options->writeSamples != NULL) {
+            writeSampledPairsFile(options->writeSamples, options->mafFile1, sampledPairs_12, seqNamesSet,
+                                  sequenceLengthHash, options->randomSeed, options->numberOfSamples,
+                                  options->numPairs1);
+        }
+        compareBatch(options, sampledPairs_12, NULL, comparisons, numComparisons, seqNamesSet, bedIndex,
+                     sequenceLengthHash);
+        stSortedSet_destruct(sampledPairs_12);
     }
-    stSortedSet *results_21 = compareMAFs_AB(options->mafFile2, options->mafFile1, &(options->numPairs2),
-                                             seqNamesSet, intervalsHash, wigglePairHash, false, options,
-                                             sequenceLengthHash);
-    fileHandle = de_fopen(options->outputFile, "w");
     // Report results.
-    writeXMLHeader(fileHandle);
-    char bedString[kMaxStringLength];
-    if (options->bedFiles != NULL) {
-        sprintf(bedString, " bedFiles=\"%s\"", options->bedFiles);
-    } else {
-        bedString[0] = '\0';
-    }
-    char wiggleString[kMaxStringLength];
-    if (options->wigglePairs != NULL) {
-        sprintf(wiggleString, " wigglePairs=\"%s\" wiggleBinLength=\"%" PRIu64 "\"",
-                options->wigglePairs, options->wiggleBinLength);
-    } else {
-        wiggleString[0] = '\0';
+    for (uint64_t i = 0; i < numComparisons; ++i) {
+        writeComparisonReport(options, comparisons[i]);
     }
-    char wiggleRegionString[kMaxStringLength];
-    if (options->wiggleRegionStop != 0) {
-        sprintf(wiggleRegionString, " wiggleRegionStart=\"%" PRIu64 "\" wiggleRegionStop=\"%" PRIu64 "\"",
-                options->wiggleRegionStart, options->wiggleRegionStop);
-    } else {
-        wiggleRegionString[0] = '\0';
-    }
-    fprintf(fileHandle, "<alignmentComparisons numberOfSamples=\"%" PRIu64 "\" "
-            "near=\"%" PRIu64 "\" seed=\"%" PRIu64 "\" maf1=\"%s\" maf2=\"%s\" "
-            "numberOfPairsInMaf1=\"%" PRIu64 "\" "
-            "numberOfPairsInMaf2=\"%" PRIu64 "\"%s%s%s version=\"%s\" "
-            "buildDate=\"%s\" buildBranch=\"%s\" buildCommit=\"%s\">\n",
-            options->numberOfSamples, options->near, options->randomSeed, options->mafFile1, options->mafFile2,
-            options->numPairs1, options->numPairs2, bedString, wiggleString, wiggleRegionString,
-            g_version, g_build_date, g_build_git_branch, g_build_git_sha);
-    reportResults(results_12, options->mafFile1, options->mafFile2, fileHandle, options->near,
-                  seqNamesSet, options->bedFiles);
-    reportResults(results_21, options->mafFile2, options->mafFile1, fileHandle, options->near,
-                  seqNamesSet, options->bedFiles);
-    reportResultsForWiggles(wigglePairHash, fileHandle);
-    fprintf(fileHandle, "</alignmentComparisons>\n");
-    fclose(fileHandle);
     // Clean up.
-    stSortedSet_destruct(results_12);
-    stSortedSet_destruct(results_21);
+    for (uint64_t i = 0; i < numComparisons; ++i) {
+        comparison_destruct(comparisons[i]);
+    }
+    free(comparisons);
+    stList_destruct(mafFile2s);
+    stList_destruct(outputFiles);
     options_destruct(options);
     stSet_destruct(seqNamesSet);
-    stHash_destruct(intervalsHash);
-    stHash_destruct(wigglePairHash);
+    bed_destroyIndex(bedIndex);
     stHash_destruct(sequenceLengthHash);
     stList_destruct(wigglePairPatternList);
     return(EXIT_SUCCESS);
@@ -29,13 +29,15 @@
 #include "sonLib.h"
 #include "common.h"
 #include "comparatorAPI.h"
+#include "comparatorCount.h"
 #include "buildVersion.h"
 
 const char *g_version = "version 0.1 July 2012";
 
 void version(void);
 void usage(void);
-int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList);
+int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList, uint64_t *numThreads,
+                 bool *isCached);
 stSet* buildSet(char *listOfLegitSequences);
 
 void version(void) {
@@ -61,18 +63,27 @@ void usage(void) {
                  "Using this option causes --sequences option to be ignored. Sequences will "
                  "be discovered by intersection of sequences present in both maf files, pairs "
                  "reported will be from the --maf option.");
+    usageMessage('\0', "threads", "The number of threads to count pairs with. The maf is split "
+                 "at block boundaries into that many pieces, each counted separately. default=1");
+    usageMessage('\0', "noCache", "Count the pairs even if the count is known from a previous run. "
+                 "Counts are remembered in FILE.pairs beside the maf and are only reused while the maf "
+                 "is unchanged.");
     usageMessage('v', "version", "Print current version number.");
 }
-int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList) {
+int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList, uint64_t *numThreads,
+                 bool *isCached) {
     static const char *optString = "v:h:";
     static const struct option longOpts[] = {
         {"maf", required_argument, 0, 0},
         {"maf2", required_argument, 0, 0},
         {"sequences", required_argument, 0, 0},
+        {"threads", required_argument, 0, 0},
+        {"noCache", no_argument, 0, 0},
         {"version", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0 }};
     int longIndex = 0;
+    int i;
     int key = getopt_long(argc, argv, optString, longOpts, &longIndex);
     while (key != -1) {
         switch (key) {
@@ -89,6 +100,18 @@ int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList)
                 *seqList = stString_copy(optarg);
                 break;
             }
+            if (strcmp("threads", longOpts[longIndex].name) == 0) {
+                i = sscanf(optarg, "%" PRIu64, numThreads);
+                if (i != 1 || *numThreads < 1) {
+                    fprintf(stderr, "Error, bad --threads value: %s\n", optarg);
+                    exit(2);
+                }
+                break;
+            }
+            if (strcmp("noCache", longOpts[longIndex].name) == 0) {
+                *isCached = false;
+                break;
+            }
         case 'v':
             version();
             exit(EXIT_SUCCESS);
@@ -115,8 +138,8 @@ int parseOptions(int argc, char **argv, char **maf, char **maf2, char **seqList)
         fileHandle = de_fopen(*maf2, "r");
         fclose(fileHandle);
         if (*seqList != NULL) {
-            free(seqList);
-            seqList = NULL;
+            free(*seqList);
+            *seqList = NULL;
         }
     }
     return optind;
@@ -140,8 +163,10 @@ int main(int argc, char **argv) {
     stSet *legitSeqsSet = NULL;
     stSet *maf1SeqSet = NULL;
     stSet *maf2SeqSet = NULL;
+    uint64_t numThreads = 1;
+    bool isCached = true;
     stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
-    parseOptions(argc, argv, &maf, &maf2, &listOfLegitSequences);
+    parseOptions(argc, argv, &maf, &maf2, &listOfLegitSequences, &numThreads, &isCached);
     if (listOfLegitSequences != NULL) {
         legitSeqsSet = buildSet(listOfLegitSequences);
     }
@@ -153,7 +178,12 @@ int main(int argc, char **argv) {
         populateNames(maf2, maf2SeqSet, sequenceLengthHash);
         legitSeqsSet = stSet_getIntersection(maf1SeqSet, maf2SeqSet);
     }
-    uint64_t numberOfPairs = countPairsInMaf(maf, legitSeqsSet);
+    uint64_t numberOfPairs;
+    if (isCached) {
+        numberOfPairs = countPairsInMafCached(maf, legitSeqsSet, numThreads);
+    } else {
+        numberOfPairs = countPairsInMafThreaded(maf, legitSeqsSet, numThreads);
+    }
     printf("%"PRIu64"\n", numberOfPairs);
     // clean up
     if (legitSeqsSet != NULL) {
@@ -405,6 +405,326 @@ static void test_pairSortComparison_0(CuTest *testCase) {
     stSortedSet_destruct(pairs);
 
 }
+static void test_recordNearPair_0(CuTest *testCase) {
+    // recordNearPair() should record exactly the sampled pairs that a brute force scan
+    // of all positions within +- near finds.
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
+    const char *seqs[] = {"A", "B", "C"};
+    for (uint64_t i = 0; i < 30; i += 3) {
+        for (uint64_t j = 0; j < 30; j += 2) {
+            stSortedSet_insert(pairs, aPair_construct(seqs[0], seqs[1], i, j));
+            stSortedSet_insert(pairs, aPair_construct(seqs[0], seqs[2], i, j + 1));
+            stSortedSet_insert(pairs, aPair_construct(seqs[1], seqs[2], j, i));
+        }
+    }
+    uint64_t nears[] = {0, 1, 4, 50};
+    for (uint64_t n = 0; n < sizeof(nears) / sizeof(uint64_t); ++n) {
+        stSortedSet *pairsByPos2 = constructPairsByPos2(pairs, nears[n]);
+        for (uint64_t i = 0; i < 32; ++i) {
+            for (uint64_t j = 0; j < 32; ++j) {
+                APair *q = aPair_construct(seqs[0], seqs[1], i, j);
+                stSet *positivePairs = stSet_construct();
+                recordNearPair(q, pairs, pairsByPos2, nears[n], positivePairs);
+                CuAssertTrue(testCase, q->pos1 == i);
+                CuAssertTrue(testCase, q->pos2 == j);
+                uint64_t expected = 0;
+                stSortedSetIterator *sit = stSortedSet_getIterator(pairs);
+                APair *p = NULL;
+                while ((p = stSortedSet_getNext(sit)) != NULL) {
+                    bool isNear = (strcmp(p->seq1, q->seq1) == 0 && strcmp(p->seq2, q->seq2) == 0 &&
+                                   ((p->pos2 == q->pos2 && closeEnough(p->pos1, q->pos1, nears[n])) ||
+                                    (p->pos1 == q->pos1 && closeEnough(p->pos2, q->pos2, nears[n]))));
+                    if (isNear) {
+                        ++expected;
+                    }
+                    CuAssertTrue(testCase, isNear == (stSet_search(positivePairs, p) != NULL));
+                }
+                stSortedSet_destructIterator(sit);
+                CuAssertTrue(testCase, expected == (uint64_t) stSet_size(positivePairs));
+                stSet_destruct(positivePairs);
+                aPair_destruct(q);
+            }
+        }
+        if (pairsByPos2 != NULL) {
+            stSortedSet_destruct(pairsByPos2);
+        }
+    }
+    stSortedSet_destruct(pairs);
+}
+static void test_runSampling_0(CuTest *testCase) {
+    // sampling every pair of a block run by run should give exactly the pairs that a column by
+    // column walk over the block gives.
+    const char *block =
+        "a score=0.0\n"
+        "s A.chr1    100 14 + 1000 ACGT--ACGTAC--GTAA\n"
+        "s B.chr1    200 16 - 1000 ACGTA-ACGTACG-GTAA\n"
+        "s C.chr1    300 10 + 1000 ACGT--ACG----TGT--\n"
+        "s D.chr1    400 18 + 1000 ACGTACGTACGTACGTAC\n"
+        "s E.chr1    500 14 - 1000 --GTACGTACGTACGT--\n";
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legitSequences, stString_copy("A.chr1"));
+    stSet_insert(legitSequences, stString_copy("B.chr1"));
+    stSet_insert(legitSequences, stString_copy("C.chr1"));
+    stSet_insert(legitSequences, stString_copy("E.chr1"));
+    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    mafBlock_t *mb = maf_newMafBlockFromString(block, 3);
+    stSortedSet *observed = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
+    uint64_t numPairs = 0;
+    walkBlockSamplingPairs("test", mb, observed, 1.0, legitSequences, chooseTwoArray, &numPairs, sequenceLengthHash);
+    // build the expected set column by column
+    stSortedSet *expected = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
+    uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
+    uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
+    char **names = maf_mafBlock_getSpeciesArray(mb);
+    char **mat = maf_mafBlock_getSequenceMatrix(mb, numSeqs, seqFieldLength);
+    bool *legitRows = getLegitRows(names, numSeqs, legitSequences);
+    uint64_t *allPositions = maf_mafBlock_getPosCoordStartArray(mb);
+    int *allStrandInts = maf_mafBlock_getStrandIntArray(mb);
+    for (uint64_t c = 0; c < seqFieldLength; ++c) {
+        for (uint64_t r1 = 0; r1 < numSeqs; ++r1) {
+            for (uint64_t r2 = r1 + 1; r2 < numSeqs; ++r2) {
+                if (legitRows[r1] && legitRows[r2] && mat[r1][c] != '-' && mat[r2][c] != '-') {
+                    stSortedSet_insert(expected, aPair_construct(names[r1], names[r2],
+                                                                 allPositions[r1], allPositions[r2]));
+                }
+            }
+        }
+        updatePositions(mat, c, allPositions, allStrandInts, numSeqs);
+    }
+    CuAssertTrue(testCase, numPairs == (uint64_t) stSortedSet_size(expected));
+    CuAssertTrue(testCase, stSortedSet_size(observed) == stSortedSet_size(expected));
+    stSortedSetIterator *sit = stSortedSet_getIterator(expected);
+    APair *p = NULL;
+    while ((p = stSortedSet_getNext(sit)) != NULL) {
+        CuAssertTrue(testCase, stSortedSet_search(observed, p) != NULL);
+    }
+    stSortedSet_destructIterator(sit);
+    CuAssertTrue(testCase, numPairs == walkBlockCountingPairs(mb, legitSequences, chooseTwoArray));
+    // clean up
+    for (uint64_t i = 0; i < numSeqs; ++i) {
+        free(names[i]);
+    }
+    free(names);
+    maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
+    free(legitRows);
+    free(allPositions);
+    free(allStrandInts);
+    stSortedSet_destruct(observed);
+    stSortedSet_destruct(expected);
+    maf_destroyMafBlockList(mb);
+    free(chooseTwoArray);
+    stHash_destruct(sequenceLengthHash);
+    stSet_destruct(legitSequences);
+}
+static void test_regionPairCounting_0(CuTest *testCase) {
+    // the pairs counted in the regions should be exactly the sampled pairs with a member inside
+    const char *block =
+        "a score=0.0\n"
+        "s A.chr1    100 14 + 1000 ACGT--ACGTAC--GTAA\n"
+        "s B.chr1    200 16 - 1000 ACGTA-ACGTACG-GTAA\n"
+        "s C.chr1    300 10 + 1000 ACGT--ACG----TGT--\n"
+        "s D.chr1    400 18 + 1000 ACGTACGTACGTACGTAC\n"
+        "s E.chr1    500 14 - 1000 --GTACGTACGTACGT--\n";
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legitSequences, stString_copy("A.chr1"));
+    stSet_insert(legitSequences, stString_copy("B.chr1"));
+    stSet_insert(legitSequences, stString_copy("C.chr1"));
+    stSet_insert(legitSequences, stString_copy("E.chr1"));
+    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    mafBlock_t *mb = maf_newMafBlockFromString(block, 3);
+    stSortedSet *observed = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
+    uint64_t numPairs = 0;
+    walkBlockSamplingPairs("test", mb, observed, 1.0, legitSequences, chooseTwoArray, &numPairs, sequenceLengthHash);
+    bedIndex_t *regions = bed_newIndex();
+    bed_addInterval(regions, "A.chr1", 104, 108);
+    bed_addInterval(regions, "B.chr1", 780, 790); // the - strand row covers 784 through 799
+    bed_addInterval(regions, "D.chr1", 400, 418); // not legit
+    bed_finalizeIndex(regions);
+    uint64_t expected = 0;
+    APair *p = NULL;
+    stSortedSetIterator *sit = stSortedSet_getIterator(observed);
+    while ((p = stSortedSet_getNext(sit)) != NULL) {
+        expected += pairInRegions(p, regions);
+    }
+    stSortedSet_destructIterator(sit);
+    CuAssertTrue(testCase, expected > 0 && expected < numPairs);
+    CuAssertTrue(testCase, walkBlockCountingRegionPairs(mb, legitSequences, regions, chooseTwoArray) == expected);
+    // a region on a sequence that is not in the block counts nothing
+    bedIndex_t *elsewhere = bed_newIndex();
+    bed_addInterval(elsewhere, "F.chr1", 0, 1000);
+    bed_finalizeIndex(elsewhere);
+    CuAssertTrue(testCase, walkBlockCountingRegionPairs(mb, legitSequences, elsewhere, chooseTwoArray) == 0);
+    // clean up
+    bed_destroyIndex(elsewhere);
+    bed_destroyIndex(regions);
+    stSortedSet_destruct(observed);
+    maf_destroyMafBlockList(mb);
+    free(chooseTwoArray);
+    stHash_destruct(sequenceLengthHash);
+    stSet_destruct(legitSequences);
+}
+static void test_parseRegion_0(CuTest *testCase) {
+    char *name = NULL;
+    uint64_t start, end;
+    CuAssertTrue(testCase, parseRegion("hg19.chr1:100-200", &name, &start, &end));
+    CuAssertTrue(testCase, strcmp(name, "hg19.chr1") == 0 && start == 100 && end == 200);
+    free(name);
+    CuAssertTrue(testCase, parseRegion("a:b:0-1", &name, &start, &end));
+    CuAssertTrue(testCase, strcmp(name, "a:b") == 0 && start == 0 && end == 1);
+    free(name);
+    CuAssertTrue(testCase, !parseRegion("hg19.chr1", &name, &start, &end));
+    CuAssertTrue(testCase, !parseRegion(":1-2", &name, &start, &end));
+    CuAssertTrue(testCase, !parseRegion("chr1:2-2", &name, &start, &end));
+    CuAssertTrue(testCase, !parseRegion("chr1:2-1", &name, &start, &end));
+    CuAssertTrue(testCase, !parseRegion("chr1:1-2x", &name, &start, &end));
+    CuAssertTrue(testCase, !parseRegion("chr1:-1-2", &name, &start, &end));
+    CuAssertTrue(testCase, !parseRegion("chr1:1,2", &name, &start, &end));
+}
+static stHash* buildTestWigglePairHash(void) {
+    stHash *wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey,
+                                               free, (void(*)(void *))wiggleContainer_destruct);
+    stHash_insert(wigglePairHash, stString_copy("A-B"), wiggleContainer_construct("A", "B", 3, 20, 5));
+    stHash_insert(wigglePairHash, stString_copy("C-B"), wiggleContainer_construct("C", "B", 0, 29, 10));
+    return wigglePairHash;
+}
+static void test_enumerateHomologyResults_0(CuTest *testCase) {
+    // the interned, possibly threaded, tallies of enumerateHomologyResults() should match a brute
+    // force count and not depend upon the number of threads.
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction, (void(*)(void *)) aPair_destruct);
+    const char *seqs[] = {"A", "B", "C"};
+    for (uint64_t i = 0; i < 30; i += 3) {
+        for (uint64_t j = 0; j < 30; j += 2) {
+            stSortedSet_insert(pairs, aPair_construct(seqs[0], seqs[1], i, j));
+            stSortedSet_insert(pairs, aPair_construct(seqs[0], seqs[2], i, j + 1));
+            stSortedSet_insert(pairs, aPair_construct(seqs[1], seqs[2], j, i));
+        }
+    }
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    for (int i = 0; i < 3; ++i) {
+        stSet_insert(legitSequences, stString_copy(seqs[i]));
+    }
+    stSet *positivePairs = stSet_construct();
+    stSortedSetIterator *sit = stSortedSet_getIterator(pairs);
+    APair *p = NULL;
+    while ((p = stSortedSet_getNext(sit)) != NULL) {
+        if ((p->pos1 + p->pos2) % 3 == 0) {
+            stSet_insert(positivePairs, p);
+        }
+    }
+    stSortedSet_destructIterator(sit);
+    bedIndex_t *bedIndex = bed_newIndex();
+    bed_addInterval(bedIndex, "A", 0, 10);
+    bed_addInterval(bedIndex, "C", 5, 20);
+    bed_finalizeIndex(bedIndex);
+    stSortedSet *results[2];
+    stHash *wiggles[2];
+    uint64_t threads[] = {1, 4};
+    for (int t = 0; t < 2; ++t) {
+        results[t] = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly, (void(*)(void *)) aPair_destruct);
+        wiggles[t] = buildTestWigglePairHash();
+        enumerateHomologyResults(pairs, results[t], bedIndex, positivePairs, wiggles[t], true, 5,
+                                 legitSequences, threads[t]);
+        CuAssertTrue(testCase, stSortedSet_size(results[t]) == 3);
+    }
+    // brute force
+    ResultPair *rp = NULL;
+    sit = stSortedSet_getIterator(results[0]);
+    while ((rp = stSortedSet_getNext(sit)) != NULL) {
+        ResultPair *expected = resultPair_construct(rp->seq1, rp->seq2);
+        stSortedSetIterator *pit = stSortedSet_getIterator(pairs);
+        while ((p = stSortedSet_getNext(pit)) != NULL) {
+            if (strcmp(p->seq1, rp->seq1) != 0 || strcmp(p->seq2, rp->seq2) != 0) {
+                continue;
+            }
+            uint64_t found = (stSet_search(positivePairs, p) != NULL);
+            bool in1 = bed_contains(bedIndex, p->seq1, p->pos1);
+            bool in2 = bed_contains(bedIndex, p->seq2, p->pos2);
+            ++(expected->total);
+            expected->inAll += found;
+            if (in1 && in2) {
+                ++(expected->totalBoth);
+                expected->inBoth += found;
+            } else if (in1) {
+                ++(expected->totalA);
+                expected->inA += found;
+            } else if (in2) {
+                ++(expected->totalB);
+                expected->inB += found;
+            } else {
+                ++(expected->totalNeither);
+                expected->inNeither += found;
+            }
+        }
+        stSortedSet_destructIterator(pit);
+        ResultPair *threaded = stSortedSet_search(results[1], rp);
+        CuAssertTrue(testCase, threaded != NULL);
+        ResultPair *candidates[] = {rp, threaded};
+        for (int t = 0; t < 2; ++t) {
+            ResultPair *c = candidates[t];
+            CuAssertTrue(testCase, c->total == expected->total);
+            CuAssertTrue(testCase, c->inAll == expected->inAll);
+            CuAssertTrue(testCase, c->totalBoth == expected->totalBoth);
+            CuAssertTrue(testCase, c->inBoth == expected->inBoth);
+            CuAssertTrue(testCase, c->totalA == expected->totalA);
+            CuAssertTrue(testCase, c->inA == expected->inA);
+            CuAssertTrue(testCase, c->totalB == expected->totalB);
+            CuAssertTrue(testCase, c->inB == expected->inB);
+            CuAssertTrue(testCase, c->totalNeither == expected->totalNeither);
+            CuAssertTrue(testCase, c->inNeither == expected->inNeither);
+        }
+        resultPair_destruct(expected);
+    }
+    stSortedSet_destructIterator(sit);
+    // wiggles. A-B is indexed by the position in A (seq1), C-B by the position in C (seq2)
+    const char *keys[] = {"A-B", "C-B"};
+    for (int k = 0; k < 2; ++k) {
+        WiggleContainer *wc = stHash_search(wiggles[0], (void *) keys[k]);
+        WiggleContainer *wcThreaded = stHash_search(wiggles[1], (void *) keys[k]);
+        uint64_t *present = st_calloc(wc->numBins, sizeof(uint64_t));
+        uint64_t *absent = st_calloc(wc->numBins, sizeof(uint64_t));
+        stSortedSetIterator *pit = stSortedSet_getIterator(pairs);
+        while ((p = stSortedSet_getNext(pit)) != NULL) {
+            if (strcmp(p->seq1, (k == 0) ? "A" : "B") != 0 || strcmp(p->seq2, (k == 0) ? "B" : "C") != 0) {
+                continue;
+            }
+            uint64_t refPos = (k == 0) ? p->pos1 : p->pos2;
+            if (refPos < wc->refStart || refPos > wc->refStart + wc->refLength) {
+                continue;
+            }
+            uint64_t bin = (refPos - wc->refStart) / 5;
+            if (bin >= wc->numBins) {
+                continue;
+            }
+            if (stSet_search(positivePairs, p) != NULL) {
+                ++present[bin];
+            } else {
+                ++absent[bin];
+            }
+        }
+        stSortedSet_destructIterator(pit);
+        for (uint64_t b = 0; b < wc->numBins; ++b) {
+            CuAssertTrue(testCase, wc->presentAtoB[b] == present[b]);
+            CuAssertTrue(testCase, wc->absentAtoB[b] == absent[b]);
+            CuAssertTrue(testCase, wcThreaded->presentAtoB[b] == present[b]);
+            CuAssertTrue(testCase, wcThreaded->absentAtoB[b] == absent[b]);
+            CuAssertTrue(testCase, wc->presentBtoA[b] == 0);
+            CuAssertTrue(testCase, wcThreaded->absentBtoA[b] == 0);
+        }
+        free(present);
+        free(absent);
+    }
+    // clean up
+    for (int t = 0; t < 2; ++t) {
+        stSortedSet_destruct(results[t]);
+        stHash_destruct(wiggles[t]);
+    }
+    bed_destroyIndex(bedIndex);
+    stSet_destruct(positivePairs);
+    stSet_destruct(legitSequences);
+    stSortedSet_destruct(pairs);
+}
 CuSuite* comparatorAPI_TestSuite(void) {
     // listing the tests as void allows us to quickly comment out certain tests
     // when trying to isolate bugs highlighted by one particular test
@@ -417,6 +737,11 @@ CuSuite* comparatorAPI_TestSuite(void) {
     (void) test_columnSampling_timing_0;
     (void) test_mappingRoundTrip_0;
     (void) test_pairSortComparison_0;
+    (void) test_recordNearPair_0;
+    (void) test_runSampling_0;
+    (void) test_enumerateHomologyResults_0;
+    (void) test_regionPairCounting_0;
+    (void) test_parseRegion_0;
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_mappingMatrixToArray_0);
     SUITE_ADD_TEST(suite, test_mappingArrayToMatrix_0);
@@ -424,5 +749,10 @@ CuSuite* comparatorAPI_TestSuite(void) {
     SUITE_ADD_TEST(suite, test_pairCounting_0);
     SUITE_ADD_TEST(suite, test_chooseTwoValues_0);
     SUITE_ADD_TEST(suite, test_pairSortComparison_0);
+    SUITE_ADD_TEST(suite, test_recordNearPair_0);
+    SUITE_ADD_TEST(suite, test_runSampling_0);
+    SUITE_ADD_TEST(suite, test_enumerateHomologyResults_0);
+    SUITE_ADD_TEST(suite, test_regionPairCounting_0);
+    SUITE_ADD_TEST(suite, test_parseRegion_0);
     return suite;
 }
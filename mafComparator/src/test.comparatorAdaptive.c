@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CuTest.h"
+#include "common.h"
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorAdaptive.h"
+
+static void test_normalQuantileForLevel_0(CuTest *testCase) {
+    CuAssertDblEquals(testCase, 1.959964, normalQuantileForLevel(0.95), 1e-6);
+    CuAssertDblEquals(testCase, 2.575829, normalQuantileForLevel(0.99), 1e-6);
+    CuAssertDblEquals(testCase, 0.674490, normalQuantileForLevel(0.5), 1e-6);
+}
+static void test_wilsonInterval_0(CuTest *testCase) {
+    // values from the closed form, e.g. Newcombe (1998)
+    double lower, upper;
+    double z = normalQuantileForLevel(0.95);
+    wilsonInterval(5, 10, z, &lower, &upper);
+    CuAssertDblEquals(testCase, 0.236593, lower, 1e-6);
+    CuAssertDblEquals(testCase, 0.763407, upper, 1e-6);
+    wilsonInterval(0, 10, z, &lower, &upper);
+    CuAssertDblEquals(testCase, 0.0, lower, 1e-12);
+    CuAssertDblEquals(testCase, 0.277533, upper, 1e-6);
+    wilsonInterval(10, 10, z, &lower, &upper);
+    CuAssertDblEquals(testCase, 0.722467, lower, 1e-6);
+    CuAssertDblEquals(testCase, 1.0, upper, 1e-12);
+    wilsonInterval(0, 0, z, &lower, &upper);
+    CuAssertDblEquals(testCase, 0.0, lower, 1e-12);
+    CuAssertDblEquals(testCase, 1.0, upper, 1e-12);
+}
+static void test_wilsonSamplesNeeded_0(CuTest *testCase) {
+    // with no tests yet the estimate is 1/2, where the interval narrows as z / sqrt(n + z^2)
+    double z = normalQuantileForLevel(0.95);
+    double widths[] = {0.5, 0.1, 0.02, 0.001};
+    for (unsigned i = 0; i < sizeof(widths) / sizeof(*widths); ++i) {
+        double expected = z * z / (widths[i] * widths[i]) - z * z;
+        uint64_t n = wilsonSamplesNeeded(0, 0, z, widths[i]);
+        CuAssertTrue(testCase, n >= expected - 1e-6);
+        CuAssertTrue(testCase, n < expected + 1.0);
+    }
+    // a proportion estimated to be near 1 needs far fewer tests, and never more as the width grows
+    uint64_t previous = UINT64_MAX;
+    for (double w = 0.001; w < 0.5; w *= 1.5) {
+        uint64_t n = wilsonSamplesNeeded(990, 1000, z, w);
+        CuAssertTrue(testCase, n <= previous);
+        CuAssertTrue(testCase, n <= wilsonSamplesNeeded(0, 0, z, w));
+        previous = n;
+    }
+    // once the interval of the estimate is narrow enough no more tests are needed
+    double lower, upper;
+    uint64_t n = wilsonSamplesNeeded(9500, 10000, z, 0.02);
+    wilsonInterval(9500 * n / 10000, n, z, &lower, &upper);
+    CuAssertTrue(testCase, upper - lower <= 0.02 + 1e-3);
+    CuAssertTrue(testCase, n < 10000);
+}
+static ResultPair* newStratumResult(const char *seq1, const char *seq2, uint64_t numPairs, uint64_t tested,
+                                    uint64_t found, double z) {
+    ResultPair *rp = resultPair_construct(seq1, seq2);
+    rp->inAll = rp->inNeither = found;
+    rp->total = rp->totalNeither = tested;
+    setStratifiedEstimate(rp, numPairs, z);
+    return rp;
+}
+static void test_stratifiedInterval_0(CuTest *testCase) {
+    // a large pair of sequences mostly true and a small one mostly false, tested equally often.
+    // Pooling the counts would put the aggregate near 0.63, the pairs themselves put it near 0.9.
+    double z = normalQuantileForLevel(0.95);
+    double average, lower, upper;
+    stSortedSet *results = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction_seqsOnly,
+                                                  (void(*)(void *)) resultPair_destruct);
+    stSortedSet_insert(results, newStratumResult("a.chr1", "b.chr1", 1000000, 200, 180, z));
+    stSortedSet_insert(results, newStratumResult("a.chr1", "c.chr1", 100, 100, 10, z)); // exhaustive
+    ResultPair *all = aggregateResult(reportResults_fn, results, NULL, "", "");
+    CuAssertTrue(testCase, all->total == 300 && all->inAll == 190 && all->numStrata == 2);
+    stratifiedInterval(all, z, &average, &lower, &upper);
+    CuAssertDblEquals(testCase, (900000.0 + 10.0) / 1000100.0, average, 1e-9);
+    CuAssertTrue(testCase, lower < 0.9 && 0.9 < upper);
+    CuAssertTrue(testCase, 190.0 / 300.0 < lower);
+    // the exhaustive stratum adds no variance, so the interval is that of the large stratum, scaled
+    double halfWidth = (upper - lower) / 2.0;
+    double pAdjusted = (180.0 + z * z / 2.0) / (200.0 + z * z);
+    CuAssertDblEquals(testCase, z * sqrt(pAdjusted * (1.0 - pAdjusted) / (200.0 + z * z) * (1.0 - 200.0 / 1000000.0))
+                      * 1000000.0 / 1000100.0, halfWidth, 1e-9);
+    // a single stratum keeps its counts and its Wilson interval
+    ResultPair *small = stSortedSet_getLast(results);
+    double wilsonLower, wilsonUpper;
+    stratifiedInterval(small, z, &average, &lower, &upper);
+    wilsonInterval(10, 100, z, &wilsonLower, &wilsonUpper);
+    CuAssertDblEquals(testCase, 0.1, average, 1e-12);
+    CuAssertDblEquals(testCase, wilsonLower, lower, 1e-12);
+    CuAssertDblEquals(testCase, wilsonUpper, upper, 1e-12);
+    // and the report carries the stratified average
+    stSet *legit = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legit, stString_copy("a.chr1"));
+    stSet_insert(legit, stString_copy("b.chr1"));
+    stSet_insert(legit, stString_copy("c.chr1"));
+    FILE *f = tmpfile();
+    reportResults(results, "A.maf", "B.maf", f, 0, legit, NULL, 0.95);
+    long length = ftell(f);
+    rewind(f);
+    char *xml = st_calloc(length + 1, 1);
+    CuAssertTrue(testCase, fread(xml, 1, length, f) == (size_t) length);
+    fclose(f);
+    CuAssertTrue(testCase, strstr(xml, "totalTests=\"300\" totalTrue=\"190\" totalFalse=\"110\" average=\"0.899920\"") != NULL);
+    free(xml);
+    resultPair_destruct(all);
+    stSet_destruct(legit);
+    stSortedSet_destruct(results);
+}
+CuSuite* comparatorAdaptive_TestSuite(void) {
+    (void) test_normalQuantileForLevel_0;
+    (void) test_wilsonInterval_0;
+    (void) test_wilsonSamplesNeeded_0;
+    (void) test_stratifiedInterval_0;
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_normalQuantileForLevel_0);
+    SUITE_ADD_TEST(suite, test_wilsonInterval_0);
+    SUITE_ADD_TEST(suite, test_wilsonSamplesNeeded_0);
+    SUITE_ADD_TEST(suite, test_stratifiedInterval_0);
+    return suite;
+}
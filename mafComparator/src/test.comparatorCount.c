@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CuTest.h"
+#include "common.h"
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorCount.h"
+
+static const char *kCountTestMaf = "test.comparatorCount.maf";
+
+static void writeRandomMaf(const char *filename, uint64_t numBlocks, bool isHeaderSeparated) {
+    // blocks of random gapped rows, separated by varying numbers of blank and whitespace lines
+    static const char *names[] = {"hg19.chr1", "mm9.chr1", "rn4.chr2", "canFam2.chr3"};
+    FILE *fh = de_fopen(filename, "w");
+    fprintf(fh, "##maf version=1\n");
+    if (isHeaderSeparated) {
+        fprintf(fh, "\n");
+    }
+    for (uint64_t b = 0; b < numBlocks; ++b) {
+        fprintf(fh, "a score=0\n");
+        if (st_random() < 0.2) {
+            fprintf(fh, "# a comment within a block\n");
+        }
+        int64_t numRows = st_randomInt(1, 6);
+        int64_t length = st_randomInt(1, 40);
+        for (int64_t r = 0; r < numRows; ++r) {
+            char *seq = st_malloc(length + 1);
+            int64_t n = 0;
+            for (int64_t i = 0; i < length; ++i) {
+                seq[i] = (st_random() < 0.3) ? '-' : "ACGT"[st_randomInt(0, 4)];
+                n += (seq[i] != '-');
+            }
+            seq[length] = '\0';
+            fprintf(fh, "s %s %" PRIu64 " %" PRIi64 " + 1000000 %s\n",
+                    names[st_randomInt(0, 4)], b * 100, n, seq);
+            free(seq);
+        }
+        int64_t numBlank = st_randomInt(1, 4);
+        for (int64_t i = 0; i < numBlank; ++i) {
+            fprintf(fh, (st_random() < 0.5) ? "\n" : " \t\n");
+        }
+    }
+    fclose(fh);
+}
+static uint64_t countByChunks(const char *filename, stSet *legitSequences, uint64_t numChunks) {
+    uint64_t *offsets = splitMafAtBlocks(filename, numChunks);
+    uint64_t *chooseTwoArray = buildChooseTwoArray();
+    uint64_t counter = 0;
+    for (uint64_t i = 0; i < numChunks; ++i) {
+        counter += countPairsInMafRange(filename, legitSequences, offsets[i], offsets[i + 1],
+                                        chooseTwoArray);
+    }
+    free(chooseTwoArray);
+    free(offsets);
+    return counter;
+}
+static void test_splitMafAtBlocks_0(CuTest *testCase) {
+    // offsets run from 0 to the end of the file and every interior one starts a line
+    writeRandomMaf(kCountTestMaf, 200, true);
+    uint64_t size = 0;
+    FILE *fh = de_fopen(kCountTestMaf, "r");
+    fseek(fh, 0, SEEK_END);
+    size = (uint64_t) ftell(fh);
+    for (uint64_t numChunks = 1; numChunks < 20; ++numChunks) {
+        uint64_t *offsets = splitMafAtBlocks(kCountTestMaf, numChunks);
+        CuAssertTrue(testCase, offsets[0] == 0);
+        CuAssertTrue(testCase, offsets[numChunks] == size);
+        for (uint64_t i = 1; i < numChunks; ++i) {
+            CuAssertTrue(testCase, offsets[i - 1] <= offsets[i]);
+            if (offsets[i] < size) {
+                fseek(fh, (long) offsets[i] - 1, SEEK_SET);
+                CuAssertTrue(testCase, fgetc(fh) == '\n');
+            }
+        }
+        free(offsets);
+    }
+    fclose(fh);
+    remove(kCountTestMaf);
+}
+static void test_countPairsInMafRange_0(CuTest *testCase) {
+    // however the file is split the chunks sum to the count of the whole file
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legitSequences, stString_copy("hg19.chr1"));
+    stSet_insert(legitSequences, stString_copy("rn4.chr2"));
+    for (int trial = 0; trial < 4; ++trial) {
+        writeRandomMaf(kCountTestMaf, st_randomInt(1, 300), trial % 2 == 0);
+        uint64_t all = countPairsInMaf(kCountTestMaf, NULL);
+        uint64_t legit = countPairsInMaf(kCountTestMaf, legitSequences);
+        for (uint64_t numChunks = 1; numChunks < 24; ++numChunks) {
+            CuAssertTrue(testCase, countByChunks(kCountTestMaf, NULL, numChunks) == all);
+            CuAssertTrue(testCase, countByChunks(kCountTestMaf, legitSequences, numChunks) == legit);
+        }
+        CuAssertTrue(testCase, countPairsInMafThreaded(kCountTestMaf, NULL, 4) == all);
+    }
+    stSet_destruct(legitSequences);
+    remove(kCountTestMaf);
+}
+static void test_pairCountCache_0(CuTest *testCase) {
+    // counts are found for the file and legit set they were written for, and only while the
+    // file is unchanged
+    char *cacheName = stString_print("%s.pairs", kCountTestMaf);
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stSet_insert(legitSequences, stString_copy("mm9.chr1"));
+    uint64_t numPairs = 0;
+    writeRandomMaf(kCountTestMaf, 50, true);
+    remove(cacheName);
+    CuAssertTrue(testCase, !readPairCountCache(kCountTestMaf, NULL, &numPairs));
+    uint64_t all = countPairsInMafCached(kCountTestMaf, NULL, 1);
+    CuAssertTrue(testCase, all == countPairsInMaf(kCountTestMaf, NULL));
+    CuAssertTrue(testCase, readPairCountCache(kCountTestMaf, NULL, &numPairs));
+    CuAssertTrue(testCase, numPairs == all);
+    CuAssertTrue(testCase, !readPairCountCache(kCountTestMaf, legitSequences, &numPairs));
+    writePairCountCache(kCountTestMaf, legitSequences, 7);
+    CuAssertTrue(testCase, readPairCountCache(kCountTestMaf, legitSequences, &numPairs));
+    CuAssertTrue(testCase, numPairs == 7);
+    CuAssertTrue(testCase, readPairCountCache(kCountTestMaf, NULL, &numPairs));
+    CuAssertTrue(testCase, numPairs == all);
+    // the same number of bytes, likely within the same second, but not the same file
+    FILE *fh = de_fopen(kCountTestMaf, "r+");
+    fseek(fh, 0, SEEK_SET);
+    fprintf(fh, "##maf version=2\n");
+    fclose(fh);
+    CuAssertTrue(testCase, !readPairCountCache(kCountTestMaf, NULL, &numPairs));
+    CuAssertTrue(testCase, !readPairCountCache(kCountTestMaf, legitSequences, &numPairs));
+    stSet_destruct(legitSequences);
+    remove(kCountTestMaf);
+    remove(cacheName);
+    free(cacheName);
+}
+CuSuite* comparatorCount_TestSuite(void) {
+    (void) test_splitMafAtBlocks_0;
+    (void) test_countPairsInMafRange_0;
+    (void) test_pairCountCache_0;
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_splitMafAtBlocks_0);
+    SUITE_ADD_TEST(suite, test_countPairsInMafRange_0);
+    SUITE_ADD_TEST(suite, test_pairCountCache_0);
+    return suite;
+}
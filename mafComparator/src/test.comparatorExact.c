@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CuTest.h"
+#include "common.h"
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorExact.h"
+
+static uint64_t streamAll(ExactRuns *runs, ExactPair **out, uint64_t maxPairs) {
+    // returns the number of pairs streamed into *out, which has room for maxPairs
+    uint64_t n = 0;
+    *out = st_malloc(sizeof(**out) * (maxPairs + 1));
+    ExactPairStream *s = exactPairStream_construct(runs);
+    while (n <= maxPairs && exactPairStream_next(s, &((*out)[n]))) {
+        ++n;
+    }
+    exactPairStream_destruct(s);
+    return n;
+}
+static void checkExactRuns(CuTest *testCase, uint64_t memoryBytes, uint64_t numThreads,
+                           uint64_t numPairs, uint64_t minRuns, uint64_t maxRuns) {
+    // the stream of the runs should be the sorted, distinct, canonicalized pairs that were added
+    ExactRuns *runs = exactRuns_construct(".", memoryBytes, numThreads);
+    ExactPair *expected = st_malloc(sizeof(*expected) * numPairs);
+    for (uint64_t i = 0; i < numPairs; ++i) {
+        // small ranges so that there are plenty of duplicates
+        uint64_t seq1 = st_randomInt(0, 4), seq2 = st_randomInt(0, 4);
+        uint64_t pos1 = st_randomInt(0, 300), pos2 = st_randomInt(0, 300);
+        exactRuns_add(runs, seq1, pos1, seq2, pos2);
+        if (seq1 > seq2 || (seq1 == seq2 && pos1 > pos2)) {
+            expected[i] = (ExactPair) {pos2, pos1, seq2, seq1};
+        } else {
+            expected[i] = (ExactPair) {pos1, pos2, seq1, seq2};
+        }
+    }
+    exactRuns_finish(runs);
+    CuAssertTrue(testCase, exactRuns_getNumberOfRuns(runs) >= minRuns);
+    CuAssertTrue(testCase, exactRuns_getNumberOfRuns(runs) <= maxRuns);
+    qsort(expected, numPairs, sizeof(*expected), exactPair_cmp);
+    uint64_t numDistinct = 0;
+    for (uint64_t i = 0; i < numPairs; ++i) {
+        if (numDistinct == 0 || exactPair_cmp(&(expected[i]), &(expected[numDistinct - 1])) != 0) {
+            expected[numDistinct++] = expected[i];
+        }
+    }
+    for (int pass = 0; pass < 2; ++pass) {
+        // the runs may be streamed more than once
+        ExactPair *observed = NULL;
+        uint64_t n = streamAll(runs, &observed, numPairs);
+        CuAssertTrue(testCase, n == numDistinct);
+        for (uint64_t i = 0; i < n; ++i) {
+            CuAssertTrue(testCase, exactPair_cmp(&(observed[i]), &(expected[i])) == 0);
+            CuAssertTrue(testCase, observed[i].seq1 < observed[i].seq2 ||
+                         (observed[i].seq1 == observed[i].seq2 && observed[i].pos1 <= observed[i].pos2));
+        }
+        free(observed);
+    }
+    free(expected);
+    exactRuns_destruct(runs);
+}
+static void test_exactRuns_0(CuTest *testCase) {
+    // everything fits in memory, a single run
+    checkExactRuns(testCase, (uint64_t) 1 << 24, 1, 20000, 1, 1);
+}
+static void test_exactRuns_1(CuTest *testCase) {
+    // a minimal buffer forces enough runs that they are merged on the way
+    checkExactRuns(testCase, 0, 1, 300000, 2, 64);
+}
+static void test_exactRuns_2(CuTest *testCase) {
+    // buffers large enough to be sorted in slices by several threads
+    checkExactRuns(testCase, 200000 * sizeof(ExactPair), 4, 700000, 4, 4);
+}
+static void test_exactRuns_empty_0(CuTest *testCase) {
+    ExactRuns *runs = exactRuns_construct(".", 0, 1);
+    exactRuns_finish(runs);
+    ExactPair *observed = NULL;
+    CuAssertTrue(testCase, streamAll(runs, &observed, 0) == 0);
+    free(observed);
+    exactRuns_destruct(runs);
+}
+CuSuite* comparatorExact_TestSuite(void) {
+    (void) test_exactRuns_0;
+    (void) test_exactRuns_1;
+    (void) test_exactRuns_2;
+    (void) test_exactRuns_empty_0;
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_exactRuns_0);
+    SUITE_ADD_TEST(suite, test_exactRuns_1);
+    SUITE_ADD_TEST(suite, test_exactRuns_2);
+    SUITE_ADD_TEST(suite, test_exactRuns_empty_0);
+    return suite;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "CuTest.h"
+#include "common.h"
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorSampleFile.h"
+
+static const char *kSampleFileTestMaf = "test.comparatorSampleFile.maf.tmp";
+
+static void writeSampleFileTestMaf(void) {
+    // the samples files are tied to the maf they were sampled from, whose contents don't matter here
+    FILE *f = de_fopen(kSampleFileTestMaf, "w");
+    fprintf(f, "##maf version=1\n\na score=0\ns hg19.chr1 0 4 + 249250621 ACGT\n\n");
+    fclose(f);
+}
+
+static void test_sampleFileRoundTrip_0(CuTest *testCase) {
+    // pairs written to a samples file should come back identical, along with the
+    // header values and the legit sequences.
+    const char *filename = "test.comparatorSampleFile.tmp";
+    const char *names[] = {"hg19.chr1", "mm9.chr2", "canFam2.chr11", "rn4.chrX"};
+    uint64_t lengths[] = {249250621, 181748087, 75157539, 166650296};
+    stSet *legit = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stHash *lengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    for (uint64_t i = 0; i < 4; ++i) {
+        stSet_insert(legit, stString_copy(names[i]));
+        stHash_insert(lengthHash, stString_copy(names[i]), buildInt64(lengths[i]));
+    }
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction,
+                                                (void(*)(void *)) aPair_destruct);
+    for (uint64_t i = 0; i < 500; ++i) {
+        stSortedSet_insert(pairs, aPair_construct(names[st_randomInt(0, 4)], names[st_randomInt(0, 4)],
+                                                  st_randomInt(0, 1000000), st_randomInt(0, 1000000)));
+    }
+    writeSampleFileTestMaf();
+    writeSampledPairsFile(filename, kSampleFileTestMaf, pairs, legit, lengthHash, 1234, 500, 987654321);
+    stSet *legit2 = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stHash *lengthHash2 = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    uint64_t seed = 0, numberOfSamples = 0, numberOfPairs = 0;
+    stSortedSet *pairs2 = readSampledPairsFile(filename, kSampleFileTestMaf, legit2, lengthHash2, &seed,
+                                               &numberOfSamples, &numberOfPairs);
+    CuAssertTrue(testCase, seed == 1234);
+    CuAssertTrue(testCase, numberOfSamples == 500);
+    CuAssertTrue(testCase, numberOfPairs == 987654321);
+    CuAssertTrue(testCase, stSet_size(legit2) == 4);
+    for (uint64_t i = 0; i < 4; ++i) {
+        CuAssertTrue(testCase, stSet_search(legit2, (void *) names[i]) != NULL);
+        CuAssertTrue(testCase, *(int64_t *) stHash_search(lengthHash2, (void *) names[i]) == (int64_t) lengths[i]);
+    }
+    CuAssertTrue(testCase, stSortedSet_size(pairs) == stSortedSet_size(pairs2));
+    stSortedSetIterator *sit = stSortedSet_getIterator(pairs);
+    stSortedSetIterator *sit2 = stSortedSet_getIterator(pairs2);
+    APair *p = NULL, *p2 = NULL;
+    while ((p = stSortedSet_getNext(sit)) != NULL) {
+        p2 = stSortedSet_getNext(sit2);
+        CuAssertTrue(testCase, p2 != NULL);
+        CuAssertTrue(testCase, aPair_cmpFunction(p, p2) == 0);
+    }
+    CuAssertTrue(testCase, stSortedSet_getNext(sit2) == NULL);
+    // clean up
+    unlink(filename);
+    unlink(kSampleFileTestMaf);
+    stSortedSet_destructIterator(sit);
+    stSortedSet_destructIterator(sit2);
+    stSortedSet_destruct(pairs);
+    stSortedSet_destruct(pairs2);
+    stSet_destruct(legit);
+    stSet_destruct(legit2);
+    stHash_destruct(lengthHash);
+    stHash_destruct(lengthHash2);
+}
+static void test_sampleFileEmpty_0(CuTest *testCase) {
+    // an empty sample set is still a valid samples file
+    const char *filename = "test.comparatorSampleFile.tmp";
+    stSet *legit = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    stHash *lengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    stSortedSet *pairs = stSortedSet_construct3((int(*)(const void *, const void *)) aPair_cmpFunction,
+                                                (void(*)(void *)) aPair_destruct);
+    writeSampleFileTestMaf();
+    writeSampledPairsFile(filename, kSampleFileTestMaf, pairs, legit, lengthHash, 7, 10, 0);
+    uint64_t seed = 0, numberOfSamples = 0, numberOfPairs = 1;
+    stSortedSet *pairs2 = readSampledPairsFile(filename, kSampleFileTestMaf, legit, lengthHash, &seed,
+                                               &numberOfSamples, &numberOfPairs);
+    CuAssertTrue(testCase, seed == 7);
+    CuAssertTrue(testCase, numberOfSamples == 10);
+    CuAssertTrue(testCase, numberOfPairs == 0);
+    CuAssertTrue(testCase, stSortedSet_size(pairs2) == 0);
+    CuAssertTrue(testCase, stSet_size(legit) == 0);
+    // clean up
+    unlink(filename);
+    unlink(kSampleFileTestMaf);
+    stSortedSet_destruct(pairs);
+    stSortedSet_destruct(pairs2);
+    stSet_destruct(legit);
+    stHash_destruct(lengthHash);
+}
+CuSuite* comparatorSampleFile_TestSuite(void) {
+    (void) test_sampleFileRoundTrip_0;
+    (void) test_sampleFileEmpty_0;
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_sampleFileRoundTrip_0);
+    SUITE_ADD_TEST(suite, test_sampleFileEmpty_0);
+    return suite;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2009-2013 by
+ * Dent Earl (dearl@soe.ucsc.edu, dentearl@gmail.com)
+ * Benedict Paten (benedict@soe.ucsc.edu, benedictpaten@gmail.com)
+ * Mark Diekhans (markd@soe.ucsc.edu)
+ * ... and other members of the Reconstruction Team of David Haussler's
+ * lab (BME Dept. UCSC).
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+*/
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CuTest.h"
+#include "common.h"
+#include "sonLib.h"
+#include "comparatorAPI.h"
+#include "comparatorExact.h"
+#include "comparatorSpill.h"
+
+static const char *kSpillTestMafA = "test.comparatorSpill.a.maf";
+static const char *kSpillTestMafB = "test.comparatorSpill.b.maf";
+
+static void writeRow(FILE *fh, const char *name, uint64_t start, uint64_t n, char *row) {
+    fprintf(fh, "s %s %" PRIu64 " %" PRIu64 " + 1000000 %s\n", name, start, n, row);
+}
+static void writeRandomMafPair(uint64_t numBlocks) {
+    // two mafs of the same blocks, where the rows of the second are sometimes shuffled so that
+    // some of the pairs of the first are missing from it, or are only near their positions
+    static const char *names[] = {"hg19.chr1", "mm9.chr1", "rn4.chr2", "canFam2.chr3", "panTro2.chr1"};
+    uint64_t next[] = {0, 0, 0, 0, 0};
+    FILE *fhA = de_fopen(kSpillTestMafA, "w");
+    FILE *fhB = de_fopen(kSpillTestMafB, "w");
+    fprintf(fhA, "##maf version=1\n\n");
+    fprintf(fhB, "##maf version=1\n\n");
+    for (uint64_t b = 0; b < numBlocks; ++b) {
+        fprintf(fhA, "a score=0\n");
+        fprintf(fhB, "a score=0\n");
+        int64_t length = st_randomInt(1, 60);
+        char *row = st_malloc(length + 1);
+        for (int64_t s = 0; s < 5; ++s) {
+            if (st_random() < 0.3) {
+                continue;
+            }
+            uint64_t n = 0;
+            for (int64_t i = 0; i < length; ++i) {
+                row[i] = (st_random() < 0.2) ? '-' : 'A';
+                n += (row[i] != '-');
+            }
+            row[length] = '\0';
+            writeRow(fhA, names[s], next[s], n, row);
+            if (st_random() < 0.3) {
+                for (int64_t i = length - 1; i > 0; --i) {
+                    int64_t j = st_randomInt(0, i + 1);
+                    char t = row[i];
+                    row[i] = row[j];
+                    row[j] = t;
+                }
+            }
+            writeRow(fhB, names[s], next[s], n, row);
+            next[s] += n;
+        }
+        free(row);
+        fprintf(fhA, "\n");
+        fprintf(fhB, "\n");
+    }
+    fclose(fhA);
+    fclose(fhB);
+}
+static void checkSameResults(CuTest *testCase, stSortedSet *expected, stSortedSet *observed) {
+    CuAssertTrue(testCase, stSortedSet_size(expected) == stSortedSet_size(observed));
+    stSortedSetIterator *sit = stSortedSet_getIterator(expected);
+    ResultPair *e = NULL;
+    while ((e = stSortedSet_getNext(sit)) != NULL) {
+        ResultPair *o = stSortedSet_search(observed, e);
+        CuAssertTrue(testCase, o != NULL);
+        CuAssertTrue(testCase, e->total == o->total);
+        CuAssertTrue(testCase, e->inAll == o->inAll);
+        CuAssertTrue(testCase, e->totalNeither == o->totalNeither);
+        CuAssertTrue(testCase, e->inNeither == o->inNeither);
+        CuAssertTrue(testCase, e->totalBoth == o->totalBoth);
+        CuAssertTrue(testCase, e->inBoth == o->inBoth);
+        CuAssertTrue(testCase, e->totalA == o->totalA);
+        CuAssertTrue(testCase, e->inA == o->inA);
+        CuAssertTrue(testCase, e->totalB == o->totalB);
+        CuAssertTrue(testCase, e->inB == o->inB);
+    }
+    stSortedSet_destructIterator(sit);
+}
+static void checkSpilledComparison(CuTest *testCase, uint64_t near) {
+    // sampling into runs and testing in small batches should give exactly the sample and the
+    // results of doing it all in memory
+    writeRandomMafPair(400);
+    Options *options = options_construct();
+    options->numberOfSamples = 6000;
+    options->near = near;
+    options->tempDir = stString_copy(".");
+    stHash *sequenceLengthHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+    stSet *legitSequences = stSet_construct3(stHash_stringKey, stHash_stringEqualKey, free);
+    populateNames(kSpillTestMafA, legitSequences, sequenceLengthHash);
+    bedIndex_t *bedIndex = bed_newIndex();
+    bed_finalizeIndex(bedIndex);
+    stHash *wigglePairHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free,
+                                               (void(*)(void *)) wiggleContainer_destruct);
+    uint64_t numPairs = 0, numSpilledPairs = 0, numBatches = 0;
+    st_randomSeed(near + 1);
+    stSortedSet *pairs = sampleMafPairs(kSpillTestMafA, &numPairs, legitSequences, options, sequenceLengthHash);
+    st_randomSeed(near + 1);
+    ExactRuns *runs = sampleMafPairsToRuns(kSpillTestMafA, &numSpilledPairs, legitSequences, options,
+                                           sequenceLengthHash, 0);
+    CuAssertTrue(testCase, numPairs == numSpilledPairs);
+    CuAssertTrue(testCase, exactRuns_getNumberOfRuns(runs) > 1);
+    // the runs stream the sampled set in order
+    ExactPairStream *s = exactPairStream_construct(runs);
+    stSortedSetIterator *sit = stSortedSet_getIterator(pairs);
+    APair *pair = NULL;
+    ExactPair p;
+    uint64_t n = 0;
+    while ((pair = stSortedSet_getNext(sit)) != NULL) {
+        CuAssertTrue(testCase, exactPairStream_next(s, &p));
+        CuAssertTrue(testCase, pair->pos1 == p.pos1 && pair->pos2 == p.pos2);
+        ++n;
+    }
+    CuAssertTrue(testCase, !exactPairStream_next(s, &p));
+    CuAssertTrue(testCase, n > 3 * spill_getBatchLength(0));
+    stSortedSet_destructIterator(sit);
+    exactPairStream_destruct(s);
+    stSortedSet *expected = compareSampledPairs(pairs, kSpillTestMafB, legitSequences, bedIndex,
+                                                wigglePairHash, true, options);
+    stSortedSet *observed = compareSpilledPairs(runs, kSpillTestMafB, legitSequences, legitSequences, bedIndex,
+                                                wigglePairHash, true, options, 0, &numBatches);
+    CuAssertTrue(testCase, numBatches > 3);
+    checkSameResults(testCase, expected, observed);
+    // clean up
+    stSortedSet_destruct(expected);
+    stSortedSet_destruct(observed);
+    stSortedSet_destruct(pairs);
+    exactRuns_destruct(runs);
+    stHash_destruct(wigglePairHash);
+    bed_destroyIndex(bedIndex);
+    stSet_destruct(legitSequences);
+    stHash_destruct(sequenceLengthHash);
+    options_destruct(options);
+    remove(kSpillTestMafA);
+    remove(kSpillTestMafB);
+    remove("test.comparatorSpill.a.maf.pairs");
+}
+static void test_spilledComparison(CuTest *testCase) {
+    checkSpilledComparison(testCase, 0);
+}
+static void test_spilledComparison_near(CuTest *testCase) {
+    // pairs near the ends of each batch are tested along with it
+    checkSpilledComparison(testCase, 3);
+}
+CuSuite* comparatorSpill_TestSuite(void) {
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_spilledComparison);
+    SUITE_ADD_TEST(suite, test_spilledComparison_near);
+    return suite;
+}
@@ -248,7 +248,7 @@ knownValuesLegitFail = ['A:20,B:21', 'A:21,B:20', 'A:10,B:11', 'A:11,B:10', 'A:2
                         ]
 knownValuesNumberOfPairs = ['10,10', '10,10', '10,10', '5,5', '10,10',
                             '10,10', '60,60', '60,60', '45,60', '60,45',
-                            '60,60', '60,60', '13,13', '13,13'
+                            '60,60', '360,60', '13,13', '13,13'
                             ]
 knownValuesNumberOfPairsFail = ['100,10', '100,10', '10,100', '5,50', '100,10',
                                 '100,10', '60,600', '600,60', '450,60', '60,450',
@@ -848,6 +848,70 @@ class NumberOfPairsTest(unittest.TestCase):
             passed = mtt.noMemoryErrors(os.path.join(tmpDir, 'valgrind.xml'))
             self.assertTrue(passed)
         mtt.removeDir(tmpDir)
+    def test_stalePairsCache(self):
+        """ a wrong count in a FILE.pairs cache should be corrected rather than stop every later run
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('stalePairsCache'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        maf1, maf2, totalTrue, totalFalse = knownValues[6]
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), maf1, g_headers)
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), maf2, g_headers)
+        cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+               '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+               '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+               '--out', os.path.abspath(os.path.join(tmpDir, 'output.xml')),
+               '--samples=1000', '--logLevel=critical',
+               ]
+        mtt.recordCommands([cmd], tmpDir)
+        mtt.runCommandsS([cmd], tmpDir)
+        cache = os.path.join(tmpDir, 'maf1.maf.pairs')
+        def cachedCounts():
+            f = open(cache)
+            counts = [line.split()[-1] for line in f if not line.startswith('#')]
+            f.close()
+            return counts
+        self.assertEqual(['60'], cachedCounts())
+        # make the cache's count wrong, as if the maf had changed without its fingerprint changing
+        f = open(cache)
+        lines = f.readlines()
+        f.close()
+        f = open(cache, 'w')
+        for line in lines:
+            if not line.startswith('#'):
+                line = ' '.join(line.split()[:-1] + ['61']) + '\n'
+            f.write(line)
+        f.close()
+        mtt.runCommandsS([cmd], tmpDir)
+        self.assertEqual(totalTrue, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalTrue'))
+        self.assertEqual(totalFalse, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalFalse'))
+        self.assertEqual('60', ET.parse(os.path.join(tmpDir, 'output.xml')).getroot().attrib['numberOfPairsInMaf1'])
+        self.assertEqual(['60'], cachedCounts())
+        mtt.removeDir(tmpDir)
+    def test_noCache(self):
+        """ mafComparator --noCache should leave no FILE.pairs or FILE.mbi files beside the mafs
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('noCache'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        maf1, maf2, totalTrue, totalFalse = knownValues[6]
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), maf1, g_headers)
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), maf2, g_headers)
+        for args in [['--samples=1000'], ['--samples=1000', '--maxMemory=1'], ['--region', 'A:0-20']]:
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                   '--out', os.path.abspath(os.path.join(tmpDir, 'output.xml')),
+                   '--noCache', '--logLevel=critical',
+                   ] + args
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            if '--region' not in args:
+                self.assertEqual(totalTrue, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalTrue'))
+            for maf in ['maf1.maf', 'maf2.maf']:
+                for suffix in ['.pairs', '.mbi']:
+                    self.assertFalse(os.path.exists(os.path.join(tmpDir, maf + suffix)))
+        mtt.removeDir(tmpDir)
 
 class KnownValuesTest(unittest.TestCase):
     # knownValues contains quad-tuples,
@@ -1033,6 +1097,335 @@ class randomSeedTests(unittest.TestCase):
                 mtt.runCommandsS([cmd], tmpDir)
                 self.assertTrue(mtt.noMemoryErrors(os.path.join(tmpDir, 'valgrind.xml')))
         mtt.removeDir(tmpDir)
+class SampleFileTests(unittest.TestCase):
+    def test_writeReadSamples(self):
+        """ mafComparator should produce the same maf1 to maf2 results from a samples file as from sampling
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('sampleFile'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for maf1, maf2, totalTrue, totalFalse in knownValues:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                   '--out', os.path.abspath(os.path.join(tmpDir, 'output.xml')),
+                   '--writeSamples', os.path.abspath(os.path.join(tmpDir, 'samples.bin')),
+                   '--samples=1000', '--logLevel=critical',
+                   ]
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                   '--out', os.path.abspath(os.path.join(tmpDir, 'outputRead.xml')),
+                   '--readSamples', os.path.abspath(os.path.join(tmpDir, 'samples.bin')),
+                   '--logLevel=critical',
+                   ]
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            for out in ['output.xml', 'outputRead.xml']:
+                self.assertEqual(totalTrue, getAggregateResult(os.path.join(tmpDir, out), 'totalTrue'))
+                self.assertEqual(totalFalse, getAggregateResult(os.path.join(tmpDir, out), 'totalFalse'))
+            tree = ET.parse(os.path.join(tmpDir, 'output.xml'))
+            treeRead = ET.parse(os.path.join(tmpDir, 'outputRead.xml'))
+            for elm in ['seed', 'numberOfSamples', 'numberOfPairsInMaf1']:
+                self.assertEqual(tree.getroot().attrib[elm], treeRead.getroot().attrib[elm])
+        mtt.removeDir(tmpDir)
+    def test_batchMatchesReadSamples(self):
+        """ mafComparator batch reports (comma separated --maf2) should match single runs from the same samples file
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('sampleFileBatch'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for maf1, maf2, totalTrue, totalFalse in knownValues:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            predictions = ['maf2.maf', 'maf1.maf']
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', ','.join([os.path.abspath(os.path.join(tmpDir, p)) for p in predictions]),
+                   '--out', ','.join([os.path.abspath(os.path.join(tmpDir, 'batch_%d.xml' % i)) 
+                                      for i in xrange(len(predictions))]),
+                   '--writeSamples', os.path.abspath(os.path.join(tmpDir, 'samples.bin')),
+                   '--samples=1000', '--logLevel=critical',
+                   ]
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            self.assertEqual(totalTrue, getAggregateResult(os.path.join(tmpDir, 'batch_0.xml'), 'totalTrue'))
+            self.assertEqual(totalFalse, getAggregateResult(os.path.join(tmpDir, 'batch_0.xml'), 'totalFalse'))
+            for i, p in enumerate(predictions):
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                       '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                       '--maf2', os.path.abspath(os.path.join(tmpDir, p)),
+                       '--out', os.path.abspath(os.path.join(tmpDir, 'single_%d.xml' % i)),
+                       '--readSamples', os.path.abspath(os.path.join(tmpDir, 'samples.bin')),
+                       '--logLevel=critical',
+                       ]
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                f = open(os.path.join(tmpDir, 'batch_%d.xml' % i))
+                batch = f.read()
+                f.close()
+                f = open(os.path.join(tmpDir, 'single_%d.xml' % i))
+                single = f.read()
+                f.close()
+                self.assertEqual(batch, single)
+        mtt.removeDir(tmpDir)
+    def test_batchMissingSequence(self):
+        """ mafComparator batch reports should match single runs when one maf2 lacks a sequence of maf1
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('batchMissingSequence'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        mafs = {'maf1.maf': ('a score=0\n'
+                             's A.chr0 0 10 + 100 ACGTACGTAC\n'
+                             's B.chr0 0 10 + 100 ACGTACGTAC\n'
+                             's C.chr0 0 10 + 100 ACGTACGTAC\n\n'
+                             'a score=0\n'
+                             's A.chr0 10 10 + 100 ACGTACGTAC\n'
+                             's B.chr0 20 10 + 100 ACGTACGTAC\n\n'),
+                'maf2.maf': ('a score=0\n'
+                             's A.chr0 0 10 + 100 ACGTACGTAC\n'
+                             's B.chr0 0 10 + 100 ACGTACGTAC\n'
+                             's C.chr0 0 10 + 100 ACGTACGTAC\n\n'
+                             'a score=0\n'
+                             's A.chr0 10 10 + 100 ACGTACGTAC\n'
+                             's B.chr0 30 10 + 100 ACGTACGTAC\n\n'),
+                'maf3.maf': ('a score=0\n'
+                             's A.chr0 0 10 + 100 ACGTACGTAC\n'
+                             's B.chr0 0 10 + 100 ACGTACGTAC\n\n'
+                             'a score=0\n'
+                             's A.chr0 10 10 + 100 ACGTACGTAC\n'
+                             's B.chr0 20 10 + 100 ACGTACGTAC\n\n'),
+                }
+        for name in mafs:
+            mtt.testFile(os.path.abspath(os.path.join(tmpDir, name)), mafs[name], g_headers)
+        predictions = ['maf2.maf', 'maf3.maf']
+        for args in [[], ['--exact'], ['--maxMemory=1']]:
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', ','.join([os.path.abspath(os.path.join(tmpDir, p)) for p in predictions]),
+                   '--out', ','.join([os.path.abspath(os.path.join(tmpDir, 'batch_%d.xml' % i))
+                                      for i in xrange(len(predictions))]),
+                   '--samples=1000', '--seed=1', '--logLevel=critical',
+                   ] + args
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            for i, p in enumerate(predictions):
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                       '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                       '--maf2', os.path.abspath(os.path.join(tmpDir, p)),
+                       '--out', os.path.abspath(os.path.join(tmpDir, 'single_%d.xml' % i)),
+                       '--samples=1000', '--seed=1', '--logLevel=critical',
+                       ] + args
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                f = open(os.path.join(tmpDir, 'batch_%d.xml' % i))
+                batch = f.read()
+                f.close()
+                f = open(os.path.join(tmpDir, 'single_%d.xml' % i))
+                single = f.read()
+                f.close()
+                self.assertEqual(batch, single)
+            # maf3 lacks C.chr0, so only the 20 A.chr0-B.chr0 pairs of maf1 are tested in it
+            self.assertEqual(20, getAggregateResult(os.path.join(tmpDir, 'batch_1.xml'), 'totalTrue'))
+            self.assertEqual(0, getAggregateResult(os.path.join(tmpDir, 'batch_1.xml'), 'totalFalse'))
+            # while all 40 pairs of maf1 are tested in maf2, which moves the second B.chr0 row
+            self.assertEqual(30, getAggregateResult(os.path.join(tmpDir, 'batch_0.xml'), 'totalTrue'))
+            self.assertEqual(10, getAggregateResult(os.path.join(tmpDir, 'batch_0.xml'), 'totalFalse'))
+        mtt.removeDir(tmpDir)
+    def test_readSamplesOtherMaf2(self):
+        """ mafComparator --readSamples should match a fresh run against a maf2 lacking a sequence, and refuse a changed maf1
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('readSamplesOtherMaf2'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        maf1 = ('a score=0\n'
+                's A.chr0 0 10 + 100 ACGTACGTAC\n'
+                's B.chr0 0 10 + 100 ACGTACGTAC\n'
+                's C.chr0 0 10 + 100 ACGTACGTAC\n\n')
+        maf2 = ('a score=0\n'
+                's A.chr0 0 10 + 100 ACGTACGTAC\n'
+                's B.chr0 0 10 + 100 ACGTACGTAC\n\n')
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), maf1, g_headers)
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), maf2, g_headers)
+        def run(maf2Name, out, args):
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', os.path.abspath(os.path.join(tmpDir, maf2Name)),
+                   '--out', os.path.abspath(os.path.join(tmpDir, out)),
+                   '--logLevel=critical',
+                   ] + args
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir, errPipes=[subprocess.PIPE])
+        samples = os.path.abspath(os.path.join(tmpDir, 'samples.bin'))
+        # the samples are written against maf1 itself, which has every sequence
+        run('maf1.maf', 'self.xml', ['--samples=1000', '--seed=1', '--writeSamples', samples])
+        run('maf2.maf', 'fresh.xml', ['--samples=1000', '--seed=1'])
+        run('maf2.maf', 'read.xml', ['--readSamples', samples])
+        f = open(os.path.join(tmpDir, 'fresh.xml'))
+        fresh = f.read()
+        f.close()
+        f = open(os.path.join(tmpDir, 'read.xml'))
+        read = f.read()
+        f.close()
+        self.assertEqual(fresh, read)
+        self.assertEqual(10, getAggregateResult(os.path.join(tmpDir, 'read.xml'), 'totalTests'))
+        # a maf1 that has changed since the samples were written is refused
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), maf1.replace('C.chr0', 'D.chr0'),
+                     g_headers)
+        passed = False
+        try:
+            run('maf2.maf', 'changed.xml', ['--readSamples', samples])
+        except RuntimeError:
+            passed = True
+        self.assertTrue(passed)
+        mtt.removeDir(tmpDir)
+    def test_exactKnownValues(self):
+        """ mafComparator --exact should return the hand-calculable results, whatever the sort memory and threads
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('exact'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for maf1, maf2, totalTrue, totalFalse in knownValues:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            for threads in ['1', '3']:
+                cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                       '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                       '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                       '--out', os.path.abspath(os.path.join(tmpDir, 'output.xml')),
+                       '--exact', '--sortMemory=1', '--threads=%s' % threads,
+                       '--tempDir', tmpDir, '--logLevel=critical',
+                       ]
+                mtt.recordCommands([cmd], tmpDir)
+                mtt.runCommandsS([cmd], tmpDir)
+                self.assertEqual(totalTrue, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalTrue'))
+                self.assertEqual(totalFalse, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalFalse'))
+        mtt.removeDir(tmpDir)
+    def test_ciWidthKnownValues(self):
+        """ mafComparator --ciWidth should test every pair of small alignments and report intervals around the averages
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('ciWidth'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        for maf1, maf2, totalTrue, totalFalse in knownValues:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                   '--out', os.path.abspath(os.path.join(tmpDir, 'output.xml')),
+                   '--ciWidth=0.001', '--samples=10000000', '--logLevel=critical',
+                   ]
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            self.assertEqual(totalTrue, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalTrue'))
+            self.assertEqual(totalFalse, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalFalse'))
+            tree = ET.parse(os.path.join(tmpDir, 'output.xml'))
+            for homTests in tree.findall('homologyTests'):
+                for homTest in homTests.find('homologyPairTests').findall('homologyTest'):
+                    a = homTest.find('aggregateResults').find('all').attrib
+                    self.assertTrue(float(a['ciLower']) <= float(a['average']) <= float(a['ciUpper']))
+        mtt.removeDir(tmpDir)
+    def test_ciWidthFail(self):
+        """ mafComparator --ciWidth should refuse --bedFiles and --wigglePairs, whose counts it can't weight
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('ciWidthFail'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        maf1, maf2, totalTrue, totalFalse = knownValues[0]
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), maf1, g_headers)
+        mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), maf2, g_headers)
+        f = open(os.path.join(tmpDir, 'regions.bed'), 'w')
+        f.write('target.chr0\t0\t10\n')
+        f.close()
+        for args in [['--bedFiles', os.path.abspath(os.path.join(tmpDir, 'regions.bed'))],
+                     ['--wigglePairs', 'target.chr0:*']]:
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                   '--out', os.path.abspath(os.path.join(tmpDir, 'output.xml')),
+                   '--ciWidth=0.01', '--logLevel=critical',
+                   ] + args
+            mtt.recordCommands([cmd], tmpDir)
+            passed = False
+            try:
+                mtt.runCommandsS([cmd], tmpDir, errPipes=[subprocess.PIPE])
+            except RuntimeError:
+                passed = True
+            self.assertTrue(passed)
+        mtt.removeDir(tmpDir)
+    def test_regionKnownValues(self):
+        """ mafComparator --region should compare only the pairs with a member in the region
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('region'))
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        # regions covering every sequence give the whole file results
+        for maf1, maf2, totalTrue, totalFalse in knownValues:
+            testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), 
+                                    maf1, g_headers)
+            testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), 
+                                    maf2, g_headers)
+            names = set([line.split()[1] for line in (maf1 + maf2).split('\n') if line.startswith('s')])
+            f = open(os.path.join(tmpDir, 'regions.bed'), 'w')
+            for name in names:
+                f.write('%s\t0\t1000000000\n' % name)
+            f.close()
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                   '--out', os.path.abspath(os.path.join(tmpDir, 'output.xml')),
+                   '--regionBed', os.path.abspath(os.path.join(tmpDir, 'regions.bed')),
+                   '--samples=1000', '--logLevel=critical',
+                   ]
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            self.assertEqual(totalTrue, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalTrue'))
+            self.assertEqual(totalFalse, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalFalse'))
+        # only the first block of maf1 is in maf2
+        maf1 = '''a score=0
+s A 0 10 + 20 ACGTACGTAC
+s B 0 10 + 20 ACGTACGTAC
+
+a score=0
+s A 10 10 + 20 ACGTACGTAC
+s B 10 10 + 20 ACGTACGTAC
+
+'''
+        maf2 = '''a score=0
+s A 0 10 + 20 ACGTACGTAC
+s B 0 10 + 20 ACGTACGTAC
+
+'''
+        testMaf1 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf1.maf')), maf1, g_headers)
+        testMaf2 = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'maf2.maf')), maf2, g_headers)
+        for region, totalTrue, totalFalse in [(None, 10, 10), ('A:0-10', 10, 0), ('B:10-20', 0, 10),
+                                              ('A:5-15', 5, 5)]:
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafComparator')),
+                   '--maf1', os.path.abspath(os.path.join(tmpDir, 'maf1.maf')),
+                   '--maf2', os.path.abspath(os.path.join(tmpDir, 'maf2.maf')),
+                   '--out', os.path.abspath(os.path.join(tmpDir, 'output.xml')),
+                   '--samples=1000', '--logLevel=critical',
+                   ]
+            if region is not None:
+                cmd.append('--region=%s' % region)
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            self.assertEqual(totalTrue, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalTrue'))
+            self.assertEqual(totalFalse, getAggregateResult(os.path.join(tmpDir, 'output.xml'), 'totalFalse'))
+        mtt.removeDir(tmpDir)
 class NearTests(unittest.TestCase):
     def test_nearSimple(self):
         """ mafComparator should return correct results for hand-calculable problems that use the --near=0 option
@@ -149,12 +149,14 @@ int64_t getTotalLengthOfSequences(stHash *sequenceNamesToSequenceSizes) {
 struct _pairwiseCoverage {
     stHash *sequenceCoverages; //A hash of sequence names to char arrays describing the coverage of each base of the given species.
     const stHash *sequenceNamesToSequenceSizeForGivenSpecies; //A hash of sequence names to their lengths, memory not owned by the object.
+    double *nCoverages; //The n-coverages, or NULL if a coverage array may have changed since they were calculated.
 };
 
 PairwiseCoverage *pairwiseCoverage_construct(const stHash *sequenceNamesToSequenceSizeForGivenSpecies) {
     PairwiseCoverage *pC = st_malloc(sizeof(PairwiseCoverage));
     pC->sequenceCoverages = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
     pC->sequenceNamesToSequenceSizeForGivenSpecies = sequenceNamesToSequenceSizeForGivenSpecies;
+    pC->nCoverages = NULL;
     //Now build the sequence coverage arrays.
     stHashIterator *it = stHash_getIterator((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies);
     char *sequenceName;
@@ -168,12 +170,16 @@ PairwiseCoverage *pairwiseCoverage_construct(const stHash *sequenceNamesToSequen
 
 void pairwiseCoverage_destruct(PairwiseCoverage *pC) {
     stHash_destruct(pC->sequenceCoverages);
+    free(pC->nCoverages);
     free(pC);
 }
 
 char *pairwiseCoverage_getCoverageArrayForSequence(PairwiseCoverage *pC, char *sequenceName) {
     char *sequenceCoverageArray = stHash_search(pC->sequenceCoverages, sequenceName);
     assert(sequenceCoverageArray != NULL);
+    //The caller may increase the coverage, so the n-coverages must be recalculated.
+    free(pC->nCoverages);
+    pC->nCoverages = NULL;
     return sequenceCoverageArray;
 }
 
@@ -186,32 +192,57 @@ bool pairwiseCoverageArray_increase(char *sequenceCoverageArray, int64_t positio
     return 0;
 }
 
+static void addToCoverageHistogram(const char *chromosomeCoverage, int64_t chromosomeLength, uint64_t *histogram) {
+    //Counts each coverage value of the chromosome. Successive bases are counted in separate
+    //histograms so that runs of the same value do not wait on the previous increment.
+    uint64_t counts[4][SCHAR_MAX + 1];
+    memset(counts, 0, sizeof(counts));
+    const unsigned char *c = (const unsigned char *) chromosomeCoverage;
+    int64_t i = 0;
+    for (; i + 4 <= chromosomeLength; i += 4) {
+        counts[0][c[i]]++;
+        counts[1][c[i + 1]]++;
+        counts[2][c[i + 2]]++;
+        counts[3][c[i + 3]]++;
+    }
+    for (; i < chromosomeLength; i++) {
+        counts[0][c[i]]++;
+    }
+    for (int64_t j = 0; j <= SCHAR_MAX; j++) {
+        histogram[j] += counts[0][j] + counts[1][j] + counts[2][j] + counts[3][j];
+    }
+}
+
 double *pairwiseCoverage_calculateNCoverages(PairwiseCoverage *pC) {
-    stHashIterator *it = stHash_getIterator((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies);
-    double *nCoverages = st_calloc(SCHAR_MAX + 1, sizeof(double));
-    char *sequenceName;
-    while ((sequenceName = stHash_getNext(it)) != NULL) {
-        int64_t chromosomeLength = stIntTuple_get(stHash_search((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies, sequenceName), 0);
-        char *chromosomeCoverage = stHash_search(pC->sequenceCoverages, sequenceName);
-        for (int64_t i = 0; i < chromosomeLength; i++) {
-            for (int64_t j = chromosomeCoverage[i]; j >= 0; j--) {
-                nCoverages[j]++;
-            }
+    if (pC->nCoverages == NULL) {
+        //A base with coverage c counts towards every n-coverage up to c, so the n-coverages
+        //are the suffix sums of the histogram of coverage values.
+        uint64_t histogram[SCHAR_MAX + 1];
+        memset(histogram, 0, sizeof(histogram));
+        stHashIterator *it = stHash_getIterator((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies);
+        char *sequenceName;
+        while ((sequenceName = stHash_getNext(it)) != NULL) {
+            int64_t chromosomeLength = stIntTuple_get(stHash_search((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies, sequenceName), 0);
+            char *chromosomeCoverage = stHash_search(pC->sequenceCoverages, sequenceName);
+            addToCoverageHistogram(chromosomeCoverage, chromosomeLength, histogram);
+        }
+        stHash_destructIterator(it);
+        int64_t genomeLength = getTotalLengthOfSequences((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies);
+        pC->nCoverages = st_malloc((SCHAR_MAX + 1) * sizeof(double));
+        uint64_t atLeast = 0;
+        for (int64_t i = SCHAR_MAX; i >= 0; i--) {
+            atLeast += histogram[i];
+            pC->nCoverages[i] = (double) atLeast / genomeLength;
         }
     }
-    stHash_destructIterator(it);
-    int64_t genomeLength = getTotalLengthOfSequences((stHash *)pC->sequenceNamesToSequenceSizeForGivenSpecies);
-    for (int64_t i = 0; i <= SCHAR_MAX; i++) {
-        nCoverages[i] /= genomeLength;
-    }
+    double *nCoverages = st_malloc((SCHAR_MAX + 1) * sizeof(double));
+    memcpy(nCoverages, pC->nCoverages, (SCHAR_MAX + 1) * sizeof(double));
     return nCoverages;
 }
 
 double pairwiseCoverage_calculateCoverage(PairwiseCoverage *pC) {
-    double *nCoverages = pairwiseCoverage_calculateNCoverages(pC);
-    double coverage = nCoverages[1];
-    free(nCoverages);
-    return coverage;
+    free(pairwiseCoverage_calculateNCoverages(pC));
+    return pC->nCoverages[1];
 }
 
 /*
@@ -77,7 +77,8 @@ void pairwiseCoverage_destruct(PairwiseCoverage *pC);
 double pairwiseCoverage_calculateCoverage(PairwiseCoverage *pC);
 
 /*
- * Returns an array of the n-coverages upto but excluding 128, with the index corresponding to n.
+ * Returns an array of the n-coverages upto but excluding 128, with the index corresponding to n. The array is
+ * the caller's to free. The n-coverages are kept until a coverage array is next asked for, so asking again is cheap.
  */
 double *pairwiseCoverage_calculateNCoverages(PairwiseCoverage *pC);
 
@@ -140,6 +140,108 @@ static void test_pairwiseCoverage(CuTest *testCase) {
     teardown();
 }
 
+static void addMafToPairwiseCoverage(const char *filename, PairwiseCoverage *pC) {
+    //Covers each bat base by every other row its column aligns to it, as nGenomeCoverage_populate() does.
+    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    mafBlock_t *mb = NULL;
+    while ((mb = maf_readBlock(mfa)) != NULL) {
+        for (mafLine_t *qML = maf_mafBlock_getHeadLine(mb); qML != NULL; qML = maf_mafLine_getNext(qML)) {
+            if (maf_mafLine_getType(qML) != 's' || strncmp(maf_mafLine_getSpecies(qML), "bat.", 4) != 0) {
+                continue;
+            }
+            for (mafLine_t *tML = maf_mafBlock_getHeadLine(mb); tML != NULL; tML = maf_mafLine_getNext(tML)) {
+                if (maf_mafLine_getType(tML) != 's' || tML == qML) {
+                    continue;
+                }
+                char *coverageArray = pairwiseCoverage_getCoverageArrayForSequence(pC, maf_mafLine_getSpecies(qML));
+                char *q = maf_mafLine_getSequence(qML), *t = maf_mafLine_getSequence(tML);
+                int64_t position = maf_mafLine_getPositiveCoord(qML);
+                for (int64_t k = 0; q[k] != '\0'; k++) {
+                    if (q[k] != '-') {
+                        if (t[k] != '-') {
+                            pairwiseCoverageArray_increase(coverageArray, position);
+                        }
+                        position += maf_mafLine_getStrand(qML) == '+' ? 1 : -1;
+                    }
+                }
+            }
+        }
+        maf_destroyMafBlockList(mb);
+    }
+    maf_destroyMfa(mfa);
+}
+
+static void checkNCoveragesPerPosition(CuTest *testCase, PairwiseCoverage *pC, stHash *sequenceSizes) {
+    //The n-coverages counted position by position, n by n, as they were before the histogram.
+    double expected[SCHAR_MAX + 1];
+    memset(expected, 0, sizeof(expected));
+    int64_t genomeLength = getTotalLengthOfSequences(sequenceSizes);
+    stHashIterator *it = stHash_getIterator(sequenceSizes);
+    char *sequenceName;
+    while ((sequenceName = stHash_getNext(it)) != NULL) {
+        int64_t length = stIntTuple_get(stHash_search(sequenceSizes, sequenceName), 0);
+        char *coverageArray = pairwiseCoverage_getCoverageArrayForSequence(pC, sequenceName);
+        for (int64_t i = 0; i < length; i++) {
+            for (int64_t n = 0; n <= coverageArray[i]; n++) {
+                expected[n] += 1.0 / genomeLength;
+            }
+        }
+    }
+    stHash_destructIterator(it);
+    //Twice, the second from the kept n-coverages.
+    for (int64_t j = 0; j < 2; j++) {
+        double *nCoverages = pairwiseCoverage_calculateNCoverages(pC);
+        for (int64_t n = 0; n <= SCHAR_MAX; n++) {
+            CuAssertDblEquals(testCase, expected[n], nCoverages[n], 1e-9);
+        }
+        free(nCoverages);
+    }
+    CuAssertDblEquals(testCase, expected[1], pairwiseCoverage_calculateCoverage(pC), 1e-9);
+}
+
+static void test_pairwiseCoverage_perPosition(CuTest *testCase) {
+    //The histogram of a small maf, with lengths that are not a multiple of the four counts
+    //and a saturated position, gives the n-coverages of the per position count.
+    const char *filename = "test.mafCoverageAPI.maf";
+    FILE *f = de_fopen(filename, "w");
+    fprintf(f, "##maf version=1\n\n"
+            "a score=0\n"
+            "s bat.man      0 10 + 50 ACGTACGTAC\n"
+            "s spider.man   0  1 + 1  ---A------\n"
+            "s danger.mouse 2 10 + 12 ACGTACGTAC\n"
+            "s penfold      0  9 + 12 ACG-ACGTAC\n"
+            "\n"
+            "a score=0\n"
+            "s bat.fink     0  7 - 7  ACG-TACG\n"
+            "s bat.man     45  5 + 50 A-C-G-TA\n"
+            "s penfold      3  5 + 12 ACGT---A\n"
+            "\n");
+    fclose(f);
+    stHash *sequenceSizes = getMapOfSequenceNamesToSizesFromMaf((char *) filename);
+    stHash *batSizes = getMapOfSequenceNamesToSequenceSizesForGivenSpeciesOrChr(sequenceSizes, "bat", 0);
+    PairwiseCoverage *pC = pairwiseCoverage_construct(batSizes);
+    addMafToPairwiseCoverage(filename, pC);
+    char *coverageArray = pairwiseCoverage_getCoverageArrayForSequence(pC, "bat.man");
+    for (int64_t i = 0; i < 2 * SCHAR_MAX; i++) {
+        pairwiseCoverageArray_increase(coverageArray, 49);
+    }
+    checkNCoveragesPerPosition(testCase, pC, batSizes);
+    double before = pairwiseCoverage_calculateCoverage(pC);
+
+    //Asking for a coverage array drops the kept n-coverages, so covering more is counted.
+    addMafToPairwiseCoverage(filename, pC);
+    coverageArray = pairwiseCoverage_getCoverageArrayForSequence(pC, "bat.man");
+    pairwiseCoverageArray_increase(coverageArray, 20);
+    pairwiseCoverageArray_increase(coverageArray, 20);
+    checkNCoveragesPerPosition(testCase, pC, batSizes);
+    CuAssertTrue(testCase, pairwiseCoverage_calculateCoverage(pC) > before);
+
+    pairwiseCoverage_destruct(pC);
+    stHash_destruct(batSizes);
+    stHash_destruct(sequenceSizes);
+    remove(filename);
+}
+
 static void test_nGenomeCoverage(CuTest *testCase) {
     setup();
     //Just build a single nGenomeCoverage and check the report functions work as expected.
@@ -160,6 +262,7 @@ CuSuite* coverage_TestSuite(void) {
     SUITE_ADD_TEST(suite, test_getMapOfSequenceNamesToSequenceSizesForGivenSpecies);
     SUITE_ADD_TEST(suite, test_getTotalLengthOfSequences);
     SUITE_ADD_TEST(suite, test_pairwiseCoverage);
+    SUITE_ADD_TEST(suite, test_pairwiseCoverage_perPosition);
     SUITE_ADD_TEST(suite, test_nGenomeCoverage);
     return suite;
 }
@@ -37,7 +37,7 @@
 #include "buildVersion.h"
 
 const char *g_version = "version 0.1 May 2013";
-uint64_t getRegionSize(char *seq1, stHash *intervalsHash);
+uint64_t getRegionSize(char *seq1, bedIndex_t *bedIndex);
 
 void version(void) {
   fprintf(stderr, "mafPairCoverage, %s\nbuild: %s, %s, %s\n\n", g_version,
@@ -81,7 +81,7 @@ void usage(void) {
 
 
 void parseOptions(int argc, char **argv, char *filename, char *seq1Name,
-                  char *seq2Name, stHash *intervalsHash, int64_t *bin_start,
+                  char *seq2Name, bedIndex_t *bedIndex, int64_t *bin_start,
                   int64_t *bin_end, int64_t *bin_length) {
   extern int g_debug_flag;
   extern int g_verbose_flag;
@@ -120,7 +120,7 @@ void parseOptions(int argc, char **argv, char *filename, char *seq1Name,
         version();
         exit(EXIT_SUCCESS);
       } else if (strcmp("bed", longOptions[longIndex].name) == 0) {
-        parseBedFile(optarg, intervalsHash);
+        bed_readFile(bedIndex, optarg);
       } else if (strcmp("bin_start", longOptions[longIndex].name) == 0) {
         i = sscanf(optarg, "%" PRIi64, bin_start);
         assert(i == 1);
@@ -167,36 +167,28 @@ void parseOptions(int argc, char **argv, char *filename, char *seq1Name,
   }
 }
 
-uint64_t getRegionSize(char *seq1, stHash *intervalsHash) {
-  // go through intervalsHash and see if seq1 matches any of the keys we pull
+uint64_t getRegionSize(char *seq1, bedIndex_t *bedIndex) {
+  // go through the bed index and see if seq1 matches any of the sequences we pull
   // out. if so, add up the size
   uint64_t n = 0;
-  stHashIterator *hit = stHash_getIterator(intervalsHash);
-  char *key = NULL;
-  while ((key = stHash_getNext(hit)) != NULL) {
-    stSortedSetIterator *sit = NULL;
-    if (!searchMatched_(key, seq1)) {
+  for (uint64_t i = 0; i < bed_getNumberOfSequences(bedIndex); ++i) {
+    bedIntervals_t *bis = bed_getIntervalsByIndex(bedIndex, i);
+    if (!searchMatched_(bed_intervals_getName(bis), seq1)) {
       continue;
     }
-    sit = stSortedSet_getIterator(stHash_search(intervalsHash, key));
-    stIntTuple *inttup = NULL;
-    while ((inttup = stSortedSet_getNext(sit)) != NULL) {
-      n += stIntTuple_get(inttup, 1)  - stIntTuple_get(inttup, 0);
-    }
-    stSortedSet_destructIterator(sit);
+    n += bed_intervals_getTotalLength(bis);
   }
-  stHash_destructIterator(hit);
   return n;
 }
 
 
 void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
                          stHash *seq2Hash, uint64_t *alignedPositions,
-                         stHash *intervalsHash) {
+                         bedIndex_t *bedIndex) {
   /*
    * If there are results within the intervals hash, report those
    */
-  if (stHash_size(intervalsHash) == 0) {
+  if (bed_getNumberOfSequences(bedIndex) == 0) {
     return;
   }
   uint64_t tot1 = 0, tot1in = 0, tot1out = 0;
@@ -207,7 +199,7 @@ void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
   if (stHash_size(seq1Hash) > 0) {
     hit = stHash_getIterator(seq1Hash);
     while ((key = stHash_getNext(hit)) != NULL) {
-      tot1 += getRegionSize(key, intervalsHash);
+      tot1 += getRegionSize(key, bedIndex);
       tot1in += mafCoverageCount_getInRegion(stHash_search(seq1Hash, key));
       tot1out += mafCoverageCount_getOutRegion(stHash_search(seq1Hash, key));
     }
@@ -230,7 +222,7 @@ void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
   if (stHash_size(seq1Hash) > 0) {
     hit = stHash_getIterator(seq1Hash);
     while ((key = stHash_getNext(hit)) != NULL) {
-      if (stHash_search(intervalsHash, key) == NULL) {
+      if (bed_getIntervals(bedIndex, key) == NULL) {
         // don't report sequences that do not show up in the bed region file
         continue;
       }
@@ -238,10 +230,10 @@ void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
         cov1in = 0;
       } else {
         cov1in = (double) mafCoverageCount_getInRegion(stHash_search(seq1Hash, key)) /
-          (double) getRegionSize(key, intervalsHash);
+          (double) getRegionSize(key, bedIndex);
       }
       printf("%20s\t%15" PRIu64 "\t%15" PRIu64 "\t%15" PRIu64 "\t%15e\n",
-             key, getRegionSize(key, intervalsHash),
+             key, getRegionSize(key, bedIndex),
              mafCoverageCount_getInRegion(stHash_search(seq1Hash, key)),
              mafCoverageCount_getOutRegion(stHash_search(seq1Hash, key)),
              cov1in);
@@ -252,7 +244,7 @@ void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
   if (stHash_size(seq2Hash) > 0) {
     hit = stHash_getIterator(seq2Hash);
     while ((key = stHash_getNext(hit)) != NULL) {
-      if (stHash_search(intervalsHash, key) == NULL) {
+      if (bed_getIntervals(bedIndex, key) == NULL) {
         // don't report sequences that do not show up in the bed region file
         continue;
       }
@@ -260,11 +252,11 @@ void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
         cov1in = 0;
       } else {
         cov1in = (double) mafCoverageCount_getInRegion(stHash_search(seq2Hash, key)) /
-          (double) getRegionSize(key, intervalsHash);
+          (double) getRegionSize(key, bedIndex);
 
       }
       printf("%20s\t%15" PRIu64 "\t%15" PRIu64 "\t%15" PRIu64 "\t%15e\n",
-             key, getRegionSize(key, intervalsHash),
+             key, getRegionSize(key, bedIndex),
              mafCoverageCount_getInRegion(stHash_search(seq2Hash, key)),
              mafCoverageCount_getOutRegion(stHash_search(seq2Hash, key)),
              cov1in);
@@ -390,12 +382,10 @@ int main(int argc, char **argv) {
   int64_t bin_end = -1;  // sentinel value. real values > 0
   int64_t bin_length = 1000;
   BinContainer *bin_container = NULL;
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey, free,
-                                            (void(*)(void *))
-                                            stSortedSet_destruct);
-  parseOptions(argc, argv, filename, seq1, seq2, intervalsHash,
+  bedIndex_t *bedIndex = bed_newIndex();
+  parseOptions(argc, argv, filename, seq1, seq2, bedIndex,
                &bin_start, &bin_end, &bin_length);
+  bed_finalizeIndex(bedIndex);
   if ((bin_start != -1) && (bin_end != -1) && (bin_length > 0)) {
     bin_container = binContainer_construct(bin_start, bin_end,
                                                          bin_length);
@@ -414,15 +404,15 @@ int main(int argc, char **argv) {
                                        free, free);
   uint64_t alignedPositions = 0;
   processBody(mfa, seq1, seq2, seq1Hash, seq2Hash, &alignedPositions,
-              intervalsHash, bin_container);
+              bedIndex, bin_container);
   reportResults(seq1, seq2, seq1Hash, seq2Hash, &alignedPositions);
   reportResultsRegion(seq1, seq2, seq1Hash, seq2Hash, &alignedPositions,
-                      intervalsHash);
+                      bedIndex);
   reportResultsBins(seq1, seq2, bin_container);
   maf_destroyMfa(mfa);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bin_container);
   return EXIT_SUCCESS;
 }
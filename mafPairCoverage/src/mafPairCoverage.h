@@ -29,17 +29,18 @@
 #include <stdint.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "bedIndex.h"
 #include "sonLib.h"
 
 void version(void);
 void usage(void);
 void parseOptions(int argc, char **argv, char *filename, char *seq1Name,
-                  char *seq2Name, stHash *intervalsHashn, int64_t *bin_start,
+                  char *seq2Name, bedIndex_t *bedIndex, int64_t *bin_start,
                   int64_t *bin_end, int64_t *bin_length);
 void reportResults(char *seq1, char *seq2, stHash *seq1Hash, stHash *seq2Hash,
                    uint64_t *alignedPositions);
 void reportResultsRegion(char *seq1, char *seq2, stHash *seq1Hash,
                          stHash *seq2Hash, uint64_t *alignedPositions,
-                         stHash *intervalsHash);
+                         bedIndex_t *bedIndex);
 
 #endif // _PAIR_COVERAGE_H_
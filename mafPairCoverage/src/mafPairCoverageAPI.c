@@ -23,7 +23,6 @@
  * THE SOFTWARE.
  */
 #include <assert.h>
-#include <errno.h> // file existence via ENOENT, errno
 #include <getopt.h>
 #include <inttypes.h>
 #include <stdbool.h>
@@ -34,7 +33,6 @@
 #include "common.h"
 #include "sharedMaf.h"
 #include "mafPairCoverageAPI.h"
-#include "bioioC.h" // benLine()
 
 struct mafCoverageCount {
   // used to slice the coverage data down to the sequence level
@@ -194,7 +192,7 @@ static void quickSetup(mafLine_t *ml1, mafLine_t *ml2, uint64_t *pos1,
 }
 void compareLines(mafLine_t *ml1, mafLine_t *ml2, stHash *seq1Hash,
                   stHash *seq2Hash, uint64_t *alignedPositions,
-                  stHash *intervalsHash, BinContainer *bin_container) {
+                  bedIndex_t *bedIndex, BinContainer *bin_container) {
   // look through the sequences position by position and count the number of
   // places where the two sequences contained aligned residues, i.e. neither
   // position contains a gap character.
@@ -223,7 +221,7 @@ void compareLines(mafLine_t *ml1, mafLine_t *ml2, stHash *seq1Hash,
     s1_start = maf_mafLine_getSourceLength(ml1) - s1_start - 1;
     strand = -1;
   }
-  if (stHash_size(intervalsHash) == 0) {
+  if (bed_getNumberOfSequences(bedIndex) == 0) {
     // no intervals: yay, life is simple! :D
     uint64_t offset = 0;  // accounts for gaps in sequence 1
     for (uint64_t i = 0; i < n; ++i) {
@@ -249,6 +247,10 @@ void compareLines(mafLine_t *ml1, mafLine_t *ml2, stHash *seq1Hash,
     uint64_t pos1, pos2;
     int strand1, strand2;
     quickSetup(ml1, ml2, &pos1, &pos2, &strand1, &strand2);
+    // both positions move monotonically along the rows, so cursors make the lookups cheap
+    bedCursor_t cursor1, cursor2;
+    bed_cursor_init(&cursor1, bed_getIntervals(bedIndex, seqName1));
+    bed_cursor_init(&cursor2, bed_getIntervals(bedIndex, seqName2));
     uint64_t offset = 0;
     for (uint64_t i = 0; i < n; ++i) {
       pos1 += strand1;
@@ -259,14 +261,14 @@ void compareLines(mafLine_t *ml1, mafLine_t *ml2, stHash *seq1Hash,
         ++(mcct2->count);
         binContainer_incrementPosition(bin_container,
                                        s1_start + offset * strand);
-        if (inInterval(intervalsHash, seqName1, pos1)) {
+        if (bed_cursor_contains(&cursor1, pos1)) {
           // seq 1 is in the interval
           ++(mcct1->inRegion);
         } else {
           // seq 1 is not in the interval
           ++(mcct1->outRegion);
         }
-        if (inInterval(intervalsHash, seqName2, pos2)) {
+        if (bed_cursor_contains(&cursor2, pos2)) {
           // seq 2 is in the interval
           ++(mcct2->inRegion);
         } else {
@@ -291,7 +293,7 @@ void wrapDestroyMafLine(void *p) {
 }
 void checkBlock(mafBlock_t *b, const char *seq1, const char *seq2,
                 stHash *seq1Hash, stHash *seq2Hash, uint64_t *alignedPositions,
-                stHash *intervalsHash, BinContainer *bin_container) {
+                bedIndex_t *bedIndex, BinContainer *bin_container) {
   // read through each line of a mafBlock and if the sequence matches the
   // region we're looking for, report the block.
   mafLine_t *ml1 = maf_mafBlock_getHeadLine(b);
@@ -359,7 +361,7 @@ void checkBlock(mafBlock_t *b, const char *seq1, const char *seq2,
     sl_it2 = stList_getIterator(seq2List);
     while ((ml2 = stList_getNext(sl_it2)) != NULL) {
       compareLines(ml1, ml2, seq1Hash, seq2Hash,
-                   alignedPositions, intervalsHash, bin_container);
+                   alignedPositions, bedIndex, bin_container);
     }
     stList_destructIterator(sl_it2);
   }
@@ -371,129 +373,18 @@ void checkBlock(mafBlock_t *b, const char *seq1, const char *seq2,
 
 void processBody(mafFileApi_t *mfa, char *seq1, char *seq2, stHash *seq1Hash,
                  stHash *seq2Hash,
-                 uint64_t *alignedPositions, stHash *intervalsHash,
+                 uint64_t *alignedPositions, bedIndex_t *bedIndex,
                  BinContainer *bin_container) {
   mafBlock_t *thisBlock = NULL;
   *alignedPositions = 0;
   while ((thisBlock = maf_readBlock(mfa)) != NULL) {
     checkBlock(thisBlock, seq1, seq2, seq1Hash, seq2Hash,
-               alignedPositions, intervalsHash, bin_container);
+               alignedPositions, bedIndex, bin_container);
     maf_destroyMafBlockList(thisBlock);
   }
 }
 
 
-void parseBedFile(const char *filepath, stHash *intervalsHash) {
-  /*
-   * WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING
-   * This function is near copy-pasta from mafComparator.c
-   * WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING
-   * takes a filepath and the intervalsHash, opens and reads the file,
-   * adding intervals taken from each bed line to the intervalsHash.
-   * intervals hash is keyed with the name of the sequence and valued with
-   * a st_sortedset
-   */
-  FILE *fileHandle = fopen(filepath, "r");
-  st_logDebug("Parsing the bed file: %s\n", filepath);
-  if (fileHandle == NULL) {
-    if (errno == ENOENT)
-      fprintf(stderr, "ERROR, file %s does not exist.\n", filepath);
-    else
-      fprintf(stderr, "ERROR, unable to open %s\n", filepath);
-    exit(EXIT_FAILURE);
-  }
-  int64_t nBytes = 100;
-  char *cA2 = st_malloc(nBytes + 1);
-  int64_t bytesRead = benLine(&cA2, &nBytes, fileHandle);
-  while (bytesRead != -1) {
-    if (bytesRead > 0) {
-      int64_t start, stop;
-      char *cA3 = stString_copy(cA2);
-      int64_t i = sscanf(cA2, "%s %" PRIi64 " %" PRIi64 "", cA3,
-                         &start, &stop);
-      if (i != 3) {
-        fprintf(stderr, "Error while parsing bed file %s, expected 3 "
-                "column bed format:\n"
-                "sequence_name\tstart\tend\n", filepath);
-        exit(EXIT_FAILURE);
-      }
-      stSortedSet *intervals = stHash_search(intervalsHash, cA3);
-      if (intervals == NULL) {
-        intervals = stSortedSet_construct3(
-                                           (int(*)(const void *, const void *))
-                                           stIntTuple_cmpFn,
-                                           (void(*)(void *))
-                                           stIntTuple_destruct);
-        stHash_insert(intervalsHash, stString_copy(cA3), intervals);
-      }
-      stIntTuple *j = stIntTuple_construct2(start, stop);
-      stIntTuple *k = stSortedSet_searchLessThanOrEqual(intervals, j);
-      if (k != NULL) {
-        if (stIntTuple_get(k, 1) > start) {
-          st_errAbort(
-                      "Found an overlapping interval in the bed file: %s "
-                      "%" PRIi64 " "
-                      "%" PRIi64 " overlaps %s %" PRIi64 " %" PRIi64 "",
-                      cA3, start, stop, cA2,
-                      stIntTuple_get(k, 0),
-                      stIntTuple_get(k, 1));
-        }
-      }
-      k = stSortedSet_searchGreaterThanOrEqual(intervals, j);
-      if (k != NULL) {
-        if (stIntTuple_get(k, 1) < stop) {
-          st_errAbort(
-                      "Found an overlapping interval in the bed file: %s "
-                      "%" PRIi64 " "
-                      "%" PRIi64 " overlaps %s %" PRIi64 " %" PRIi64 "",
-                      cA3, start, stop, cA2,
-                      stIntTuple_get(k, 0),
-                      stIntTuple_get(k, 1));
-        }
-      }
-      assert(stSortedSet_search(intervals, j) == NULL);
-      st_logDebug("Adding in an interval: %s %" PRIi64 " %" PRIi64 "\n",
-                  cA3, start, stop);
-      stSortedSet_insert(intervals, j);
-      free(cA3);
-    }
-    bytesRead = benLine(&cA2, &nBytes, fileHandle);
-  }
-  free(cA2);
-  fclose(fileHandle);
-  st_logDebug("Finished parsing the bed file: %s\n", filepath);
-}
-
-
-bool inInterval(stHash *intervalsHash, char *seq, uint64_t pos) {
-  /*
-   * WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING
-   * This function is copy pasta from mafComparatator/src/comparatorAPI.c
-   * WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING WARNING
-   * check to see if the sequence and position are within the intervals hash.
-   *
-   */
-  stSortedSet *intervals = stHash_search(intervalsHash, seq);
-  if (intervals == NULL) {
-    // printf("%s %" PRIu64 " is not in the region, bad seq.\n", seq, pos);
-    return false;
-  }
-  stIntTuple *i = stIntTuple_construct2( pos, INT64_MAX);
-  stIntTuple *j = stSortedSet_searchLessThanOrEqual(intervals, i);
-  stIntTuple_destruct(i);
-  if (j == NULL) {
-    // printf("%s %" PRIu64 " is not in the region, bad pos.\n", seq, pos);
-    return false;
-  }
-  assert(stIntTuple_length(j) == 2);
-  /* if (stIntTuple_get(j, 0) <= pos && pos < stIntTuple_get(j, 1)) { */
-  /*      printf("%s %" PRIu64 " IS in the region.\n", seq, pos); */
-  /* } else { */
-  /*     printf("%s %" PRIu64 " IS NOT in the region.\n", seq, pos); */
-  /* } */
-  return stIntTuple_get(j, 0) <= pos && pos < stIntTuple_get(j, 1);
-}
-
 BinContainer* binContainer_init(void) {
   BinContainer *bc = st_malloc(sizeof(*bc));
   bc->bin_start = 0;
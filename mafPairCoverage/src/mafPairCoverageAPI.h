@@ -30,6 +30,7 @@
 #include <inttypes.h>
 #include "common.h"
 #include "sharedMaf.h"
+#include "bedIndex.h"
 #include "sonLib.h"
 #include "mafPairCoverage.h"
 
@@ -59,21 +60,19 @@ void binContainer_incrementPosition(BinContainer *bc, int64_t i);
 void binContainer_incrementBin(BinContainer *bc, int64_t i);
 void binContainer_setBinValue(BinContainer *bc, int64_t i, int64_t v);
 bool is_wild(const char *s);
-bool inInterval(stHash *intervalsHash, char *seq, uint64_t pos);
 bool searchMatched(mafLine_t *ml, const char *seq);
 bool searchMatched_(const char *target, const char *seq);
 void compareLines(mafLine_t *ml1, mafLine_t *ml2, stHash *seq1Hash,
                   stHash *seq2Hash, uint64_t *alignedPositions,
-                  stHash *intervalsHash, BinContainer *bc);
+                  bedIndex_t *bedIndex, BinContainer *bc);
 void wrapDestroyMafLine(void *p);
 void checkBlock(mafBlock_t *b, const char *seq1, const char *seq2,
                 stHash *seq1Hash, stHash *seq2Hash, uint64_t *alignedPositions,
-                stHash *intervalsHash, BinContainer *bc);
+                bedIndex_t *bedIndex, BinContainer *bc);
 void processBody(mafFileApi_t *mfa, char *seq1, char *seq2, stHash *seq1Hash,
                  stHash *seq2Hash,
-                 uint64_t *alignedPositions, stHash *intervalsHash,
+                 uint64_t *alignedPositions, bedIndex_t *bedIndex,
                  BinContainer *bc);
-void parseBedFile(const char *filepath, stHash *intervalsHash);
 void reportResultsBins(char *seq1, char *seq2, BinContainer *bin_container);
 BinContainer* binContainer_init(void);
 BinContainer* binContainer_construct(int64_t bin_start, int64_t bin_end,
@@ -70,7 +70,8 @@ static void test_compareLines_0(CuTest *testCase) {
   mafLine_t *ml2 = maf_newMafLineFromString("s mm9.chr1        123480 13 + 1234870098735 ACGTACGTACGTA", 1);
   stHash *seq1Hash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
-  stHash *empty = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+  bedIndex_t *empty = bed_newIndex();
+  bed_finalizeIndex(empty);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -87,7 +88,7 @@ static void test_compareLines_0(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(empty);
+  bed_destroyIndex(empty);
   binContainer_destruct(bc);
 
   // test case 1
@@ -96,7 +97,8 @@ static void test_compareLines_0(CuTest *testCase) {
   ml2 = maf_newMafLineFromString("s mm9.chr2        123480  5 + 1234870098735 AC--------GTA", 1);
   seq1Hash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
   seq2Hash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
-  empty = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+  empty = bed_newIndex();
+  bed_finalizeIndex(empty);
   mcct1 = createMafCoverageCount();
   mcct2 = createMafCoverageCount();
   bc = binContainer_init();
@@ -110,7 +112,7 @@ static void test_compareLines_0(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(empty);
+  bed_destroyIndex(empty);
   binContainer_destruct(bc);
 }
 static void test_compareLines_1(CuTest *testCase) {
@@ -120,7 +122,8 @@ static void test_compareLines_1(CuTest *testCase) {
   mafLine_t *ml2 = maf_newMafLineFromString("s mm9.chr1        123480 13 + 1234870098734 ACGTACGTACGTA", 1);
   stHash *seq1Hash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
-  stHash *empty = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, free);
+  bedIndex_t *empty = bed_newIndex();
+  bed_finalizeIndex(empty);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -137,41 +140,24 @@ static void test_compareLines_1(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(empty);
+  bed_destroyIndex(empty);
   binContainer_destruct(bc);
   // test case 1
 }
 static void test_intervalCheck_0(CuTest *testCase) {
   // make sure that the hash is being correctly populated
   // test case 0
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   for (int i = 123480; i < 123485; ++i) {
-    CuAssertTrue(testCase, inInterval(intervalsHash, "hg19.chr19", i) == true);
-  }
-  CuAssertTrue(testCase, inInterval(intervalsHash, "hg19.chr19", 123479) == false);
-  CuAssertTrue(testCase, inInterval(intervalsHash, "hg19.chr19", 123486) == false);
-  CuAssertTrue(testCase, inInterval(intervalsHash, "hg19.chr1", 123482) == false);
-  CuAssertTrue(testCase, inInterval(intervalsHash, "hg19", 123482) == false);
-  stHash_destruct(intervalsHash);
-}
-static void displayIntTuple(stIntTuple *t) {
-  if (t != NULL) {
-    printf("%" PRIi64 " %" PRIi64 "\n", stIntTuple_get(t, 0), stIntTuple_get(t, 1));
-  } else {
-    printf("NULL\n");
-  }
-}
-static void displaySortedSet(stSortedSet *s) {
-  stSortedSetIterator *sit = stSortedSet_getIterator(s);
-  stIntTuple *t = NULL;
-  while ((t = stSortedSet_getNext(sit)) != NULL) {
-    displayIntTuple(t);
+    CuAssertTrue(testCase, bed_contains(bedIndex, "hg19.chr19", i) == true);
   }
+  CuAssertTrue(testCase, bed_contains(bedIndex, "hg19.chr19", 123479) == false);
+  CuAssertTrue(testCase, bed_contains(bedIndex, "hg19.chr19", 123486) == false);
+  CuAssertTrue(testCase, bed_contains(bedIndex, "hg19.chr1", 123482) == false);
+  CuAssertTrue(testCase, bed_contains(bedIndex, "hg19", 123482) == false);
+  bed_destroyIndex(bedIndex);
 }
 static void test_compareLines_region_0(CuTest *testCase) {
   // make sure that the hash is being correctly populated
@@ -185,15 +171,9 @@ static void test_compareLines_region_0(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stIntTuple *q = stIntTuple_construct2(123482, 123484);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -203,15 +183,15 @@ static void test_compareLines_region_0(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, stHash_search(seq1Hash, "hg19.chr19") != NULL);
   CuAssertTrue(testCase, stHash_search(seq2Hash, "mm9.chr1") != NULL);
   CuAssertTrue(testCase, stHash_search(seq2Hash, "bannana") == NULL);
-  stSortedSet *intSet = stHash_search(intervalsHash, "hg19.chr19");
-  CuAssertTrue(testCase, intSet != NULL);
-  stIntTuple *u = stSortedSet_search(intSet, q);
-  CuAssertTrue(testCase, u == NULL);
-  free(q);
+  bedIntervals_t *bis = bed_getIntervals(bedIndex, "hg19.chr19");
+  CuAssertTrue(testCase, bis != NULL);
+  CuAssertTrue(testCase, bed_intervals_getNumberOfIntervals(bis) == 1);
+  CuAssertTrue(testCase, bed_intervals_getStart(bis, 0) == 123480);
+  CuAssertTrue(testCase, bed_intervals_getEnd(bis, 0) == 123485);
   CuAssertTrue(testCase, mafCoverageCount_getInRegion(mcct1) == 4);
   CuAssertTrue(testCase, mafCoverageCount_getOutRegion(mcct1) == 9);
   CuAssertTrue(testCase, mafCoverageCount_getInRegion(mcct2) == 0);
@@ -220,7 +200,7 @@ static void test_compareLines_region_0(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
   // test case 1
 }
@@ -236,14 +216,9 @@ static void test_binning_0(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -253,7 +228,7 @@ static void test_binning_0(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 123480);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 123500);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -269,7 +244,7 @@ static void test_binning_0(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_1(CuTest *testCase) {
@@ -284,14 +259,9 @@ static void test_binning_1(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -301,7 +271,7 @@ static void test_binning_1(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 123480);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 123500);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -312,7 +282,7 @@ static void test_binning_1(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_2(CuTest *testCase) {
@@ -327,14 +297,9 @@ static void test_binning_2(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -344,7 +309,7 @@ static void test_binning_2(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 123480);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 123500);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -361,7 +326,7 @@ static void test_binning_2(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_3(CuTest *testCase) {
@@ -376,14 +341,9 @@ static void test_binning_3(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -393,7 +353,7 @@ static void test_binning_3(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 123480);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 123500);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -411,7 +371,7 @@ static void test_binning_3(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_4(CuTest *testCase) {
@@ -426,14 +386,9 @@ static void test_binning_4(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -443,7 +398,7 @@ static void test_binning_4(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 123480);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 123500);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -460,7 +415,7 @@ static void test_binning_4(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_5(CuTest *testCase) {
@@ -475,14 +430,9 @@ static void test_binning_5(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -492,7 +442,7 @@ static void test_binning_5(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 123480);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 123500);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -506,7 +456,7 @@ static void test_binning_5(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_6(CuTest *testCase) {
@@ -521,14 +471,9 @@ static void test_binning_6(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -538,7 +483,7 @@ static void test_binning_6(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 123486);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 123495);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -555,7 +500,7 @@ static void test_binning_6(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_7(CuTest *testCase) {
@@ -570,14 +515,9 @@ static void test_binning_7(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -587,7 +527,7 @@ static void test_binning_7(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 123476);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 123495);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -607,7 +547,7 @@ static void test_binning_7(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_8(CuTest *testCase) {
@@ -622,14 +562,9 @@ static void test_binning_8(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -639,7 +574,7 @@ static void test_binning_8(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 123476);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 123485);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -655,7 +590,7 @@ static void test_binning_8(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_9(CuTest *testCase) {
@@ -670,14 +605,9 @@ static void test_binning_9(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -687,7 +617,7 @@ static void test_binning_9(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 80);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 100);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -704,7 +634,7 @@ static void test_binning_9(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_10(CuTest *testCase) {
@@ -720,14 +650,9 @@ static void test_binning_10(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -737,7 +662,7 @@ static void test_binning_10(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 80);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 100);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -754,7 +679,7 @@ static void test_binning_10(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 
@@ -772,14 +697,9 @@ static void test_binning_11(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -789,7 +709,7 @@ static void test_binning_11(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 80);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 100);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -813,7 +733,7 @@ static void test_binning_11(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 static void test_binning_12(CuTest *testCase) {
@@ -830,14 +750,9 @@ static void test_binning_12(CuTest *testCase) {
                                        stHash_stringEqualKey, free, free);
   stHash *seq2Hash = stHash_construct3(stHash_stringKey,
                                        stHash_stringEqualKey, free, free);
-  stHash *intervalsHash = stHash_construct3(stHash_stringKey,
-                                            stHash_stringEqualKey,
-                                            free, (void(*)(void *)) stSortedSet_destruct);
-  stSortedSet *intervals = stSortedSet_construct3((int(*)(const void *, const void*)) stIntTuple_cmpFn,
-                                                  (void(*)(void *)) stIntTuple_destruct);
-  stHash_insert(intervalsHash, stString_copy("hg19.chr19"), intervals);
-  stIntTuple *t = stIntTuple_construct2(123480, 123485);
-  stSortedSet_insert(intervals, t);
+  bedIndex_t *bedIndex = bed_newIndex();
+  bed_addInterval(bedIndex, "hg19.chr19", 123480, 123485);
+  bed_finalizeIndex(bedIndex);
   uint64_t alignedPositions = 0;
   mafCoverageCount_t *mcct1 = createMafCoverageCount();
   mafCoverageCount_t *mcct2 = createMafCoverageCount();
@@ -847,7 +762,7 @@ static void test_binning_12(CuTest *testCase) {
   stHash_insert(seq1Hash, stString_copy("hg19.chr19"), mcct1);
   stHash_insert(seq2Hash, stString_copy("mm9.chr1"), mcct2);
   compareLines(ml1, ml2, seq1Hash, seq2Hash, &alignedPositions,
-               intervalsHash, bc);
+               bedIndex, bc);
   CuAssertTrue(testCase, binContainer_getBinStart(bc) == 0);
   CuAssertTrue(testCase, binContainer_getBinEnd(bc) == 20);
   CuAssertTrue(testCase, binContainer_getBins(bc) != NULL);
@@ -869,14 +784,13 @@ static void test_binning_12(CuTest *testCase) {
   maf_destroyMafLineList(ml2);
   stHash_destruct(seq1Hash);
   stHash_destruct(seq2Hash);
-  stHash_destruct(intervalsHash);
+  bed_destroyIndex(bedIndex);
   binContainer_destruct(bc);
 }
 
 CuSuite* pairCoverage_TestSuite(void) {
   CuSuite* suite = CuSuiteNew();
   (void) BinContents;
-  (void) displaySortedSet;
   (void) test_is_wild_0;
   (void) test_searchMatched_0;
   (void) test_compareLines_0;
@@ -61,6 +61,10 @@ void parseOptions(int argc, char **argv, options_t *options) {
       {"breakpointPenalty",  required_argument, 0, 0},
       {"interstitialSequence",  required_argument, 0, 0},
       {"referenceSequence",  required_argument, 0, 0},
+      {"spill", no_argument, 0, 0},
+      {"tempDir",  required_argument, 0, 0},
+      {"partition", no_argument, 0, 0},
+      {"threads",  required_argument, 0, 0},
       {0, 0, 0, 0}
     };
     int option_index = 0;
@@ -109,6 +113,26 @@ void parseOptions(int argc, char **argv, options_t *options) {
         options->reference = stString_copy(optarg);
         break;
       }
+      if (strcmp("spill", long_options[option_index].name) == 0) {
+        options->spill = true;
+        break;
+      }
+      if (strcmp("tempDir", long_options[option_index].name) == 0) {
+        options->tempDir = stString_copy(optarg);
+        break;
+      }
+      if (strcmp("partition", long_options[option_index].name) == 0) {
+        options->partition = true;
+        break;
+      }
+      if (strcmp("threads", long_options[option_index].name) == 0) {
+        i = sscanf(optarg, "%" PRIu64, &(options->numThreads));
+        if (i != 1 || options->numThreads < 1) {
+          fprintf(stderr, "Error, --threads must be a positive integer, not %s\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      }
       break;
     case 'v':
       g_verbose_flag++;
@@ -144,6 +168,9 @@ void parseOptions(int argc, char **argv, options_t *options) {
     fprintf(stderr, "specify --interstitialSequence\n");
     usage();
   }
+  if ((options->spill || options->partition) && options->tempDir == NULL) {
+    options->tempDir = stString_copy((getenv("TMPDIR") != NULL) ? getenv("TMPDIR") : "/tmp");
+  }
   // Check there's nothing left over on the command line
   if (optind < argc) {
     char *errorString = st_malloc(kMaxStringLength);
@@ -168,12 +195,16 @@ void usage(void) {
   fprintf(stderr, "Options: \n");
   usageMessage('h', "help", "show this message and exit.");
   usageMessage('m', "maf", "path to the maf file.");
-  usageMessage('\0', "seqs", "comma separated list of fasta sequences. each fasta may contain multiple entries. all sequences in the input alignment must be accounted for with an element in a fasta.");
+  usageMessage('\0', "seqs", "comma separated list of fasta sequences. each fasta may contain multiple entries. all sequences in the input alignment must be accounted for with an element in a fasta. a .fai index is built beside each fasta on first use so that only the sequence needed is read.");
   usageMessage('\0', "outMfa", "multiple sequence fasta output file.");
   usageMessage('\0', "breakpointPenalty", "number of `N' characters to insert into a sequence when a breakpoint is detected.");
   usageMessage('\0', "interstitialSequence", "maximum length of interstitial sequence to be added (from a fasta) into the fasta before a breakpoint is declared and the <code>--breakpointPenalty</code> number of <code>N</code>'s is added instead.");
   usageMessage('\0', "outMaf", "multiple alignment format output file.");
   usageMessage('\0', "reference", "optional. The name of the reference sequence. All intervening reference sequence between the first and last block of the input --maf will be read out in the output.");
+  usageMessage('\0', "spill", "optional. Keep each row of the output in its own temporary file rather than in memory, so that memory use does not grow with the length of the alignment. Long runs of gaps and N's are still kept in memory.");
+  usageMessage('\0', "tempDir", "optional. With --spill or --partition, the directory to keep the rows and blocks in. Default is $TMPDIR, or /tmp.");
+  usageMessage('\0', "partition", "optional. Group the blocks by their first (reference) sequence and stitch each group on its own, as though it were the only one in the --maf. The outputs are written one after another in the order the reference sequences first appear: the rows of each group in the mfa, and one block per group in the maf. With --referenceSequence, which then names a species (e.g. hg19, or hg19.chr1 for just that sequence), blocks are grouped by their first row of that species instead, falling back to their first row, and each group is stitched with its own sequence as the reference.");
+  usageMessage('\0', "threads", "optional. With --partition, the number of groups stitched at once. Default is 1, the output does not depend on it.");
   usageMessage('v', "verbose", "turns on verbose output.");
   exit(EXIT_FAILURE);
 }
@@ -187,17 +218,25 @@ int main(int argc, char **argv) {
   de_verbose("Creating sequence hash.\n");
   sequenceHash = createSequenceHash(options->seqs);
   mafFileApi_t *mfapi = maf_newMfa(options->maf, "r");
-  de_verbose("Creating alignment hash.\n");
-  buildAlignmentHash(mfapi, alignmentHash, sequenceHash, rowOrder, options);
-  if (options->outMfa != NULL) {
-    // fasta output
-    de_verbose("Writing fasta output.\n");
-    writeFastaOut(alignmentHash, rowOrder, options);
-  }
-  if (options->outMaf != NULL) {
-    // maf output
-    de_verbose("Writing maf output.\n");
-    writeMafOut(alignmentHash, rowOrder, options);
+  if (options->partition) {
+    de_verbose("Partitioning the alignment by reference sequence.\n");
+    mafPartition_t *partition = partitionMaf(mfapi, options->tempDir, options->reference);
+    de_verbose("Stitching %" PRIu64 " partitions.\n", mafPartition_getNumberOfParts(partition));
+    stitchPartitions(partition, sequenceHash, options);
+    mafPartition_destroy(partition);
+  } else {
+    de_verbose("Creating alignment hash.\n");
+    buildAlignmentHash(mfapi, alignmentHash, sequenceHash, rowOrder, options);
+    if (options->outMfa != NULL) {
+      // fasta output
+      de_verbose("Writing fasta output.\n");
+      writeFastaOut(alignmentHash, rowOrder, options);
+    }
+    if (options->outMaf != NULL) {
+      // maf output
+      de_verbose("Writing maf output.\n");
+      writeMafOut(alignmentHash, rowOrder, options);
+    }
   }
   // cleanup
   maf_destroyMfa(mfapi);
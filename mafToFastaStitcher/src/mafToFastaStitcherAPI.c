@@ -24,12 +24,18 @@
  */
 
 #include <ctype.h> // mac os x toupper()
+#include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "common.h"
 #include "CuTest.h"
 #include "sharedMaf.h"
@@ -39,6 +45,10 @@
 #include "mafToFastaStitcherAPI.h"
 #include "buildVersion.h"
 
+static const uint64_t kMaxRowChunk = 1 << 20; // largest chunk of a row_t, in bytes
+static const uint64_t kMinRowRun = 256; // shorter runs of gaps or N's are stored as characters
+static const uint64_t kSpoolBufferLength = 1 << 16; // bytes read from a row's spool at a time
+
 options_t* options_construct(void) {
     options_t *o = (options_t*) st_malloc(sizeof(*o));
     o->maf = NULL;
@@ -48,6 +58,10 @@ options_t* options_construct(void) {
     o->reference = NULL;
     o->breakpointPenalty = 0;
     o->interstitialSequence = 0;
+    o->spill = false;
+    o->tempDir = NULL;
+    o->partition = false;
+    o->numThreads = 1;
     return o;
 }
 void destroyOptions(options_t *o) {
@@ -71,6 +85,7 @@ void destroyOptions(options_t *o) {
         free(o->reference);
         o->reference = NULL;
     }
+    free(o->tempDir);
     free(o);
     o = NULL;
 }
@@ -81,6 +96,8 @@ mtfseq_t* newMtfseq(uint64_t length) {
     mtfs->memLength = length;
     mtfs->index = 0;
     mtfs->seq[mtfs->index] = '\0';
+    mtfs->map = NULL;
+    memset(&(mtfs->fai), 0, sizeof(mtfs->fai));
     return mtfs;
 }
 void resizeMtfseq(mtfseq_t *m) {
@@ -98,27 +115,19 @@ void resizeMtfseq(mtfseq_t *m) {
     free(m->seq);
     m->seq = new;
 }
-void resizeRowSequence(row_t *r) {
-    // double the size of the mtfseq_t, updating all members
-    uint64_t n = 2 << 16;
-    if (n < r->memLength) {
-        n = r->memLength;
-    }
-    n *= 2;
-    r->memLength = n;
-    char *new = (char *) st_malloc(n);
-    new[0] = '\0';
-    strcpy(new, r->sequence);
-    free(r->sequence);
-    r->sequence = new;
-}
 void destroyMtfseq(void *p) {
     // extra casting due to function being called by stHash destructor
-    free(((mtfseq_t *)p)->seq);
+    mtfseq_t *mtfs = (mtfseq_t *) p;
+    free(mtfs->seq);
+    free(mtfs->fai.name);
+    if (mtfs->map != NULL && --(mtfs->map->refCount) == 0) {
+        munmap(mtfs->map->data, mtfs->map->size);
+        free(mtfs->map);
+    }
     free(p);
 }
 row_t* newRow(uint64_t n) {
-    // n should be a power of two
+    // n is the capacity of the row's first chunk, later chunks double up to kMaxRowChunk
     row_t *r = (row_t *) st_malloc(sizeof(*r));
     r->name = NULL;
     r->multipleNames = false;
@@ -129,17 +138,28 @@ row_t* newRow(uint64_t n) {
     r->strand = '0';
     r->prevStrand = '0';
     r->sourceLength = 0;
-    r->memLength = n;
-    r->sequence = (char*) st_malloc(n);
-    r->sequence[0] = '\0';
+    r->head = NULL;
+    r->tail = NULL;
     r->index = 0;
+    r->chunkSize = (n > 0) ? n : 1;
+    r->spool = NULL;
+    r->spooled = 0;
     return r;
 }
 void destroyRow(void *row) {
     // extra casting due to function being called by stHash destructor
     free(((row_t *)row)->name);
     free(((row_t *)row)->prevName);
-    free(((row_t *)row)->sequence);
+    rowPiece_t *p = ((row_t *)row)->head, *next = NULL;
+    while (p != NULL) {
+        next = p->next;
+        free(p->chunk);
+        free(p);
+        p = next;
+    }
+    if (((row_t *)row)->spool != NULL) {
+        fclose(((row_t *)row)->spool);
+    }
     free(row);
 }
 row_t* mafLineToRow(mafLine_t *ml) {
@@ -147,7 +167,7 @@ row_t* mafLineToRow(mafLine_t *ml) {
     row_t *r = newRow(nearestTwo(maf_mafLine_getSequenceFieldLength(ml)));
     assert(r->name == NULL);
     assert(r->prevName == NULL);
-    assert(r->sequence[0] == '\0');
+    assert(r->index == 0);
     r->name = stString_copy(maf_mafLine_getSpecies(ml));
     r->prevName = stString_copy(maf_mafLine_getSpecies(ml));
     row_copyIn(r, maf_mafLine_getSequence(ml)); // copy in sequence
@@ -165,7 +185,11 @@ stHash* createSequenceHash(char *fastas) {
     stHash *sequenceHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, destroyMtfseq);
     for (unsigned i = 0; i < n; ++i) {
         de_verbose("Reading fasta %s\n", fastaArray[i]);
-        addSequencesToHash(sequenceHash, fastaArray[i]);
+        if (!addIndexedSequencesToHash(sequenceHash, fastaArray[i])) {
+            de_verbose("%s has lines of differing lengths and cannot be indexed, loading it instead\n",
+                       fastaArray[i]);
+            addSequencesToHash(sequenceHash, fastaArray[i]);
+        }
         free(fastaArray[i]);
     }
     free(fastaArray);
@@ -215,14 +239,221 @@ void seq_copyIn(mtfseq_t *mtfs, char *src) {
     //        (*mtfs)->memLength, (*mtfs)->index);
 }
 void row_copyIn(row_t *row, char *src) {
-    // copy src into row_t starting with ->index. 
-    unsigned n = strlen(src);
-    extendSequence(row, n + 1);
-    for (unsigned i = 0; i < n; ++i) {
-        // copy the new sequence into ->sequence at the index;
-        row->sequence[(row->index)++] = src[i];
+    // copy src onto the end of row_t
+    row_appendBases(row, src, strlen(src));
+}
+void row_spill(row_t *row, const char *tempDir) {
+    // from now on write the characters of the row to a temporary file in tempDir rather than
+    // keeping them in chunks. Runs stay in memory. The file is removed as soon as it is open,
+    // so it goes away with the process.
+    static uint64_t rowCount = 0;
+    static pthread_mutex_t rowCountLock = PTHREAD_MUTEX_INITIALIZER;
+    assert(row->spool == NULL);
+    assert(row->head == NULL || row->head == row->tail);
+    assert(row->tail == NULL || row->tail->chunk == NULL);
+    pthread_mutex_lock(&rowCountLock);
+    uint64_t id = rowCount++;
+    pthread_mutex_unlock(&rowCountLock);
+    char *filename = stString_print("%s/mafToFastaStitcher.%d.%" PRIu64 ".row", tempDir, (int) getpid(), id);
+    row->spool = fopen(filename, "w+b");
+    if (row->spool == NULL) {
+        fprintf(stderr, "Error, unable to create temporary file %s, see --tempDir\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    remove(filename);
+    free(filename);
+}
+static rowPiece_t* row_addPiece(row_t *row, char fill, uint64_t capacity) {
+    rowPiece_t *p = (rowPiece_t *) st_malloc(sizeof(*p));
+    p->fill = fill;
+    p->chunk = (capacity > 0) ? (char *) st_malloc(capacity) : NULL;
+    p->offset = 0;
+    p->length = 0;
+    p->capacity = capacity;
+    p->next = NULL;
+    if (row->tail == NULL) {
+        row->head = p;
+    } else {
+        row->tail->next = p;
+    }
+    row->tail = p;
+    return p;
+}
+static bool seekSpool(FILE *spool, uint64_t offset) {
+    // fseek() takes a long, so a temporary file can only be read back up to LONG_MAX bytes
+    // (2 GiB where long is 32 bits)
+    if (offset > (uint64_t) LONG_MAX) {
+        fprintf(stderr, "Error, a temporary file has grown past %ld bytes, the most that can be "
+                "read back on this system\n", LONG_MAX);
+        exit(EXIT_FAILURE);
+    }
+    return fseek(spool, (long) offset, SEEK_SET) == 0;
+}
+static void row_appendToSpool(row_t *row, const char *src, char fill, uint64_t n) {
+    // write n characters of src, or n copies of fill if src is NULL, onto the end of the spool,
+    // extending the last piece when it is already spooled
+    char fillBuffer[4096];
+    rowPiece_t *p = row->tail;
+    uint64_t k;
+    if (p == NULL || p->fill != '\0') {
+        p = row_addPiece(row, '\0', 0);
+        p->offset = row->spooled;
+    }
+    if (src == NULL) {
+        memset(fillBuffer, fill, (n < sizeof(fillBuffer)) ? n : sizeof(fillBuffer));
+    }
+    for (uint64_t done = 0; done < n; done += k) {
+        k = n - done;
+        if (src == NULL && k > sizeof(fillBuffer)) {
+            k = sizeof(fillBuffer);
+        }
+        if (fwrite((src != NULL) ? src + done : fillBuffer, 1, k, row->spool) != k) {
+            fprintf(stderr, "Error, unable to write to a temporary file, see --tempDir\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    p->length += n;
+    row->spooled += n;
+    row->index += n;
+}
+static void row_appendToChunks(row_t *row, const char *src, char fill, uint64_t n) {
+    // copy n characters of src, or n copies of fill if src is NULL, onto the end of the row,
+    // filling the last chunk before starting another
+    rowPiece_t *p = row->tail;
+    uint64_t k;
+    if (row->spool != NULL) {
+        row_appendToSpool(row, src, fill, n);
+        return;
+    }
+    while (n > 0) {
+        if (p == NULL || p->chunk == NULL || p->length == p->capacity) {
+            p = row_addPiece(row, '\0', row->chunkSize);
+            if (row->chunkSize < kMaxRowChunk) {
+                row->chunkSize *= 2;
+            }
+        }
+        k = p->capacity - p->length;
+        if (k > n) {
+            k = n;
+        }
+        if (src != NULL) {
+            memcpy(p->chunk + p->length, src, k);
+            src += k;
+        } else {
+            memset(p->chunk + p->length, fill, k);
+        }
+        p->length += k;
+        row->index += k;
+        n -= k;
+    }
+}
+void row_appendBases(row_t *row, const char *src, uint64_t n) {
+    row_appendToChunks(row, src, '\0', n);
+}
+void row_appendFill(row_t *row, char fill, uint64_t n) {
+    // add n copies of fill onto the end of the row as a run, which costs the same for any n.
+    // short runs are copied into the last chunk instead so that a row does not become a
+    // long list of tiny pieces.
+    if (n == 0) {
+        return;
+    }
+    rowPiece_t *p = row->tail;
+    if (p != NULL && p->fill == fill) {
+        p->length += n;
+        row->index += n;
+        return;
+    }
+    if (n < kMinRowRun) {
+        row_appendToChunks(row, NULL, fill, n);
+        return;
+    }
+    if (p != NULL && p->chunk != NULL && p->length < p->capacity) {
+        // the chunk is finished, give back the space it will not use
+        p->chunk = (char *) realloc(p->chunk, p->length);
+        p->capacity = p->length;
     }
-    row->sequence[row->index] = '\0';
+    p = row_addPiece(row, fill, 0);
+    p->length = n;
+    row->index += n;
+}
+static void row_readSpool(row_t *row, uint64_t offset, char *dest, uint64_t n) {
+    // read n characters of the spool of the row, starting at offset, then return to the end of
+    // the spool where row_appendToSpool() writes
+    if (fflush(row->spool) != 0 || !seekSpool(row->spool, offset) ||
+        fread(dest, 1, n, row->spool) != n || !seekSpool(row->spool, row->spooled)) {
+        fprintf(stderr, "Error, unable to read from a temporary file\n");
+        exit(EXIT_FAILURE);
+    }
+}
+char* row_getSequence(row_t *row) {
+    // return a copy of the sequence of the row as a string
+    char *s = (char *) st_malloc(row->index + 1);
+    uint64_t i = 0;
+    for (rowPiece_t *p = row->head; p != NULL; p = p->next) {
+        if (p->chunk != NULL) {
+            memcpy(s + i, p->chunk, p->length);
+        } else if (p->fill == '\0') {
+            row_readSpool(row, p->offset, s + i, p->length);
+        } else {
+            memset(s + i, p->fill, p->length);
+        }
+        i += p->length;
+    }
+    s[i] = '\0';
+    return s;
+}
+void row_write(row_t *row, FILE *f, uint64_t lineLength) {
+    // write out the sequence of the row, with a newline between every lineLength characters.
+    // a lineLength of 0 writes the sequence on one line. Runs are written from a buffer of fill,
+    // spooled pieces are streamed through a buffer of kSpoolBufferLength.
+    char fillBuffer[4096];
+    char *spoolBuffer = NULL;
+    const char *src = NULL;
+    char fill = '\0';
+    uint64_t i = 0, k, done, buffered = 0, used = 0;
+    for (rowPiece_t *p = row->head; p != NULL; p = p->next) {
+        if (p->chunk == NULL && p->fill != '\0' && p->fill != fill) {
+            fill = p->fill;
+            memset(fillBuffer, fill, sizeof(fillBuffer));
+        }
+        if (p->chunk == NULL && p->fill == '\0' && spoolBuffer == NULL) {
+            spoolBuffer = (char *) st_malloc(kSpoolBufferLength);
+        }
+        buffered = used = 0;
+        for (done = 0; done < p->length; done += k, i += k) {
+            if (lineLength > 0 && i > 0 && (i % lineLength) == 0) {
+                fputc('\n', f);
+            }
+            k = p->length - done;
+            if (lineLength > 0 && k > lineLength - (i % lineLength)) {
+                k = lineLength - (i % lineLength);
+            }
+            if (p->chunk != NULL) {
+                src = p->chunk + done;
+            } else if (p->fill != '\0') {
+                if (k > sizeof(fillBuffer)) {
+                    k = sizeof(fillBuffer);
+                }
+                src = fillBuffer;
+            } else {
+                if (used == buffered) {
+                    buffered = p->length - done;
+                    if (buffered > kSpoolBufferLength) {
+                        buffered = kSpoolBufferLength;
+                    }
+                    row_readSpool(row, p->offset + done, spoolBuffer, buffered);
+                    used = 0;
+                }
+                if (k > buffered - used) {
+                    k = buffered - used;
+                }
+                src = spoolBuffer + used;
+                used += k;
+            }
+            fwrite(src, 1, k, f);
+        }
+    }
+    free(spoolBuffer);
 }
 void addSequencesToHash(stHash *hash, char *filename) {
     // add sequences from a fasta file into the seqHash containing mtfseq_t values
@@ -277,13 +508,235 @@ void addSequencesToHash(stHash *hash, char *filename) {
         stHash_insert(hash, stString_copy(name), mtfs);
         free(name);
     }
-    if (copy != NULL) {
-        free(copy);
+    if (copyHead != NULL) {
+        free(copyHead);
     }
     fclose(ifp);
     free(line);
     de_verbose("Finished reading fasta %s\n", filename);
 }
+void destroyFaiEntry(void *p) {
+    free(((faiEntry_t *)p)->name);
+    free(p);
+}
+static faiEntry_t* newFaiEntry(const char *header, uint64_t n, uint64_t offset) {
+    // the name is the first word of the header, which excludes the leading `>'
+    uint64_t i = 0, j;
+    while (i < n && isspace(header[i])) {
+        ++i;
+    }
+    for (j = i; j < n && !isspace(header[j]); ++j);
+    faiEntry_t *e = (faiEntry_t *) st_malloc(sizeof(*e));
+    e->name = (char *) st_malloc(j - i + 1);
+    memcpy(e->name, header + i, j - i);
+    e->name[j - i] = '\0';
+    e->length = 0;
+    e->offset = offset;
+    e->lineBases = 0;
+    e->lineWidth = 0;
+    return e;
+}
+static bool faiEntryMatches(faiEntry_t *e, const char *data, uint64_t size) {
+    // check an entry read from a .fai against the fasta it claims to index: the header line
+    // before the bases names the sequence and the last base ends the sequence. As file times only
+    // have a resolution of seconds this is what catches an index left over from a rewritten fasta.
+    if (e->offset == 0 || e->offset > size || data[e->offset - 1] != '\n') {
+        return false;
+    }
+    uint64_t h = e->offset - 1;
+    while (h > 0 && data[h - 1] != '\n') {
+        --h;
+    }
+    if (data[h] != '>') {
+        return false;
+    }
+    faiEntry_t *header = newFaiEntry(data + h + 1, e->offset - h - 2, e->offset);
+    bool named = (strcmp(header->name, e->name) == 0);
+    destroyFaiEntry(header);
+    if (!named) {
+        return false;
+    }
+    if (e->length == 0) {
+        return true;
+    }
+    if (e->lineBases == 0 || e->lineWidth < e->lineBases) {
+        return false;
+    }
+    uint64_t last = e->offset + ((e->length - 1) / e->lineBases) * e->lineWidth + (e->length - 1) % e->lineBases;
+    if (last >= size) {
+        return false;
+    }
+    // the last base must end its line and the sequence must not carry on past it
+    uint64_t next = last + 1;
+    if (next < size && data[next] == '\r') {
+        ++next;
+    }
+    if (next < size && data[next] != '\n') {
+        return false;
+    }
+    ++next;
+    return (next >= size || data[next] == '>' || data[next] == '\n' || data[next] == '\r');
+}
+stList* buildFastaIndex(const char *data, uint64_t size) {
+    // scan the fasta in data, returning a list of faiEntry_t. Returns NULL if the fasta cannot be
+    // indexed, i.e. it has sequence before the first header or a sequence's lines differ in length.
+    stList *entries = stList_construct3(0, destroyFaiEntry);
+    faiEntry_t *e = NULL;
+    bool ended = false; // a short line has been seen, the current sequence must not continue
+    uint64_t pos = 0, end, next, bases;
+    while (pos < size) {
+        const char *nl = memchr(data + pos, '\n', size - pos);
+        end = (nl == NULL) ? size : (uint64_t) (nl - data);
+        next = (nl == NULL) ? size : end + 1;
+        bases = end - pos;
+        if (bases > 0 && data[end - 1] == '\r') {
+            --bases;
+        }
+        if (data[pos] == '>') {
+            e = newFaiEntry(data + pos + 1, bases - 1, next);
+            stList_append(entries, e);
+            ended = false;
+        } else if (bases == 0) {
+            ended = (e != NULL);
+        } else {
+            if (e == NULL || ended) {
+                stList_destruct(entries);
+                return NULL;
+            }
+            if (e->lineBases == 0) {
+                e->lineBases = bases;
+                e->lineWidth = next - pos;
+            } else if (bases > e->lineBases || (nl != NULL && next - pos - bases != e->lineWidth - e->lineBases)) {
+                stList_destruct(entries);
+                return NULL;
+            } else if (bases < e->lineBases) {
+                ended = true;
+            }
+            e->length += bases;
+        }
+        pos = next;
+    }
+    return entries;
+}
+stList* readFastaIndex(char *filename, const char *data, uint64_t size) {
+    // read the .fai index of the fasta in data, returning NULL if it cannot be read or does not match
+    FILE *ifp = fopen(filename, "r");
+    if (ifp == NULL) {
+        return NULL;
+    }
+    stList *entries = stList_construct3(0, destroyFaiEntry);
+    int64_t n = kMaxStringLength;
+    char *line = (char*) st_malloc(n);
+    char *tab = NULL;
+    faiEntry_t *e = NULL;
+    while (benLine(&line, &n, ifp) != -1) {
+        if ((tab = strchr(line, '\t')) == NULL) {
+            stList_destruct(entries);
+            entries = NULL;
+            break;
+        }
+        *tab = '\0';
+        e = newFaiEntry(line, strlen(line), 0);
+        stList_append(entries, e);
+        if (sscanf(tab + 1, "%" SCNu64 "\t%" SCNu64 "\t%" SCNu64 "\t%" SCNu64,
+                   &(e->length), &(e->offset), &(e->lineBases), &(e->lineWidth)) != 4 ||
+            !faiEntryMatches(e, data, size)) {
+            stList_destruct(entries);
+            entries = NULL;
+            break;
+        }
+    }
+    free(line);
+    fclose(ifp);
+    return entries;
+}
+void writeFastaIndex(char *filename, stList *entries) {
+    // save the index beside the fasta so later runs can skip the scan. Failing to do so is not an error.
+    FILE *ofp = fopen(filename, "w");
+    if (ofp == NULL) {
+        de_verbose("Unable to write fasta index %s, continuing without it\n", filename);
+        return;
+    }
+    faiEntry_t *e = NULL;
+    for (int64_t i = 0; i < stList_length(entries); ++i) {
+        e = stList_get(entries, i);
+        fprintf(ofp, "%s\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\n",
+                e->name, e->length, e->offset, e->lineBases, e->lineWidth);
+    }
+    fclose(ofp);
+}
+bool addIndexedSequencesToHash(stHash *hash, char *filename) {
+    // add sequences from a fasta file into the seqHash containing mtfseq_t values without reading
+    // them. The fasta is memory mapped and the bases are found through a .fai index, which is built
+    // and saved beside the fasta if it is missing or older than the fasta.
+    // Returns false, having added nothing, if the fasta cannot be indexed.
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        if (errno == ENOENT) {
+            fprintf(stderr, "ERROR, file %s does not exist.\n", filename);
+        } else {
+            fprintf(stderr, "ERROR, unable to open file %s for reading\n", filename);
+        }
+        exit(EXIT_FAILURE);
+    }
+    struct stat fastaStat, faiStat;
+    if (fstat(fd, &fastaStat) != 0) {
+        fprintf(stderr, "Error, unable to stat %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t size = (uint64_t) fastaStat.st_size;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+    char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error, unable to mmap %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    char *faiName = (char *) st_malloc(strlen(filename) + 5);
+    sprintf(faiName, "%s.fai", filename);
+    stList *entries = NULL;
+    if (stat(faiName, &faiStat) == 0 && faiStat.st_mtime >= fastaStat.st_mtime) {
+        entries = readFastaIndex(faiName, data, size);
+    }
+    if (entries == NULL) {
+        de_verbose("Indexing fasta %s\n", filename);
+        if ((entries = buildFastaIndex(data, size)) == NULL) {
+            munmap(data, size);
+            free(faiName);
+            return false;
+        }
+        writeFastaIndex(faiName, entries);
+    }
+    free(faiName);
+    fastaMap_t *map = (fastaMap_t *) st_malloc(sizeof(*map));
+    map->data = data;
+    map->size = size;
+    map->refCount = 1; // held until the end of this function
+    faiEntry_t *e = NULL;
+    mtfseq_t *mtfs = NULL;
+    for (int64_t i = 0; i < stList_length(entries); ++i) {
+        e = stList_get(entries, i);
+        mtfs = (mtfseq_t *) st_malloc(sizeof(*mtfs));
+        mtfs->seq = NULL;
+        mtfs->index = e->length;
+        mtfs->memLength = 0;
+        mtfs->map = map;
+        mtfs->fai = *e;
+        mtfs->fai.name = stString_copy(e->name);
+        ++(map->refCount);
+        stHash_insert(hash, stString_copy(e->name), mtfs);
+    }
+    stList_destruct(entries);
+    if (--(map->refCount) == 0) {
+        munmap(map->data, map->size);
+        free(map);
+    }
+    de_verbose("Finished indexing fasta %s\n", filename);
+    return true;
+}
 void reportSequenceHash(stHash *hash) {
     stHashIterator *hit = stHash_getIterator(hash);
     char *key = NULL;
@@ -292,16 +745,12 @@ void reportSequenceHash(stHash *hash) {
         printf("found key    : %s\n", key);
         printf("    memLength: %" PRIu64 "\n", ((mtfseq_t *)stHash_search(hash, key))->memLength);
         printf("        index: %" PRIu64 "\n", ((mtfseq_t *)stHash_search(hash, key))->index);
-        printf("               %s\n", ((mtfseq_t *)stHash_search(hash, key))->seq);
+        if (((mtfseq_t *)stHash_search(hash, key))->seq != NULL) {
+            printf("               %s\n", ((mtfseq_t *)stHash_search(hash, key))->seq);
+        }
     }
     stHash_destructIterator(hit);
 }
-void extendSequence(row_t *r, uint64_t n) {
-    // ensure there is enough room to write an additional `n' chars to ->sequence
-    while (r->index + n + 1 >= r->memLength) {
-        resizeRowSequence(r);
-    }
-}
 void penalize(stHash *hash, char *name, uint64_t n) {
     // walk the hash looking for a row_t with ->name equal to input *name,
     // penalize that sequence
@@ -313,7 +762,6 @@ void penalize(stHash *hash, char *name, uint64_t n) {
     char *rowSppName = NULL;
     while ((key = stHash_getNext(hit)) != NULL) {
         row = stHash_search(hash, key);
-        extendSequence(row, n); // make space
         fill = '-';
         rowSppName = copySpeciesName(row->name);
         if (strcmp(rowSppName, sppName) == 0) {
@@ -325,12 +773,7 @@ void penalize(stHash *hash, char *name, uint64_t n) {
         } else {
             // printf("   just going to gap       %20s: ", rowSppName);
         }
-        for (uint64_t i = 0; i < n; ++i) {
-            row->sequence[row->index] = fill;
-            ++(row->index);
-        }
-        row->sequence[row->index] = '\0';
-        // printf("%s\n", row->sequence);
+        row_appendFill(row, fill, n);
         free(rowSppName);
         rowSppName = NULL;
     }
@@ -347,7 +790,6 @@ void interstitialInsert(stHash *alignHash, stHash *seqHash, char *name, uint64_t
     char *seq = NULL;
     while ((key = stHash_getNext(hit)) != NULL) {
         row = stHash_search(alignHash, key);
-        extendSequence(row, n); // make space
         if (strcmp(row->name, name) == 0) {
             // printf("    going to interstitialize %20s: ", row->name);
             // insert into this row
@@ -360,39 +802,50 @@ void interstitialInsert(stHash *alignHash, stHash *seqHash, char *name, uint64_t
                 exit(EXIT_FAILURE);
             }
             seq = extractSubSequence(mtfs, strand, pos, n);
-            for (uint64_t i = 0; i < n; ++i) {
-                row->sequence[row->index] = seq[i];
-                ++(row->index);
-            }
-            // printf("%s\n", row->sequence);
+            row_appendBases(row, seq, n);
             free(seq);
         } else {
             // printf("    just going to gap        %20s: ", row->name);
             // these aren't the droids you're looking for, write some gaps instead
-            for (uint64_t i = 0; i < n; ++i) {
-                row->sequence[row->index] = '-';
-                ++(row->index);
-            }
-            // printf("%s\n", row->sequence);
+            row_appendFill(row, '-', n);
         }
-        row->sequence[row->index] = '\0';
     }
     stHash_destructIterator(hit);
 }
+static void copyBases(mtfseq_t *mtfs, uint64_t pos, uint64_t n, char *dest) {
+    // copy n bases starting at pos into dest, a line at a time when the sequence is mapped
+    if (mtfs->map == NULL) {
+        memcpy(dest, mtfs->seq + pos, n);
+        return;
+    }
+    uint64_t column, k;
+    while (n > 0) {
+        column = pos % mtfs->fai.lineBases;
+        k = mtfs->fai.lineBases - column;
+        if (k > n) {
+            k = n;
+        }
+        memcpy(dest, mtfs->map->data + mtfs->fai.offset + (pos / mtfs->fai.lineBases) * mtfs->fai.lineWidth + column, k);
+        dest += k;
+        pos += k;
+        n -= k;
+    }
+}
 char* extractSubSequence(mtfseq_t *mtfs, char strand, uint64_t pos, uint64_t n) {
     // make a copy of a region of a mtfseq_t structure, performing coordinate transform and 
     // reverse complementation if the strand is -
+    if (pos + n > mtfs->index) {
+        fprintf(stderr, "Error, bases %" PRIu64 " to %" PRIu64 " lie beyond the end of %s, "
+                "which has length %" PRIu64 ". Check your input fasta files.\n",
+                pos, pos + n, (mtfs->fai.name != NULL) ? mtfs->fai.name : "a sequence", mtfs->index);
+        exit(EXIT_FAILURE);
+    }
     char *seq = (char*) st_malloc(n + 1);
     if (strand == '+') {
-        for (uint64_t i = 0; i < n; ++i) {
-            seq[i] = mtfs->seq[pos + i];
-        }
+        copyBases(mtfs, pos, n, seq);
         seq[n] = '\0';
     } else {
-        uint64_t p = mtfs->index - pos - n;
-        for (uint64_t i = 0; i < n; ++i) {
-            seq[i] = mtfs->seq[p + i];
-        }
+        copyBases(mtfs, mtfs->index - pos - n, n, seq);
         seq[n] = '\0';
         reverseComplementSequence(seq, n);
     }
@@ -400,10 +853,7 @@ char* extractSubSequence(mtfseq_t *mtfs, char strand, uint64_t pos, uint64_t n)
 }
 void addMafLineToRow(row_t *row, mafLine_t *ml) {
     // given a row_t and a mafLine_t, add the information from the mafLine_t to the row_t
-    char *seq = maf_mafLine_getSequence(ml);
-    size_t n = strlen(seq);
-    extendSequence(row, n + 1);
-    row_copyIn(row, seq);
+    row_copyIn(row, maf_mafLine_getSequence(ml));
     free(row->prevName);
     row->prevName = stString_copy(maf_mafLine_getSpecies(ml));
     row->prevRightPos = maf_mafLine_getStart(ml) + maf_mafLine_getLength(ml) - 1;
@@ -415,18 +865,24 @@ void addMafLineToRow(row_t *row, mafLine_t *ml) {
 }
 void prependGaps(row_t *r, uint64_t n) {
     // add `n' many gap characters, '-', to the begining of row_t *r
-    extendSequence(r, n + 1);
-    char *new = (char*) st_malloc(r->memLength);
-    new[0] = '\0';
-    for (uint64_t i = 0; i < n; ++i) {
-        new[i] = '-';
+    if (n == 0) {
+        return;
     }
-    new[n] = '\0';
-    if (r->sequence != NULL) {
-        strcat(new, r->sequence);
-        free(r->sequence);
+    if (r->head != NULL && r->head->fill == '-') {
+        r->head->length += n;
+    } else {
+        rowPiece_t *p = (rowPiece_t *) st_malloc(sizeof(*p));
+        p->fill = '-';
+        p->chunk = NULL;
+        p->offset = 0;
+        p->length = n;
+        p->capacity = 0;
+        p->next = r->head;
+        r->head = p;
+        if (r->tail == NULL) {
+            r->tail = p;
+        }
     }
-    r->sequence = new;
     r->index += n;
 }
 uint64_t nearestTwo(uint64_t n) {
@@ -477,6 +933,9 @@ void addMafBlockToRowHash(stHash *alignHash, stHash *seqHash, stList *orderList,
             } else { 
                 r = newRow(2 << 7); // 256 seems like an okay starting point
             }
+            if (options->spill) {
+                row_spill(r, options->tempDir);
+            }
             // empty row_t structure, populate it:
             assert(r->name == NULL);
             assert(r->prevName == NULL);
@@ -569,17 +1028,12 @@ void addMafBlockToRowHash(stHash *alignHash, stHash *seqHash, stList *orderList,
     // printf(">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> RESULTS <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<\n");
     // third loop, gap out all sequences that are in the alignHash but were not in the mafBlock
     while ((key = stHash_getNext(hit)) != NULL) {
-        if (stSet_search(presentSet, key) == NULL) {
+        r = stHash_search(alignHash, key);
+        if (stSet_search(presentSet, key) == NULL && r->index < currentIndex) {
             // this species was not presentSet in the current mafBlock, gap out the sequence.
-            r = stHash_search(alignHash, key);
-            extendSequence(r, 1 + currentIndex - r->index);
-            for (uint64_t i = r->index; i < currentIndex; ++i) {
-                r->sequence[i] = '-';
-            }
-            r->sequence[currentIndex] = '\0';
-            r->index = currentIndex;
+            // a block without any sequence lines leaves the rows as they are.
+            row_appendFill(r, '-', currentIndex - r->index);
         }
-        r = stHash_search(alignHash, key);
         // printf("       result              %20s: %s\n", r->name, r->sequence);
     }
     stSet_destruct(presentSet);
@@ -599,35 +1053,23 @@ void buildAlignmentHash(mafFileApi_t *mfapi, stHash *alignmentHash, stHash *sequ
         maf_destroyMafBlockList(mb);
     }
 }
-void writeFastaOut(stHash *alignmentHash, stList *rowOrder, options_t *options) {
+void writeFastaRows(stHash *alignmentHash, stList *rowOrder, FILE *fa) {
     row_t *r = NULL;
-    FILE *fa = de_fopen(options->outMfa, "w");
-    // printf("printing fasta out!\n");
     for (int64_t i = 0; i < stList_length(rowOrder); ++i) {
         r = stHash_search(alignmentHash, stList_get(rowOrder, i));
         assert(r != NULL);
         fprintf(fa, "> %s\n", r->name);
-        // printf("> %s\n%s\n", r->name, r->sequence);
-        for (uint64_t j = 0; j < r->index; ++j) {
-            fprintf(fa, "%c", r->sequence[j]);
-            if (!((j + 1) % 50) && j != r->index - 1) {
-                fprintf(fa, "\n");
-            }
-        }
+        row_write(r, fa, 50);
         fprintf(fa, "\n");
     }
-    fclose(fa);
 }
-void writeMafOut(stHash *alignmentHash, stList *rowOrder, options_t *options) {
+void writeMafRows(stHash *alignmentHash, stList *rowOrder, FILE *maf) {
+    // write the rows out as a single maf block, or nothing if there are no rows
     row_t *r = NULL;
-    FILE *maf = de_fopen(options->outMaf, "w");
-    // fprintf(stderr, "printing Maf out!\n");
     uint64_t maxName = 1, maxStart = 1, maxLen = 1, maxSource = 1;
     char fmtName[10] = "\0", fmtStart[32] = "\0", fmtLen[32] = "\0", fmtSource[32] = "\0", *fmtLine = NULL;
-    fprintf(maf, "##maf version=1\n\n");
     if (stList_length(rowOrder) == 0) {
         // There's nothing to write out.
-        fclose(maf);
         return;
     }
     for (int64_t i = 0; i < stList_length(rowOrder); ++i) {
@@ -649,20 +1091,21 @@ void writeMafOut(stHash *alignmentHash, stList *rowOrder, options_t *options) {
             maxSource = r->sourceLength;
         }
     }
-    fmtLine = (char*) st_malloc(4 + (int)log10(maxName) + 3 + (int)log10(maxStart) + 3 + (int)log10(maxLen) + 
-                                3 + (int)log10(maxSource) + 4 + r->index);
-    fmtLine[0] = '\0';
     sprintf(fmtName, " %%-%" PRIu64 "s", maxName + 2);
     sprintf(fmtStart, " %%%d" PRIu64, (int)log10(maxStart) + 2);
     sprintf(fmtLen, " %%%d" PRIu64, (int)log10(maxLen) + 2);
     sprintf(fmtSource, " %%%d" PRIu64, (int)log10(maxSource) + 2);
+    // the sequence is written after the line, so the format only needs room for the fields
+    fmtLine = (char*) st_malloc(1 + strlen(fmtName) + strlen(fmtStart) + strlen(fmtLen) + 3 +
+                                strlen(fmtSource) + 2);
+    fmtLine[0] = '\0';
     strcat(fmtLine, "s");
     strcat(fmtLine, fmtName);
     strcat(fmtLine, fmtStart);
     strcat(fmtLine, fmtLen);
     strcat(fmtLine, " %c");
     strcat(fmtLine, fmtSource);
-    strcat(fmtLine, " %s\n");
+    strcat(fmtLine, " ");
     char strand;
     fprintf(maf, "a stitched=true\n");
     // printf("\nPrinting actual block now, fmtline: %s", fmtLine);
@@ -675,9 +1118,122 @@ void writeMafOut(stHash *alignmentHash, stList *rowOrder, options_t *options) {
         } else {
             strand = r->strand;
         }
-        fprintf(maf, fmtLine, r->name, r->start, r->length, strand, r->sourceLength, r->sequence);
+        fprintf(maf, fmtLine, r->name, r->start, r->length, strand, r->sourceLength);
+        row_write(r, maf, 0);
+        fprintf(maf, "\n");
     }
     fprintf(maf, "\n");
     free(fmtLine);
+}
+void writeFastaOut(stHash *alignmentHash, stList *rowOrder, options_t *options) {
+    FILE *fa = de_fopen(options->outMfa, "w");
+    // printf("printing fasta out!\n");
+    writeFastaRows(alignmentHash, rowOrder, fa);
+    fclose(fa);
+}
+void writeMafOut(stHash *alignmentHash, stList *rowOrder, options_t *options) {
+    FILE *maf = de_fopen(options->outMaf, "w");
+    // fprintf(stderr, "printing Maf out!\n");
+    fprintf(maf, "##maf version=1\n\n");
+    writeMafRows(alignmentHash, rowOrder, maf);
     fclose(maf);
 }
+bool isReferenceName(const char *name, const char *reference) {
+    // whether name is the --referenceSequence or, with --partition, one of the sequences of
+    // the --referenceSequence species, reference.*
+    size_t n = strlen(reference);
+    return strncmp(name, reference, n) == 0 && (name[n] == '\0' || name[n] == '.');
+}
+static bool isPartitionKey(mafBlock_t *mb, mafLine_t *ml, void *arg) {
+    // a block is keyed by its first reference sequence, or when there is none or no
+    // --referenceSequence, by its first sequence
+    const char *reference = (const char *) arg;
+    mafLine_t *key = NULL;
+    for (mafLine_t *l = maf_mafBlock_getHeadLine(mb); l != NULL; l = maf_mafLine_getNext(l)) {
+        if (maf_mafLine_getType(l) != 's') {
+            continue;
+        }
+        if (reference != NULL && isReferenceName(maf_mafLine_getSpecies(l), reference)) {
+            key = l;
+            break;
+        }
+        if (key == NULL) {
+            key = l;
+            if (reference == NULL) {
+                break;
+            }
+        }
+    }
+    return ml == key;
+}
+mafPartition_t* partitionMaf(mafFileApi_t *mfapi, const char *tempDir, const char *reference) {
+    // one pass over the maf, spooling each block and grouping it by its key, see
+    // isPartitionKey(). Blocks without sequence lines change nothing and are dropped.
+    return mafPartition_build(mfapi, tempDir, "mafToFastaStitcher", isPartitionKey, (void *) reference);
+}
+typedef struct _partitionStitcher {
+    // what every partition is stitched with and written to
+    stHash *sequenceHash;
+    options_t *options;
+    FILE *fa; // NULL when there is no --outMfa
+    FILE *maf; // NULL when there is no --outMaf
+} partitionStitcher_t;
+typedef struct _stitchedPartition {
+    stHash *alignmentHash;
+    stList *rowOrder;
+} stitchedPartition_t;
+static void* stitchPartition(mafPartition_t *partition, uint64_t p, void *arg) {
+    // with --referenceSequence a partition keyed by a reference sequence is stitched with
+    // that sequence as its reference, just as it would be on its own
+    partitionStitcher_t *stitcher = (partitionStitcher_t *) arg;
+    options_t options = *(stitcher->options);
+    char *key = mafPartition_getPartName(partition, p);
+    options.reference = (options.reference != NULL && isReferenceName(key, options.reference)) ? key : NULL;
+    stitchedPartition_t *stitched = (stitchedPartition_t *) st_malloc(sizeof(*stitched));
+    stitched->alignmentHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, destroyRow);
+    stitched->rowOrder = stList_construct3(0, free);
+    for (uint64_t i = 0; i < mafPartition_getNumberOfPartBlocks(partition, p); ++i) {
+        mafBlock_t *mb = mafPartition_readBlock(partition, p, i);
+        addMafBlockToRowHash(stitched->alignmentHash, stitcher->sequenceHash, stitched->rowOrder, mb, &options);
+        maf_destroyMafBlockList(mb);
+    }
+    return stitched;
+}
+static void writeStitchedPartition(void *built, void *arg) {
+    partitionStitcher_t *stitcher = (partitionStitcher_t *) arg;
+    stitchedPartition_t *stitched = (stitchedPartition_t *) built;
+    if (stitcher->fa != NULL) {
+        writeFastaRows(stitched->alignmentHash, stitched->rowOrder, stitcher->fa);
+    }
+    if (stitcher->maf != NULL) {
+        writeMafRows(stitched->alignmentHash, stitched->rowOrder, stitcher->maf);
+    }
+}
+static void destroyStitchedPartition(void *built, void *arg) {
+    (void) arg;
+    stitchedPartition_t *stitched = (stitchedPartition_t *) built;
+    stHash_destruct(stitched->alignmentHash);
+    stList_destruct(stitched->rowOrder);
+    free(stitched);
+}
+void stitchPartitions(mafPartition_t *partition, stHash *sequenceHash, options_t *options) {
+    // stitch each partition on its own, options->numThreads at a time, and write the outputs one
+    // after another in partition order: one mfa entry per row of each partition and one maf
+    // block per partition.
+    partitionStitcher_t stitcher;
+    stitcher.sequenceHash = sequenceHash;
+    stitcher.options = options;
+    stitcher.fa = (options->outMfa != NULL) ? de_fopen(options->outMfa, "w") : NULL;
+    stitcher.maf = (options->outMaf != NULL) ? de_fopen(options->outMaf, "w") : NULL;
+    if (stitcher.maf != NULL) {
+        fprintf(stitcher.maf, "##maf version=1\n\n");
+    }
+    mafPartition_buildInOrder(partition, options->numThreads, stitchPartition, writeStitchedPartition,
+                              destroyStitchedPartition, &stitcher);
+    if (stitcher.fa != NULL) {
+        fclose(stitcher.fa);
+    }
+    if (stitcher.maf != NULL) {
+        fclose(stitcher.maf);
+    }
+}
@@ -24,10 +24,12 @@
  */
 #ifndef MAFTOFASTASTITCHER_API_H_
 #define MAFTOFASTASTITCHER_API_H_
+#include <pthread.h>
 #include <stdint.h>
 #include "common.h"
 #include "CuTest.h"
 #include "sharedMaf.h"
+#include "mafPartition.h"
 #include "sonLib.h"
 
 typedef struct _options {
@@ -39,20 +41,52 @@ typedef struct _options {
     char *reference;
     uint64_t breakpointPenalty;
     uint64_t interstitialSequence;
+    bool spill; // keep the rows in temporary files rather than in memory
+    char *tempDir; // where --spill keeps the rows and --partition keeps the blocks
+    bool partition; // stitch the blocks of each reference sequence on their own
+    uint64_t numThreads; // number of partitions stitched at once
 } options_t;
+typedef struct _fastaMap {
+    // a memory mapped fasta file, shared by all of the mtfseq_t read from it
+    char *data;
+    uint64_t size;
+    uint64_t refCount;
+} fastaMap_t;
+typedef struct _faiEntry {
+    // one line of a .fai fasta index
+    char *name;
+    uint64_t length; // number of bases
+    uint64_t offset; // byte offset of the first base
+    uint64_t lineBases; // bases on each full line
+    uint64_t lineWidth; // bytes on each full line, including the line ending
+} faiEntry_t;
 typedef struct _sequence {
     // used to store fasta sequence elements
-    char *seq; // DNA sequence
-    uint64_t index; // first empty position in *seq
+    char *seq; // DNA sequence, NULL when the sequence is read from a mapped fasta
+    uint64_t index; // first empty position in *seq, i.e. the length of the sequence
     uint64_t memLength; // size of the *seq buffer
+    fastaMap_t *map; // non-NULL when the bases are read through a .fai index
+    faiEntry_t fai; // where the bases are in map->data
 } mtfseq_t;
+typedef struct _rowPiece {
+    // a piece of a stitched row, either a chunk of characters or a run of `length' copies of
+    // `fill' (gaps or N's) that is never written out until the row is. When the row is spilled
+    // its characters are in the row's spool rather than in chunks.
+    char fill; // '\0' for a chunk or spooled piece
+    char *chunk; // NULL for a run or spooled piece
+    uint64_t offset; // where a spooled piece starts in the spool
+    uint64_t length;
+    uint64_t capacity; // size of the *chunk buffer
+    struct _rowPiece *next;
+} rowPiece_t;
 typedef struct _row {
     // used to store the ultimate output of the utility,
     // a single element of either a multiple fasta alignment (mfa)
     // or a single row in a multiple alignment format (maf) file.
     char *name;
     char *prevName; // 
-    char *sequence;
+    rowPiece_t *head; // the sequence, as a list of pieces
+    rowPiece_t *tail;
     bool multipleNames; // initalized false, if prevName is ever != name, then this should be set permanently true
     uint64_t start; 
     uint64_t length;
@@ -60,15 +94,16 @@ typedef struct _row {
     char strand; // `+' `-' or `*' when both strands have been observed (multipleNames should be set true)
     char prevStrand; //
     uint64_t sourceLength;
-    uint64_t index; // first empty position in *sequence
-    uint64_t memLength; //size of the *sequence buffer
+    uint64_t index; // length of the sequence
+    uint64_t chunkSize; // capacity of the next chunk to be allocated
+    FILE *spool; // non-NULL when the characters of the row are written out to a temporary file
+    uint64_t spooled; // number of characters in the spool
 } row_t;
 
 options_t* options_construct(void);
 void destroyOptions(options_t *o);
 mtfseq_t* newMtfseq(uint64_t length);
 void resizeMtfseq(mtfseq_t *m);
-void resizeRowSequence(row_t *r);
 void destroyMtfseq(void *p);
 row_t* newRow(uint64_t length);
 void destroyRow(void *row);
@@ -77,10 +112,19 @@ stHash* mafBlockToBlockHash(mafBlock_t *mb, stList *orderList);
 stHash* createSequenceHash(char *fastas);
 void seq_copyIn(mtfseq_t *mtfss, char *src);
 void row_copyIn(row_t *row, char *src);
+void row_spill(row_t *row, const char *tempDir);
+void row_appendBases(row_t *row, const char *src, uint64_t n);
+void row_appendFill(row_t *row, char fill, uint64_t n);
+char* row_getSequence(row_t *row);
+void row_write(row_t *row, FILE *f, uint64_t lineLength);
 void addSequencesToHash(stHash *hash, char *filename);
+void destroyFaiEntry(void *p);
+stList* buildFastaIndex(const char *data, uint64_t size);
+stList* readFastaIndex(char *filename, const char *data, uint64_t size);
+void writeFastaIndex(char *filename, stList *entries);
+bool addIndexedSequencesToHash(stHash *hash, char *filename);
 void reportSequenceHash(stHash *hash);
 void penalize(stHash *hash, char *name, uint64_t n);
-void extendSequence(row_t *r, uint64_t n);
 void interstitialInsert(stHash *alignHash, stHash *seqHash, char *name, uint64_t pos, char strand, uint64_t n);
 char* extractSubSequence(mtfseq_t *mtfs, char strand, uint64_t pos, uint64_t n);
 void addMafLineToRow(row_t *row, mafLine_t *ml);
@@ -88,7 +132,12 @@ void addMafBlockToRowHash(stHash *alignHash, stHash *seqHash, stList *order, maf
 void prependGaps(row_t *r, uint64_t n);
 void buildAlignmentHash(mafFileApi_t *mfapi, stHash *alignmentHash, stHash *sequenceHash, 
                         stList *rowOrder, options_t *options);
+void writeFastaRows(stHash *alignmentHash, stList *rowOrder, FILE *fa);
+void writeMafRows(stHash *alignmentHash, stList *rowOrder, FILE *maf);
 void writeFastaOut(stHash *alignmentHash, stList *rowOrder, options_t *options);
 void writeMafOut(stHash *alignmentHash, stList *rowOrder, options_t *options);
+bool isReferenceName(const char *name, const char *reference);
+mafPartition_t* partitionMaf(mafFileApi_t *mfapi, const char *tempDir, const char *reference);
+void stitchPartitions(mafPartition_t *partition, stHash *sequenceHash, options_t *options);
 uint64_t nearestTwo(uint64_t n);
 #endif // MAFTOFASTASTITCHER_API_H_
@@ -378,6 +378,34 @@ class FastaStitchTest(unittest.TestCase):
             self.assertTrue(mafIsCorrect(os.path.abspath(os.path.join(tmpDir, 'out.maf')), outMaf))
             self.assertTrue(mafval.validateMaf(os.path.join(tmpDir, 'out.maf'), customOpts))
         mtt.removeDir(tmpDir)
+    def testFastaStitchPartition(self):
+        """ mafToFastaStitcher --partition should produce the same known output, each known
+        input being a single partition
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('partition'))
+        customOpts = mafval.GenericValidationOptions()
+        for reference, inMaf, inFaList, outFa, outMaf  in g_knownData:
+            testMaf = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'test.maf')),
+                                   ''.join(inMaf), g_headers)
+            testFaNames = testFasta(os.path.abspath(tmpDir), inFaList)
+            parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+            cmd = []
+            cmd += [os.path.abspath(os.path.join(parent, 'test', 'mafToFastaStitcher')),
+                    '--maf', os.path.abspath(os.path.join(tmpDir, 'test.maf')),
+                    '--seqs', testFaNames,
+                    '--breakpointPenalty', '6', '--interstitialSequence', '20',
+                    '--outMfa', os.path.abspath(os.path.join(tmpDir, 'out.fa')),
+                    '--outMaf', os.path.abspath(os.path.join(tmpDir, 'out.maf')),
+                    '--partition', '--threads', '2', '--tempDir', tmpDir,]
+            if reference is not None:
+                cmd += ['--reference', reference]
+            mtt.recordCommands([cmd], tmpDir)
+            mtt.runCommandsS([cmd], tmpDir)
+            self.assertTrue(fastaIsCorrect(os.path.abspath(os.path.join(tmpDir, 'out.fa')), outFa))
+            self.assertTrue(mafIsCorrect(os.path.abspath(os.path.join(tmpDir, 'out.maf')), outMaf))
+            self.assertTrue(mafval.validateMaf(os.path.join(tmpDir, 'out.maf'), customOpts))
+        mtt.removeDir(tmpDir)
     def testMemory1(self):
         """ If valgrind is installed on the system, check for memory related errors (1).
         """
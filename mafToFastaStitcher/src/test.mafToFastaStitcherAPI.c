@@ -40,10 +40,13 @@ static void printBlockHash(stHash *hash, const char *title) {
     char *key = NULL;
     row_t *r = NULL;
     printf("%s:\n", title);
+    char *seq = NULL;
     while ((key = stHash_getNext(hit)) != NULL) {
         r = stHash_search(hash, key);
+        seq = row_getSequence(r);
         printf("%20s %6"PRIu64" %6"PRIu64" %c %9"PRIu64" %s\n", r->name ,r->start, r->length, 
-               r->strand, r->sourceLength, r->sequence);
+               r->strand, r->sourceLength, seq);
+        free(seq);
     }
     stHash_destructIterator(hit);
 }
@@ -69,11 +72,16 @@ static bool rowsAreEqual(row_t *a, row_t *b) {
             return false;
         }
     }
-    if (a->sequence != NULL && b->sequence != NULL) {
-        if (strcmp(a->sequence, b->sequence) != 0) {
-            fprintf(stderr, "%s rows differ: sequences:\n    %s\n    %s\n", a->name, a->sequence, b->sequence);
-            return false;
-        }
+    char *aSeq = row_getSequence(a);
+    char *bSeq = row_getSequence(b);
+    bool sameSeq = (strcmp(aSeq, bSeq) == 0);
+    if (!sameSeq) {
+        fprintf(stderr, "%s rows differ: sequences:\n    %s\n    %s\n", a->name, aSeq, bSeq);
+    }
+    free(aSeq);
+    free(bSeq);
+    if (!sameSeq) {
+        return false;
     }
     if (a->multipleNames != b->multipleNames) {
         fprintf(stderr, "%s rows differ: multipleNames: %d %d\n", a->name, a->multipleNames, b->multipleNames);
@@ -84,8 +92,7 @@ static bool rowsAreEqual(row_t *a, row_t *b) {
         return false;
     }
     if (a->length != b->length) {
-        fprintf(stderr, "%s rows differ: length: %"PRIu64" %"PRIu64"\n"
-                "    %s\n    %s\n", a->name, a->length, b->length, a->sequence, b->sequence);
+        fprintf(stderr, "%s rows differ: length: %"PRIu64" %"PRIu64"\n", a->name, a->length, b->length);
         return false;
     }
     if (a->prevRightPos != b->prevRightPos) {
@@ -106,11 +113,6 @@ static bool rowsAreEqual(row_t *a, row_t *b) {
                 a->sourceLength, b->sourceLength);
         return false;
     }
-    if (a->memLength != b->memLength) {
-        fprintf(stderr, "%s rows differ: memLength: %"PRIu64" %"PRIu64"\n", a->name, 
-                a->memLength, b->memLength);
-        return false;
-    }
     if (a->index != b->index) {
         fprintf(stderr, "%s rows differ: index: %"PRIu64" %"PRIu64"\n", a->name, 
                 a->index, b->index);
@@ -118,6 +120,12 @@ static bool rowsAreEqual(row_t *a, row_t *b) {
     }
     return true;
 }
+static bool rowSequenceIs(row_t *r, const char *expected) {
+    char *seq = row_getSequence(r);
+    bool same = (strcmp(seq, expected) == 0);
+    free(seq);
+    return same && (r->index == strlen(expected));
+}
 static bool hashesAreEqual(stHash *observedHash, stHash *expectedHash) {
     stHashIterator *hit = stHash_getIterator(observedHash);
     char *key;
@@ -238,6 +246,137 @@ static void test_readingFasta_0(CuTest *testCase) {
     }
     stHash_destruct(sequenceHash);
 }
+static void test_readingFasta_1(CuTest *testCase) {
+    // sequences read through a .fai index agree with sequences loaded into memory
+    char *names[] = {"simHuman.chr0", "simHuman.chr1", "simHuman.chr2", "simHuman.chr3"};
+    uint64_t lengths[] = {1, 137, 150, 0};
+    FILE *ofp = de_fopen("testFasta.fa", "w");
+    for (int s = 0; s < 4; ++s) {
+        fprintf(ofp, "> %s some description\n", names[s]);
+        for (uint64_t i = 0; i < lengths[s]; ++i) {
+            fprintf(ofp, "%c", "ACGTacgtN"[st_randomInt(0, 9)]);
+            if (((i + 1) % 50) == 0 || i == lengths[s] - 1) {
+                fprintf(ofp, "\n");
+            }
+        }
+    }
+    fclose(ofp);
+    stHash *loaded = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, destroyMtfseq);
+    addSequencesToHash(loaded, "testFasta.fa");
+    for (int pass = 0; pass < 2; ++pass) {
+        // the first pass builds the index, the second reads it back
+        stHash *indexed = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, destroyMtfseq);
+        CuAssertTrue(testCase, addIndexedSequencesToHash(indexed, "testFasta.fa"));
+        CuAssertTrue(testCase, stHash_size(indexed) == 4);
+        for (int s = 0; s < 4; ++s) {
+            mtfseq_t *a = stHash_search(loaded, names[s]);
+            mtfseq_t *b = stHash_search(indexed, names[s]);
+            CuAssertTrue(testCase, a != NULL && b != NULL);
+            CuAssertTrue(testCase, b->index == lengths[s]);
+            for (uint64_t pos = 0; pos < lengths[s]; pos += 7) {
+                for (uint64_t n = 0; pos + n <= lengths[s]; n += 13) {
+                    char *x = extractSubSequence(a, (n % 2) ? '-' : '+', pos, n);
+                    char *y = extractSubSequence(b, (n % 2) ? '-' : '+', pos, n);
+                    CuAssertStrEquals(testCase, x, y);
+                    free(x);
+                    free(y);
+                }
+            }
+        }
+        stHash_destruct(indexed);
+    }
+    stHash_destruct(loaded);
+    // a fasta with lines of differing lengths cannot be indexed
+    ofp = de_fopen("testFasta.fa", "w");
+    fprintf(ofp, ">simHuman.chr0\nACGT\nACGTACGT\nAC\n");
+    fclose(ofp);
+    stHash *indexed = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, destroyMtfseq);
+    CuAssertTrue(testCase, !addIndexedSequencesToHash(indexed, "testFasta.fa"));
+    CuAssertTrue(testCase, stHash_size(indexed) == 0);
+    stHash_destruct(indexed);
+    if (remove("testFasta.fa") || remove("testFasta.fa.fai")) {
+        fprintf(stderr, "Error, unable to remove temporary file testFasta.fa or its index\n");
+        exit(EXIT_FAILURE);
+    }
+}
+static void checkRandomRows(CuTest *testCase, bool spill) {
+    // a row built from random appends, runs and prepended gaps reads and writes back the same as
+    // a plain string built the same way
+    for (int test = 0; test < 50; ++test) {
+        row_t *r = newRow(st_randomInt(1, 64));
+        if (spill) {
+            row_spill(r, ".");
+        }
+        uint64_t n = 0, capacity = 1 << 16;
+        char *expected = (char *) st_malloc(capacity);
+        char *bases = (char *) st_malloc(capacity);
+        for (int op = 0; op < 40; ++op) {
+            uint64_t k = st_randomInt(0, 1000);
+            if (n + k + 1 >= capacity) {
+                break;
+            }
+            switch (st_randomInt(0, 4)) {
+            case 0:
+                for (uint64_t i = 0; i < k; ++i) {
+                    bases[i] = "ACGTacgt"[st_randomInt(0, 8)];
+                }
+                row_appendBases(r, bases, k);
+                memcpy(expected + n, bases, k);
+                break;
+            case 1:
+                row_appendFill(r, '-', k);
+                memset(expected + n, '-', k);
+                break;
+            case 2:
+                row_appendFill(r, 'N', k);
+                memset(expected + n, 'N', k);
+                break;
+            default:
+                prependGaps(r, k);
+                memmove(expected + k, expected, n);
+                memset(expected, '-', k);
+            }
+            n += k;
+            if (st_randomInt(0, 4) == 0) {
+                // reading a row part way through must not disturb what is appended after
+                expected[n] = '\0';
+                CuAssertTrue(testCase, rowSequenceIs(r, expected));
+            }
+        }
+        expected[n] = '\0';
+        CuAssertTrue(testCase, rowSequenceIs(r, expected));
+        for (uint64_t lineLength = 0; lineLength < 100; lineLength += 50) {
+            // the written row has a newline between every lineLength characters
+            char *wrapped = (char *) st_malloc(2 * n + 1);
+            uint64_t w = 0;
+            for (uint64_t j = 0; j < n; ++j) {
+                if (lineLength > 0 && j > 0 && (j % lineLength) == 0) {
+                    wrapped[w++] = '\n';
+                }
+                wrapped[w++] = expected[j];
+            }
+            FILE *f = tmpfile();
+            row_write(r, f, lineLength);
+            rewind(f);
+            char *observed = (char *) st_malloc(w + 2);
+            CuAssertTrue(testCase, fread(observed, 1, w + 1, f) == w);
+            CuAssertTrue(testCase, memcmp(observed, wrapped, w) == 0);
+            fclose(f);
+            free(observed);
+            free(wrapped);
+        }
+        free(expected);
+        free(bases);
+        destroyRow(r);
+    }
+}
+static void test_row_0(CuTest *testCase) {
+    checkRandomRows(testCase, false);
+}
+static void test_row_1(CuTest *testCase) {
+    // the same rows kept in temporary files
+    checkRandomRows(testCase, true);
+}
 static void test_newBlockHashFromBlock_0(CuTest *testCase) {
     stList *orderList = stList_construct3(0, free);
     stHash *observedHash = createBlockHashFromString("a score=0 test=0\n"
@@ -259,7 +398,7 @@ static void test_newBlockHashFromBlock_0(CuTest *testCase) {
     CuAssertTrue(testCase, key->prevRightPos == 12);
     CuAssertTrue(testCase, key->strand == '+');
     CuAssertTrue(testCase, key->prevStrand == '+');
-    CuAssertTrue(testCase, strcmp(key->sequence, "gcagctgaaaaca") == 0);
+    CuAssertTrue(testCase, rowSequenceIs(key, "gcagctgaaaaca"));
     // row 2
     key = stHash_search(observedHash, "name");
     CuAssertTrue(testCase, key != NULL);
@@ -272,7 +411,7 @@ static void test_newBlockHashFromBlock_0(CuTest *testCase) {
     CuAssertTrue(testCase, key->prevRightPos == 9);
     CuAssertTrue(testCase, key->strand == '+');
     CuAssertTrue(testCase, key->prevStrand == '+');
-    CuAssertTrue(testCase, strcmp(key->sequence, "ATGT---ATGCCG") == 0);
+    CuAssertTrue(testCase, rowSequenceIs(key, "ATGT---ATGCCG"));
     // row 3
     key = stHash_search(observedHash, "name2");
     CuAssertTrue(testCase, key != NULL);
@@ -285,7 +424,7 @@ static void test_newBlockHashFromBlock_0(CuTest *testCase) {
     CuAssertTrue(testCase, key->prevRightPos == 9);
     CuAssertTrue(testCase, key->strand == '+');
     CuAssertTrue(testCase, key->prevStrand == '+');
-    CuAssertTrue(testCase, strcmp(key->sequence, "ATGT---ATGCCG") == 0);
+    CuAssertTrue(testCase, rowSequenceIs(key, "ATGT---ATGCCG"));
     // row 4
     key = stHash_search(observedHash, "name3");
     CuAssertTrue(testCase, key != NULL);
@@ -298,7 +437,7 @@ static void test_newBlockHashFromBlock_0(CuTest *testCase) {
     CuAssertTrue(testCase, key->prevRightPos == 17);
     CuAssertTrue(testCase, key->strand == '-');
     CuAssertTrue(testCase, key->prevStrand == '-');
-    CuAssertTrue(testCase, strcmp(key->sequence, "ATGTgggATGCCG") == 0);
+    CuAssertTrue(testCase, rowSequenceIs(key, "ATGTgggATGCCG"));
     stList_destruct(orderList);
     stHash_destruct(observedHash);
 }
@@ -820,10 +959,281 @@ static void test_addBlockToHash_6(CuTest *testCase) {
     maf_destroyMafBlockList(mb);
     destroyOptions(options);
 }
+static void test_partition_0(CuTest *testCase) {
+    // blocks are grouped by their first sequence, in order of first appearance, and read back
+    // in file order
+    FILE *ofp = de_fopen("testPartition.maf", "w");
+    fprintf(ofp, "##maf version=1\n\n"
+            "a score=0\n"
+            "s ref.chr1 0 3 + 100 ACG\n"
+            "s other.chr1 0 3 + 100 ACG\n\n"
+            "a score=1\n"
+            "s ref.chr0 0 2 + 100 AC\n\n"
+            "a score=2\n"
+            "i no sequence lines\n\n"
+            "a score=3\n"
+            "s ref.chr1 3 1 + 100 T\n"
+            "s other.chr0 0 1 + 100 T\n\n"
+            "a score=4\n"
+            "s ref.chr0 2 2 + 100 GT\n\n");
+    fclose(ofp);
+    mafFileApi_t *mfapi = maf_newMfa("testPartition.maf", "r");
+    mafPartition_t *partition = partitionMaf(mfapi, ".", NULL);
+    maf_destroyMfa(mfapi);
+    if (remove("testPartition.maf")) {
+        fprintf(stderr, "Error, unable to remove temporary file testPartition.maf\n");
+        exit(EXIT_FAILURE);
+    }
+    CuAssertTrue(testCase, mafPartition_getNumberOfBlocks(partition) == 4);
+    CuAssertTrue(testCase, mafPartition_getNumberOfParts(partition) == 2);
+    CuAssertStrEquals(testCase, "ref.chr1", mafPartition_getPartName(partition, 0));
+    CuAssertStrEquals(testCase, "ref.chr0", mafPartition_getPartName(partition, 1));
+    char *expected[] = {"ref.chr1", "ref.chr1", "ref.chr0", "ref.chr0"};
+    uint64_t expectedLengths[] = {3, 1, 2, 2};
+    for (uint64_t i = 0; i < 4; ++i) {
+        CuAssertTrue(testCase, mafPartition_getNumberOfPartBlocks(partition, i / 2) == 2);
+        mafBlock_t *mb = mafPartition_readBlock(partition, i / 2, i % 2);
+        mafLine_t *ml = maf_mafLine_getNext(maf_mafBlock_getHeadLine(mb));
+        CuAssertStrEquals(testCase, expected[i], maf_mafLine_getSpecies(ml));
+        CuAssertTrue(testCase, maf_mafLine_getLength(ml) == expectedLengths[i]);
+        maf_destroyMafBlockList(mb);
+    }
+    mafPartition_destroy(partition);
+}
+static void writeTestFile(const char *filename, const char *contents) {
+    FILE *ofp = de_fopen(filename, "w");
+    fprintf(ofp, "%s", contents);
+    fclose(ofp);
+}
+static char* readTestFile(const char *filename) {
+    // return the contents of filename as a string and remove the file
+    FILE *ifp = de_fopen(filename, "r");
+    uint64_t n = 0, capacity = 1 << 12;
+    char *s = (char *) st_malloc(capacity);
+    int c;
+    while ((c = fgetc(ifp)) != EOF) {
+        if (n + 1 == capacity) {
+            capacity *= 2;
+            s = (char *) realloc(s, capacity);
+            assert(s != NULL);
+        }
+        s[n++] = (char) c;
+    }
+    s[n] = '\0';
+    fclose(ifp);
+    if (remove(filename)) {
+        fprintf(stderr, "Error, unable to remove temporary file %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    return s;
+}
+static stHash* createStitchSeqHash(void) {
+    stHash *seqHash = createSeqHashFromString("ref.chr1", "ACGTccTTAaaaaaaaaaaa");
+    stHash_insert(seqHash, stString_copy("ref.chr2"), newMtfseqFromString("GGCttttttt"));
+    stHash_insert(seqHash, stString_copy("other.chr5"), newMtfseqFromString("ACAgggTTTccccGCCcccc"));
+    stHash_insert(seqHash, stString_copy("third.chr1"), newMtfseqFromString("TTAgggggg"));
+    return seqHash;
+}
+static void stitchPartitionsOf(const char *maf, options_t *options) {
+    stHash *seqHash = createStitchSeqHash();
+    mafFileApi_t *mfapi = maf_newMfa(maf, "r");
+    mafPartition_t *partition = partitionMaf(mfapi, ".", options->reference);
+    maf_destroyMfa(mfapi);
+    stitchPartitions(partition, seqHash, options);
+    mafPartition_destroy(partition);
+    stHash_destruct(seqHash);
+}
+static void test_stitchPartitions_0(CuTest *testCase) {
+    // each reference sequence is stitched on its own, giving the same outputs in the same order
+    // however many threads do the stitching
+    writeTestFile("testStitch.maf", "##maf version=1\n\n"
+                  "a score=0\n"
+                  "s ref.chr1 0 4 + 20 ACGT\n"
+                  "s other.chr5 0 3 + 20 AC-A\n\n"
+                  "a score=0\n"
+                  "s ref.chr2 0 3 + 10 GGC\n"
+                  "s other.chr5 10 3 - 20 GGC\n\n"
+                  "a score=0\n"
+                  "s ref.chr1 6 3 + 20 TTA\n"
+                  "s other.chr5 6 3 + 20 TTT\n"
+                  "s third.chr1 0 3 + 9 TTA\n\n");
+    const char *expectedMfa = ("> ref.chr1\nACGTcc---TTA\n"
+                               "> other.chr5\nAC-A--gggTTT\n"
+                               "> third.chr1\n---------TTA\n"
+                               "> ref.chr2\nGGC\n"
+                               "> other.chr5\nGGC\n");
+    const char *expectedMaf = ("##maf version=1\n\n"
+                               "a stitched=true\n"
+                               "s ref.chr1      0  9 +  20 ACGTcc---TTA\n"
+                               "s other.chr5    0  9 +  20 AC-A--gggTTT\n"
+                               "s third.chr1    0  3 +   9 ---------TTA\n\n"
+                               "a stitched=true\n"
+                               "s ref.chr2       0  3 +  10 GGC\n"
+                               "s other.chr5    10  3 -  20 GGC\n\n");
+    options_t *options = options_construct();
+    options->breakpointPenalty = 3;
+    options->interstitialSequence = 5;
+    options->outMfa = stString_copy("testStitch.mfa");
+    options->outMaf = stString_copy("testStitch.out.maf");
+    for (uint64_t numThreads = 1; numThreads <= 4; numThreads *= 4) {
+        options->numThreads = numThreads;
+        stitchPartitionsOf("testStitch.maf", options);
+        char *observed = readTestFile("testStitch.mfa");
+        CuAssertStrEquals(testCase, expectedMfa, observed);
+        free(observed);
+        observed = readTestFile("testStitch.out.maf");
+        CuAssertStrEquals(testCase, expectedMaf, observed);
+        free(observed);
+    }
+    if (remove("testStitch.maf")) {
+        fprintf(stderr, "Error, unable to remove temporary file testStitch.maf\n");
+        exit(EXIT_FAILURE);
+    }
+    destroyOptions(options);
+}
+static void test_stitchPartitions_1(CuTest *testCase) {
+    // a maf with one reference sequence is one partition, stitched just as it is without --partition
+    writeTestFile("testStitch.maf", "##maf version=1\n\n"
+                  "a score=0\n"
+                  "s ref.chr1 0 4 + 20 ACGT\n"
+                  "s other.chr5 0 3 + 20 AC-A\n\n"
+                  "a score=0\n"
+                  "s ref.chr1 6 3 + 20 TTA\n"
+                  "s other.chr5 6 3 + 20 TTT\n"
+                  "s third.chr1 0 3 + 9 TTA\n\n");
+    options_t *options = options_construct();
+    options->breakpointPenalty = 3;
+    options->interstitialSequence = 5;
+    options->outMfa = stString_copy("testStitch.mfa");
+    options->outMaf = stString_copy("testStitch.out.maf");
+    stHash *seqHash = createStitchSeqHash();
+    stHash *alignmentHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, destroyRow);
+    stList *rowOrder = stList_construct3(0, free);
+    mafFileApi_t *mfapi = maf_newMfa("testStitch.maf", "r");
+    buildAlignmentHash(mfapi, alignmentHash, seqHash, rowOrder, options);
+    maf_destroyMfa(mfapi);
+    writeFastaOut(alignmentHash, rowOrder, options);
+    writeMafOut(alignmentHash, rowOrder, options);
+    char *expectedMfa = readTestFile("testStitch.mfa");
+    char *expectedMaf = readTestFile("testStitch.out.maf");
+    stitchPartitionsOf("testStitch.maf", options);
+    char *observed = readTestFile("testStitch.mfa");
+    CuAssertStrEquals(testCase, expectedMfa, observed);
+    free(observed);
+    observed = readTestFile("testStitch.out.maf");
+    CuAssertStrEquals(testCase, expectedMaf, observed);
+    free(observed);
+    if (remove("testStitch.maf")) {
+        fprintf(stderr, "Error, unable to remove temporary file testStitch.maf\n");
+        exit(EXIT_FAILURE);
+    }
+    free(expectedMfa);
+    free(expectedMaf);
+    stHash_destruct(alignmentHash);
+    stHash_destruct(seqHash);
+    stList_destruct(rowOrder);
+    destroyOptions(options);
+}
+static char* stitchAlone(const char *maf, options_t *options, char **outMaf) {
+    // the mfa and the maf blocks of maf stitched without --partition, removing maf
+    writeTestFile("testStitchAlone.maf", maf);
+    stHash *seqHash = createStitchSeqHash();
+    stHash *alignmentHash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, destroyRow);
+    stList *rowOrder = stList_construct3(0, free);
+    mafFileApi_t *mfapi = maf_newMfa("testStitchAlone.maf", "r");
+    buildAlignmentHash(mfapi, alignmentHash, seqHash, rowOrder, options);
+    maf_destroyMfa(mfapi);
+    writeFastaOut(alignmentHash, rowOrder, options);
+    writeMafOut(alignmentHash, rowOrder, options);
+    char *mfa = readTestFile("testStitch.mfa");
+    char *stitched = readTestFile("testStitch.out.maf");
+    *outMaf = stString_copy(stitched + strlen("##maf version=1\n\n"));
+    free(stitched);
+    if (remove("testStitchAlone.maf")) {
+        fprintf(stderr, "Error, unable to remove temporary file testStitchAlone.maf\n");
+        exit(EXIT_FAILURE);
+    }
+    stHash_destruct(alignmentHash);
+    stHash_destruct(seqHash);
+    stList_destruct(rowOrder);
+    return mfa;
+}
+static void test_stitchPartitions_2(CuTest *testCase) {
+    // with a --referenceSequence species, blocks are grouped by their first row of that species
+    // and each group comes out just as it does stitched on its own with that sequence as the
+    // reference. The block without a ref row joins the group of its first row.
+    const char *blocks[] = {"a score=0\n"
+                            "s other.chr5 0 3 + 20 AC-A\n"
+                            "s ref.chr1 0 4 + 20 ACGT\n\n",
+                            "a score=0\n"
+                            "s ref.chr2 0 3 + 10 GGC\n"
+                            "s other.chr5 10 3 - 20 GGC\n\n",
+                            "a score=0\n"
+                            "s third.chr1 0 3 + 9 TTA\n"
+                            "s ref.chr1 6 3 + 20 TTA\n"
+                            "s other.chr5 6 3 + 20 TTT\n\n",
+                            "a score=0\n"
+                            "s third.chr1 5 2 + 9 GG\n"
+                            "s other.chr5 16 2 + 20 GC\n\n",
+                            "a score=0\n"
+                            "s ref.chr2 7 3 + 10 ttt\n\n"};
+    const char *header = "##maf version=1\n\n";
+    char *maf = stString_print("%s%s%s%s%s%s", header, blocks[0], blocks[1], blocks[2], blocks[3], blocks[4]);
+    const char *groups[][3] = {{"ref.chr1", blocks[0], blocks[2]},
+                               {"ref.chr2", blocks[1], blocks[4]},
+                               {"third.chr1", blocks[3], ""}};
+    options_t *options = options_construct();
+    // the two base gap in ref.chr1 is filled in as reference, not penalized as a breakpoint
+    options->breakpointPenalty = 3;
+    options->interstitialSequence = 1;
+    options->outMfa = stString_copy("testStitch.mfa");
+    options->outMaf = stString_copy("testStitch.out.maf");
+    char *expectedMfa = stString_copy("");
+    char *expectedMaf = stString_copy(header);
+    for (uint64_t g = 0; g < 3; ++g) {
+        options->reference = (strncmp(groups[g][0], "ref.", 4) == 0) ? stString_copy(groups[g][0]) : NULL;
+        char *group = stString_print("%s%s%s", header, groups[g][1], groups[g][2]);
+        char *groupMaf = NULL;
+        char *groupMfa = stitchAlone(group, options, &groupMaf);
+        char *tmp = stString_print("%s%s", expectedMfa, groupMfa);
+        free(expectedMfa);
+        expectedMfa = tmp;
+        tmp = stString_print("%s%s", expectedMaf, groupMaf);
+        free(expectedMaf);
+        expectedMaf = tmp;
+        free(group);
+        free(groupMfa);
+        free(groupMaf);
+        free(options->reference);
+    }
+    writeTestFile("testStitch.maf", maf);
+    options->reference = stString_copy("ref");
+    for (uint64_t numThreads = 1; numThreads <= 4; numThreads *= 4) {
+        options->numThreads = numThreads;
+        stitchPartitionsOf("testStitch.maf", options);
+        char *observed = readTestFile("testStitch.mfa");
+        CuAssertStrEquals(testCase, expectedMfa, observed);
+        free(observed);
+        observed = readTestFile("testStitch.out.maf");
+        CuAssertStrEquals(testCase, expectedMaf, observed);
+        free(observed);
+    }
+    if (remove("testStitch.maf")) {
+        fprintf(stderr, "Error, unable to remove temporary file testStitch.maf\n");
+        exit(EXIT_FAILURE);
+    }
+    free(maf);
+    free(expectedMfa);
+    free(expectedMaf);
+    destroyOptions(options);
+}
 CuSuite* mafToFastaStitcher_TestSuite(void) {
     // listing the tests as void allows us to quickly comment out certain tests
     // when trying to isolate bugs highlighted by one particular test
     (void) test_readingFasta_0;
+    (void) test_readingFasta_1;
+    (void) test_row_0;
+    (void) test_row_1;
     (void) test_newBlockHashFromBlock_0;
     (void) test_addMafLineToRow_0;
     (void) test_addMafLineToRow_1;
@@ -836,8 +1246,15 @@ CuSuite* mafToFastaStitcher_TestSuite(void) {
     (void) test_addBlockToHash_4;
     (void) test_addBlockToHash_5;
     (void) test_addBlockToHash_6;
+    (void) test_partition_0;
+    (void) test_stitchPartitions_0;
+    (void) test_stitchPartitions_1;
+    (void) test_stitchPartitions_2;
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_readingFasta_0);
+    SUITE_ADD_TEST(suite, test_readingFasta_1);
+    SUITE_ADD_TEST(suite, test_row_0);
+    SUITE_ADD_TEST(suite, test_row_1);
     SUITE_ADD_TEST(suite, test_newBlockHashFromBlock_0);
     SUITE_ADD_TEST(suite, test_addMafLineToRow_0);
     SUITE_ADD_TEST(suite, test_addMafLineToRow_1);
@@ -850,5 +1267,9 @@ CuSuite* mafToFastaStitcher_TestSuite(void) {
     SUITE_ADD_TEST(suite, test_addBlockToHash_4);
     SUITE_ADD_TEST(suite, test_addBlockToHash_5);
     SUITE_ADD_TEST(suite, test_addBlockToHash_6);
+    SUITE_ADD_TEST(suite, test_partition_0);
+    SUITE_ADD_TEST(suite, test_stitchPartitions_0);
+    SUITE_ADD_TEST(suite, test_stitchPartitions_1);
+    SUITE_ADD_TEST(suite, test_stitchPartitions_2);
     return suite;
 }
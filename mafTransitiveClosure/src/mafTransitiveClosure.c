@@ -26,12 +26,16 @@
 #include <ctype.h> // mac os x toupper()
 #include <getopt.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "common.h"
 #include "CuTest.h"
 #include "sharedMaf.h"
+#include "mafPartition.h"
 #include "sonLib.h"
 #include "stPinchGraphs.h"
 #include "mafTransitiveClosure.h"
@@ -40,7 +44,15 @@
 
 const uint64_t kPinchThreshold = 50000000;
 const char *g_version = "v0.2 May 2013";
+const uint64_t kBlocksPerThread = 256; // blocks read for each worker thread per batch
+const uint64_t kWriterBufferSize = 1 << 22; // bytes of output gathered before each write
 bool g_isSort = false;
+uint64_t g_numThreads = 1;
+char *g_loadCheckpoint = NULL;
+char *g_saveCheckpoint = NULL;
+bool g_isPartition = false;
+bool g_isCompress = false;
+char *g_tempDir = NULL;
 
 void version(void);
 void usage(void);
@@ -57,6 +69,12 @@ void parseOptions(int argc, char **argv, char *filename) {
             {"test", no_argument, 0, 't'},
             {"maf",  required_argument, 0, 'm'},
             {"sort", no_argument, 0, 's'},
+            {"threads", required_argument, 0, 0},
+            {"loadCheckpoint", required_argument, 0, 0},
+            {"saveCheckpoint", required_argument, 0, 0},
+            {"partition", no_argument, 0, 0},
+            {"tempDir", required_argument, 0, 0},
+            {"compress", no_argument, 0, 0},
             {0, 0, 0, 0}
         };
         int option_index = 0;
@@ -69,6 +87,27 @@ void parseOptions(int argc, char **argv, char *filename) {
                 version();
                 exit(EXIT_SUCCESS);
             }
+            if (strcmp("threads", long_options[option_index].name) == 0) {
+                if (sscanf(optarg, "%" PRIu64, &g_numThreads) != 1 || g_numThreads < 1) {
+                    fprintf(stderr, "Error, --threads must be a positive integer, not %s\n", optarg);
+                    usage();
+                }
+            }
+            if (strcmp("loadCheckpoint", long_options[option_index].name) == 0) {
+                g_loadCheckpoint = de_strdup(optarg);
+            }
+            if (strcmp("saveCheckpoint", long_options[option_index].name) == 0) {
+                g_saveCheckpoint = de_strdup(optarg);
+            }
+            if (strcmp("partition", long_options[option_index].name) == 0) {
+                g_isPartition = true;
+            }
+            if (strcmp("tempDir", long_options[option_index].name) == 0) {
+                g_tempDir = de_strdup(optarg);
+            }
+            if (strcmp("compress", long_options[option_index].name) == 0) {
+                g_isCompress = true;
+            }
             break;
         case 'm':
             setMName = 1;
@@ -98,6 +137,13 @@ void parseOptions(int argc, char **argv, char *filename) {
         fprintf(stderr, "specify --maf\n");
         usage();
     }
+    if (g_isPartition && (g_loadCheckpoint != NULL || g_saveCheckpoint != NULL)) {
+        fprintf(stderr, "Error, --partition can not be used with --loadCheckpoint or --saveCheckpoint\n");
+        usage();
+    }
+    if (g_tempDir == NULL) {
+        g_tempDir = de_strdup((getenv("TMPDIR") != NULL) ? getenv("TMPDIR") : "/tmp");
+    }
     // Check there's nothing left over on the command line 
     if (optind < argc) {
         char *errorString = de_malloc(kMaxStringLength);
@@ -128,7 +174,22 @@ void usage(void) {
             "\n\n");
     fprintf(stderr, "Options: \n");
     usageMessage('h', "help", "show this message and exit.");
-    usageMessage('m', "maf", "path to the maf file.");
+    usageMessage('m', "maf", "path to the maf file. The file is read once, so it may be a pipe.");
+    usageMessage('\0', "threads", "number of threads used to work out the pinches of each block. "
+                 "The pinches are still applied one block at a time in file order, so the output "
+                 "does not depend on the number of threads. default=1.");
+    usageMessage('\0', "loadCheckpoint", "start from a checkpoint written by an earlier run "
+                 "with --saveCheckpoint, so that only the alignments in --maf need to be added "
+                 "to the closure.");
+    usageMessage('\0', "saveCheckpoint", "write the sequences and the pinch graph to this file "
+                 "before reporting, so that a later run can add to the closure.");
+    usageMessage('\0', "partition", "build and report the closure of each connected component of "
+                 "sequences on its own, so that memory is bounded by the largest component rather "
+                 "than the whole alignment. With --threads, that many components are built at once. "
+                 "The blocks are reported one component after another.");
+    usageMessage('\0', "compress", "gzip compress the output.");
+    usageMessage('\0', "tempDir", "with --partition, the directory to keep the blocks of the maf in "
+                 "while the components are worked out. default=$TMPDIR or /tmp.");
     usageMessage('v', "verbose", "turns on verbose output..");
     exit(EXIT_FAILURE);
 }
@@ -138,19 +199,169 @@ uint64_t hashMafTcSeq(const mafTcSeq_t *mtcs) {
 int hashCompareMafTcSeq(const mafTcSeq_t *m1, const mafTcSeq_t *m2) {
     return strcmp(m1->name, m2->name) == 0;
 }
-char* createNSequence(uint64_t length) {
-    char *seq = (char*) de_malloc(length + 1);
-    memset(seq, 'N', length);
-    seq[length] = '\0';
-    return seq;
+static const char kMafTcBases[] = "ACGT";
+static const int kMafTcN = -2; // baseCode() values for N and for any other non ACGT character
+static const int kMafTcException = -1;
+static int cmpMafTcException(const void *a, const void *b) {
+    const mafTcException_t *ea = a, *eb = b;
+    if (ea->start < eb->start) {
+        return -1;
+    }
+    return ea->start > eb->start;
 }
 mafTcSeq_t* newMafTcSeq(char *name, uint64_t length) {
     mafTcSeq_t *mtcs = (mafTcSeq_t *) de_malloc(sizeof(*mtcs));
     mtcs->name = name;
-    mtcs->sequence = createNSequence(length);
+    mtcs->bases = (uint64_t *) st_calloc((length + 31) / 32, sizeof(uint64_t));
+    mtcs->known = (uint64_t *) st_calloc((length + 63) / 64, sizeof(uint64_t));
+    mtcs->exceptions = stSortedSet_construct3(cmpMafTcException, free);
     mtcs->length = length;
+    mtcs->id = 0;
+    mtcs->thread = NULL;
+    return mtcs;
+}
+mafTcSeqTable_t* newMafTcSeqTable(void) {
+    mafTcSeqTable_t *table = (mafTcSeqTable_t *) de_malloc(sizeof(*table));
+    table->names = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, NULL, NULL);
+    table->maxSeqs = 64;
+    table->seqs = (mafTcSeq_t **) de_malloc(sizeof(*(table->seqs)) * table->maxSeqs);
+    table->numSeqs = 0;
+    table->maxNameLength = 0;
+    return table;
+}
+void destroyMafTcSeqTable(mafTcSeqTable_t *table) {
+    for (uint64_t i = 0; i < table->numSeqs; ++i) {
+        destroyMafTcSeq(table->seqs[i]);
+    }
+    stHash_destruct(table->names);
+    free(table->seqs);
+    free(table);
+}
+mafTcSeq_t* mafTcSeqTable_getSeq(mafTcSeqTable_t *table, char *name) {
+    // NULL if name has not been added
+    return stHash_search(table->names, name);
+}
+mafTcSeq_t* mafTcSeqTable_addSeq(mafTcSeqTable_t *table, char *name, uint64_t length) {
+    // intern name, giving it the next id
+    assert(mafTcSeqTable_getSeq(table, name) == NULL);
+    if (table->numSeqs == table->maxSeqs) {
+        table->maxSeqs *= 2;
+        table->seqs = (mafTcSeq_t **) realloc(table->seqs, sizeof(*(table->seqs)) * table->maxSeqs);
+        if (table->seqs == NULL) {
+            fprintf(stderr, "Error, unable to grow the sequence table to %" PRIu64 " sequences\n",
+                    table->maxSeqs);
+            exit(EXIT_FAILURE);
+        }
+    }
+    mafTcSeq_t *mtcs = newMafTcSeq(stString_copy(name), length);
+    mtcs->id = table->numSeqs;
+    table->seqs[table->numSeqs++] = mtcs;
+    stHash_insert(table->names, mtcs->name, mtcs);
+    if (table->maxNameLength < strlen(name)) {
+        table->maxNameLength = strlen(name);
+    }
     return mtcs;
 }
+static int baseCode(char c) {
+    switch (c) {
+    case 'A': case 'a':
+        return 0;
+    case 'C': case 'c':
+        return 1;
+    case 'G': case 'g':
+        return 2;
+    case 'T': case 't':
+        return 3;
+    case 'N': case 'n':
+        return kMafTcN;
+    default:
+        return kMafTcException;
+    }
+}
+static uint64_t spreadBits(uint64_t x) {
+    // turn the low 32 bits of x into 32 two bit fields, 1 -> 11 and 0 -> 00
+    x &= 0xffffffff;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x | (x << 1);
+}
+static bool isKnown(mafTcSeq_t *mtcs, uint64_t pos) {
+    return (mtcs->known[pos >> 6] >> (pos & 63)) & 1;
+}
+static mafTcException_t* findException(mafTcSeq_t *mtcs, uint64_t pos) {
+    if (stSortedSet_size(mtcs->exceptions) == 0) {
+        return NULL;
+    }
+    mafTcException_t key;
+    key.start = pos;
+    mafTcException_t *e = stSortedSet_searchLessThanOrEqual(mtcs->exceptions, &key);
+    if (e != NULL && pos < e->start + e->length) {
+        return e;
+    }
+    return NULL;
+}
+static bool exceptionsOverlap(mafTcSeq_t *mtcs, uint64_t start, uint64_t end) {
+    // does any exception run intersect [start, end)
+    if (stSortedSet_size(mtcs->exceptions) == 0) {
+        return false;
+    }
+    if (findException(mtcs, start) != NULL) {
+        return true;
+    }
+    mafTcException_t key;
+    key.start = start;
+    mafTcException_t *e = stSortedSet_searchGreaterThanOrEqual(mtcs->exceptions, &key);
+    return (e != NULL && e->start < end);
+}
+static void addException(mafTcSeq_t *mtcs, uint64_t start, uint64_t length, char base) {
+    // record a run of a non ACGT character at positions that were not previously known,
+    // joining it to its neighbours where they hold the same character.
+    mafTcException_t key;
+    key.start = start;
+    mafTcException_t *prev = stSortedSet_searchLessThan(mtcs->exceptions, &key);
+    key.start = start + length;
+    mafTcException_t *next = stSortedSet_search(mtcs->exceptions, &key);
+    if (prev != NULL && prev->start + prev->length == start && prev->base == base) {
+        prev->length += length;
+    } else {
+        prev = (mafTcException_t *) de_malloc(sizeof(*prev));
+        prev->start = start;
+        prev->length = length;
+        prev->base = base;
+        stSortedSet_insert(mtcs->exceptions, prev);
+    }
+    if (next != NULL && next->base == base) {
+        prev->length += next->length;
+        stSortedSet_remove(mtcs->exceptions, next);
+        free(next);
+    }
+}
+char mafTcSeq_getBase(mafTcSeq_t *mtcs, uint64_t pos) {
+    // the (upper case) value at pos, N if the position has not been observed
+    if (!isKnown(mtcs, pos)) {
+        return 'N';
+    }
+    mafTcException_t *e = findException(mtcs, pos);
+    if (e != NULL) {
+        return e->base;
+    }
+    return kMafTcBases[(mtcs->bases[pos >> 5] >> ((pos & 31) << 1)) & 3];
+}
+static void setBase(mafTcSeq_t *mtcs, uint64_t pos, char c) {
+    int code = baseCode(c);
+    if (code == kMafTcN || isKnown(mtcs, pos)) {
+        return;
+    }
+    mtcs->known[pos >> 6] |= (uint64_t) 1 << (pos & 63);
+    if (code == kMafTcException) {
+        addException(mtcs, pos, 1, toupper(c));
+    } else {
+        mtcs->bases[pos >> 5] |= (uint64_t) code << ((pos & 31) << 1);
+    }
+}
 int g_mafRegions = 0;
 mafTcRegion_t* newMafTcRegion(uint64_t start, uint64_t end) {
     mafTcRegion_t *reg = (mafTcRegion_t *) de_malloc(sizeof(*reg));
@@ -194,7 +405,9 @@ void destroyMafTcRegion(mafTcRegion_t *r) {
 void destroyMafTcSeq(void *p) {
     // the extra casting here is due to the fact that this is called by the stHash destructor
     free(((mafTcSeq_t *)p)->name);
-    free(((mafTcSeq_t *)p)->sequence);
+    free(((mafTcSeq_t *)p)->bases);
+    free(((mafTcSeq_t *)p)->known);
+    stSortedSet_destruct(((mafTcSeq_t *)p)->exceptions);
     free(p);
 }
 void destroyMafTcComparisonOrder(mafTcComparisonOrder_t *co) {
@@ -206,104 +419,553 @@ void destroyMafTcComparisonOrder(mafTcComparisonOrder_t *co) {
         free(tmp);
     }
 }
-void addSequenceValuesToMtcSeq(mafLine_t *ml, mafTcSeq_t *mtcs) {
-    // add sequence values to maf transitive closure sequence
-    int64_t s; // transformed pos coordinate start (zero based)
-    if (maf_mafLine_getStrand(ml) == '+') {
-        s = maf_mafLine_getStart(ml);
-    } else {
-        // THIS IS A DESTRUCTIVE OPERATION ON THE MAF LINE ml:
-        reverseComplementSequence(maf_mafLine_getSequence(ml), maf_mafLine_getSequenceFieldLength(ml));
-        s = maf_mafLine_getSourceLength(ml) - (maf_mafLine_getStart(ml) + maf_mafLine_getLength(ml));
-    }
+static void addSequenceValuesOneAtATime(mafLine_t *ml, mafTcSeq_t *mtcs, int64_t s) {
+    // the slow path of addSequenceValuesToMtcSeq(), used for stretches that hold exceptions
+    // and to report the first inconsistent position of a line
     char *seq = maf_mafLine_getSequence(ml);
     uint64_t n = maf_mafLine_getSequenceFieldLength(ml);
+    char c;
     for (uint64_t i = 0, p = 0; i < n; ++i) {
         // p is the current position coordinate within the sequence (zero based)
         if (seq[i] != '-') {
-            if (mtcs->sequence[s + p] != 'N') {
+            c = mafTcSeq_getBase(mtcs, s + p);
+            if (c != 'N') {
                 // sanity check
-                if (toupper(mtcs->sequence[s + p]) != toupper(seq[i])) {
+                if (c != toupper(seq[i])) {
                     fprintf(stderr, "Error, maf file is inconsistent with regard to sequence. "
                             "On line number %" PRIu64 " sequence %s position %" PRIu64" is %c, but previously "
                             "observed value is %c.\n", maf_mafLine_getLineNumber(ml), maf_mafLine_getSpecies(ml), 
-                            s + p, seq[i], mtcs->sequence[s + p]);
+                            s + p, seq[i], c);
                     exit(EXIT_FAILURE);
                 }
             }
-            mtcs->sequence[s + p] = toupper(seq[i]);
+            setBase(mtcs, s + p, seq[i]);
             ++p;
         }
     }
 }
-void walkBlockAddingSequence(mafBlock_t *mb, stHash *hash, stHash *nameHash) {
+static bool addPackedWord(mafTcSeq_t *mtcs, uint64_t w, uint64_t word, uint64_t present) {
+    // merge the packed ACGT bases of word w, at the positions set in present, into the sequence.
+    // returns false, leaving the word untouched, if they disagree with a previously observed base.
+    uint64_t known = (mtcs->known[w >> 1] >> ((w & 1) << 5)) & 0xffffffff;
+    if ((mtcs->bases[w] ^ word) & spreadBits(known & present)) {
+        return false;
+    }
+    mtcs->bases[w] = (mtcs->bases[w] & ~spreadBits(present)) | word;
+    mtcs->known[w >> 1] |= present << ((w & 1) << 5);
+    return true;
+}
+void addSequenceValuesToMtcSeq(mafLine_t *ml, mafTcSeq_t *mtcs) {
+    // add sequence values to maf transitive closure sequence. ACGT are gathered into packed words
+    // and checked against the previously observed bases a word at a time.
+    int64_t s; // transformed pos coordinate start (zero based)
+    if (maf_mafLine_getStrand(ml) == '+') {
+        s = maf_mafLine_getStart(ml);
+    } else {
+        // THIS IS A DESTRUCTIVE OPERATION ON THE MAF LINE ml:
+        reverseComplementSequence(maf_mafLine_getSequence(ml), maf_mafLine_getSequenceFieldLength(ml));
+        s = maf_mafLine_getSourceLength(ml) - (maf_mafLine_getStart(ml) + maf_mafLine_getLength(ml));
+    }
+    if (exceptionsOverlap(mtcs, s, s + maf_mafLine_getLength(ml))) {
+        addSequenceValuesOneAtATime(ml, mtcs, s);
+        return;
+    }
+    char *seq = maf_mafLine_getSequence(ml);
+    uint64_t n = maf_mafLine_getSequenceFieldLength(ml);
+    uint64_t word = 0, present = 0, w = ((uint64_t) s) >> 5, q;
+    uint64_t runStart = 0, runLength = 0; // a run of exceptions waiting to be added
+    char runBase = '\0';
+    int code;
+    bool consistent = true;
+    for (uint64_t i = 0, p = 0; i < n; ++i) {
+        if (seq[i] == '-') {
+            continue;
+        }
+        q = s + p++;
+        if ((q >> 5) != w) {
+            if (!addPackedWord(mtcs, w, word, present)) {
+                consistent = false;
+                break;
+            }
+            w = q >> 5;
+            word = 0;
+            present = 0;
+        }
+        code = baseCode(seq[i]);
+        if (code >= 0) {
+            word |= (uint64_t) code << ((q & 31) << 1);
+            present |= (uint64_t) 1 << (q & 31);
+            continue;
+        }
+        if (isKnown(mtcs, q)) {
+            // no exceptions overlap the line so the known value is an ACGT
+            consistent = false;
+            break;
+        }
+        if (code == kMafTcN) {
+            continue;
+        }
+        mtcs->known[q >> 6] |= (uint64_t) 1 << (q & 63);
+        if (runLength > 0 && runStart + runLength == q && runBase == toupper(seq[i])) {
+            ++runLength;
+        } else {
+            if (runLength > 0) {
+                addException(mtcs, runStart, runLength, runBase);
+            }
+            runStart = q;
+            runLength = 1;
+            runBase = toupper(seq[i]);
+        }
+    }
+    if (runLength > 0) {
+        addException(mtcs, runStart, runLength, runBase);
+    }
+    if (consistent && present != 0) {
+        consistent = addPackedWord(mtcs, w, word, present);
+    }
+    if (!consistent) {
+        // the slow path reports the first inconsistent position of the line
+        addSequenceValuesOneAtATime(ml, mtcs, s);
+    }
+}
+void walkBlockAddingSequence(mafBlock_t *mb, mafTcSeqTable_t *table) {
     mafLine_t *ml = maf_mafBlock_getHeadLine(mb);
     mafTcSeq_t *mtcs = NULL;
     char *name = NULL;
     while ((ml = maf_mafLine_getNext(ml)) != NULL) {
         if (maf_mafLine_getType(ml) == 's') {
             name = maf_mafLine_getSpecies(ml);
-            if (stHash_search(hash, name) == NULL) {
-                mtcs = newMafTcSeq(stString_copy(name), maf_mafLine_getSourceLength(ml));
-                addSequenceValuesToMtcSeq(ml, mtcs);
-                stHash_insert(hash, stString_copy(name), mtcs);
-                int64_t *key = (int64_t *)st_malloc(sizeof(*key));
-                *key = (int64_t) stHash_stringKey(name);
-                if (stHash_search(nameHash, key) == NULL) {
-                    stHash_insert(nameHash, key, stString_copy(name));
-                } else {
-                    free(key);
-                }
-            } else {
-                addSequenceValuesToMtcSeq(ml, stHash_search(hash, name));
+            if ((mtcs = mafTcSeqTable_getSeq(table, name)) == NULL) {
+                mtcs = mafTcSeqTable_addSeq(table, name, maf_mafLine_getSourceLength(ml));
             }
+            addSequenceValuesToMtcSeq(ml, mtcs);
         }
     }
 }
-static uint64_t uint64Return(const void *key) {
-    return *((int64_t*) key);
+typedef struct mafTcBatch {
+    // a run of blocks from the maf, with the threads of their rows and their recorded pinches
+    mafBlock_t **blocks;
+    stPinchThread ***threads;
+    mafTcPinches_t **pinches;
+    uint64_t numBlocks;
+    uint64_t maxBlocks;
+} mafTcBatch_t;
+typedef struct mafTcWorker {
+    // walks every step'th block of the batch, starting from first
+    mafTcBatch_t *batch;
+    uint64_t first;
+    uint64_t step;
+} mafTcWorker_t;
+static mafTcBatch_t* newMafTcBatch(uint64_t maxBlocks) {
+    mafTcBatch_t *batch = (mafTcBatch_t *) de_malloc(sizeof(*batch));
+    batch->blocks = (mafBlock_t **) de_malloc(sizeof(*(batch->blocks)) * maxBlocks);
+    batch->threads = (stPinchThread ***) de_malloc(sizeof(*(batch->threads)) * maxBlocks);
+    batch->pinches = (mafTcPinches_t **) de_malloc(sizeof(*(batch->pinches)) * maxBlocks);
+    for (uint64_t i = 0; i < maxBlocks; ++i) {
+        batch->pinches[i] = newMafTcPinches();
+    }
+    batch->numBlocks = 0;
+    batch->maxBlocks = maxBlocks;
+    return batch;
 }
-static int int64EqualKey(const void *key1, const void *key2) {
-    return *((int64_t *) key1) == *((int64_t*) key2);
+static void destroyMafTcBatch(mafTcBatch_t *batch) {
+    for (uint64_t i = 0; i < batch->maxBlocks; ++i) {
+        destroyMafTcPinches(batch->pinches[i]);
+    }
+    free(batch->pinches);
+    free(batch->threads);
+    free(batch->blocks);
+    free(batch);
 }
-void createSequenceHash(mafFileApi_t *mfa, stHash **hash, stHash **nameHash) {
-    *hash = stHash_construct3(stHash_stringKey, stHash_stringEqualKey, free, destroyMafTcSeq);
-    *nameHash = stHash_construct3(uint64Return, int64EqualKey, free, free);
+static void readBatch(mafFileApi_t *mfa, mafTcBatch_t *batch, stPinchThreadSet *threadSet,
+                      mafTcSeqTable_t *table) {
+    // the threads of each block are found as it is read, as that may add to the thread set
+    mafBlock_t *mb = NULL;
+    batch->numBlocks = 0;
+    while (batch->numBlocks < batch->maxBlocks && (mb = maf_readBlock(mfa)) != NULL) {
+        batch->threads[batch->numBlocks] = getBlockThreads(mb, threadSet, table);
+        batch->blocks[batch->numBlocks++] = mb;
+    }
+}
+static void* walkBatch(void *arg) {
+    mafTcWorker_t *worker = (mafTcWorker_t *) arg;
+    mafTcBatch_t *batch = worker->batch;
+    for (uint64_t i = worker->first; i < batch->numBlocks; i += worker->step) {
+        walkBlockGettingPinches(batch->blocks[i], batch->threads[i], batch->pinches[i]);
+    }
+    return NULL;
+}
+static void applyBatch(mafTcBatch_t *batch, mafTcSeqTable_t *table) {
+    // pinch and record the residues of each block in file order, just as the serial path does
+    for (uint64_t i = 0; i < batch->numBlocks; ++i) {
+        applyPinches(batch->pinches[i]);
+        walkBlockAddingSequence(batch->blocks[i], table);
+        maf_destroyMafBlockList(batch->blocks[i]);
+        free(batch->threads[i]);
+    }
+    batch->numBlocks = 0;
+}
+static void addAlignmentsInParallel(mafFileApi_t *mfa, stPinchThreadSet *threadSet, mafTcSeqTable_t *table) {
+    // while the workers walk one batch of blocks the main thread applies the pinches of the
+    // previous batch and reads the next one. Only the main thread touches the pinch graph.
+    mafTcBatch_t *walking = newMafTcBatch(kBlocksPerThread * g_numThreads);
+    mafTcBatch_t *walked = newMafTcBatch(kBlocksPerThread * g_numThreads);
+    mafTcBatch_t *tmp = NULL;
+    pthread_t *threads = (pthread_t *) de_malloc(sizeof(*threads) * g_numThreads);
+    mafTcWorker_t *workers = (mafTcWorker_t *) de_malloc(sizeof(*workers) * g_numThreads);
+    readBatch(mfa, walking, threadSet, table);
+    while (walking->numBlocks > 0) {
+        for (uint64_t t = 0; t < g_numThreads; ++t) {
+            workers[t].batch = walking;
+            workers[t].first = t;
+            workers[t].step = g_numThreads;
+            if (pthread_create(&(threads[t]), NULL, walkBatch, &(workers[t])) != 0) {
+                fprintf(stderr, "Error, unable to create thread for addAlignmentsInParallel()\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        applyBatch(walked, table);
+        readBatch(mfa, walked, threadSet, table);
+        for (uint64_t t = 0; t < g_numThreads; ++t) {
+            pthread_join(threads[t], NULL);
+        }
+        tmp = walking;
+        walking = walked;
+        walked = tmp;
+    }
+    applyBatch(walked, table);
+    free(threads);
+    free(workers);
+    destroyMafTcBatch(walking);
+    destroyMafTcBatch(walked);
+}
+static void addAlignments(mafFileApi_t *mfa, stPinchThreadSet *threadSet, mafTcSeqTable_t *table) {
     mafBlock_t *mb = NULL;
     while ((mb = maf_readBlock(mfa)) != NULL) {
-        walkBlockAddingSequence(mb, *hash, *nameHash);
+        // the pinching works on a copy of the block while recording residues reverse
+        // complements the negative strand lines in place, so it has to come second.
+        walkBlockAddingAlignments(mb, threadSet, table);
+        walkBlockAddingSequence(mb, table);
         maf_destroyMafBlockList(mb);
     }
 }
-void reportSequenceHash(stHash *hash, stHash *nameHash) {
-    stHashIterator *hit = stHash_getIterator(hash);
-    char *key = NULL;
-    printf("Sequence Hash:\n");
-    while ((key = stHash_getNext(hit)) != NULL) {
-        printf("found key: %s: ", key);
-        printf("length: %" PRIu64 "\n", ((mafTcSeq_t *)stHash_search(hash, key))->length);
-        printf("   %s\n", ((mafTcSeq_t *)stHash_search(hash, key))->sequence);
-    }
-    stHash_destructIterator(hit);
-    hit = stHash_getIterator(nameHash);
-    key = NULL;
-    printf("Name Hash:\n");
-    while ((key = stHash_getNext(hit)) != NULL) {
-        printf("found key: %" PRIi64 ": ", *((int64_t *)key));
-        printf("value: %s\n", ((char *)stHash_search(nameHash, key)));
-    }
-    stHash_destructIterator(hit);
-}
-stPinchThreadSet* buildThreadSet(stHash *hash) {
-    stPinchThreadSet *ts = stPinchThreadSet_construct();
-    stHashIterator *hit = stHash_getIterator(hash);
-    char *key = NULL;
-    while ((key = stHash_getNext(hit)) != NULL) {
-        stPinchThreadSet_addThread(ts, stHash_stringKey(key), 0, 
-                                   ((mafTcSeq_t *)stHash_search(hash, key))->length);
-    }
-    stHash_destructIterator(hit);
-    return ts;
+void buildThreadSet(mafFileApi_t *mfa, stPinchThreadSet *threadSet, mafTcSeqTable_t *table) {
+    // a single pass over the maf, adding it to threadSet, which is empty or holds a loaded
+    // checkpoint. Threads are added the first time their sequence is seen, since source
+    // lengths are on every line, each block is pinched into the thread set and then its
+    // residues are recorded in the sequence table.
+    if (g_numThreads > 1) {
+        addAlignmentsInParallel(mfa, threadSet, table);
+    } else {
+        addAlignments(mfa, threadSet, table);
+    }
+    stPinchThreadSet_joinTrivialBoundaries(threadSet);
+}
+/* A checkpoint holds everything a later run needs to carry on from this one, in native byte
+   order: the magic string, then the number of sequences and for each one, in id order, its
+   name length, name, length, whether it has a thread, its packed bases, its known bitmap and
+   its exceptions. Last come the number of blocks and for each block its degree and then the
+   thread name, start, length and orientation of each segment. Segments outside of any block
+   are not written, they are rebuilt from the thread lengths. */
+static const char kMafTcCheckpointMagic[] = "mafTcCk1";
+static void writeCheckpoint(const void *p, size_t size, size_t n, FILE *ofp, char *filename) {
+    if (fwrite(p, size, n, ofp) != n) {
+        fprintf(stderr, "Error, unable to write to checkpoint %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+}
+static void writeCheckpointValue(uint64_t v, FILE *ofp, char *filename) {
+    writeCheckpoint(&v, sizeof(v), 1, ofp, filename);
+}
+static void consumeCheckpoint(uint64_t *remaining, uint64_t count, uint64_t size, char *filename) {
+    // take count items of size bytes from the unread part of a checkpoint, exiting if they
+    // aren't there. Checked before anything is allocated, so a damaged count can not become
+    // an enormous allocation.
+    if (count > *remaining / size) {
+        fprintf(stderr, "Error, checkpoint %s is truncated or is not a mafTransitiveClosure "
+                "checkpoint, it lists %" PRIu64 " items of %" PRIu64 " bytes with only %" PRIu64
+                " bytes left\n", filename, count, size, *remaining);
+        exit(EXIT_FAILURE);
+    }
+    *remaining -= count * size;
+}
+static void readCheckpoint(void *p, size_t size, size_t n, FILE *ifp, char *filename) {
+    if (fread(p, size, n, ifp) != n) {
+        fprintf(stderr, "Error, checkpoint %s is truncated or is not a mafTransitiveClosure "
+                "checkpoint\n", filename);
+        exit(EXIT_FAILURE);
+    }
+}
+static uint64_t readCheckpointValue(FILE *ifp, char *filename, uint64_t *remaining) {
+    uint64_t v;
+    consumeCheckpoint(remaining, 1, sizeof(v), filename);
+    readCheckpoint(&v, sizeof(v), 1, ifp, filename);
+    return v;
+}
+void saveCheckpoint(char *filename, stPinchThreadSet *threadSet, mafTcSeqTable_t *table) {
+    FILE *ofp = de_fopen(filename, "wb");
+    writeCheckpoint(kMafTcCheckpointMagic, 1, strlen(kMafTcCheckpointMagic), ofp, filename);
+    writeCheckpointValue(table->numSeqs, ofp, filename);
+    mafTcSeq_t *mtcs = NULL;
+    mafTcException_t *e = NULL;
+    for (uint64_t i = 0; i < table->numSeqs; ++i) {
+        mtcs = table->seqs[i];
+        writeCheckpointValue(strlen(mtcs->name), ofp, filename);
+        writeCheckpoint(mtcs->name, 1, strlen(mtcs->name), ofp, filename);
+        writeCheckpointValue(mtcs->length, ofp, filename);
+        writeCheckpointValue(mtcs->thread != NULL, ofp, filename);
+        writeCheckpoint(mtcs->bases, sizeof(uint64_t), (mtcs->length + 31) / 32, ofp, filename);
+        writeCheckpoint(mtcs->known, sizeof(uint64_t), (mtcs->length + 63) / 64, ofp, filename);
+        writeCheckpointValue(stSortedSet_size(mtcs->exceptions), ofp, filename);
+        stSortedSetIterator *sit = stSortedSet_getIterator(mtcs->exceptions);
+        while ((e = stSortedSet_getNext(sit)) != NULL) {
+            writeCheckpointValue(e->start, ofp, filename);
+            writeCheckpointValue(e->length, ofp, filename);
+            writeCheckpointValue((uint64_t) e->base, ofp, filename);
+        }
+        stSortedSet_destructIterator(sit);
+    }
+    uint64_t numBlocks = 0;
+    stPinchBlock *block = NULL;
+    stPinchThreadSetBlockIt bit = stPinchThreadSet_getBlockIt(threadSet);
+    while ((block = stPinchThreadSetBlockIt_getNext(&bit)) != NULL) {
+        ++numBlocks;
+    }
+    writeCheckpointValue(numBlocks, ofp, filename);
+    stPinchSegment *seg = NULL;
+    bit = stPinchThreadSet_getBlockIt(threadSet);
+    while ((block = stPinchThreadSetBlockIt_getNext(&bit)) != NULL) {
+        writeCheckpointValue(stPinchBlock_getDegree(block), ofp, filename);
+        stPinchBlockIt sit = stPinchBlock_getSegmentIterator(block);
+        while ((seg = stPinchBlockIt_getNext(&sit)) != NULL) {
+            writeCheckpointValue((uint64_t) stPinchSegment_getName(seg), ofp, filename);
+            writeCheckpointValue((uint64_t) stPinchSegment_getStart(seg), ofp, filename);
+            writeCheckpointValue((uint64_t) stPinchSegment_getLength(seg), ofp, filename);
+            writeCheckpointValue(stPinchSegment_getBlockOrientation(seg), ofp, filename);
+        }
+    }
+    if (fclose(ofp) != 0) {
+        fprintf(stderr, "Error, unable to write to checkpoint %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+}
+void loadCheckpoint(char *filename, stPinchThreadSet *threadSet, mafTcSeqTable_t *table) {
+    // fill an empty table and thread set from a checkpoint made by saveCheckpoint(). Each
+    // block is rebuilt by pinching its first segment to each of the others, so the time taken
+    // goes with the size of the closure rather than with the mafs that were used to make it.
+    // Every count is checked against what is left of the file before it is acted on.
+    FILE *ifp = de_fopen(filename, "rb");
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        fprintf(stderr, "Error, unable to stat checkpoint %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t remaining = (uint64_t) st.st_size;
+    char magic[sizeof(kMafTcCheckpointMagic)] = {0};
+    consumeCheckpoint(&remaining, strlen(kMafTcCheckpointMagic), 1, filename);
+    readCheckpoint(magic, 1, strlen(kMafTcCheckpointMagic), ifp, filename);
+    if (strcmp(magic, kMafTcCheckpointMagic) != 0) {
+        fprintf(stderr, "Error, %s is not a mafTransitiveClosure checkpoint\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t numSeqs = readCheckpointValue(ifp, filename, &remaining);
+    mafTcSeq_t *mtcs = NULL;
+    for (uint64_t i = 0; i < numSeqs; ++i) {
+        uint64_t nameLength = readCheckpointValue(ifp, filename, &remaining);
+        consumeCheckpoint(&remaining, nameLength, 1, filename);
+        char *name = (char *) de_malloc(nameLength + 1);
+        readCheckpoint(name, 1, nameLength, ifp, filename);
+        name[nameLength] = '\0';
+        if (mafTcSeqTable_getSeq(table, name) != NULL) {
+            fprintf(stderr, "Error, checkpoint %s lists sequence %s twice\n", filename, name);
+            exit(EXIT_FAILURE);
+        }
+        uint64_t length = readCheckpointValue(ifp, filename, &remaining);
+        bool hasThread = readCheckpointValue(ifp, filename, &remaining);
+        // the packed bases and the known bitmap, without rounding length up past UINT64_MAX
+        consumeCheckpoint(&remaining, length / 32 + (length % 32 != 0), sizeof(uint64_t), filename);
+        consumeCheckpoint(&remaining, length / 64 + (length % 64 != 0), sizeof(uint64_t), filename);
+        mtcs = mafTcSeqTable_addSeq(table, name, length);
+        free(name);
+        if (hasThread) {
+            mtcs->thread = stPinchThreadSet_addThread(threadSet, mtcs->id, 0, mtcs->length);
+        }
+        readCheckpoint(mtcs->bases, sizeof(uint64_t), (mtcs->length + 31) / 32, ifp, filename);
+        readCheckpoint(mtcs->known, sizeof(uint64_t), (mtcs->length + 63) / 64, ifp, filename);
+        uint64_t numExceptions = readCheckpointValue(ifp, filename, &remaining);
+        consumeCheckpoint(&remaining, numExceptions, 3 * sizeof(uint64_t), filename);
+        for (uint64_t j = 0; j < numExceptions; ++j) {
+            mafTcException_t *e = (mafTcException_t *) de_malloc(sizeof(*e));
+            readCheckpoint(&(e->start), sizeof(uint64_t), 1, ifp, filename);
+            readCheckpoint(&(e->length), sizeof(uint64_t), 1, ifp, filename);
+            uint64_t base;
+            readCheckpoint(&base, sizeof(base), 1, ifp, filename);
+            e->base = (char) base;
+            stSortedSet_insert(mtcs->exceptions, e);
+        }
+    }
+    uint64_t numBlocks = readCheckpointValue(ifp, filename, &remaining);
+    for (uint64_t i = 0; i < numBlocks; ++i) {
+        uint64_t degree = readCheckpointValue(ifp, filename, &remaining);
+        stPinchThread *first = NULL;
+        int64_t firstStart = 0;
+        bool firstOrientation = true;
+        for (uint64_t j = 0; j < degree; ++j) {
+            uint64_t id = readCheckpointValue(ifp, filename, &remaining);
+            int64_t start = (int64_t) readCheckpointValue(ifp, filename, &remaining);
+            int64_t length = (int64_t) readCheckpointValue(ifp, filename, &remaining);
+            bool orientation = readCheckpointValue(ifp, filename, &remaining);
+            if (id >= table->numSeqs || table->seqs[id]->thread == NULL ||
+                start < 0 || length < 1 || (uint64_t) (start + length) > table->seqs[id]->length) {
+                fprintf(stderr, "Error, checkpoint %s has a block segment that is not on any "
+                        "of its threads\n", filename);
+                exit(EXIT_FAILURE);
+            }
+            if (j == 0) {
+                first = table->seqs[id]->thread;
+                firstStart = start;
+                firstOrientation = orientation;
+            } else {
+                stPinchThread_pinch(first, table->seqs[id]->thread, firstStart, start, length,
+                                    firstOrientation == orientation);
+            }
+        }
+    }
+    fclose(ifp);
+}
+mafTcWriter_t* newMafTcWriter(bool compress) {
+    mafTcWriter_t *writer = (mafTcWriter_t *) de_malloc(sizeof(*writer));
+    writer->size = kWriterBufferSize;
+    writer->buffer = (char *) de_malloc(writer->size);
+    writer->used = 0;
+    writer->gz = NULL;
+    if (compress && (writer->gz = gzdopen(STDOUT_FILENO, "wb")) == NULL) {
+        fprintf(stderr, "Error, unable to open stdout for compressed output\n");
+        exit(EXIT_FAILURE);
+    }
+    return writer;
+}
+void mafTcWriter_flush(mafTcWriter_t *writer) {
+    if (writer->used == 0) {
+        return;
+    }
+    if (writer->gz != NULL) {
+        if (gzwrite(writer->gz, writer->buffer, (unsigned) writer->used) != (int) writer->used) {
+            fprintf(stderr, "Error, unable to write compressed output\n");
+            exit(EXIT_FAILURE);
+        }
+    } else if (fwrite(writer->buffer, 1, writer->used, stdout) != writer->used) {
+        fprintf(stderr, "Error, unable to write output\n");
+        exit(EXIT_FAILURE);
+    }
+    writer->used = 0;
+}
+void destroyMafTcWriter(mafTcWriter_t *writer) {
+    mafTcWriter_flush(writer);
+    if (writer->gz != NULL) {
+        if (gzclose(writer->gz) != Z_OK) {
+            fprintf(stderr, "Error, unable to write compressed output\n");
+            exit(EXIT_FAILURE);
+        }
+    } else if (fflush(stdout) != 0) {
+        fprintf(stderr, "Error, unable to write output\n");
+        exit(EXIT_FAILURE);
+    }
+    free(writer->buffer);
+    free(writer);
+}
+static char* reserveOutput(mafTcWriter_t *writer, uint64_t n) {
+    // room for n more bytes, returned as a pointer into the buffer. The caller fills them.
+    if (writer->used + n > writer->size) {
+        mafTcWriter_flush(writer);
+        if (n > writer->size) {
+            // a segment longer than the buffer
+            free(writer->buffer);
+            writer->size = n;
+            writer->buffer = (char *) de_malloc(writer->size);
+        }
+    }
+    char *p = writer->buffer + writer->used;
+    writer->used += n;
+    return p;
+}
+static void writeString(mafTcWriter_t *writer, const char *s, uint64_t n) {
+    memcpy(reserveOutput(writer, n), s, n);
+}
+static void writePadding(mafTcWriter_t *writer, uint64_t n) {
+    memset(reserveOutput(writer, n), ' ', n);
+}
+static void writeNumber(mafTcWriter_t *writer, uint64_t x, uint64_t width) {
+    // x right justified in a field of width characters
+    uint64_t digits = countDigits(x);
+    if (width < digits) {
+        width = digits;
+    }
+    char *p = reserveOutput(writer, width);
+    memset(p, ' ', width - digits);
+    for (char *q = p + width - 1; digits > 0; --digits, --q) {
+        *q = '0' + (x % 10);
+        x /= 10;
+    }
+}
+void buildPartitionComponent(mafPartition_t *partition, uint64_t c, stPinchThreadSet *threadSet,
+                             mafTcSeqTable_t *table) {
+    // read the blocks of component c back out of the spool, in file order, and add them to
+    // the (empty) thread set and table just as addAlignments() does.
+    for (uint64_t i = 0; i < mafPartition_getNumberOfPartBlocks(partition, c); ++i) {
+        mafBlock_t *mb = mafPartition_readBlock(partition, c, i);
+        walkBlockAddingAlignments(mb, threadSet, table);
+        walkBlockAddingSequence(mb, table);
+        maf_destroyMafBlockList(mb);
+    }
+    stPinchThreadSet_joinTrivialBoundaries(threadSet);
+}
+typedef struct mafTcComponent {
+    // a component built by buildComponent(), waiting for its turn to be reported
+    mafTcSeqTable_t *table;
+    stPinchThreadSet *threadSet;
+} mafTcComponent_t;
+static void* buildComponent(mafPartition_t *partition, uint64_t c, void *arg) {
+    (void) arg;
+    mafTcComponent_t *component = (mafTcComponent_t *) de_malloc(sizeof(*component));
+    component->table = newMafTcSeqTable();
+    component->threadSet = stPinchThreadSet_construct();
+    buildPartitionComponent(partition, c, component->threadSet, component->table);
+    return component;
+}
+static void reportComponent(void *built, void *arg) {
+    mafTcComponent_t *component = (mafTcComponent_t *) built;
+    reportTransitiveClosureBlocks(component->threadSet, component->table, (mafTcWriter_t *) arg);
+}
+static void destroyComponent(void *built, void *arg) {
+    (void) arg;
+    mafTcComponent_t *component = (mafTcComponent_t *) built;
+    destroyMafTcSeqTable(component->table);
+    stPinchThreadSet_destruct(component->threadSet);
+    free(component);
+}
+mafPartition_t* partitionMaf(mafFileApi_t *mfa, const char *tempDir) {
+    // one pass over the maf, spooling the blocks and joining the sequences that share a block
+    // into connected components, numbered in order of first appearance.
+    return mafPartition_build(mfa, tempDir, "mafTransitiveClosure", NULL, NULL);
+}
+void reportPartitionedTransitiveClosure(mafPartition_t *partition, mafTcWriter_t *writer) {
+    // build and report each component in turn, g_numThreads at a time
+    reportTransitiveClosureHeader(writer);
+    mafPartition_buildInOrder(partition, g_numThreads, buildComponent, reportComponent,
+                              destroyComponent, writer);
+    writeString(writer, "\n", 1);
+}
+void reportSequenceTable(mafTcSeqTable_t *table) {
+    printf("Sequence Table:\n");
+    for (uint64_t i = 0; i < table->numSeqs; ++i) {
+        mafTcSeq_t *mtcs = table->seqs[i];
+        printf("id: %" PRIu64 ": %s: ", mtcs->id, mtcs->name);
+        printf("length: %" PRIu64 "\n", mtcs->length);
+        char *seq = getSequenceSubset(mtcs, 0, '+', mtcs->length);
+        printf("   %s\n", seq);
+        free(seq);
+    }
 }
 mafTcComparisonOrder_t *getComparisonOrderFromMatrix(char **mat, uint64_t numRows, uint64_t numCols, 
                                                      uint64_t *lengths, int **vizMat) {
@@ -318,133 +980,166 @@ mafTcComparisonOrder_t *getComparisonOrderFromMatrix(char **mat, uint64_t numRow
        ..-.**-...-*.
        ......*...*..
        where * represent the comparison "reference" and . represent some non-gap character.
+       The work is done by getComparisonsFromMatrix(), this only turns its array into a list.
     */
-    mafTcRegion_t *todo = newMafTcRegion(0, numCols - 1); // the entire region needs to be done
-    mafTcComparisonOrder_t *co = NULL;
-    uint64_t r = 0;
+    mafTcComparison_t *comparisons = NULL;
+    uint64_t n = getComparisonsFromMatrix(mat, numRows, numCols, lengths, &comparisons);
+    mafTcComparisonOrder_t *co = NULL, *head = NULL;
+    for (uint64_t i = 0; i < n; ++i) {
+        // insert into the start of the list
+        co = newMafTcComparisonOrder();
+        co->ref = comparisons[i].ref;
+        co->region = newMafTcRegion(comparisons[i].start, comparisons[i].end);
+        co->next = head;
+        head = co;
+    }
+    free(comparisons);
     if (g_debug_flag) {
-        printTodoArray(todo, numCols);
+        updateVizMatrix(vizMat, head);
         printVizMatrix(vizMat, numRows, numCols);
     }
-    while (todo != NULL && r < numRows) {
-        todo = getComparisonOrderFromRow(mat, r, &co, todo, (lengths[r] != numCols));
-        r++;
-        if (g_debug_flag) {            
-            updateVizMatrix(vizMat, co);
-            printTodoArray(todo, numCols);
-            printVizMatrix(vizMat, numRows, numCols);
+    return head;
+}
+static uint64_t gapWord(const char *s, uint64_t w, uint64_t numCols) {
+    // bit i is set when column 64 * w + i of s is a gap
+    uint64_t start = w * 64;
+    uint64_t n = (numCols - start < 64) ? numCols - start : 64;
+    uint64_t g = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        g |= (uint64_t) (s[start + i] == '-') << i;
+    }
+    return g;
+}
+mafTcBlockIndex_t* newMafTcBlockIndex(char **mat, uint64_t numRows, uint64_t numCols, uint64_t *lengths) {
+    // lengths holds the number of bases in each row, rows without gaps are not scanned.
+    mafTcBlockIndex_t *index = (mafTcBlockIndex_t*) de_malloc(sizeof(*index));
+    index->numRows = numRows;
+    index->numCols = numCols;
+    index->numWords = (numCols + 63) / 64;
+    index->gaps = (uint64_t*) de_malloc(sizeof(uint64_t) * (numRows * index->numWords + 1));
+    index->bases = (uint64_t*) de_malloc(sizeof(uint64_t) * (numRows * index->numWords + 1));
+    // columns past the end of the block count as gaps so that runs stop there
+    uint64_t tail = (numCols % 64) ? ~((1ULL << (numCols % 64)) - 1) : 0;
+    for (uint64_t r = 0; r < numRows; ++r) {
+        uint64_t *g = index->gaps + r * index->numWords;
+        uint64_t *b = index->bases + r * index->numWords;
+        uint64_t bases = 0;
+        for (uint64_t w = 0; w < index->numWords; ++w) {
+            g[w] = (lengths[r] == numCols) ? 0 : gapWord(mat[r], w, numCols);
+            if (w == index->numWords - 1) {
+                g[w] |= tail;
+            }
+            b[w] = bases;
+            bases += (uint64_t) __builtin_popcountll(~g[w]);
         }
     }
-    destroyMafTcRegionList(todo);
-    return co;
+    return index;
+}
+void destroyMafTcBlockIndex(mafTcBlockIndex_t *index) {
+    if (index == NULL) {
+        return;
+    }
+    free(index->gaps);
+    free(index->bases);
+    free(index);
+}
+uint64_t mafTcBlockIndex_getPosition(mafTcBlockIndex_t *index, uint64_t row, uint64_t col) {
+    // the number of bases in row before column col, ie the local sequence coordinate of col
+    uint64_t i = row * index->numWords + (col >> 6);
+    return index->bases[i] + (uint64_t) __builtin_popcountll(~index->gaps[i] & ((1ULL << (col & 63)) - 1));
 }
-mafTcRegion_t* getComparisonOrderFromRow(char **mat, uint64_t row, mafTcComparisonOrder_t **done, 
-                                         mafTcRegion_t *todo, int containsGaps) {
-    // proudce a comparison order given a sequence matrix (mat), a row index (row), a list of already
-    // completed regions (done) and a list of regions that still need to be done (todo)
-    mafTcRegion_t *newTodo = NULL, *newTodoTail = NULL;
-    mafTcRegion_t *headTodo = todo;
-    mafTcComparisonOrder_t *co = NULL;
-    bool inGap;
-    de_debug("getComparisonOrderFromRow(mat, %u, done, todo)\n", row);
-    while (todo != NULL) {
-        // walk the todo linked list and see if we can fill in any regions with the current row.
-        de_debug("starting to walk todo [%" PRIu64 ", %" PRIu64 "]\n", todo->start, todo->end);
-        inGap = false;
-        if (containsGaps == 0) {
-            // if this row does not contain gaps we can shortcut this by accepting all todo regions.
-            co = newMafTcComparisonOrder();
-            co->ref = row;
-            co->region = newMafTcRegion(todo->start, todo->end);
-            de_debug("creating new region for row:%" PRIu64 ", position %" PRIu64 "\n", row, todo->start);
-            // insert into the start of the list
-            if (done != NULL) {
-                co->next = *done;
+static void addComparison(mafTcComparison_t **comparisons, uint64_t *n, uint64_t *max,
+                          uint64_t ref, uint64_t start, uint64_t end) {
+    if (*n == *max) {
+        *max *= 2;
+        *comparisons = (mafTcComparison_t *) realloc(*comparisons, sizeof(**comparisons) * *max);
+        if (*comparisons == NULL) {
+            fprintf(stderr, "Error, unable to grow the comparison order to %" PRIu64 " comparisons\n", *max);
+            exit(EXIT_FAILURE);
+        }
+    }
+    (*comparisons)[*n].ref = ref;
+    (*comparisons)[*n].start = start;
+    (*comparisons)[*n].end = end;
+    ++(*n);
+}
+uint64_t getComparisonsFromMatrix(char **mat, uint64_t numRows, uint64_t numCols, uint64_t *lengths,
+                                  mafTcComparison_t **comparisons) {
+    // given a char matrix and its dimensions, fill *comparisons with the gapless runs that give
+    // coverage of the matrix, returning how many there are. Each row takes every still uncovered
+    // column it has a base in, so the runs come out row by row and left to right, which is the
+    // reverse of the list getComparisonOrderFromMatrix() returns.
+    // Columns are kept as bitsets, 64 to a word: `uncovered' holds the columns still to do and
+    // `starts' marks the first column of each todo region, as runs never cross a region boundary.
+    // Gap bits of a row are only worked out for words that still have uncovered columns.
+    uint64_t n = 0, max = 16;
+    *comparisons = (mafTcComparison_t *) de_malloc(sizeof(**comparisons) * max);
+    uint64_t numWords = (numCols + 63) / 64;
+    if (numWords == 0) {
+        return 0;
+    }
+    uint64_t *uncovered = (uint64_t *) de_malloc(sizeof(*uncovered) * numWords);
+    uint64_t *starts = (uint64_t *) de_malloc(sizeof(*starts) * numWords);
+    uint64_t *gaps = (uint64_t *) de_malloc(sizeof(*gaps) * numWords);
+    for (uint64_t w = 0; w < numWords; ++w) {
+        uncovered[w] = ~0ULL;
+        starts[w] = 0;
+        gaps[w] = 0;
+    }
+    if (numCols % 64) {
+        uncovered[numWords - 1] = (1ULL << (numCols % 64)) - 1;
+    }
+    starts[0] = 1;
+    bool remaining = true;
+    uint64_t runStart = 0;
+    for (uint64_t r = 0; remaining && r < numRows; ++r) {
+        bool containsGaps = (lengths[r] != numCols);
+        for (uint64_t w = 0; w < numWords; ++w) {
+            if (uncovered[w] != 0) {
+                gaps[w] = containsGaps ? gapWord(mat[r], w, numCols) : 0;
             }
-            *done = co;
-            co = NULL;
-            todo = todo->next;
-            continue;
         }
-        for (uint64_t i = todo->start; i <= todo->end; ++i) {
-            // walk the current region.
-            de_debug("position %" PRIu64 "\n", i);
-            if (mat[row][i] == '-') {
-                // inside a gap region
-                de_debug("now inside a gap region\n");
-                if (!inGap) {
-                    de_debug("previously was not inGap\n");
-                    // transition from sequence into gap
-                    // no matter what we create a new todoRegion:
-                    inGap = true;
-                    if (newTodo == NULL) {
-                        de_debug("newTodo == NULL, creating newTodo & tail at %" PRIu64 "\n", i);
-                        newTodo = newMafTcRegion(i, i);
-                        newTodoTail = newTodo;
-                    } else {
-                        de_debug("newTodo != NULL, creating new newTodoTail at %" PRIu64 "\n", i);
-                        newTodoTail->next = newMafTcRegion(i, i);
-                        newTodoTail = newTodoTail->next;
-                    }
-                } else {
-                    de_debug("remaining inGap, extending gap end to %" PRIu64 "\n", i);
-                    // remain in gap
-                    de_debug("newTodoTail->start: %" PRIu64 ", ->end: %" PRIu64 "\n", 
-                             newTodoTail->start, newTodoTail->end);
-                    newTodoTail->end = i;
-                    de_debug("newTodoTail->start: %" PRIu64 ", ->end: %" PRIu64 "\n", 
-                             newTodoTail->start, newTodoTail->end);
+        remaining = false;
+        // top bits of the previous word, as they were before it was updated
+        uint64_t prevCover = 0, prevTodo = 0;
+        for (uint64_t w = 0; w < numWords; ++w) {
+            uint64_t cover = uncovered[w] & ~gaps[w];
+            uint64_t todo = uncovered[w] & gaps[w];
+            uint64_t nextCover = 0, nextStarts = 0;
+            if (w + 1 < numWords) {
+                nextCover = uncovered[w + 1] & ~gaps[w + 1];
+                nextStarts = starts[w + 1];
+            }
+            // a run starts where its column is covered and either the column before is not or
+            // a todo region starts; it ends on the mirror image of that.
+            uint64_t runStarts = cover & (~((cover << 1) | prevCover) | starts[w]);
+            uint64_t runEnds = cover & (~((cover >> 1) | (nextCover << 63)) |
+                                        (starts[w] >> 1) | (nextStarts << 63));
+            uint64_t bits = runStarts | runEnds;
+            while (bits != 0) {
+                uint64_t b = (uint64_t) __builtin_ctzll(bits);
+                uint64_t bit = 1ULL << b;
+                if (runStarts & bit) {
+                    runStart = w * 64 + b;
                 }
-                de_debug("current newTodo:\n");
-                printRegion(newTodo);
-            } else {
-                de_debug("now inside a sequence region\n");
-                // inside a sequence region
-                if (inGap) {
-                    de_debug("previously was inGap\n");
-                    // transition from gap to sequence
-                    inGap = false;
-                    co = newMafTcComparisonOrder();
-                    co->ref = row;
-                    co->region = newMafTcRegion(i, i);
-                    de_debug("creating new region for row:%" PRIu64 ", position %" PRIu64 "\n", row, i);
-                    // insert into the start of the list
-                    if (done != NULL) {
-                        // de_debug("done != NULL, inserting this comparison into the start of the list.\n");
-                        co->next = *done;
-                    }
-                    *done = co;
-                } else {
-                    de_debug("remaining in sequence\n");
-                    // remain in sequence
-                    if (co != NULL) {
-                        de_debug("co != NULL, moving ref:%" PRIu64 " with "
-                                 "start %" PRIu64 ", end to %" PRIu64 "\n", co->ref, co->region->start, i);
-                        co->region->end = i;
-                    } else {
-                        de_debug("co == NULL, ref: %" PRIu64 ", must create new region at %" PRIu64 "\n", 
-                                 row, i);
-                        co = newMafTcComparisonOrder();
-                        co->ref = row;
-                        co->region = newMafTcRegion(i, i);
-                        // insert into the start of the `done' list
-                        if (done != NULL) {
-                            de_debug("done != NULL, inserting this comparison into head of list\n");
-                            co->next = *done;
-                        } else {
-                            de_debug("done == NULL, inserting a new comparison into head of list\n");
-                            done = (mafTcComparisonOrder_t **) de_malloc(sizeof(*done));
-                        }
-                        *done = co;
-                    }
+                if (runEnds & bit) {
+                    addComparison(comparisons, &n, &max, r, runStart, w * 64 + b);
                 }
+                bits &= bits - 1;
             }
+            // the gaps left in the todo regions are the todo regions for the next row
+            uint64_t newStarts = todo & (~((todo << 1) | prevTodo) | starts[w]);
+            prevCover = cover >> 63;
+            prevTodo = todo >> 63;
+            uncovered[w] = todo;
+            starts[w] = newStarts;
+            remaining = remaining || (todo != 0);
         }
-        co = NULL;
-        todo = todo->next;
     }
-    destroyMafTcRegionList(headTodo);
-    return newTodo;
+    free(uncovered);
+    free(starts);
+    free(gaps);
+    return n;
 }
 int64_t localSeqCoordsToGlobalPositiveStartCoords(int64_t c, uint64_t start, uint64_t sourceLength, 
                                                   char strand, uint64_t length) {
@@ -465,100 +1160,78 @@ int64_t localSeqCoordsToGlobalPositiveCoords(int64_t c, uint64_t start, uint64_t
         return (int64_t) (sourceLength - 1 - (start + c));
     }
 }
-int64_t localSeqCoords(uint64_t p, char *s, mafCoordinatePair_t *b, int containsGaps) {
-    // given a coordinate inside of a sequence with respect to the start (which is 0), 
-    // walk backwards and anytime you see a gap drop one from the coordinate to return
-    if (containsGaps == 0) {
-        // store bookmark
-        b->a = p;
-        b->b = p;
-        return b->b;
-    }
-    int64_t bases = 0;
-    for (int64_t i = p; i >= 0; --i) {
-        if (b->a == i) {
-            if (s[i] != '-' && b->b == -1) {
-                bases += 1;
-            }
-            b->a = p;
-            b->b += bases;
-            return b->b;
-        }
-        if (s[i] != '-') {
-            ++bases;
+mafTcPinches_t* newMafTcPinches(void) {
+    mafTcPinches_t *pinches = (mafTcPinches_t *) de_malloc(sizeof(*pinches));
+    pinches->maxPinches = 16;
+    pinches->pinches = (mafTcPinch_t *) de_malloc(sizeof(*(pinches->pinches)) * pinches->maxPinches);
+    pinches->numPinches = 0;
+    return pinches;
+}
+void destroyMafTcPinches(mafTcPinches_t *pinches) {
+    if (pinches == NULL) {
+        return;
+    }
+    free(pinches->pinches);
+    free(pinches);
+}
+static void addPinch(mafTcPinches_t *pinches, stPinchThread *a, stPinchThread *b, int64_t aStart,
+                     int64_t bStart, int64_t length, bool strand) {
+    if (pinches->numPinches == pinches->maxPinches) {
+        pinches->maxPinches *= 2;
+        pinches->pinches = (mafTcPinch_t *) realloc(pinches->pinches,
+                                                    sizeof(*(pinches->pinches)) * pinches->maxPinches);
+        if (pinches->pinches == NULL) {
+            fprintf(stderr, "Error, unable to grow the pinch list to %" PRIu64 " pinches\n",
+                    pinches->maxPinches);
+            exit(EXIT_FAILURE);
         }
     }
-    b->a = p;
-    b->b = bases;
-    return b->b;
+    mafTcPinch_t *p = &(pinches->pinches[pinches->numPinches++]);
+    p->a = a;
+    p->b = b;
+    p->aStart = aStart;
+    p->bStart = bStart;
+    p->length = length;
+    p->strand = strand;
 }
 uint64_t g_numPinches = 0;
-void processPairForPinching(stPinchThreadSet *threadSet, stPinchThread *a, uint64_t aGlobalStart, 
-                            uint64_t aGlobalLength, int aStrand, 
-                            char *aSeq, stPinchThread *b, uint64_t bGlobalStart, uint64_t bGlobalLength,
-                            int bStrand, char *bSeq, uint64_t regionStart, uint64_t regionEnd,
-                            mafCoordinatePair_t aBookmark, mafCoordinatePair_t bBookmark, 
-                            int aContainsGaps, int bContainsGaps, 
-                            void (*pinchFunction)(stPinchThread *, stPinchThread *, int64_t, int64_t, int64_t, bool)) {
-    // perform a pinch operation for regions of bSeq that are not gaps, i.e. `-'
-    // GlobalStart is the positive strand position (zero based) coordinate of the start of this block
-    // the nasty construction of passing in the pinch function is so that we can more easily unit test 
-    // this code. Sorry about that.
-    (void) (threadSet);
-    uint64_t length = 0, localPos = 0;
-    uint64_t localBlockStart = localPos;
-    int64_t aLocalPosCoords, bLocalPosCoords, aGlobalPosCoords, bGlobalPosCoords;
-    de_debug("aGlobalStart: %" PRIu64 ", bGlobalStart: %" PRIu64 ", pos & regionStart: %" PRIu64 ", regionEnd: %" PRIu64 "\n", 
-             aGlobalStart, bGlobalStart, regionStart, regionEnd);
-    de_debug("aSeq: %s\n", aSeq);
-    de_debug("bSeq: %s\n", bSeq);
-    bool inBlock = false;
-    for (localPos = regionStart; localPos < (regionEnd + 1); ++localPos) {
-        de_debug("pos: %" PRIu64 " \n", localPos);
-        if (bSeq[localPos] == '-') {
-            if (inBlock) {
-                inBlock = false;
-                aLocalPosCoords = localSeqCoords(localBlockStart, aSeq, &aBookmark, aContainsGaps);
-                aGlobalPosCoords = localSeqCoordsToGlobalPositiveStartCoords(aLocalPosCoords, aGlobalStart, 
-                                                                             aGlobalLength, aStrand, length);
-                bLocalPosCoords = localSeqCoords(localBlockStart, bSeq, &bBookmark, bContainsGaps);
-                bGlobalPosCoords = localSeqCoordsToGlobalPositiveStartCoords(bLocalPosCoords, bGlobalStart, 
-                                                                             bGlobalLength, bStrand, length);
-                de_debug("bSeq[pos] is a gap && inBlock\n");
-                de_debug("maybe little pinch (#1)? p:%" PRIu64 ", l:%" PRIu64 "\n", localBlockStart, length);
-                de_debug("a coords local: %" PRIi64 " global: %" PRIi64
-                         ", b coords local: %" PRIi64 ", global: %" PRIi64 "\n",
-                         aLocalPosCoords, aGlobalPosCoords, bLocalPosCoords, bGlobalPosCoords);
-                pinchFunction(a, b, aGlobalPosCoords, bGlobalPosCoords, length, (aStrand == bStrand));
-                ++g_numPinches;
-                length = 0;
-            }
-        } else {
-            if (!inBlock) {
-                de_debug("bSeq[pos] is not a gap char && !inBlock, starting "
-                         "new block at %" PRIu64 "\n", localPos);
-                inBlock = true;
-                localBlockStart = localPos;
-            }
-            ++length; // length of this segment
-        }
-    }
-    de_debug("done walking comparison region\n");
-    if (inBlock) {
-        inBlock = false;
-        aLocalPosCoords = localSeqCoords(localBlockStart, aSeq, &aBookmark, aContainsGaps);
-        aGlobalPosCoords = localSeqCoordsToGlobalPositiveStartCoords(aLocalPosCoords, aGlobalStart, 
-                                                                     aGlobalLength, aStrand, length);
-        bLocalPosCoords = localSeqCoords(localBlockStart, bSeq, &bBookmark, bContainsGaps);
-        bGlobalPosCoords = localSeqCoordsToGlobalPositiveStartCoords(bLocalPosCoords, bGlobalStart, 
-                                                                     bGlobalLength, bStrand, length);
-        de_debug("maybe little pinch (#2)? p:%" PRIu64 ", l:%" PRIu64 "\n", localBlockStart, length);
-        de_debug("a coords local: %" PRIi64 " global: %" PRIi64
-                         ", b coords local: %" PRIi64 ", global: %" PRIi64 "\n",
-                         aLocalPosCoords, aGlobalPosCoords, bLocalPosCoords, bGlobalPosCoords);
-        pinchFunction(a, b, aGlobalPosCoords, bGlobalPosCoords, length, (aStrand == bStrand));
-        length = 0;
-        ++g_numPinches;
+static uint64_t nextColumn(mafTcBlockIndex_t *index, uint64_t row, uint64_t col, uint64_t end, bool gap) {
+    // the first column in [col, end] of row that is a gap (or a base, when !gap), else end + 1
+    const uint64_t *g = index->gaps + row * index->numWords;
+    while (col <= end) {
+        uint64_t bits = (gap ? g[col >> 6] : ~g[col >> 6]) >> (col & 63);
+        if (bits) {
+            col += (uint64_t) __builtin_ctzll(bits);
+            return (col <= end) ? col : end + 1;
+        }
+        col = ((col >> 6) + 1) << 6;
+    }
+    return end + 1;
+}
+void processPairForPinching(mafTcBlockIndex_t *index, uint64_t a, uint64_t b, stPinchThread **threads,
+                            uint64_t *starts, uint64_t *sourceLengths, char *strands,
+                            uint64_t regionStart, uint64_t regionEnd, mafTcPinches_t *pinches) {
+    // record a pinch operation between row a and each run of row b that is not gaps, i.e. `-',
+    // inside of columns regionStart to regionEnd. Row a has no gaps in the region.
+    // the pinches are applied later, by applyPinches(), so that blocks can be walked in parallel.
+    int64_t aGlobalPosCoords, bGlobalPosCoords;
+    uint64_t runStart, runEnd, length;
+    de_debug("a: %" PRIu64 ", b: %" PRIu64 ", regionStart: %" PRIu64 ", regionEnd: %" PRIu64 "\n",
+             a, b, regionStart, regionEnd);
+    for (runStart = nextColumn(index, b, regionStart, regionEnd, false); runStart <= regionEnd;
+         runStart = nextColumn(index, b, runEnd, regionEnd, false)) {
+        runEnd = nextColumn(index, b, runStart, regionEnd, true);
+        length = runEnd - runStart;
+        aGlobalPosCoords = localSeqCoordsToGlobalPositiveStartCoords(
+            (int64_t) mafTcBlockIndex_getPosition(index, a, runStart), starts[a], sourceLengths[a],
+            strands[a], length);
+        bGlobalPosCoords = localSeqCoordsToGlobalPositiveStartCoords(
+            (int64_t) mafTcBlockIndex_getPosition(index, b, runStart), starts[b], sourceLengths[b],
+            strands[b], length);
+        de_debug("pinch p:%" PRIu64 ", l:%" PRIu64 ", a global: %" PRIi64 ", b global: %" PRIi64 "\n",
+                 runStart, length, aGlobalPosCoords, bGlobalPosCoords);
+        addPinch(pinches, threads[a], threads[b], aGlobalPosCoords, bGlobalPosCoords, length,
+                 (strands[a] == strands[b]));
     }
 }
 static void printMatrix(char **mat, uint64_t n) {
@@ -571,25 +1244,6 @@ static void printu32Array(uint64_t *a, uint64_t n) {
     for (uint64_t i = 0; i < n; ++i)
         fprintf(stderr, "%" PRIu64 "%s", a[i], (i == n - 1) ? "\n" : ", ");
 }
-mafCoordinatePair_t* newCoordinatePairArray(uint64_t numSeqs, char **seqs) {
-    // create a new array of mafCoordinatePair_t* and then initialize it using the 
-    // decomposed information from the mafBlock_t (strands, starts, sourceLengths, seqs, etc)
-    mafCoordinatePair_t *a = (mafCoordinatePair_t*) de_malloc(sizeof(*a) * numSeqs);
-    uint64_t pos;
-    for (uint64_t i = 0; i < numSeqs; ++i) {
-        pos = 0;
-        while ((seqs[i][pos] == '-') && (pos < strlen(seqs[i]))) {
-            // find the first non gap position in the sequence and start the bookmark there.
-            ++pos;
-        }
-        a[i].a = (int64_t) pos;
-        a[i].b = -1;
-    }
-    return a;
-}
-void destroyCoordinatePairArray(mafCoordinatePair_t *cp) {
-    free(cp);
-}
 int** getVizMatrix(mafBlock_t *mb, unsigned n, unsigned m) {
     // currently this is not stored and must be built
     // should return a matrix containing the alignment, one row per sequence
@@ -679,7 +1333,6 @@ int cmp_by_gaps(const void *a, const void *b) {
     mafBlockSort_t **ib = (mafBlockSort_t **) b;
     return ((*ia)->value >= (*ib)->value);
 }
-int64_t g_stableOrder = INT64_MIN;
 void mafBlock_sortBlockByIncreasingGap(mafBlock_t *mb) {
     // take a pointer to mafblock, sort the maflines by 
     // the number of gaps they contain smallest to largest. All non-sequence
@@ -691,6 +1344,7 @@ void mafBlock_sortBlockByIncreasingGap(mafBlock_t *mb) {
     assert(ml != NULL);
     int64_t i, n = maf_mafBlock_getNumberOfLines(mb);
     int64_t value;
+    int64_t stableOrder = INT64_MIN; // only needs to increase within the block
     mafBlockSort_t **array = (mafBlockSort_t **) de_malloc(sizeof(mafBlockSort_t *) * n);
     for (i = 0; i < n; ++i) {
         array[i] = (mafBlockSort_t *) de_malloc(sizeof(mafBlockSort_t));
@@ -699,12 +1353,12 @@ void mafBlock_sortBlockByIncreasingGap(mafBlock_t *mb) {
             value = maf_mafLine_getSequenceFieldLength(ml) - maf_mafLine_getLength(ml);
             if (value == 0) {
                 // force stability for blocks without gaps
-                array[i]->value = ++g_stableOrder;
+                array[i]->value = ++stableOrder;
             } else {
                 array[i]->value = value;
             }
         } else {
-            array[i]->value = ++g_stableOrder;
+            array[i]->value = ++stableOrder;
         }
         ml = maf_mafLine_getNext(ml);
     }
@@ -733,12 +1387,44 @@ void mafBlock_sortBlockByIncreasingGap(mafBlock_t *mb) {
         free(array[i]);
     free(array);
 }
-void walkBlockAddingAlignments(mafBlock_t *mb, stPinchThreadSet *threadSet) {
-    // for a given block, add the alignment information to the threadset.
-    de_debug("walkBlockAddingAlignments():\n");
+stPinchThread** getBlockThreads(mafBlock_t *mb, stPinchThreadSet *threadSet, mafTcSeqTable_t *table) {
+    // the threads of the sequence rows of the block, in row order. Threads are added the first
+    // time their sequence turns up, named by its id. With --sort the block is sorted first.
     if (g_isSort)
         mafBlock_sortBlockByIncreasingGap(mb);
     uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
+    stPinchThread **threads = (stPinchThread **) de_malloc(sizeof(*threads) * (numSeqs + 1));
+    mafTcSeq_t *mtcs = NULL;
+    uint64_t i = 0;
+    for (mafLine_t *ml = maf_mafBlock_getHeadLine(mb); ml != NULL; ml = maf_mafLine_getNext(ml)) {
+        if (maf_mafLine_getType(ml) != 's') {
+            continue;
+        }
+        if ((mtcs = mafTcSeqTable_getSeq(table, maf_mafLine_getSpecies(ml))) == NULL) {
+            mtcs = mafTcSeqTable_addSeq(table, maf_mafLine_getSpecies(ml), maf_mafLine_getSourceLength(ml));
+        }
+        if (mtcs->thread == NULL) {
+            mtcs->thread = stPinchThreadSet_addThread(threadSet, mtcs->id, 0, mtcs->length);
+        }
+        threads[i++] = mtcs->thread;
+    }
+    return threads;
+}
+void applyPinches(mafTcPinches_t *pinches) {
+    // feed the recorded pinches to the pinch graph, in the order they were recorded
+    mafTcPinch_t *p = NULL;
+    for (uint64_t i = 0; i < pinches->numPinches; ++i) {
+        p = &(pinches->pinches[i]);
+        stPinchThread_pinch(p->a, p->b, p->aStart, p->bStart, p->length, p->strand);
+    }
+    __atomic_fetch_add(&g_numPinches, pinches->numPinches, __ATOMIC_RELAXED); // --partition threads
+    pinches->numPinches = 0;
+}
+void walkBlockGettingPinches(mafBlock_t *mb, stPinchThread **threads, mafTcPinches_t *pinches) {
+    // for a given block, record the pinches that add its alignment information to the threadset.
+    // the block and the thread set are only read, so different blocks may be walked at once.
+    de_debug("walkBlockGettingPinches():\n");
+    uint64_t numSeqs = maf_mafBlock_getNumberOfSequences(mb);
     if (numSeqs < 1) 
         return;
     uint64_t seqFieldLength = maf_mafBlock_getSequenceFieldLength(mb);
@@ -748,35 +1434,33 @@ void walkBlockAddingAlignments(mafBlock_t *mb, stPinchThreadSet *threadSet) {
         vizMat = getVizMatrix(mb, numSeqs, seqFieldLength);
     }
     char *strands = maf_mafBlock_getStrandArray(mb);
-    char **names = maf_mafBlock_getSpeciesArray(mb);
     uint64_t *starts = maf_mafBlock_getStartArray(mb);
     uint64_t *sourceLengths = maf_mafBlock_getSourceLengthArray(mb);
     uint64_t *lengths = maf_mafBlock_getSequenceLengthArray(mb);
-    // coordinate bookmarks are used to store the mapping between local block position
-    // and local sequence coordinate positions, ie local block position minus gap positions.
-    mafCoordinatePair_t *bookmarks = newCoordinatePairArray(numSeqs, mat);
+    // the index maps block columns to local sequence coordinates, ie block column minus gaps.
+    mafTcBlockIndex_t *index = newMafTcBlockIndex(mat, numSeqs, seqFieldLength, lengths);
     // comparison order coordinates are relative to the block
-    mafTcComparisonOrder_t *c = getComparisonOrderFromMatrix(mat, numSeqs, seqFieldLength, lengths, vizMat);
-    de_debug("comparisonOrder_t obtained\n");
-    mafTcComparisonOrder_t *tmp = NULL;
-    stPinchThread *a = NULL, *b = NULL;
-    while (c != NULL) {
-        a = stPinchThreadSet_getThread(threadSet, stHash_stringKey(names[c->ref]));
-        assert(a != NULL);
+    mafTcComparison_t *comparisons = NULL;
+    uint64_t numComparisons = getComparisonsFromMatrix(mat, numSeqs, seqFieldLength, lengths, &comparisons);
+    de_debug("comparisons obtained\n");
+    if (g_debug_flag) {
+        for (uint64_t i = 0; i < numComparisons; ++i) {
+            for (uint64_t j = comparisons[i].start; j <= comparisons[i].end; ++j) {
+                vizMat[comparisons[i].ref][j] = 2;
+            }
+        }
+        printVizMatrix(vizMat, numSeqs, seqFieldLength);
+    }
+    // walk the comparisons last first, the order the pinches have always been made in
+    mafTcComparison_t *c = NULL;
+    for (uint64_t i = numComparisons; i > 0; --i) {
+        c = &(comparisons[i - 1]);
         for (uint64_t r = c->ref + 1; r < numSeqs; ++r) {
-            b = stPinchThreadSet_getThread(threadSet, stHash_stringKey(names[r]));
-            assert(b != NULL);
-            processPairForPinching(threadSet, a, starts[c->ref], sourceLengths[c->ref], strands[c->ref],
-                                   mat[c->ref], b, starts[r], sourceLengths[r], strands[r], mat[r], 
-                                   c->region->start, c->region->end, bookmarks[c->ref], bookmarks[r],
-                                   (lengths[c->ref] != seqFieldLength), (lengths[r] != seqFieldLength), 
-                                   stPinchThread_pinch);
-        }
-        tmp = c;
-        c = c->next;
-        destroyMafTcRegion(tmp->region);
-        free(tmp);
+            processPairForPinching(index, c->ref, r, threads, starts, sourceLengths, strands,
+                                   c->start, c->end, pinches);
+        }
     }
+    free(comparisons);
     // cleanup
     maf_mafBlock_destroySequenceMatrix(mat, numSeqs);
     destroyVizMatrix(vizMat, numSeqs);
@@ -784,33 +1468,31 @@ void walkBlockAddingAlignments(mafBlock_t *mb, stPinchThreadSet *threadSet) {
     free(starts);
     free(sourceLengths);
     free(lengths);
-    destroyCoordinatePairArray(bookmarks);
-    for (uint64_t i = 0; i < numSeqs; ++i) {
-        free(names[i]);
-    }
-    free(names);
+    destroyMafTcBlockIndex(index);
 }
-void addAlignmentsToThreadSet(mafFileApi_t *mfa, stPinchThreadSet *threadSet) {
-    mafBlock_t *mb = NULL;
-    while ((mb = maf_readBlock(mfa)) != NULL) {
-        walkBlockAddingAlignments(mb, threadSet);
-        maf_destroyMafBlockList(mb);
-    }
-    stPinchThreadSet_joinTrivialBoundaries(threadSet);
+void walkBlockAddingAlignments(mafBlock_t *mb, stPinchThreadSet *threadSet, mafTcSeqTable_t *table) {
+    // for a given block, add the alignment information to the threadset.
+    stPinchThread **threads = getBlockThreads(mb, threadSet, table);
+    mafTcPinches_t *pinches = newMafTcPinches();
+    walkBlockGettingPinches(mb, threads, pinches);
+    applyPinches(pinches);
+    destroyMafTcPinches(pinches);
+    free(threads);
 }
-uint64_t getMaxNameLength(stHash *hash) {
-    // utility function to find out the length of the longest sequence name in the hash.
-    stHashIterator *hit = stHash_getIterator(hash);
-    char *key = NULL;
-    uint64_t max = 0;
-    while ((key = stHash_getNext(hit)) != NULL) {
-        if (max < strlen(key) + 2)
-            max = strlen(key) + 2;
+uint64_t getMaxNameLength(mafTcSeqTable_t *table) {
+    // utility function to find out the length of the longest sequence name in the table.
+    return table->maxNameLength + 2;
+}
+uint64_t countDigits(uint64_t x) {
+    // the number of decimal digits needed to print x
+    uint64_t n = 1;
+    while (x >= 10) {
+        x /= 10;
+        ++n;
     }
-    stHash_destructIterator(hit);
-    return max;
+    return n;
 }
-void getMaxFieldLengths(stHash *hash, stHash *nameHash, stPinchBlock *block, uint64_t *maxStart, 
+void getMaxFieldLengths(mafTcSeqTable_t *table, stPinchBlock *block, uint64_t *maxStart, 
                         uint64_t *maxLength, uint64_t *maxSource) {
     // utility function to find out the length of the longest field members.
     stPinchBlockIt thisSegIt = stPinchBlock_getSegmentIterator(block);
@@ -818,128 +1500,152 @@ void getMaxFieldLengths(stHash *hash, stHash *nameHash, stPinchBlock *block, uin
     *maxStart = 0;
     *maxLength = 0;
     *maxSource = 0;
-    char *temp = NULL;
-    char *key = NULL;
-    char strand = '\0';
-    int64_t *intKey = NULL;
+    mafTcSeq_t *mtcs = NULL;
+    uint64_t start, n;
     while ((thisSeg = stPinchBlockIt_getNext(&thisSegIt)) != NULL) {
-        strand = stPinchSegment_getBlockOrientation(thisSeg) == 1 ? '+' : '-';
-        intKey = (int64_t*) st_malloc(sizeof(*intKey));
-        *intKey = stPinchSegment_getName(thisSeg);
-        key = (char*) stHash_search(nameHash, (void*) intKey);
-        temp = (char*) de_malloc(kMaxStringLength);
-        if (strand == '+') {
-            sprintf(temp, "%" PRIi64, stPinchSegment_getStart(thisSeg));
+        mtcs = table->seqs[stPinchSegment_getName(thisSeg)];
+        if (stPinchSegment_getBlockOrientation(thisSeg)) {
+            start = stPinchSegment_getStart(thisSeg);
         } else {
-            sprintf(temp, "%" PRIi64,
-                    (((int64_t)((mafTcSeq_t*)stHash_search(hash, key))->length) - 
-                     stPinchSegment_getStart(thisSeg) - stPinchSegment_getLength(thisSeg)));
-        }
-        if (*maxStart < strlen(temp)) {
-            *maxStart = strlen(temp);
-        }
-        free(temp);
-        temp = (char*) de_malloc(kMaxStringLength);
-        sprintf(temp, "%" PRIi64, stPinchSegment_getLength(thisSeg));
-        if (*maxLength < strlen(temp))
-            *maxLength = strlen(temp);
-        free(temp);
-        temp = (char*) de_malloc(kMaxStringLength);
-        sprintf(temp, "%" PRIu64, ((mafTcSeq_t*)stHash_search(hash, key))->length);
-        if (*maxSource < strlen(temp))
-            *maxSource = strlen(temp);
-        free(temp);
-        free(intKey);
-    }
-}
-char* getSequenceSubset(char *seq, int64_t start, char strand, int64_t length) {
+            start = mtcs->length - stPinchSegment_getStart(thisSeg) - stPinchSegment_getLength(thisSeg);
+        }
+        if ((n = countDigits(start)) > *maxStart)
+            *maxStart = n;
+        if ((n = countDigits(stPinchSegment_getLength(thisSeg))) > *maxLength)
+            *maxLength = n;
+        if ((n = countDigits(mtcs->length)) > *maxSource)
+            *maxSource = n;
+    }
+}
+char* getSequenceSubset(mafTcSeq_t *mtcs, int64_t start, char strand, int64_t length) {
     // used to extract a copy of a small subset of a sequnce, for use when printing
     // out an alignment.
     char *out = (char*) de_malloc(sizeof(*out) * length + 1);
-    int64_t i, j;
-    for (i = start, j = 0; i < start + length; ++i, ++j) {
-        out[j] = seq[i];
+    copySequenceSubset(mtcs, start, strand, length, out);
+    out[length] = '\0';
+    return out;
+}
+void copySequenceSubset(mafTcSeq_t *mtcs, int64_t start, char strand, int64_t length, char *out) {
+    // write length bases of mtcs from start into out, which is not terminated
+    uint64_t q;
+    for (int64_t i = 0; i < length; ++i) {
+        q = start + i;
+        out[i] = isKnown(mtcs, q) ? kMafTcBases[(mtcs->bases[q >> 5] >> ((q & 31) << 1)) & 3] : 'N';
+    }
+    if (exceptionsOverlap(mtcs, start, start + length)) {
+        for (int64_t i = 0; i < length; ++i) {
+            if (out[i] != 'N') {
+                out[i] = mafTcSeq_getBase(mtcs, start + i);
+            }
+        }
     }
-    out[j] = '\0';
     if (strand == '-')
-        reverseComplementSequence(out, strlen(out));
-    return out;
+        reverseComplementSequence(out, length);
 }
-void reportTransitiveClosure(stPinchThreadSet *threadSet, stHash *hash, stHash *nameHash) {
+void reportTransitiveClosureHeader(mafTcWriter_t *writer) {
+    char *header = stString_print("##maf version=1\n# mafTransitiveClosure %s, build: %s, %s, %s\n\n",
+                                  g_version, g_build_date, g_build_git_branch, g_build_git_sha);
+    writeString(writer, header, strlen(header));
+    free(header);
+}
+void reportTransitiveClosureBlocks(stPinchThreadSet *threadSet, mafTcSeqTable_t *table, mafTcWriter_t *writer) {
     // walk the completed threadSet and report back the blocks that form the transitive closure
-    // of the alignment.
+    // of the alignment. Lines are formatted straight into the writer's buffer and the bases
+    // are copied into it from the packed sequences.
     stPinchThreadSetBlockIt thisBlockIt = stPinchThreadSet_getBlockIt(threadSet);
     stPinchBlock *thisBlock = NULL;
     stPinchBlockIt thisSegIt;
     stPinchSegment *thisSeg = NULL;
-    char *key = NULL;
-    char *seq = NULL;
+    mafTcSeq_t *mtcs = NULL;
     char strand = '\0';
-    printf("##maf version=1\n");
-    printf("# mafTransitiveClosure %s, build: %s, %s, %s\n\n", g_version, g_build_date, 
-           g_build_git_branch, g_build_git_sha);
     uint64_t maxNameLength, maxStartLength, maxLengthLength, maxSourceLengthLength;
-    int64_t xformedStart;
-    int64_t *intKey = NULL;
-    maxNameLength = getMaxNameLength(hash);
+    uint64_t xformedStart, length, nameLength;
+    char *p = NULL;
+    maxNameLength = getMaxNameLength(table);
     while ((thisBlock = stPinchThreadSetBlockIt_getNext(&thisBlockIt)) != NULL) {
-        getMaxFieldLengths(hash, nameHash, thisBlock, &maxStartLength,
+        getMaxFieldLengths(table, thisBlock, &maxStartLength,
                            &maxLengthLength, &maxSourceLengthLength);
-        printf("a degree=%" PRIu64 "\n", stPinchBlock_getDegree(thisBlock));
+        writeString(writer, "a degree=", 9);
+        writeNumber(writer, stPinchBlock_getDegree(thisBlock), 0);
+        writeString(writer, "\n", 1);
         thisSegIt = stPinchBlock_getSegmentIterator(thisBlock);
         while ((thisSeg = stPinchBlockIt_getNext(&thisSegIt)) != NULL) {
-            intKey = (int64_t *) st_malloc(sizeof(*intKey));
-            *intKey = stPinchSegment_getName(thisSeg);
+            mtcs = table->seqs[stPinchSegment_getName(thisSeg)];
             strand = stPinchSegment_getBlockOrientation(thisSeg) == 1 ? '+' : '-';
-            key = (char*)stHash_search(nameHash, (void *)intKey);
-            seq = getSequenceSubset(((mafTcSeq_t*)stHash_search(hash, key))->sequence,
-                                    stPinchSegment_getStart(thisSeg),
-                                    strand,
-                                    stPinchSegment_getLength(thisSeg));
+            length = stPinchSegment_getLength(thisSeg);
             if (strand == '+') {
                 xformedStart = stPinchSegment_getStart(thisSeg);
             } else {
-                xformedStart = (((int64_t)((mafTcSeq_t*)stHash_search(hash, key))->length) - 
-                                stPinchSegment_getStart(thisSeg) - stPinchSegment_getLength(thisSeg));
+                xformedStart = mtcs->length - stPinchSegment_getStart(thisSeg) - length;
             }
-            printf("s %-*s %*" PRIi32 " %*" PRIi32 " %c %*" PRIu32 " %s\n",
-                   (uint32_t)maxNameLength, key,
-                   (uint32_t)maxStartLength, (int32_t)xformedStart,
-                   (uint32_t)maxLengthLength, (uint32_t)stPinchSegment_getLength(thisSeg),
-                   strand,
-                   (uint32_t)maxSourceLengthLength, (uint32_t)((mafTcSeq_t*)stHash_search(hash, key))->length,
-                   seq
-                   );
-            free(seq);
-            free(intKey);
+            nameLength = strlen(mtcs->name);
+            writeString(writer, "s ", 2);
+            writeString(writer, mtcs->name, nameLength);
+            if (nameLength < maxNameLength) {
+                writePadding(writer, maxNameLength - nameLength);
+            }
+            writeString(writer, " ", 1);
+            writeNumber(writer, xformedStart, maxStartLength);
+            writeString(writer, " ", 1);
+            writeNumber(writer, length, maxLengthLength);
+            p = reserveOutput(writer, 3);
+            p[0] = ' ';
+            p[1] = strand;
+            p[2] = ' ';
+            writeNumber(writer, mtcs->length, maxSourceLengthLength);
+            writeString(writer, " ", 1);
+            copySequenceSubset(mtcs, stPinchSegment_getStart(thisSeg), strand, length,
+                               reserveOutput(writer, length));
+            writeString(writer, "\n", 1);
         }
-        printf("\n");
+        writeString(writer, "\n", 1);
     }
-    printf("\n");
-} 
+}
+void reportTransitiveClosure(stPinchThreadSet *threadSet, mafTcSeqTable_t *table, mafTcWriter_t *writer) {
+    reportTransitiveClosureHeader(writer);
+    reportTransitiveClosureBlocks(threadSet, table, writer);
+    writeString(writer, "\n", 1);
+}
 int main(int argc, char **argv) {
     (void) (printMatrix);
     (void) (printu32Array);
-    (void) (reportSequenceHash);
+    (void) (reportSequenceTable);
     (void) (printComparisonOrder);
     (void) (printRegion);
     char filename[kMaxStringLength];
-    stHash *sequenceHash, *nameHash;
     parseOptions(argc, argv, filename);
-    // first pass, build sequence hash
+    if (g_isPartition) {
+        mafFileApi_t *mfa = maf_newMfa(filename, "r");
+        mafPartition_t *partition = partitionMaf(mfa, g_tempDir);
+        maf_destroyMfa(mfa);
+        mafTcWriter_t *writer = newMafTcWriter(g_isCompress);
+        reportPartitionedTransitiveClosure(partition, writer);
+        destroyMafTcWriter(writer);
+        mafPartition_destroy(partition);
+        free(g_tempDir);
+        return EXIT_SUCCESS;
+    }
+    // one pass, build sequence table and pinch graph, on top of a checkpoint if there is one
+    mafTcSeqTable_t *table = newMafTcSeqTable();
+    stPinchThreadSet *threadSet = stPinchThreadSet_construct();
+    if (g_loadCheckpoint != NULL) {
+        loadCheckpoint(g_loadCheckpoint, threadSet, table);
+    }
     mafFileApi_t *mfa = maf_newMfa(filename, "r");
-    createSequenceHash(mfa, &sequenceHash, &nameHash);
-    stPinchThreadSet *threadSet = buildThreadSet(sequenceHash);
-    maf_destroyMfa(mfa);
-    // second pass, build pinch graph
-    mfa = maf_newMfa(filename, "r");
-    addAlignmentsToThreadSet(mfa, threadSet);
+    buildThreadSet(mfa, threadSet, table);
     maf_destroyMfa(mfa);
+    if (g_saveCheckpoint != NULL) {
+        saveCheckpoint(g_saveCheckpoint, threadSet, table);
+    }
     // consolidate and report
-    reportTransitiveClosure(threadSet, sequenceHash, nameHash);
+    mafTcWriter_t *writer = newMafTcWriter(g_isCompress);
+    reportTransitiveClosure(threadSet, table, writer);
+    destroyMafTcWriter(writer);
     // cleanup
-    stHash_destruct(sequenceHash);
-    stHash_destruct(nameHash);
+    destroyMafTcSeqTable(table);
     stPinchThreadSet_destruct(threadSet);
+    free(g_loadCheckpoint);
+    free(g_saveCheckpoint);
+    free(g_tempDir);
     return EXIT_SUCCESS;
 }
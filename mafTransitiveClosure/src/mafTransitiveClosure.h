@@ -24,18 +24,42 @@
  */
 #ifndef MAFTRANSITIVECLOSURE_H_
 #define MAFTRANSITIVECLOSURE_H_
+#include <stdio.h>
+#include <zlib.h>
 #include "sonLib.h"
 #include "stPinchGraphs.h"
 #include "common.h"
 #include "CuTest.h"
 #include "sharedMaf.h"
+#include "mafPartition.h"
 
+typedef struct mafTcException {
+    // a run of some character other than ACGT or N, e.g. an IUPAC code, in a mafTcSeq_t
+    uint64_t start;
+    uint64_t length;
+    char base;
+} mafTcException_t;
 typedef struct mafTcSeq {
-    // maf tc (trasitive closure) sequence
+    // maf tc (trasitive closure) sequence. Bases are packed two bits apiece, 32 to a word,
+    // the positions that have been observed are set in the known bitmap and anything that
+    // is not ACGT is kept as a run in the exceptions set. Unobserved positions read as N.
     char *name;
-    char *sequence;
+    uint64_t *bases;
+    uint64_t *known;
+    stSortedSet *exceptions; // mafTcException_t, ordered by start
     uint64_t length;
+    uint64_t id; // position in the mafTcSeqTable_t, also the name of the thread
+    stPinchThread *thread;
 } mafTcSeq_t;
+typedef struct mafTcSeqTable {
+    // interns sequence names as dense ids, so that pinch threads are named without hashing
+    // and output can go straight from a segment to its sequence.
+    stHash *names; // name -> mafTcSeq_t
+    mafTcSeq_t **seqs; // indexed by id
+    uint64_t numSeqs;
+    uint64_t maxSeqs;
+    uint64_t maxNameLength;
+} mafTcSeqTable_t;
 typedef struct mafTcRegion {
     // region or interval
     uint64_t start;
@@ -62,12 +86,43 @@ typedef struct mafTcComparisonOrder {
     mafTcRegion_t *region;
     struct mafTcComparisonOrder *next;
 } mafTcComparisonOrder_t;
-typedef struct mafCoordinatePair {
-    /* this struct is used to store pairs of coordinates
-    */
-    int64_t a;
-    int64_t b;
-} mafCoordinatePair_t;
+typedef struct mafTcComparison {
+    // one entry of the flat comparison order made by getComparisonsFromMatrix(): columns
+    // start to end (inclusive) of the block use row ref as their reference.
+    uint64_t ref;
+    uint64_t start;
+    uint64_t end;
+} mafTcComparison_t;
+typedef struct mafTcBlockIndex {
+    // the gap bits of every row of a block, 64 columns to a word, along with the number of
+    // bases in the row before each word, so that a column maps to a sequence position in O(1).
+    uint64_t numRows;
+    uint64_t numCols;
+    uint64_t numWords;
+    uint64_t *gaps; // row r, word w is at r * numWords + w
+    uint64_t *bases; // same layout as gaps
+} mafTcBlockIndex_t;
+typedef struct mafTcPinch {
+    // a pinch worked out from a block, kept until it is applied to the thread set
+    stPinchThread *a;
+    stPinchThread *b;
+    int64_t aStart;
+    int64_t bStart;
+    int64_t length;
+    bool strand;
+} mafTcPinch_t;
+typedef struct mafTcPinches {
+    mafTcPinch_t *pinches;
+    uint64_t numPinches;
+    uint64_t maxPinches;
+} mafTcPinches_t;
+typedef struct mafTcWriter {
+    // buffered output of the closure to stdout, optionally gzip compressed
+    char *buffer;
+    uint64_t used;
+    uint64_t size;
+    gzFile gz; // NULL when not compressing
+} mafTcWriter_t;
 typedef struct mafBlockSort {
     /* this struct is used to sort a sequence matrix by the number of gaps in each row
      */
@@ -79,46 +134,62 @@ void usage(void);
 mafTcSeq_t* newMafTcSeq(char *name, uint64_t length);
 mafTcComparisonOrder_t* newMafTcComparisonOrder(void);
 mafTcRegion_t* newMafTcRegion(uint64_t start, uint64_t end);
-mafCoordinatePair_t* newCoordinatePairArray(uint64_t numSeqs, char **seqs);
 void destroyMafTcSeq(void *p);
+mafTcSeqTable_t* newMafTcSeqTable(void);
+void destroyMafTcSeqTable(mafTcSeqTable_t *table);
+mafTcSeq_t* mafTcSeqTable_getSeq(mafTcSeqTable_t *table, char *name);
+mafTcSeq_t* mafTcSeqTable_addSeq(mafTcSeqTable_t *table, char *name, uint64_t length);
 void destroyMafTcRegionList(mafTcRegion_t *r);
 void destroyMafTcRegion(mafTcRegion_t *r);
 void destroyMafTcComparisonOrder(mafTcComparisonOrder_t *c);
-void destroyCoordinatePairArray(mafCoordinatePair_t *cp);
 uint64_t hashMafTcSeq(const mafTcSeq_t *mtcs);
 int hashCompareMafTcSeq(const mafTcSeq_t *m1, const mafTcSeq_t *m2);
-char* createNSequence(uint64_t length);
+char mafTcSeq_getBase(mafTcSeq_t *mtcs, uint64_t pos);
 void addSequenceValuesToMtcSeq(mafLine_t *ml, mafTcSeq_t *mtcs);
 void parseOptions(int argc, char **argv, char *filename);
-stPinchThreadSet* buildThreadSet(stHash *hash);
-void walkBlockAddingAlignments(mafBlock_t *mb, stPinchThreadSet *threadSet);
-void addAlignmentsToThreadSet(mafFileApi_t *mfa, stPinchThreadSet *threadSet);
-void createSequenceHash(mafFileApi_t *mfa, stHash **hash, stHash **nameHash);
-mafTcRegion_t* getComparisonOrderFromRow(char **mat, uint64_t row, mafTcComparisonOrder_t **done,
-                                         mafTcRegion_t *todo, int containsGaps);
+void buildThreadSet(mafFileApi_t *mfa, stPinchThreadSet *threadSet, mafTcSeqTable_t *table);
+void saveCheckpoint(char *filename, stPinchThreadSet *threadSet, mafTcSeqTable_t *table);
+void loadCheckpoint(char *filename, stPinchThreadSet *threadSet, mafTcSeqTable_t *table);
+mafPartition_t* partitionMaf(mafFileApi_t *mfa, const char *tempDir);
+void buildPartitionComponent(mafPartition_t *partition, uint64_t c, stPinchThreadSet *threadSet,
+                             mafTcSeqTable_t *table);
+void reportPartitionedTransitiveClosure(mafPartition_t *partition, mafTcWriter_t *writer);
+void walkBlockAddingAlignments(mafBlock_t *mb, stPinchThreadSet *threadSet, mafTcSeqTable_t *table);
+stPinchThread** getBlockThreads(mafBlock_t *mb, stPinchThreadSet *threadSet, mafTcSeqTable_t *table);
+void walkBlockGettingPinches(mafBlock_t *mb, stPinchThread **threads, mafTcPinches_t *pinches);
+mafTcPinches_t* newMafTcPinches(void);
+void destroyMafTcPinches(mafTcPinches_t *pinches);
+void applyPinches(mafTcPinches_t *pinches);
 mafTcComparisonOrder_t *getComparisonOrderFromMatrix(char **mat, uint64_t rowLength, uint64_t colLength,
                                                      uint64_t *lengths, int **vizMat);
-void processPairForPinching(stPinchThreadSet *threadSet, stPinchThread *a, uint64_t aGlobalStart,
-                            uint64_t aGlobalLength, int aStrand,
-                            char *aSeq, stPinchThread *b, uint64_t bGlobalStart, uint64_t bGlobalLength,
-                            int bStrand, char *bSeq, uint64_t regionStart, uint64_t regionEnd,
-                            mafCoordinatePair_t aBookmark, mafCoordinatePair_t bBookmark,
-                            int aContainsGaps, int bContainsGaps,
-                            void (*pinchFunction)(stPinchThread *, stPinchThread *, int64_t, int64_t, int64_t, bool));
-int64_t localSeqCoords(uint64_t p, char *s, mafCoordinatePair_t *bookmark, int containsGaps);
+uint64_t getComparisonsFromMatrix(char **mat, uint64_t numRows, uint64_t numCols, uint64_t *lengths,
+                                  mafTcComparison_t **comparisons);
+mafTcBlockIndex_t* newMafTcBlockIndex(char **mat, uint64_t numRows, uint64_t numCols, uint64_t *lengths);
+void destroyMafTcBlockIndex(mafTcBlockIndex_t *index);
+uint64_t mafTcBlockIndex_getPosition(mafTcBlockIndex_t *index, uint64_t row, uint64_t col);
+void processPairForPinching(mafTcBlockIndex_t *index, uint64_t a, uint64_t b, stPinchThread **threads,
+                            uint64_t *starts, uint64_t *sourceLengths, char *strands,
+                            uint64_t regionStart, uint64_t regionEnd, mafTcPinches_t *pinches);
 int64_t localSeqCoordsToGlobalPositiveCoords(int64_t c, uint64_t start, uint64_t sourceLength, char strand);
 int64_t localSeqCoordsToGlobalPositiveStartCoords(int64_t c, uint64_t start, uint64_t sourceLength,
                                                   char strand, uint64_t length);
 void mafBlock_sortBlockByIncreasingGap(mafBlock_t *mb);
-void walkBlockAddingSequence(mafBlock_t *mb, stHash *hash, stHash *nameHash);
-void reportSequenceHash(stHash *hash, stHash *nameHash);
+void walkBlockAddingSequence(mafBlock_t *mb, mafTcSeqTable_t *table);
+void reportSequenceTable(mafTcSeqTable_t *table);
 void destroyVizMatrix(int **mat, unsigned n);
 int cmp_by_gaps(const void *a, const void *b);
-uint64_t getMaxNameLength(stHash *hash);
-void getMaxFieldLengths(stHash *hash, stHash *nameHash, stPinchBlock *block, uint64_t *maxStart,
+uint64_t getMaxNameLength(mafTcSeqTable_t *table);
+void getMaxFieldLengths(mafTcSeqTable_t *table, stPinchBlock *block, uint64_t *maxStart,
                         uint64_t *maxLength, uint64_t *maxSource);
-char* getSequenceSubset(char *seq, int64_t start, char strand, int64_t length);
-void reportTransitiveClosure(stPinchThreadSet *threadSet, stHash *hash, stHash *nameHash);
+char* getSequenceSubset(mafTcSeq_t *mtcs, int64_t start, char strand, int64_t length);
+void copySequenceSubset(mafTcSeq_t *mtcs, int64_t start, char strand, int64_t length, char *out);
+uint64_t countDigits(uint64_t x);
+mafTcWriter_t* newMafTcWriter(bool compress);
+void mafTcWriter_flush(mafTcWriter_t *writer);
+void destroyMafTcWriter(mafTcWriter_t *writer);
+void reportTransitiveClosureHeader(mafTcWriter_t *writer);
+void reportTransitiveClosureBlocks(stPinchThreadSet *threadSet, mafTcSeqTable_t *table, mafTcWriter_t *writer);
+void reportTransitiveClosure(stPinchThreadSet *threadSet, mafTcSeqTable_t *table, mafTcWriter_t *writer);
 // debugging tools
 int** getVizMatrix(mafBlock_t *mb, unsigned n, unsigned m);
 void updateVizMatrix(int **mat, mafTcComparisonOrder_t *co);
@@ -23,9 +23,11 @@
  * THE SOFTWARE. 
  */
 #include <assert.h>
+#include <ctype.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "CuTest.h"
 #include "common.h"
 #include "sonLib.h"
@@ -222,6 +224,148 @@ static bool mafBlocksAreEqual(mafBlock_t *input, mafBlock_t *expected, bool verb
     }
     return true;
 }
+// the row by row comparison order and the gap walking coordinate lookup, replaced in
+// mafTransitiveClosure.c by getComparisonsFromMatrix() and mafTcBlockIndex_t and kept here as
+// the reference implementations that the tests check those against
+typedef struct mafCoordinatePair {
+    /* this struct is used to store pairs of coordinates
+    */
+    int64_t a;
+    int64_t b;
+} mafCoordinatePair_t;
+static mafTcRegion_t* getComparisonOrderFromRow(char **mat, uint64_t row, mafTcComparisonOrder_t **done, 
+                                                mafTcRegion_t *todo, int containsGaps) {
+    // proudce a comparison order given a sequence matrix (mat), a row index (row), a list of already
+    // completed regions (done) and a list of regions that still need to be done (todo)
+    mafTcRegion_t *newTodo = NULL, *newTodoTail = NULL;
+    mafTcRegion_t *headTodo = todo;
+    mafTcComparisonOrder_t *co = NULL;
+    bool inGap;
+    de_debug("getComparisonOrderFromRow(mat, %u, done, todo)\n", row);
+    while (todo != NULL) {
+        // walk the todo linked list and see if we can fill in any regions with the current row.
+        de_debug("starting to walk todo [%" PRIu64 ", %" PRIu64 "]\n", todo->start, todo->end);
+        inGap = false;
+        if (containsGaps == 0) {
+            // if this row does not contain gaps we can shortcut this by accepting all todo regions.
+            co = newMafTcComparisonOrder();
+            co->ref = row;
+            co->region = newMafTcRegion(todo->start, todo->end);
+            de_debug("creating new region for row:%" PRIu64 ", position %" PRIu64 "\n", row, todo->start);
+            // insert into the start of the list
+            if (done != NULL) {
+                co->next = *done;
+            }
+            *done = co;
+            co = NULL;
+            todo = todo->next;
+            continue;
+        }
+        for (uint64_t i = todo->start; i <= todo->end; ++i) {
+            // walk the current region.
+            de_debug("position %" PRIu64 "\n", i);
+            if (mat[row][i] == '-') {
+                // inside a gap region
+                de_debug("now inside a gap region\n");
+                if (!inGap) {
+                    de_debug("previously was not inGap\n");
+                    // transition from sequence into gap
+                    // no matter what we create a new todoRegion:
+                    inGap = true;
+                    if (newTodo == NULL) {
+                        de_debug("newTodo == NULL, creating newTodo & tail at %" PRIu64 "\n", i);
+                        newTodo = newMafTcRegion(i, i);
+                        newTodoTail = newTodo;
+                    } else {
+                        de_debug("newTodo != NULL, creating new newTodoTail at %" PRIu64 "\n", i);
+                        newTodoTail->next = newMafTcRegion(i, i);
+                        newTodoTail = newTodoTail->next;
+                    }
+                } else {
+                    de_debug("remaining inGap, extending gap end to %" PRIu64 "\n", i);
+                    // remain in gap
+                    de_debug("newTodoTail->start: %" PRIu64 ", ->end: %" PRIu64 "\n", 
+                             newTodoTail->start, newTodoTail->end);
+                    newTodoTail->end = i;
+                    de_debug("newTodoTail->start: %" PRIu64 ", ->end: %" PRIu64 "\n", 
+                             newTodoTail->start, newTodoTail->end);
+                }
+            } else {
+                de_debug("now inside a sequence region\n");
+                // inside a sequence region
+                if (inGap) {
+                    de_debug("previously was inGap\n");
+                    // transition from gap to sequence
+                    inGap = false;
+                    co = newMafTcComparisonOrder();
+                    co->ref = row;
+                    co->region = newMafTcRegion(i, i);
+                    de_debug("creating new region for row:%" PRIu64 ", position %" PRIu64 "\n", row, i);
+                    // insert into the start of the list
+                    if (done != NULL) {
+                        // de_debug("done != NULL, inserting this comparison into the start of the list.\n");
+                        co->next = *done;
+                    }
+                    *done = co;
+                } else {
+                    de_debug("remaining in sequence\n");
+                    // remain in sequence
+                    if (co != NULL) {
+                        de_debug("co != NULL, moving ref:%" PRIu64 " with "
+                                 "start %" PRIu64 ", end to %" PRIu64 "\n", co->ref, co->region->start, i);
+                        co->region->end = i;
+                    } else {
+                        de_debug("co == NULL, ref: %" PRIu64 ", must create new region at %" PRIu64 "\n", 
+                                 row, i);
+                        co = newMafTcComparisonOrder();
+                        co->ref = row;
+                        co->region = newMafTcRegion(i, i);
+                        // insert into the start of the `done' list
+                        if (done != NULL) {
+                            de_debug("done != NULL, inserting this comparison into head of list\n");
+                            co->next = *done;
+                        } else {
+                            de_debug("done == NULL, inserting a new comparison into head of list\n");
+                            done = (mafTcComparisonOrder_t **) de_malloc(sizeof(*done));
+                        }
+                        *done = co;
+                    }
+                }
+            }
+        }
+        co = NULL;
+        todo = todo->next;
+    }
+    destroyMafTcRegionList(headTodo);
+    return newTodo;
+}
+static int64_t localSeqCoords(uint64_t p, char *s, mafCoordinatePair_t *b, int containsGaps) {
+    // given a coordinate inside of a sequence with respect to the start (which is 0), 
+    // walk backwards and anytime you see a gap drop one from the coordinate to return
+    if (containsGaps == 0) {
+        // store bookmark
+        b->a = p;
+        b->b = p;
+        return b->b;
+    }
+    int64_t bases = 0;
+    for (int64_t i = p; i >= 0; --i) {
+        if (b->a == i) {
+            if (s[i] != '-' && b->b == -1) {
+                bases += 1;
+            }
+            b->a = p;
+            b->b += bases;
+            return b->b;
+        }
+        if (s[i] != '-') {
+            ++bases;
+        }
+    }
+    b->a = p;
+    b->b = bases;
+    return b->b;
+}
 static void test_reverseComplement(CuTest *testCase) {
     // test that the reverseComplement function works properly
     char *input = de_strdup("GGGGaaaaaaaatttatatat");
@@ -733,6 +877,59 @@ static void test_matrixAlignmentBlockComparisonOrdering_4(CuTest *testCase) {
     destroyMafTcComparisonOrder(expectedOrder);
     destroyMafTcComparisonOrder(obsOrder);
 }
+static void test_matrixAlignmentBlockComparisonOrdering_5(CuTest *testCase) {
+    // the flat comparison order agrees with the row by row one on random blocks wide enough
+    // to span several 64 column words, with runs of gaps that cross the word boundaries.
+    for (int test = 0; test < 200; ++test) {
+        uint64_t numRows = st_randomInt(1, 9);
+        uint64_t numCols = st_randomInt(1, 300);
+        char **input = (char**) de_malloc(sizeof(char*) * numRows);
+        uint64_t *lengths = de_malloc(sizeof(uint64_t) * numRows);
+        for (uint64_t r = 0; r < numRows; ++r) {
+            input[r] = (char*) de_malloc(numCols + 1);
+            int gapPercent = (test % 4 == 0) ? 0 : st_randomInt(0, 95);
+            bool inGap = false;
+            lengths[r] = 0;
+            for (uint64_t c = 0; c < numCols; ++c) {
+                if (st_randomInt(0, 100) < 30) {
+                    inGap = (st_randomInt(0, 100) < gapPercent);
+                }
+                input[r][c] = inGap ? '-' : 'A';
+                lengths[r] += !inGap;
+            }
+            input[r][numCols] = '\0';
+        }
+        mafTcRegion_t *todo = newMafTcRegion(0, numCols - 1);
+        mafTcComparisonOrder_t *expectedOrder = NULL;
+        for (uint64_t r = 0; todo != NULL && r < numRows; ++r) {
+            todo = getComparisonOrderFromRow(input, r, &expectedOrder, todo, (lengths[r] != numCols));
+        }
+        destroyMafTcRegionList(todo);
+        mafTcComparison_t *comparisons = NULL;
+        uint64_t n = getComparisonsFromMatrix(input, numRows, numCols, lengths, &comparisons);
+        mafTcComparisonOrder_t *eo = expectedOrder;
+        for (uint64_t i = n; i > 0; --i) {
+            CuAssertTrue(testCase, eo != NULL);
+            CuAssertTrue(testCase, eo->ref == comparisons[i - 1].ref);
+            CuAssertTrue(testCase, eo->region->start == comparisons[i - 1].start);
+            CuAssertTrue(testCase, eo->region->end == comparisons[i - 1].end);
+            eo = eo->next;
+        }
+        CuAssertTrue(testCase, eo == NULL);
+        // cleanup
+        for (uint64_t r = 0; r < numRows; ++r)
+            free(input[r]);
+        free(input);
+        free(lengths);
+        free(comparisons);
+        destroyMafTcComparisonOrder(expectedOrder);
+    }
+}
+static void checkMtcSeq(CuTest *testCase, mafTcSeq_t *mtcs, const char *expected) {
+    char *seq = getSequenceSubset(mtcs, 0, '+', mtcs->length);
+    CuAssertStrEquals(testCase, expected, seq);
+    free(seq);
+}
 static void test_addSequenceValuesToMtcSeq_0(CuTest *testCase) {
     mafLine_t *ml = maf_newMafLine();
     maf_mafLine_setType(ml, 's');
@@ -742,9 +939,9 @@ static void test_addSequenceValuesToMtcSeq_0(CuTest *testCase) {
     maf_mafLine_setSourceLength(ml, 20);
     maf_mafLine_setSequence(ml, de_strdup("ACGT----ACGTTT"));
     mafTcSeq_t *mtcs = newMafTcSeq(de_strdup("test.chr2"), maf_mafLine_getSourceLength(ml));
-    CuAssertTrue(testCase, strcmp(mtcs->sequence, "NNNNNNNNNNNNNNNNNNNN") == 0);
+    checkMtcSeq(testCase, mtcs, "NNNNNNNNNNNNNNNNNNNN");
     addSequenceValuesToMtcSeq(ml, mtcs);
-    CuAssertTrue(testCase, strcmp(mtcs->sequence, "NACGTACGTTTNNNNNNNNN") == 0);
+    checkMtcSeq(testCase, mtcs, "NACGTACGTTTNNNNNNNNN");
     maf_destroyMafLineList(ml);
     ml = maf_newMafLine();
     maf_mafLine_setType(ml, 's');
@@ -754,7 +951,7 @@ static void test_addSequenceValuesToMtcSeq_0(CuTest *testCase) {
     maf_mafLine_setSourceLength(ml, 20);
     maf_mafLine_setSequence(ml, de_strdup("AATT------G"));
     addSequenceValuesToMtcSeq(ml, mtcs);
-    CuAssertTrue(testCase, strcmp(mtcs->sequence, "NACGTACGTTTNNNCAATTN") == 0);
+    checkMtcSeq(testCase, mtcs, "NACGTACGTTTNNNCAATTN");
     maf_destroyMafLineList(ml);
     ml = maf_newMafLine();
     maf_mafLine_setType(ml, 's');
@@ -764,7 +961,7 @@ static void test_addSequenceValuesToMtcSeq_0(CuTest *testCase) {
     maf_mafLine_setSourceLength(ml, 20);
     maf_mafLine_setSequence(ml, de_strdup("--T----G-G-G-C-"));
     addSequenceValuesToMtcSeq(ml, mtcs);
-    CuAssertTrue(testCase, strcmp(mtcs->sequence, "NACGTACGTTTGGGCAATTN") == 0);
+    checkMtcSeq(testCase, mtcs, "NACGTACGTTTGGGCAATTN");
     maf_destroyMafLineList(ml);
     ml = maf_newMafLine();
     maf_mafLine_setType(ml, 's');
@@ -774,7 +971,7 @@ static void test_addSequenceValuesToMtcSeq_0(CuTest *testCase) {
     maf_mafLine_setSourceLength(ml, 20);
     maf_mafLine_setSequence(ml, de_strdup("AACGTACGTTTGGGCAATTG"));
     addSequenceValuesToMtcSeq(ml, mtcs);
-    CuAssertTrue(testCase, strcmp(mtcs->sequence, "AACGTACGTTTGGGCAATTG") == 0);
+    checkMtcSeq(testCase, mtcs, "AACGTACGTTTGGGCAATTG");
     maf_destroyMafLineList(ml);
     ml = maf_newMafLine();
     maf_mafLine_setType(ml, 's');
@@ -784,10 +981,226 @@ static void test_addSequenceValuesToMtcSeq_0(CuTest *testCase) {
     maf_mafLine_setSourceLength(ml, 20);
     maf_mafLine_setSequence(ml, de_strdup("---CAATTGCCC---AAACGTAC----GTT"));
     addSequenceValuesToMtcSeq(ml, mtcs);
-    CuAssertTrue(testCase, strcmp(mtcs->sequence, "AACGTACGTTTGGGCAATTG") == 0);
+    checkMtcSeq(testCase, mtcs, "AACGTACGTTTGGGCAATTG");
     maf_destroyMafLineList(ml);
     destroyMafTcSeq(mtcs);
 }
+static void test_addSequenceValuesToMtcSeq_1(CuTest *testCase) {
+    // random pieces of a sequence holding Ns and IUPAC codes, on either strand and spanning
+    // many packed words, should build up the same sequence as a plain character array.
+    const uint64_t sourceLength = 1000;
+    const char *alphabet = "ACGTacgtNRYKM";
+    char *source = de_malloc(sourceLength + 1);
+    char *expected = de_malloc(sourceLength + 1);
+    for (uint64_t i = 0; i < sourceLength; ++i) {
+        source[i] = alphabet[st_randomInt(0, (i % 100 < 90) ? 8 : 13)];
+        expected[i] = 'N';
+    }
+    source[sourceLength] = '\0';
+    expected[sourceLength] = '\0';
+    mafTcSeq_t *mtcs = newMafTcSeq(de_strdup("test.chr3"), sourceLength);
+    for (int t = 0; t < 200; ++t) {
+        uint64_t start = st_randomInt(0, sourceLength);
+        uint64_t length = st_randomInt(0, sourceLength - start + 1);
+        char *field = de_malloc(2 * length + 1);
+        uint64_t n = 0;
+        for (uint64_t i = 0; i < length; ++i) {
+            if (st_random() < 0.2) {
+                field[n++] = '-';
+            }
+            field[n++] = source[start + i];
+            if (toupper(source[start + i]) != 'N') {
+                expected[start + i] = toupper(source[start + i]);
+            }
+        }
+        field[n] = '\0';
+        mafLine_t *ml = maf_newMafLine();
+        maf_mafLine_setType(ml, 's');
+        maf_mafLine_setLength(ml, length);
+        maf_mafLine_setSourceLength(ml, sourceLength);
+        if (st_random() < 0.5) {
+            maf_mafLine_setStrand(ml, '+');
+            maf_mafLine_setStart(ml, start);
+        } else {
+            reverseComplementSequence(field, n);
+            maf_mafLine_setStrand(ml, '-');
+            maf_mafLine_setStart(ml, sourceLength - start - length);
+        }
+        maf_mafLine_setSequence(ml, field);
+        addSequenceValuesToMtcSeq(ml, mtcs);
+        maf_destroyMafLineList(ml);
+        checkMtcSeq(testCase, mtcs, expected);
+    }
+    char *sub = getSequenceSubset(mtcs, 100, '-', 50);
+    char *rc = de_strndup(expected + 100, 50);
+    reverseComplementSequence(rc, 50);
+    CuAssertStrEquals(testCase, rc, sub);
+    free(sub);
+    free(rc);
+    free(source);
+    free(expected);
+    destroyMafTcSeq(mtcs);
+}
+static void test_mafTcSeqTable_0(CuTest *testCase) {
+    // names are interned as dense ids in the order they are added
+    mafTcSeqTable_t *table = newMafTcSeqTable();
+    char name[32];
+    for (uint64_t i = 0; i < 1000; ++i) {
+        sprintf(name, "species%" PRIu64 ".chr%" PRIu64, i % 7, i);
+        CuAssertTrue(testCase, mafTcSeqTable_getSeq(table, name) == NULL);
+        mafTcSeq_t *mtcs = mafTcSeqTable_addSeq(table, name, i + 1);
+        CuAssertTrue(testCase, mtcs->id == i);
+        CuAssertTrue(testCase, mtcs->thread == NULL);
+    }
+    CuAssertTrue(testCase, table->numSeqs == 1000);
+    CuAssertTrue(testCase, getMaxNameLength(table) == strlen("species0.chr100") + 2);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        sprintf(name, "species%" PRIu64 ".chr%" PRIu64, i % 7, i);
+        mafTcSeq_t *mtcs = mafTcSeqTable_getSeq(table, name);
+        CuAssertTrue(testCase, mtcs == table->seqs[i]);
+        CuAssertStrEquals(testCase, name, mtcs->name);
+        CuAssertTrue(testCase, mtcs->length == i + 1);
+    }
+    destroyMafTcSeqTable(table);
+}
+static void test_walkBlockGettingPinches_0(CuTest *testCase) {
+    // the pinches of a block are recorded, in order, rather than applied
+    mafBlock_t *mb = maf_newMafBlock();
+    maf_mafBlock_setHeadLine(mb, maf_newMafLineFromString("a score=0.0", 1));
+    mafLine_t *ml = maf_mafBlock_getHeadLine(mb);
+    maf_mafLine_setNext(ml, maf_newMafLineFromString("s a.1 0 6 + 10 ACGTAC", 2));
+    ml = maf_mafLine_getNext(ml);
+    maf_mafLine_setNext(ml, maf_newMafLineFromString("s b.1 2 5 - 10 AC-TAC", 3));
+    ml = maf_mafLine_getNext(ml);
+    maf_mafBlock_setTailLine(mb, ml);
+    maf_mafBlock_setNumberOfLines(mb, 3);
+    maf_mafBlock_setNumberOfSequences(mb, 2);
+    maf_mafBlock_setSequenceFieldLength(mb, 6);
+    stPinchThreadSet *threadSet = stPinchThreadSet_construct();
+    stPinchThread *threads[2];
+    threads[0] = stPinchThreadSet_addThread(threadSet, 0, 0, 10);
+    threads[1] = stPinchThreadSet_addThread(threadSet, 1, 0, 10);
+    mafTcPinches_t *pinches = newMafTcPinches();
+    walkBlockGettingPinches(mb, threads, pinches);
+    CuAssertTrue(testCase, pinches->numPinches == 2);
+    mafTcPinch_t *p = &(pinches->pinches[0]);
+    CuAssertTrue(testCase, p->a == threads[0] && p->b == threads[1]);
+    CuAssertTrue(testCase, p->aStart == 0 && p->bStart == 6 && p->length == 2 && !p->strand);
+    p = &(pinches->pinches[1]);
+    CuAssertTrue(testCase, p->a == threads[0] && p->b == threads[1]);
+    CuAssertTrue(testCase, p->aStart == 3 && p->bStart == 3 && p->length == 3 && !p->strand);
+    applyPinches(pinches);
+    CuAssertTrue(testCase, pinches->numPinches == 0);
+    destroyMafTcPinches(pinches);
+    stPinchThreadSet_destruct(threadSet);
+    maf_destroyMafBlockList(mb);
+}
+static void test_checkpoint_0(CuTest *testCase) {
+    // a saved and reloaded checkpoint has the same sequences and the same blocks
+    const char *checkpoint = "test.mafTransitiveClosure.checkpoint";
+    mafBlock_t *mb = maf_newMafBlock();
+    maf_mafBlock_setHeadLine(mb, maf_newMafLineFromString("a score=0.0", 1));
+    mafLine_t *ml = maf_mafBlock_getHeadLine(mb);
+    maf_mafLine_setNext(ml, maf_newMafLineFromString("s a.1 0 6 + 10 ACRTAC", 2));
+    ml = maf_mafLine_getNext(ml);
+    maf_mafLine_setNext(ml, maf_newMafLineFromString("s b.1 2 5 - 10 AC-TAC", 3));
+    ml = maf_mafLine_getNext(ml);
+    maf_mafBlock_setTailLine(mb, ml);
+    maf_mafBlock_setNumberOfLines(mb, 3);
+    maf_mafBlock_setNumberOfSequences(mb, 2);
+    maf_mafBlock_setSequenceFieldLength(mb, 6);
+    mafTcSeqTable_t *table = newMafTcSeqTable();
+    mafTcSeqTable_addSeq(table, "unaligned", 4);
+    stPinchThreadSet *threadSet = stPinchThreadSet_construct();
+    walkBlockAddingAlignments(mb, threadSet, table);
+    walkBlockAddingSequence(mb, table);
+    stPinchThreadSet_joinTrivialBoundaries(threadSet);
+    saveCheckpoint((char *) checkpoint, threadSet, table);
+    mafTcSeqTable_t *loadedTable = newMafTcSeqTable();
+    stPinchThreadSet *loadedThreadSet = stPinchThreadSet_construct();
+    loadCheckpoint((char *) checkpoint, loadedThreadSet, loadedTable);
+    stPinchThreadSet_joinTrivialBoundaries(loadedThreadSet);
+    CuAssertTrue(testCase, loadedTable->numSeqs == 3);
+    for (uint64_t i = 0; i < table->numSeqs; ++i) {
+        CuAssertStrEquals(testCase, table->seqs[i]->name, loadedTable->seqs[i]->name);
+        CuAssertTrue(testCase, loadedTable->seqs[i]->id == i);
+        CuAssertTrue(testCase, (table->seqs[i]->thread == NULL) == (loadedTable->seqs[i]->thread == NULL));
+        char *expected = getSequenceSubset(table->seqs[i], 0, '+', table->seqs[i]->length);
+        checkMtcSeq(testCase, loadedTable->seqs[i], expected);
+        free(expected);
+    }
+    CuAssertTrue(testCase, loadedTable->maxNameLength == table->maxNameLength);
+    uint64_t numSegments[2] = {0, 0}, numColumns[2] = {0, 0};
+    stPinchThreadSet *threadSets[2] = {threadSet, loadedThreadSet};
+    for (int i = 0; i < 2; ++i) {
+        stPinchThreadSetBlockIt bit = stPinchThreadSet_getBlockIt(threadSets[i]);
+        stPinchBlock *block = NULL;
+        while ((block = stPinchThreadSetBlockIt_getNext(&bit)) != NULL) {
+            stPinchBlockIt sit = stPinchBlock_getSegmentIterator(block);
+            stPinchSegment *seg = stPinchBlockIt_getNext(&sit);
+            numSegments[i] += stPinchBlock_getDegree(block);
+            numColumns[i] += stPinchBlock_getDegree(block) * stPinchSegment_getLength(seg);
+        }
+    }
+    CuAssertTrue(testCase, numSegments[0] == 4 && numSegments[1] == 4);
+    CuAssertTrue(testCase, numColumns[0] == 10 && numColumns[1] == 10);
+    // cleanup
+    remove(checkpoint);
+    destroyMafTcSeqTable(table);
+    destroyMafTcSeqTable(loadedTable);
+    stPinchThreadSet_destruct(threadSet);
+    stPinchThreadSet_destruct(loadedThreadSet);
+    maf_destroyMafBlockList(mb);
+}
+static void test_partitionMaf_0(CuTest *testCase) {
+    // blocks are bucketed by the connected component of their sequences, in file order
+    const char *filename = "test.mafTransitiveClosure.partition.maf";
+    FILE *ofp = de_fopen(filename, "w");
+    fprintf(ofp, "##maf version=1\n\n"
+            "a score=0\ns a.1 0 4 + 10 ACGT\ns b.1 0 4 + 10 ACGT\n\n"
+            "a score=1\ns c.1 0 2 + 10 AC\ns d.1 0 2 - 10 AC\n\n"
+            "a score=2\ns e.1 2 3 + 10 GTA\ns b.1 2 3 + 10 GTA\n\n"
+            "a score=3\ns f.1 0 2 + 10 TT\n\n"
+            "a score=4\ns d.1 5 2 + 10 GG\ns c.1 5 2 + 10 GG\n\n");
+    fclose(ofp);
+    mafFileApi_t *mfa = maf_newMfa(filename, "r");
+    mafPartition_t *partition = partitionMaf(mfa, ".");
+    maf_destroyMfa(mfa);
+    remove(filename);
+    CuAssertTrue(testCase, mafPartition_getNumberOfBlocks(partition) == 5);
+    CuAssertTrue(testCase, mafPartition_getNumberOfParts(partition) == 3);
+    uint64_t expectedStarts[] = {0, 2, 4, 5};
+    uint64_t expectedBlocks[] = {0, 2, 1, 4, 3};
+    for (uint64_t c = 0; c < mafPartition_getNumberOfParts(partition); ++c) {
+        uint64_t n = mafPartition_getNumberOfPartBlocks(partition, c);
+        CuAssertTrue(testCase, n == expectedStarts[c + 1] - expectedStarts[c]);
+        for (uint64_t i = 0; i < n; ++i) {
+            CuAssertTrue(testCase, mafPartition_getBlockIndex(partition, c, i) == expectedBlocks[expectedStarts[c] + i]);
+        }
+    }
+    const char *expectedNames[] = {"a.1", "b.1", "e.1"};
+    mafTcSeqTable_t *table = newMafTcSeqTable();
+    stPinchThreadSet *threadSet = stPinchThreadSet_construct();
+    buildPartitionComponent(partition, 0, threadSet, table);
+    CuAssertTrue(testCase, table->numSeqs == 3);
+    for (uint64_t i = 0; i < table->numSeqs; ++i) {
+        CuAssertStrEquals(testCase, expectedNames[i], table->seqs[i]->name);
+    }
+    checkMtcSeq(testCase, table->seqs[1], "ACGTANNNNN");
+    // cleanup
+    destroyMafTcSeqTable(table);
+    stPinchThreadSet_destruct(threadSet);
+    mafPartition_destroy(partition);
+}
+static void test_countDigits_0(CuTest *testCase) {
+    uint64_t x = 1;
+    CuAssertTrue(testCase, countDigits(0) == 1);
+    for (uint64_t n = 1; n < 20; ++n, x *= 10) {
+        CuAssertTrue(testCase, countDigits(x) == n);
+        CuAssertTrue(testCase, countDigits(x * 10 - 1) == n);
+    }
+    CuAssertTrue(testCase, countDigits(UINT64_MAX) == 20);
+}
 static void test_localSeqCoords_0(CuTest *testCase) {
     mafCoordinatePair_t mcp;
     mcp.a = 0;
@@ -873,6 +1286,37 @@ static void test_localSeqCoords_0(CuTest *testCase) {
     CuAssertTrue(testCase, mcp.b == 15);
     free(s);
 }
+static void test_mafTcBlockIndex_0(CuTest *testCase) {
+    // the index gives the same local sequence coordinates as counting the bases by hand
+    for (int test = 0; test < 100; ++test) {
+        uint64_t numRows = st_randomInt(1, 6);
+        uint64_t numCols = st_randomInt(1, 300);
+        char **input = (char**) de_malloc(sizeof(char*) * numRows);
+        uint64_t *lengths = de_malloc(sizeof(uint64_t) * numRows);
+        for (uint64_t r = 0; r < numRows; ++r) {
+            input[r] = (char*) de_malloc(numCols + 1);
+            int gapPercent = (test % 4 == 0) ? 0 : st_randomInt(0, 95);
+            lengths[r] = 0;
+            for (uint64_t c = 0; c < numCols; ++c) {
+                input[r][c] = (st_randomInt(0, 100) < gapPercent) ? '-' : 'A';
+                lengths[r] += (input[r][c] != '-');
+            }
+            input[r][numCols] = '\0';
+        }
+        mafTcBlockIndex_t *index = newMafTcBlockIndex(input, numRows, numCols, lengths);
+        for (uint64_t r = 0; r < numRows; ++r) {
+            uint64_t bases = 0;
+            for (uint64_t c = 0; c < numCols; ++c) {
+                CuAssertTrue(testCase, mafTcBlockIndex_getPosition(index, r, c) == bases);
+                bases += (input[r][c] != '-');
+            }
+            free(input[r]);
+        }
+        destroyMafTcBlockIndex(index);
+        free(input);
+        free(lengths);
+    }
+}
 static void test_localSeqCoordsToGlobalPositiveCoords_0(CuTest *testCase) {
     // int64_t localSeqCoordsToGlobalPositiveCoords(localPosition, startField, sourceLength, strand);
     CuAssertTrue(testCase, localSeqCoordsToGlobalPositiveCoords(3, 0, 20, '+') == 3);
@@ -1068,8 +1512,16 @@ CuSuite* mafTransitiveClosure_TestSuite(void) {
     SUITE_ADD_TEST(suite, test_matrixAlignmentBlockComparisonOrdering_2);
     SUITE_ADD_TEST(suite, test_matrixAlignmentBlockComparisonOrdering_3);
     SUITE_ADD_TEST(suite, test_matrixAlignmentBlockComparisonOrdering_4);
+    SUITE_ADD_TEST(suite, test_matrixAlignmentBlockComparisonOrdering_5);
     SUITE_ADD_TEST(suite, test_addSequenceValuesToMtcSeq_0);
+    SUITE_ADD_TEST(suite, test_addSequenceValuesToMtcSeq_1);
+    SUITE_ADD_TEST(suite, test_mafTcSeqTable_0);
+    SUITE_ADD_TEST(suite, test_walkBlockGettingPinches_0);
+    SUITE_ADD_TEST(suite, test_checkpoint_0);
+    SUITE_ADD_TEST(suite, test_partitionMaf_0);
+    SUITE_ADD_TEST(suite, test_countDigits_0);
     SUITE_ADD_TEST(suite, test_localSeqCoords_0);
+    SUITE_ADD_TEST(suite, test_mafTcBlockIndex_0);
     SUITE_ADD_TEST(suite, test_localSeqCoordsToGlobalPositiveCoords_0);
     SUITE_ADD_TEST(suite, test_localSeqCoordsToGlobalPositiveStartCoords_0);
     SUITE_ADD_TEST(suite, test_coordinateTransforms_0);
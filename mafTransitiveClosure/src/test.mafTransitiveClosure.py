@@ -22,8 +22,11 @@
 # OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 # THE SOFTWARE.
 ##################################################
+import gzip
 import os
 import random
+import struct
+import subprocess
 import sys
 import unittest
 sys.path.append(
@@ -178,6 +181,128 @@ s rn3.chr4       0 10 - 20 CCGGCGGTTG
             passed = mafIsClosed(os.path.join(tmpDir, 'transitiveClosure.maf'), outList)
             self.assertTrue(passed)
         mtt.removeDir(tmpDir)
+    def testKnownInOut_3(self):
+        """ mafTransitiveClosure should compute the same transitive closure when the pinches are worked out on several threads.
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('knownInOut_3'))
+        for inMaf, outList in self.knownResults:
+            testMaf = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'test.maf')),
+                                   inMaf, g_headers)
+            parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafTransitiveClosure')),
+                   '--maf', os.path.abspath(os.path.join(tmpDir, 'test.maf')), '--threads', '3']
+            outpipes = [os.path.abspath(os.path.join(tmpDir, 'transitiveClosure.maf'))]
+            mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+            mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+            passed = mafIsClosed(os.path.join(tmpDir, 'transitiveClosure.maf'), outList)
+            self.assertTrue(passed)
+        mtt.removeDir(tmpDir)
+    def testKnownInOut_4(self):
+        """ mafTransitiveClosure should compute the same transitive closure when the first blocks are added by an earlier run and loaded from its checkpoint.
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('knownInOut_4'))
+        for inMaf, outList in self.knownResults:
+            blocks = [b for b in inMaf.split('\n\n') if b.strip() != '']
+            half = len(blocks) // 2
+            testMaf = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'test1.maf')),
+                                   '\n\n'.join(blocks[:half]) + '\n\n', g_headers)
+            testMaf = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'test2.maf')),
+                                   '\n\n'.join(blocks[half:]) + '\n\n', g_headers)
+            parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+            checkpoint = os.path.abspath(os.path.join(tmpDir, 'test1.checkpoint'))
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafTransitiveClosure')),
+                   '--maf', os.path.abspath(os.path.join(tmpDir, 'test1.maf')),
+                   '--saveCheckpoint', checkpoint]
+            outpipes = [os.path.abspath(os.path.join(tmpDir, 'transitiveClosure1.maf'))]
+            mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+            mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafTransitiveClosure')),
+                   '--maf', os.path.abspath(os.path.join(tmpDir, 'test2.maf')),
+                   '--loadCheckpoint', checkpoint]
+            outpipes = [os.path.abspath(os.path.join(tmpDir, 'transitiveClosure.maf'))]
+            mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+            mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+            passed = mafIsClosed(os.path.join(tmpDir, 'transitiveClosure.maf'), outList)
+            self.assertTrue(passed)
+        mtt.removeDir(tmpDir)
+    def testKnownInOut_5(self):
+        """ mafTransitiveClosure should compute the same transitive closure when each connected component is built on its own.
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('knownInOut_5'))
+        for inMaf, outList in self.knownResults:
+            testMaf = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'test.maf')),
+                                   inMaf, g_headers)
+            parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafTransitiveClosure')),
+                   '--maf', os.path.abspath(os.path.join(tmpDir, 'test.maf')), '--partition',
+                   '--threads', '2', '--tempDir', tmpDir]
+            outpipes = [os.path.abspath(os.path.join(tmpDir, 'transitiveClosure.maf'))]
+            mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+            mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+            passed = mafIsClosed(os.path.join(tmpDir, 'transitiveClosure.maf'), outList)
+            self.assertTrue(passed)
+        mtt.removeDir(tmpDir)
+    def testKnownInOut_6(self):
+        """ mafTransitiveClosure should write the same transitive closure, gzip compressed, with --compress.
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('knownInOut_6'))
+        for inMaf, outList in self.knownResults:
+            testMaf = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'test.maf')),
+                                   inMaf, g_headers)
+            parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafTransitiveClosure')),
+                   '--maf', os.path.abspath(os.path.join(tmpDir, 'test.maf')), '--compress']
+            outpipes = [os.path.abspath(os.path.join(tmpDir, 'transitiveClosure.maf.gz'))]
+            mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+            mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+            f = gzip.open(os.path.join(tmpDir, 'transitiveClosure.maf.gz'))
+            g = open(os.path.join(tmpDir, 'transitiveClosure.maf'), 'w')
+            g.write(f.read())
+            f.close()
+            g.close()
+            passed = mafIsClosed(os.path.join(tmpDir, 'transitiveClosure.maf'), outList)
+            self.assertTrue(passed)
+        mtt.removeDir(tmpDir)
+    def testBadCheckpoint_1(self):
+        """ mafTransitiveClosure should refuse a damaged checkpoint, without trying to allocate what its counts claim.
+        """
+        mtt.makeTempDirParent()
+        tmpDir = os.path.abspath(mtt.makeTempDir('badCheckpoint_1'))
+        inMaf, outList = self.knownResults[0]
+        testMaf = mtt.testFile(os.path.abspath(os.path.join(tmpDir, 'test.maf')),
+                               inMaf, g_headers)
+        parent = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        checkpoint = os.path.abspath(os.path.join(tmpDir, 'test.checkpoint'))
+        cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafTransitiveClosure')),
+               '--maf', os.path.abspath(os.path.join(tmpDir, 'test.maf')),
+               '--saveCheckpoint', checkpoint]
+        outpipes = [os.path.abspath(os.path.join(tmpDir, 'transitiveClosure.maf'))]
+        mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+        mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes)
+        f = open(checkpoint, 'rb')
+        saved = f.read()
+        f.close()
+        # the magic string and the number of sequences come before the first name length
+        huge = struct.pack('=Q', 1 << 60)
+        for damaged in [saved[:16] + huge + saved[24:], saved[:len(saved) // 2]]:
+            f = open(checkpoint, 'wb')
+            f.write(damaged)
+            f.close()
+            cmd = [os.path.abspath(os.path.join(parent, 'test', 'mafTransitiveClosure')),
+                   '--maf', os.path.abspath(os.path.join(tmpDir, 'test.maf')),
+                   '--loadCheckpoint', checkpoint]
+            mtt.recordCommands([cmd], tmpDir, outPipes=outpipes)
+            passed = False
+            try:
+                mtt.runCommandsS([cmd], tmpDir, outPipes=outpipes, errPipes=[subprocess.PIPE])
+            except RuntimeError as e:
+                passed = 'retcode:1' in str(e)
+            self.assertTrue(passed)
+        mtt.removeDir(tmpDir)
     def testMemory_1(self):
         """ mafTransitiveClosure should be memory clean.
         """